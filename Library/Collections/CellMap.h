@@ -34,6 +34,7 @@
 #include "Engine/Streams.h"
 #include "Engine/EngineBase.h"
 #include "Thread/WriteLocker.h"
+#include "Olap/ContextArena.h"
 
 using namespace palo;
 
@@ -176,7 +177,7 @@ public:
 	};
 
 	virtual PProcessorBase getValues() {
-		return PProcessorBase(new Reader(*this));
+		return ContextArena::create<Reader>(*this);
 	}
 private:
 	size_t _dims;
@@ -377,7 +378,7 @@ public:
 	};
 
 	virtual PProcessorBase getValues() {
-		return PProcessorBase(new Reader(*this));
+		return ContextArena::create<Reader>(*this);
 	}
 private:
 	IdentifiersType startPath;
@@ -395,6 +396,308 @@ private:
 	}
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief sorted cell map stored in leaves of LEAF_SIZE cells
+///
+/// Keys are kept inline in the leaves, one allocation serves LEAF_SIZE cells
+/// instead of one tree node per cell. Leaves are grouped into branches of at
+/// most BRANCH_SIZE leaves, so splitting a leaf or a branch moves a bounded
+/// number of pointers also for random bulk loads. A leaf is found by binary
+/// search over the first keys of the branches and then of their leaves.
+/// Appending in key order fills the leaves and branches completely.
+////////////////////////////////////////////////////////////////////////////////
+
+template<int _N, typename ValueType>
+class CellLeafMap : public ICellMap<ValueType> {
+public:
+	typedef IdsNType<_N> KeyType;
+
+	CellLeafMap() : count(0), maxCount(0), limited(false) {}
+	virtual ~CellLeafMap() {
+		for (typename vector<Branch *>::iterator bit = branches.begin(); bit != branches.end(); ++bit) {
+			for (typename vector<Leaf *>::iterator it = (*bit)->leaves.begin(); it != (*bit)->leaves.end(); ++it) {
+				delete *it;
+			}
+			delete *bit;
+		}
+	}
+	virtual bool set(const IdentifiersType &path, const ValueType &value) {
+		return insert(&path[0], value, false);
+	}
+	virtual bool set(const IdentifierType *path, const ValueType &value) {
+		return insert(path, value, false);
+	}
+	virtual bool add(const IdentifiersType &path, const ValueType &value) {
+		return insert(&path[0], value, true);
+	}
+	virtual bool add(const IdentifierType *path, const ValueType &value) {
+		return insert(path, value, true);
+	}
+	virtual bool get(const IdentifiersType &path, ValueType &value) const {
+		return get(&path[0], value);
+	}
+	virtual bool get(const IdentifierType *path, ValueType &value) const {
+		if (branches.empty()) {
+			return false;
+		}
+		const Branch *branch = branches[findKey(branchKeys, path)];
+		const Leaf *leaf = branch->leaves[findKey(branch->firstKeys, path)];
+		size_t pos = lowerBound(leaf, path);
+		if (pos < leaf->count && !compareKey(leaf->keys[pos], path)) {
+			value = leaf->values[pos];
+			return true;
+		}
+		return false;
+	}
+	virtual size_t size() const {
+		return count;
+	}
+	virtual void setLimit(const IdentifiersType &startPath, uint64_t maxCount) {
+		this->startPath = startPath;
+		this->maxCount = maxCount;
+	}
+
+	class Reader : public ProcessorBase {
+	public:
+		Reader(CellLeafMap &clm) : ProcessorBase(true, PEngineBase()), started(false), pclm(clm.shared_from_this()), clm(clm), branch(0), leaf(0), pos(0), vkey(_N) {}
+		virtual ~Reader() {}
+		virtual bool next() {
+			while (branch < clm.branches.size()) {
+				const vector<Leaf *> &leaves = clm.branches[branch]->leaves;
+				while (leaf < leaves.size() && pos >= leaves[leaf]->count) {
+					leaf++;
+					pos = 0;
+				}
+				if (leaf < leaves.size()) {
+					const Leaf *l = leaves[leaf];
+					memcpy(&vkey[0], (const IdentifierType *)l->keys[pos], sizeof(KeyType));
+					val = l->values[pos];
+					started = true;
+					++pos;
+					return true;
+				}
+				branch++;
+				leaf = 0;
+				pos = 0;
+			}
+			return false;
+		}
+		virtual const CellValue &getValue() {
+			cellval = val;
+			if (cellval.isEmpty()) {
+				cellval.setEmpty(false);
+			}
+			return cellval;
+		}
+		virtual double getDouble() {
+			return double(val);
+		}
+		virtual const IdentifiersType &getKey() const {
+			if (!started) {
+				return EMPTY_KEY;
+			}
+			return vkey;
+		}
+		virtual void reset() {
+			started = false;
+			branch = 0;
+			leaf = 0;
+			pos = 0;
+		}
+		virtual bool move(const IdentifiersType &key, bool *found) {
+			if (clm.branches.empty()) {
+				branch = 0;
+			} else {
+				branch = findKey(clm.branchKeys, &key[0]);
+				const Branch *b = clm.branches[branch];
+				leaf = findKey(b->firstKeys, &key[0]);
+				pos = clm.lowerBound(b->leaves[leaf], &key[0]);
+			}
+			bool ret = next();
+			if (found) {
+				*found = ret && !memcmp(&vkey[0], &key[0], sizeof(KeyType));
+			}
+			return ret;
+		}
+	private:
+		bool started;
+		boost::shared_ptr<CellMapBase> pclm;
+		CellLeafMap<_N, ValueType> &clm;
+		size_t branch;
+		size_t leaf;
+		size_t pos;
+		IdentifiersType vkey;
+		ValueType val;
+		CellValue cellval;
+	};
+
+	virtual PProcessorBase getValues() {
+		return ContextArena::create<Reader>(*this);
+	}
+private:
+	static const size_t LEAF_SIZE = 128;
+	static const size_t BRANCH_SIZE = 256;
+	struct Leaf {
+		Leaf() : count(0) {}
+		size_t count;
+		KeyType keys[LEAF_SIZE];
+		ValueType values[LEAF_SIZE];
+	};
+	struct Branch {
+		vector<Leaf *> leaves;
+		vector<KeyType> firstKeys;
+	};
+
+	static int compareKey(const IdentifierType *key1, const IdentifierType *key2) {
+		for (int dim = 0; dim < _N; dim++) {
+			if (key1[dim] < key2[dim]) {
+				return -1;
+			} else if (key1[dim] > key2[dim]) {
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	// last entry starting at or before path
+	static size_t findKey(const vector<KeyType> &firstKeys, const IdentifierType *path) {
+		size_t lo = 0, hi = firstKeys.size();
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (compareKey(firstKeys[mid], path) <= 0) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo ? lo - 1 : 0;
+	}
+
+	static size_t lowerBound(const Leaf *leaf, const IdentifierType *path) {
+		size_t lo = 0, hi = leaf->count;
+		// sorted appends hit the end of the leaf
+		if (hi && compareKey(leaf->keys[hi - 1], path) < 0) {
+			return hi;
+		}
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (compareKey(leaf->keys[mid], path) < 0) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	bool insert(const IdentifierType *path, const ValueType &value, bool add) {
+		if (limited && compareKey(lastKey, path) < 0) {
+			return false;
+		}
+		if (branches.empty()) {
+			Branch *branch = new Branch();
+			branch->leaves.push_back(new Leaf());
+			branch->firstKeys.push_back(KeyType(path));
+			branches.push_back(branch);
+			branchKeys.push_back(KeyType(path));
+		}
+		size_t bi = findKey(branchKeys, path);
+		Branch *branch = branches[bi];
+		size_t li = findKey(branch->firstKeys, path);
+		Leaf *leaf = branch->leaves[li];
+		size_t pos = lowerBound(leaf, path);
+		if (pos < leaf->count && !compareKey(leaf->keys[pos], path)) {
+			if (add) {
+				leaf->values[pos] += value;
+			} else {
+				leaf->values[pos] = value;
+			}
+			return false;
+		}
+		if (leaf->count == LEAF_SIZE) {
+			// appending to the last leaf starts a new one, otherwise the leaf is halved
+			bool append = bi + 1 == branches.size() && li + 1 == branch->leaves.size() && pos == LEAF_SIZE;
+			size_t from = append ? LEAF_SIZE : LEAF_SIZE / 2;
+			Leaf *right = new Leaf();
+			std::copy(leaf->keys + from, leaf->keys + LEAF_SIZE, right->keys);
+			std::copy(leaf->values + from, leaf->values + LEAF_SIZE, right->values);
+			right->count = LEAF_SIZE - from;
+			leaf->count = from;
+			branch->leaves.insert(branch->leaves.begin() + li + 1, right);
+			branch->firstKeys.insert(branch->firstKeys.begin() + li + 1, right->count ? right->keys[0] : KeyType(path));
+			if (pos >= from) {
+				leaf = right;
+				pos -= from;
+				li++;
+			}
+			if (branch->leaves.size() > BRANCH_SIZE) {
+				// the same for branches, only the new leaf moves when appending
+				size_t fromLeaf = append ? branch->leaves.size() - 1 : branch->leaves.size() / 2;
+				Branch *rightBranch = new Branch();
+				rightBranch->leaves.assign(branch->leaves.begin() + fromLeaf, branch->leaves.end());
+				rightBranch->firstKeys.assign(branch->firstKeys.begin() + fromLeaf, branch->firstKeys.end());
+				branch->leaves.resize(fromLeaf);
+				branch->firstKeys.resize(fromLeaf);
+				branches.insert(branches.begin() + bi + 1, rightBranch);
+				branchKeys.insert(branchKeys.begin() + bi + 1, rightBranch->firstKeys[0]);
+				if (li >= fromLeaf) {
+					branch = rightBranch;
+					li -= fromLeaf;
+					bi++;
+				}
+			}
+		}
+		std::copy_backward(leaf->keys + pos, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+		std::copy_backward(leaf->values + pos, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+		leaf->keys[pos] = KeyType(path);
+		leaf->values[pos] = value;
+		leaf->count++;
+		if (!pos) {
+			branch->firstKeys[li] = leaf->keys[0];
+			if (!li) {
+				branchKeys[bi] = leaf->keys[0];
+			}
+		}
+		++count;
+		if (maxCount && count > maxCount) {
+			// delete last value and remember new last key
+			eraseLast();
+			return false;
+		}
+		return true;
+	}
+
+	void eraseLast() {
+		Branch *branch = branches.back();
+		Leaf *leaf = branch->leaves.back();
+		if (!--leaf->count) {
+			delete leaf;
+			branch->leaves.pop_back();
+			branch->firstKeys.pop_back();
+			if (branch->leaves.empty()) {
+				delete branch;
+				branches.pop_back();
+				branchKeys.pop_back();
+			}
+		}
+		--count;
+		if (!branches.empty()) {
+			const Leaf *last = branches.back()->leaves.back();
+			lastKey = last->keys[last->count - 1];
+			limited = true;
+		}
+	}
+
+	vector<Branch *> branches;
+	vector<KeyType> branchKeys;	// first keys of the branches
+	size_t count;
+	IdentifiersType startPath;
+	uint64_t maxCount;
+	bool limited;
+	KeyType lastKey;
+};
+
+#define CREATE_LEAF_MAP(DIMENSIONS) case (DIMENSIONS): pmap.reset(new CellLeafMap<(DIMENSIONS), ValueType>()); break;
 #define CREATE_CELL_MAP(DIMENSIONS) case (DIMENSIONS): pmap.reset(new CellArrayMap<(DIMENSIONS), ValueType>()); break;
 #define CREATE_DEFAULT_MAP() default: pmap.reset(new CellVectorMap<ValueType>(dimensions)); break;
 
@@ -405,21 +708,21 @@ boost::shared_ptr<ICellMap<ValueType> > CreateCellMap(size_t dimensions)
 
 	switch (dimensions) {
 		CREATE_CELL_MAP(1);
-		CREATE_CELL_MAP(2);
-		CREATE_CELL_MAP(3);
-		CREATE_CELL_MAP(4);
-		CREATE_CELL_MAP(5);
-		CREATE_CELL_MAP(6);
-		CREATE_CELL_MAP(7);
-		CREATE_CELL_MAP(8);
-		CREATE_CELL_MAP(9);
-		CREATE_CELL_MAP(10);
-		CREATE_CELL_MAP(11);
-		CREATE_CELL_MAP(12);
-		CREATE_CELL_MAP(13);
-		CREATE_CELL_MAP(14);
-		CREATE_CELL_MAP(15);
-		CREATE_CELL_MAP(16);
+		CREATE_LEAF_MAP(2);
+		CREATE_LEAF_MAP(3);
+		CREATE_LEAF_MAP(4);
+		CREATE_LEAF_MAP(5);
+		CREATE_LEAF_MAP(6);
+		CREATE_LEAF_MAP(7);
+		CREATE_LEAF_MAP(8);
+		CREATE_LEAF_MAP(9);
+		CREATE_LEAF_MAP(10);
+		CREATE_LEAF_MAP(11);
+		CREATE_LEAF_MAP(12);
+		CREATE_LEAF_MAP(13);
+		CREATE_LEAF_MAP(14);
+		CREATE_LEAF_MAP(15);
+		CREATE_LEAF_MAP(16);
 		CREATE_CELL_MAP(17);
 		CREATE_CELL_MAP(18);
 		CREATE_CELL_MAP(19);
@@ -442,9 +745,11 @@ boost::shared_ptr<ICellMap<ValueType> > CreateCellMap(size_t dimensions)
 }
 
 #undef CREATE_CELL_MAP
+#undef CREATE_LEAF_MAP
 #undef CREATE_DEFAULT_MAP
 
 #define CREATE_CELL_MAP(DIMENSIONS) case (DIMENSIONS): pmap.reset(new CellArrayMap<(DIMENSIONS),double>()); break;
+#define CREATE_LEAF_MAP(DIMENSIONS) case (DIMENSIONS): pmap.reset(new CellLeafMap<(DIMENSIONS),double>()); break;
 #define CREATE_DEFAULT_MAP() default: pmap.reset(new CellVectorMap<double>(dimensions)); break;
 
 inline PDoubleCellMap CreateDoubleCellMap(size_t dimensions)
@@ -453,21 +758,21 @@ inline PDoubleCellMap CreateDoubleCellMap(size_t dimensions)
 
 	switch (dimensions) {
 		CREATE_CELL_MAP(1);
-		CREATE_CELL_MAP(2);
-		CREATE_CELL_MAP(3);
-		CREATE_CELL_MAP(4);
-		CREATE_CELL_MAP(5);
-		CREATE_CELL_MAP(6);
-		CREATE_CELL_MAP(7);
-		CREATE_CELL_MAP(8);
-		CREATE_CELL_MAP(9);
-		CREATE_CELL_MAP(10);
-		CREATE_CELL_MAP(11);
-		CREATE_CELL_MAP(12);
-		CREATE_CELL_MAP(13);
-		CREATE_CELL_MAP(14);
-		CREATE_CELL_MAP(15);
-		CREATE_CELL_MAP(16);
+		CREATE_LEAF_MAP(2);
+		CREATE_LEAF_MAP(3);
+		CREATE_LEAF_MAP(4);
+		CREATE_LEAF_MAP(5);
+		CREATE_LEAF_MAP(6);
+		CREATE_LEAF_MAP(7);
+		CREATE_LEAF_MAP(8);
+		CREATE_LEAF_MAP(9);
+		CREATE_LEAF_MAP(10);
+		CREATE_LEAF_MAP(11);
+		CREATE_LEAF_MAP(12);
+		CREATE_LEAF_MAP(13);
+		CREATE_LEAF_MAP(14);
+		CREATE_LEAF_MAP(15);
+		CREATE_LEAF_MAP(16);
 		CREATE_CELL_MAP(17);
 		CREATE_CELL_MAP(18);
 		CREATE_CELL_MAP(19);
@@ -490,6 +795,7 @@ inline PDoubleCellMap CreateDoubleCellMap(size_t dimensions)
 }
 
 #undef CREATE_CELL_MAP
+#undef CREATE_LEAF_MAP
 #undef CREATE_DEFAULT_MAP
 
 }
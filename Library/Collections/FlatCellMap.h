@@ -0,0 +1,440 @@
+/* 
+ *
+ * Copyright (C) 2006-2014 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * 
+ *
+ */
+
+#ifndef FLATCELLMAP_H
+#define FLATCELLMAP_H
+
+#include "palo.h"
+#include "Collections/CellMap.h"
+#include "Engine/Area.h"
+#include "Exceptions/ErrorException.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FLAT_CELL_MAP_SSE2 1
+#endif
+
+namespace palo {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief bit layout of identifiers packed into WORDS 64-bit words
+///
+/// Dimensions are stored from the most significant bits of the first word
+/// and never cross a word boundary, so packed keys compare in path order.
+////////////////////////////////////////////////////////////////////////////////
+
+template <int WORDS>
+struct FlatKeyLayout {
+	struct Key {
+		uint64_t w[WORDS];
+		bool operator==(const Key &o) const {
+			for (int i = 0; i < WORDS; i++) {
+				if (w[i] != o.w[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+		bool operator<(const Key &o) const {
+			for (int i = 0; i < WORDS; i++) {
+				if (w[i] != o.w[i]) {
+					return w[i] < o.w[i];
+				}
+			}
+			return false;
+		}
+	};
+
+	bool init(const vector<uint32_t> &bits) {
+		dims = bits.size();
+		word.resize(dims);
+		shift.resize(dims);
+		mask.resize(dims);
+		int current = 0;
+		uint32_t freeBits = 64;
+		for (size_t dim = 0; dim < dims; dim++) {
+			if (bits[dim] > freeBits) {
+				if (++current == WORDS) {
+					return false;
+				}
+				freeBits = 64;
+			}
+			freeBits -= bits[dim];
+			word[dim] = current;
+			shift[dim] = freeBits;
+			mask[dim] = bits[dim] == 32 ? 0xFFFFFFFFu : ((uint32_t(1) << bits[dim]) - 1);
+		}
+		return true;
+	}
+
+	bool pack(const IdentifierType *path, Key &key) const {
+		memset(key.w, 0, sizeof(key.w));
+		for (size_t dim = 0; dim < dims; dim++) {
+			if (path[dim] > mask[dim]) {
+				return false;
+			}
+			key.w[word[dim]] |= uint64_t(path[dim]) << shift[dim];
+		}
+		return true;
+	}
+
+	void unpack(const Key &key, IdentifiersType &path) const {
+		for (size_t dim = 0; dim < dims; dim++) {
+			path[dim] = IdentifierType((key.w[word[dim]] >> shift[dim]) & mask[dim]);
+		}
+	}
+
+	int compare(const Key &key, const IdentifierType *path) const {
+		for (size_t dim = 0; dim < dims; dim++) {
+			IdentifierType id = IdentifierType((key.w[word[dim]] >> shift[dim]) & mask[dim]);
+			if (id != path[dim]) {
+				return id < path[dim] ? -1 : 1;
+			}
+		}
+		return 0;
+	}
+
+	size_t dims;
+	vector<int> word;
+	vector<uint32_t> shift;
+	vector<uint32_t> mask;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief open addressing hash map of packed cell paths
+///
+/// Accumulator for large aggregation targets. Slots are grouped by 16, each
+/// slot has a control byte with 7 bits of the hash, so one SSE2 compare
+/// probes a whole group. Values are never removed. The reader returns the
+/// cells sorted by path. Limits set by setLimit are not supported.
+////////////////////////////////////////////////////////////////////////////////
+
+template <int WORDS>
+class FlatHashCellMap : public ICellMap<double> {
+public:
+	typedef FlatKeyLayout<WORDS> Layout;
+	typedef typename Layout::Key Key;
+
+private:
+	struct Slot {
+		Key key;
+		double value;
+	};
+	enum {GROUP = 16, MIN_GROUPS = 16, EMPTY = 0x80};
+
+public:
+	FlatHashCellMap(const Layout &layout) : layout(layout), count(0), groupMask(0) {
+		rehash(MIN_GROUPS);
+	}
+	virtual ~FlatHashCellMap() {}
+
+	virtual bool set(const IdentifierType *path, const double &value) {
+		bool inserted;
+		*findOrInsert(packKey(path), inserted) = value;
+		return inserted;
+	}
+	virtual bool set(const IdentifiersType &path, const double &value) {
+		return set(&path[0], value);
+	}
+	virtual bool add(const IdentifierType *path, const double &value) {
+		bool inserted;
+		double *slotValue = findOrInsert(packKey(path), inserted);
+		if (inserted) {
+			*slotValue = value;
+		} else {
+			*slotValue += value;
+		}
+		return inserted;
+	}
+	virtual bool add(const IdentifiersType &path, const double &value) {
+		return add(&path[0], value);
+	}
+	virtual bool get(const IdentifierType *path, double &value) const {
+		Key key;
+		if (!layout.pack(path, key)) {
+			return false;
+		}
+		const Slot *slot = find(key);
+		if (slot) {
+			value = slot->value;
+		}
+		return slot != 0;
+	}
+	virtual bool get(const IdentifiersType &path, double &value) const {
+		return get(&path[0], value);
+	}
+	virtual size_t size() const {
+		return count;
+	}
+	virtual void setLimit(const IdentifiersType &startPath, uint64_t maxCount) {
+		// not supported, CreateFlatDoubleCellMap is not used for limited results
+	}
+
+	class Reader : public ProcessorBase {
+	public:
+		Reader(FlatHashCellMap &fm) : ProcessorBase(true, PEngineBase()), started(false), pfm(fm.shared_from_this()), fm(fm), current(0), vkey(fm.layout.dims), val(0) {
+			order.reserve(fm.count);
+			for (size_t i = 0; i < fm.ctrl.size(); i++) {
+				if (fm.ctrl[i] != EMPTY) {
+					order.push_back(&fm.slots[i]);
+				}
+			}
+			std::sort(order.begin(), order.end(), slotLess);
+		}
+		virtual ~Reader() {}
+		virtual bool next() {
+			if (current < order.size()) {
+				fm.layout.unpack(order[current]->key, vkey);
+				val = order[current]->value;
+				started = true;
+				++current;
+				return true;
+			}
+			return false;
+		}
+		virtual const CellValue &getValue() {
+			cellval = val;
+			if (cellval.isEmpty()) {
+				cellval.setEmpty(false);
+			}
+			return cellval;
+		}
+		virtual double getDouble() {
+			return val;
+		}
+		virtual const IdentifiersType &getKey() const {
+			if (!started) {
+				return EMPTY_KEY;
+			}
+			return vkey;
+		}
+		virtual void reset() {
+			started = false;
+			current = 0;
+		}
+		virtual bool move(const IdentifiersType &key, bool *found) {
+			size_t lo = 0, hi = order.size();
+			while (lo < hi) {
+				size_t mid = (lo + hi) / 2;
+				if (fm.layout.compare(order[mid]->key, &key[0]) < 0) {
+					lo = mid + 1;
+				} else {
+					hi = mid;
+				}
+			}
+			current = lo;
+			bool ret = next();
+			if (found) {
+				*found = ret && vkey == key;
+			}
+			return ret;
+		}
+	private:
+		static bool slotLess(const typename FlatHashCellMap::Slot *s1, const typename FlatHashCellMap::Slot *s2) {
+			return s1->key < s2->key;
+		}
+		bool started;
+		boost::shared_ptr<CellMapBase> pfm;
+		FlatHashCellMap &fm;
+		vector<const typename FlatHashCellMap::Slot *> order;
+		size_t current;
+		IdentifiersType vkey;
+		double val;
+		CellValue cellval;
+	};
+	virtual PProcessorBase getValues() {
+		return ContextArena::create<Reader>(*this);
+	}
+
+private:
+	static uint64_t hash(const Key &key) {
+		uint64_t h = key.w[0];
+		for (int i = 1; i < WORDS; i++) {
+			h ^= key.w[i] + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+		}
+		// murmur3 finalizer
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	static uint32_t matchGroup(const uint8_t *group, uint8_t tag) {
+#ifdef FLAT_CELL_MAP_SSE2
+		__m128i c = _mm_loadu_si128((const __m128i *)group);
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8((char)tag)));
+#else
+		uint32_t m = 0;
+		for (size_t i = 0; i < GROUP; i++) {
+			if (group[i] == tag) {
+				m |= 1u << i;
+			}
+		}
+		return m;
+#endif
+	}
+
+	static uint32_t lowestBit(uint32_t m) {
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, m);
+		return (uint32_t)index;
+#else
+		return (uint32_t)__builtin_ctz(m);
+#endif
+	}
+
+	Key packKey(const IdentifierType *path) const {
+		Key key;
+		if (!layout.pack(path, key)) {
+			throw ErrorException(ErrorException::ERROR_INTERNAL, "FlatHashCellMap: path out of key range");
+		}
+		return key;
+	}
+
+	const Slot *find(const Key &key) const {
+		uint64_t h = hash(key);
+		uint8_t tag = uint8_t(h >> 57);
+		for (size_t g = size_t(h) & groupMask;; g = (g + 1) & groupMask) {
+			const uint8_t *group = &ctrl[g * GROUP];
+			for (uint32_t m = matchGroup(group, tag); m; m &= m - 1) {
+				const Slot *slot = &slots[g * GROUP + lowestBit(m)];
+				if (slot->key == key) {
+					return slot;
+				}
+			}
+			if (matchGroup(group, EMPTY)) {
+				return 0;
+			}
+		}
+	}
+
+	double *findOrInsert(const Key &key, bool &inserted) {
+		if ((count + 1) * 8 > ctrl.size() * 7) {
+			rehash((groupMask + 1) * 2);
+		}
+		uint64_t h = hash(key);
+		uint8_t tag = uint8_t(h >> 57);
+		for (size_t g = size_t(h) & groupMask;; g = (g + 1) & groupMask) {
+			uint8_t *group = &ctrl[g * GROUP];
+			for (uint32_t m = matchGroup(group, tag); m; m &= m - 1) {
+				Slot *slot = &slots[g * GROUP + lowestBit(m)];
+				if (slot->key == key) {
+					inserted = false;
+					return &slot->value;
+				}
+			}
+			uint32_t empty = matchGroup(group, EMPTY);
+			if (empty) {
+				size_t i = g * GROUP + lowestBit(empty);
+				ctrl[i] = tag;
+				slots[i].key = key;
+				slots[i].value = 0;
+				++count;
+				inserted = true;
+				return &slots[i].value;
+			}
+		}
+	}
+
+	void rehash(size_t groups) {
+		vector<uint8_t> oldCtrl(groups * GROUP, uint8_t(EMPTY));
+		vector<Slot> oldSlots(groups * GROUP);
+		oldCtrl.swap(ctrl);
+		oldSlots.swap(slots);
+		groupMask = groups - 1;
+		for (size_t i = 0; i < oldCtrl.size(); i++) {
+			if (oldCtrl[i] != EMPTY) {
+				uint64_t h = hash(oldSlots[i].key);
+				for (size_t g = size_t(h) & groupMask;; g = (g + 1) & groupMask) {
+					uint32_t empty = matchGroup(&ctrl[g * GROUP], EMPTY);
+					if (empty) {
+						size_t j = g * GROUP + lowestBit(empty);
+						ctrl[j] = oldCtrl[i];
+						slots[j] = oldSlots[i];
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	Layout layout;
+	vector<uint8_t> ctrl;
+	vector<Slot> slots;
+	size_t count;
+	size_t groupMask;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief creates flat hash map for cells of the area
+///
+/// Returns empty pointer if the identifiers of the area can't be packed into
+/// 128 bits.
+////////////////////////////////////////////////////////////////////////////////
+
+inline PDoubleCellMap CreateFlatDoubleCellMap(CPArea area)
+{
+	vector<uint32_t> bits;
+	uint32_t totalBits = 0;
+	for (size_t dim = 0; dim < area->dimCount(); dim++) {
+		CPSet set = area->getDim(dim);
+		if (!set || set->empty()) {
+			return PDoubleCellMap();
+		}
+		IdentifierType maxId = *(--set->end());
+		uint32_t dimBits = 1;
+		while (dimBits < 32 && (maxId >> dimBits)) {
+			dimBits++;
+		}
+		bits.push_back(dimBits);
+		totalBits += dimBits;
+	}
+
+	PDoubleCellMap pmap;
+	if (totalBits <= 64) {
+		FlatKeyLayout<1> layout;
+		if (layout.init(bits)) {
+			pmap.reset(new FlatHashCellMap<1>(layout));
+		}
+	}
+	if (!pmap && totalBits <= 128) {
+		FlatKeyLayout<2> layout;
+		if (layout.init(bits)) {
+			pmap.reset(new FlatHashCellMap<2>(layout));
+		}
+	}
+	return pmap;
+}
+
+}
+
+#endif
@@ -62,6 +62,8 @@ template <typename TType> class SlimPage {
 	friend class SlimVector<TType>;
 public:
 	SlimPage(uint32_t size);
+	// page stored in a mapped file, read-only until copied
+	SlimPage(uint32_t size, uint32_t count, boost::shared_ptr<char> mapping, TType *blocks);
 	virtual ~SlimPage();
 
 	TType & push_back(TType value);
@@ -95,6 +97,9 @@ public:
 	bool isCheckedOut() const {
 		return checkedOut;
 	}
+	bool isMapped() const {
+		return mapping != 0;
+	}
 	typename Slim<TType>::PSlimPage getCopy();
 	void moveValues(typename Slim<TType>::PSlimPage &page, uint32_t fromOffset);
 	bool full() const {
@@ -136,6 +141,7 @@ private:
 	uint32_t emptyCount; // null objects in the page
 	TType *blocks;
 	bool checkedOut;
+	boost::shared_ptr<char> mapping;
 };
 
 template <typename TType> const float SlimPage<TType>::maxFill = 1;
@@ -150,6 +156,12 @@ template <typename TType> SlimPage<TType>::SlimPage(uint32_t size) :
 }
 
 
+template <typename TType> SlimPage<TType>::SlimPage(uint32_t size, uint32_t count, boost::shared_ptr<char> mapping, TType *blocks) :
+	maxBlockCount(size / sizeof(TType)), blocksFilled(count), emptyCount(0), blocks(blocks), checkedOut(false), mapping(mapping)
+{
+}
+
+
 template <typename TType> SlimPage<TType>::SlimPage(const SlimPage & page) :
 	maxBlockCount(page.maxBlockCount), blocksFilled(page.blocksFilled), emptyCount(page.emptyCount), checkedOut(true)
 {
@@ -164,7 +176,9 @@ template <typename TType> SlimPage<TType>::SlimPage(const SlimPage & page) :
 
 template <typename TType> SlimPage<TType>::~SlimPage()
 {
-	delete[] blocks;
+	if (!mapping) {
+		delete[] blocks;
+	}
 }
 
 
@@ -74,6 +74,10 @@ public:
 	void load(FileReader *file);
 	void save(FileWriter *file) const;
 
+	// pages stored at file offsets aligned to the page size, mapped when loaded
+	void loadAligned(FileReader *file);
+	void saveAligned(FileWriter *file) const;
+
 	virtual bool merge(const CPCommitable &o, const PCommitable &p);
 	virtual PCommitable copy() const;
 
@@ -390,6 +394,94 @@ template <typename TType> void SlimVector<TType>::save(FileWriter *file) const
 	}
 }
 
+template <typename TType> void SlimVector<TType>::loadAligned(FileReader *file)
+{
+	//number of pages
+	uint32_t size;
+	file->getRaw((char *)&size, sizeof(uint32_t));
+	clear();
+
+	if (size) {
+		vector<typename Slim<TType>::PSlimPage > pagesLocal;
+		pagesLocal.reserve(size);
+
+		//page size
+		file->getRaw((char *)&pageMemorySize, sizeof(uint32_t));
+		blocksInPage = pageMemorySize / sizeof(TType);
+
+		//filled blocks of pages
+		vector<uint32_t> counts(size);
+		file->getRaw((char *)&counts[0], size * sizeof(uint32_t));
+
+		//padding to the aligned file offset
+		uint32_t padding;
+		file->getRaw((char *)&padding, sizeof(uint32_t));
+		if (padding) {
+			vector<char> skip(padding);
+			file->getRaw(&skip[0], padding);
+		}
+
+		boost::shared_ptr<char> mapping = file->mapRaw((streamsize)size * pageMemorySize);
+		for (uint32_t i = 0; i < size; i++) {
+			if (counts[i] > blocksInPage) {
+				throw ErrorException(ErrorException::ERROR_CORRUPT_FILE, "invalid page size");
+			}
+			typename Slim<TType>::PSlimPage page;
+			if (mapping) {
+				page.reset(new SlimPage<TType>(pageMemorySize, counts[i], mapping, (TType *)(mapping.get() + (size_t)i * pageMemorySize)));
+			} else {
+				page.reset(new SlimPage<TType>(pageMemorySize));
+				page->setSize(counts[i]);
+				file->getRaw((char *)page->blocks, pageMemorySize);
+			}
+			pagesLocal.push_back(page);
+		}
+
+		// complete load was successful
+		this->pages.swap(pagesLocal);
+	}
+}
+
+template <typename TType> void SlimVector<TType>::saveAligned(FileWriter *file) const
+{
+	uint32_t size = (uint32_t)pages.size();
+	//number of pages
+	file->appendRaw((const char *)&size, sizeof(uint32_t));
+
+	if (size) {
+		//page size
+		file->appendRaw((const char *)&pageMemorySize, sizeof(uint32_t));
+
+		//filled blocks of pages
+		for (uint32_t i = 0; i < size; i++) {
+			uint32_t count = pages[i]->count();
+			file->appendRaw((const char *)&count, sizeof(uint32_t));
+		}
+
+		//padding to the aligned file offset
+		int64_t pos = file->getRawPosition();
+		if (pos < 0) {
+			throw ErrorException(ErrorException::ERROR_INTERNAL, "file position not available for aligned pages");
+		}
+		pos += sizeof(uint32_t);
+		uint32_t padding = (uint32_t)((pageMemorySize - pos % pageMemorySize) % pageMemorySize);
+		file->appendRaw((const char *)&padding, sizeof(uint32_t));
+		vector<char> zeros(pageMemorySize, 0);
+		if (padding) {
+			file->appendRaw(&zeros[0], padding);
+		}
+
+		//whole pages
+		for (uint32_t i = 0; i < size; i++) {
+			uint32_t used = pages[i]->count() * sizeof(TType);
+			file->appendRaw((const char *)pages[i]->blocks, used);
+			if (used < pageMemorySize) {
+				file->appendRaw(&zeros[0], pageMemorySize - used);
+			}
+		}
+	}
+}
+
 template <typename TType> bool SlimVector<TType>::merge(const CPCommitable &o, const PCommitable &p)
 {
 	bool ret = true;
@@ -715,6 +715,42 @@ struct StringBuffer {
 		appendChar(';');
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief appends unsigned integer as varint
+	///
+	/// Seven bits per byte, lowest bits first, the high bit marks a following
+	/// byte.
+	////////////////////////////////////////////////////////////////////////////////
+
+	void appendVarint(uint64_t i) {
+		reserve(11);
+		while (0x80 <= i) {
+			appendChar0((char)(i | 0x80));
+			i >>= 7;
+		}
+		appendChar0((char)i);
+		*bufferPtr = '\0';
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief appends double as raw IEEE value
+	////////////////////////////////////////////////////////////////////////////////
+
+	void appendRawDouble(double d) {
+		reserve(sizeof(double) + 1);
+		appendData(&d, sizeof(double));
+		*bufferPtr = '\0';
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief appends string prefixed by its length as varint
+	////////////////////////////////////////////////////////////////////////////////
+
+	void appendLengthString(const string& text) {
+		appendVarint(text.size());
+		appendText(text);
+	}
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// @brief reserves space
 	////////////////////////////////////////////////////////////////////////////////
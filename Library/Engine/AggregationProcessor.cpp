@@ -28,6 +28,7 @@
 
 #include "Engine/AggregationProcessor.h"
 #include "Engine/StorageCpu.h"
+#include "Collections/FlatCellMap.h"
 #include "Logger/Logger.h"
 #include "InputOutput/Condition.h"
 
@@ -343,7 +344,7 @@ bool AggregationProcessor::move(const IdentifiersType &key, bool *found)
 	return storageReader->move(key, found);
 }
 
-void AggregationProcessor::aggregateCell(const IdentifiersType &key, const double value)
+void AggregationProcessor::aggregateCell(const IdentifierType *key, const double value)
 {
 	double fixedWeight;
 	size_t multiDimCount;
@@ -392,6 +393,21 @@ PProcessorBase AggregationProcessor::getCalculatedValues()
 	return PProcessorBase();
 }
 
+PDoubleCellMap AggregationProcessor::createTargetStorage() const
+{
+	PDoubleCellMap result;
+	uint64_t maxCount = aggregationPlan->getMaxCount() == 0 ? 0 : aggregationPlan->getMaxCount() + 1;
+	if (!maxCount) {
+		// flat hash map if the target paths fit into 128 bits
+		result = CreateFlatDoubleCellMap(aggregationPlan->getArea());
+	}
+	if (!result) {
+		result = CreateDoubleCellMap(aggregationPlan->getArea()->dimCount());
+		result->setLimit(IdentifiersType(), maxCount);
+	}
+	return result;
+}
+
 void AggregationProcessor::aggregate()
 {
 	// not yet calculated
@@ -401,8 +417,7 @@ void AggregationProcessor::aggregate()
 		hashStorage = new HashValueStorage(aggregationPlan->getArea());
 		storage.reset(hashStorage);
 	} else {
-		storage = CreateDoubleCellMap(aggregationPlan->getArea()->dimCount());
-		storage->setLimit(IdentifiersType(), (aggregationPlan->getMaxCount() == 0 ? 0 : aggregationPlan->getMaxCount() + 1));
+		storage = createTargetStorage();
 	}
 
 	initIntern();
@@ -414,12 +429,23 @@ void AggregationProcessor::aggregate()
 		CellValueStream *sourceData = sourceDataSP.get();
 
 		StorageCpu::Processor *cpuProc = dynamic_cast<StorageCpu::Processor *>(sourceData);
+		ColumnarProcessor *columnarProc = cpuProc ? 0 : dynamic_cast<ColumnarProcessor *>(sourceData);
 		if (hashStorage && cpuProc && aggregationPlan->getAggregationType() == AggregationPlanNode::SUM) {
 			cpuProc->aggregate(hashStorage, &parentMaps[0]);
+		} else if (hashStorage && columnarProc && aggregationPlan->getAggregationType() == AggregationPlanNode::SUM) {
+			columnarProc->aggregate(hashStorage, &parentMaps[0]);
 		} else {
-			while (sourceData->next()) {
-				// process the value
-				aggregateCell(sourceData->getKey(), sourceData->getDouble());
+			CellBatch batch;
+			while (sourceData->nextBatch(batch)) {
+				// process the values, keys are read in place
+				for (size_t i = 0; i < batch.size(); i++) {
+					aggregateCell(batch.getKey(i), batch.getValue(i));
+				}
+				if (batch.hasCurrent()) {
+					aggregateCell(&sourceData->getKey()[0], sourceData->getDouble());
+				} else if (batch.isLast()) {
+					break;
+				}
 			}
 		}
 	}
@@ -434,7 +460,7 @@ void AggregationProcessor::aggregate()
 	storageReader = storage->getValues();
 }
 
-void AggregationProcessor::initParentKey(const IdentifiersType &key, size_t &multiDimCount, double *fixedWeight)
+void AggregationProcessor::initParentKey(const IdentifierType *key, size_t &multiDimCount, double *fixedWeight)
 {
 	if (fixedWeight) {
 		*fixedWeight = 1;
@@ -443,7 +469,7 @@ void AggregationProcessor::initParentKey(const IdentifiersType &key, size_t &mul
 	multiDimCount = 0;
 	vector<AggregationMap::TargetReader>::iterator lastTarget = lastTargets.begin();
 	IdentifiersType::iterator prevSourceKeyIt = prevSourceKey.begin();
-	IdentifiersType::const_iterator elemId = key.begin();
+	const IdentifierType *elemId = key;
 	for (size_t dim = 0; dim < dimCount; dim++, ++lastTarget, ++prevSourceKeyIt, ++elemId) {
 		AggregationMap::TargetReader targets;
 		IdentifierType lastTargetId = NO_IDENTIFIER;
@@ -530,7 +556,7 @@ void AggregationFunctionProcessor::aggregate()
 	}
 }
 
-void AggregationFunctionProcessor::aggregateCell(const IdentifiersType &key, const double value)
+void AggregationFunctionProcessor::aggregateCell(const IdentifierType *key, const double value)
 {
 	if (isFiltered) {
 		if (aggrType == AggregationPlanNode::SUM || aggrType == AggregationPlanNode::AVG) {
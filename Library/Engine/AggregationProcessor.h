@@ -92,6 +92,7 @@ private:
 	size_t resultSize;
 
 	friend class StorageCpu::Processor;
+	friend class ColumnarProcessor;
 };
 
 class SERVER_CLASS FilteredReader : public ProcessorBase {
@@ -140,11 +141,16 @@ public:
 	PProcessorBase getCalculatedValues();
 protected:
 	virtual void aggregate();
-	virtual void aggregateCell(const IdentifiersType &key, const double value);
+	virtual void aggregateCell(const IdentifierType *key, const double value);
 
 	void initIntern();
 
-	void initParentKey(const IdentifiersType &key, size_t &multiDimCount, double *fixedWeight);
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief creates accumulator for aggregation targets not fitting HashValueStorage
+	////////////////////////////////////////////////////////////////////////////////
+	PDoubleCellMap createTargetStorage() const;
+
+	void initParentKey(const IdentifierType *key, size_t &multiDimCount, double *fixedWeight);
 	void nextParentKey(size_t multiDimCount, size_t &changeMultiDim);
 
 	PEngineBase engine;
@@ -171,7 +177,7 @@ public:
 
 protected:
 	virtual void aggregate();
-	virtual void aggregateCell(const IdentifiersType &key, const double value);
+	virtual void aggregateCell(const IdentifierType *key, const double value);
 	virtual const CellValue &getValue();
 
 private:
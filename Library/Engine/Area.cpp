@@ -174,6 +174,18 @@ void PathTranslator::binPathToPath(const GpuBinPath& binPath, IdentifiersType& p
 	}
 }
 
+// compares ranges by their low id
+struct RangeLow {
+	bool operator()(const pair<IdentifierType, IdentifierType> &range, IdentifierType id) const {return range.first < id;}
+	bool operator()(IdentifierType id, const pair<IdentifierType, IdentifierType> &range) const {return id < range.first;}
+};
+
+// compares ranges by their high id
+struct RangeHigh {
+	bool operator()(const pair<IdentifierType, IdentifierType> &range, IdentifierType id) const {return range.second < id;}
+	bool operator()(IdentifierType id, const pair<IdentifierType, IdentifierType> &range) const {return id < range.second;}
+};
+
 Set::Iterator::Iterator(const Set::Iterator &it) : it(it.it), pos(it.pos), par(it.par), singleElementId(it.singleElementId), end(it.end)
 {
 }
@@ -182,11 +194,11 @@ Set::Iterator::Iterator() : pos(0), par(0), singleElementId(NO_IDENTIFIER), end(
 {
 }
 
-Set::Iterator::Iterator(const SetType::iterator &it, const Set &s, bool end) : it(it), pos(end ? 0 : it->first), par(&s), singleElementId(NO_IDENTIFIER), end(end)
+Set::Iterator::Iterator(const SetType::const_iterator &it, const Set &s, bool end) : it(it), pos(end ? 0 : it->first), par(&s), singleElementId(NO_IDENTIFIER), end(end)
 {
 }
 
-Set::Iterator::Iterator(const SetType::iterator &it, IdentifierType pos, const Set &s) : it(it), pos(pos), par(&s), singleElementId(NO_IDENTIFIER), end(false)
+Set::Iterator::Iterator(const SetType::const_iterator &it, IdentifierType pos, const Set &s) : it(it), pos(pos), par(&s), singleElementId(NO_IDENTIFIER), end(false)
 {
 }
 
@@ -290,7 +302,7 @@ Set::Set() : siz(0)
 Set::Set(bool full)
 {
 	if (full) {
-		ranges.insert(make_pair(0, ALL_IDENTIFIERS));
+		ranges.push_back(make_pair(0, ALL_IDENTIFIERS));
 		siz = (size_t)-1;
 	} else {
 		siz = 0;
@@ -303,76 +315,67 @@ Set::Set(const Set &set) : ranges(set.ranges), siz(set.siz)
 
 bool Set::insert(IdentifierType id)
 {
-	bool result = false;
-
-	SetType::iterator itp = ranges.lower_bound(make_pair(id, 0));
-	if (itp == ranges.end() || itp->first != id) {
-		if (itp != ranges.begin()) {
-			--itp;
+	SetType::iterator it = upper_bound(ranges.begin(), ranges.end(), id, RangeLow());
+	bool joinPrev = false;
+	if (it != ranges.begin()) {
+		SetType::iterator prev = it - 1;
+		if (prev->second >= id) {
+			return false;
 		}
+		joinPrev = prev->second + 1 == id;
 	}
-	if (itp == ranges.end()) {
-		ranges.insert(make_pair(id, id));
-		++siz;
-		result = true;
+	bool joinNext = it != ranges.end() && it->first == id + 1;
+	if (joinPrev && joinNext) {
+		(it - 1)->second = it->second;
+		ranges.erase(it);
+	} else if (joinPrev) {
+		(it - 1)->second = id;
+	} else if (joinNext) {
+		it->first = id;
 	} else {
-		SetType::iterator tmp;
-		if (itp->second < id) {
-			if (itp->second == id - 1) {
-				tmp = itp;
-				--tmp;
-				tmp = ranges.insert(tmp, make_pair(itp->first, id));
-				ranges.erase(itp);
-				itp = tmp;
-				result = true;
-				siz += 1;
-			}
-			SetType::iterator itn = itp;
-			++itn;
-			if (itn == ranges.end()) {
-				if (!result) {
-					ranges.insert(itp, make_pair(id, id));
-					++siz;
-					result = true;
-				}
-			} else {
-				if (itn->first > id) {
-					if (itn->first == id + 1) {
-						tmp = ranges.insert(itp, make_pair(id, itn->second));
-						ranges.erase(itn);
-						itn = tmp;
-						if (!result) {
-							result = true;
-							++siz;
-						}
-					} else {
-						if (!result) {
-							ranges.insert(itp, make_pair(id, id));
-							++siz;
-							result = true;
-						}
-					}
-				}
-				if (itp->second == itn->first) {
-					ranges.insert(itp, make_pair(itp->first, itn->second));
-					ranges.erase(itp);
-					ranges.erase(itn);
-				}
-			}
+		ranges.insert(it, make_pair(id, id));
+	}
+	++siz;
+	return true;
+}
+
+void Set::insertBulk(IdentifiersType &ids)
+{
+	if (ids.empty()) {
+		return;
+	}
+	sort(ids.begin(), ids.end());
+	ids.erase(unique(ids.begin(), ids.end()), ids.end());
+
+	// single merge of the sorted ids with the ranges instead of an O(n) vector insert per id
+	SetType merged;
+	merged.reserve(ranges.size() + ids.size());
+	SetType::const_iterator range = ranges.begin();
+	IdentifiersType::const_iterator id = ids.begin();
+	while (range != ranges.end() || id != ids.end()) {
+		pair<IdentifierType, IdentifierType> next;
+		bool isId = range == ranges.end() || (id != ids.end() && *id < range->first);
+		if (isId) {
+			next = make_pair(*id, *id);
+			++id;
 		} else {
-			if (itp->first > id) {
-				if (id == itp->first - 1) {
-					ranges.insert(make_pair(id, itp->second)).first;
-					ranges.erase(itp);
-				} else {
-					ranges.insert(make_pair(id, id)).first;
-				}
-				++siz;
-				result = true;
-			}
+			next = *range;
+			++range;
+		}
+		if (!merged.empty() && next.first <= merged.back().second) {
+			// only an id can overlap, it is already in the set
+			continue;
+		}
+		if (isId) {
+			++siz;
+		}
+		if (!merged.empty() && merged.back().second + 1 == next.first) {
+			merged.back().second = next.second;
+		} else {
+			merged.push_back(next);
 		}
 	}
-	return result;
+	ranges.swap(merged);
 }
 
 Set::Iterator Set::begin() const
@@ -387,33 +390,18 @@ Set::Iterator Set::end() const
 
 Set::Iterator Set::find(IdentifierType id) const
 {
-	pair<IdentifierType, IdentifierType> val(id, 0);
-	SetType::iterator it = ranges.lower_bound(val);
-	if (it != ranges.end() && it->first == id) {
-		return Iterator(it, id, *this);
-	}
-	if (it != ranges.begin()) {
-		--it;
-		if (it->first <= id && it->second >= id) {
-			return Iterator(it, id, *this);
-		}
+	SetType::const_iterator it = upper_bound(ranges.begin(), ranges.end(), id, RangeLow());
+	if (it != ranges.begin() && (it - 1)->second >= id) {
+		return Iterator(it - 1, id, *this);
 	}
 	return end();
 }
 
 Set::Iterator Set::lowerBound(IdentifierType id) const
 {
-	pair<IdentifierType, IdentifierType> val(id, 0);
-	SetType::iterator it = ranges.lower_bound(val);
-	if (it != ranges.end() && it->first == id) {
-		return Iterator(it, id, *this);
-	}
-	if (it != ranges.begin()) {
-		SetType::iterator sit = it;
-		--sit;
-		if (sit->first <= id && sit->second >= id) {
-			return Iterator(sit, id, *this);
-		}
+	SetType::const_iterator it = upper_bound(ranges.begin(), ranges.end(), id, RangeLow());
+	if (it != ranges.begin() && (it - 1)->second >= id) {
+		return Iterator(it - 1, id, *this);
 	}
 	if (it != ranges.end()) {
 		return Iterator(it, it->first, *this);
@@ -424,30 +412,23 @@ Set::Iterator Set::lowerBound(IdentifierType id) const
 Set::Iterator Set::erase(const Set::Iterator &it)
 {
 	siz--;
-	if (it.it->first == it.pos) {
-		pair<IdentifierType, IdentifierType> val = *it.it;
-		SetType::iterator tmp = it.it;
-		++tmp;
-		ranges.erase(it.it);
-		if (val.second != it.pos) {
-			val.first++;
-			return Iterator(ranges.insert(val).first, val.first, *this);
+	SetType::iterator range = ranges.begin() + (it.it - ranges.begin());
+	if (range->first == it.pos) {
+		if (range->second != it.pos) {
+			range->first++;
+			return Iterator(range, range->first, *this);
 		} else {
-			return Iterator(tmp, *this, tmp==ranges.end());
+			range = ranges.erase(range);
+			return Iterator(range, *this, range == ranges.end());
 		}
-	} else if (it.it->second == it.pos) {
-		pair<IdentifierType, IdentifierType> val = *it.it;
-		ranges.erase(it.it);
-		val.second--;
-		return Iterator(ranges.insert(val).first, val.second, *this);
+	} else if (range->second == it.pos) {
+		range->second--;
+		return Iterator(range, range->second, *this);
 	} else {
-		pair<IdentifierType, IdentifierType> val1 = *it.it;
-		pair<IdentifierType, IdentifierType> val2 = *it.it;
-		ranges.erase(it.it);
-		val1.second = it.pos - 1;
-		val2.first = it.pos + 1;
-		ranges.insert(val1);
-		return Iterator(ranges.insert(val2).first, val2.first, *this);
+		pair<IdentifierType, IdentifierType> val2(it.pos + 1, range->second);
+		range->second = it.pos - 1;
+		range = ranges.insert(range + 1, val2);
+		return Iterator(range, val2.first, *this);
 	}
 }
 
@@ -455,7 +436,7 @@ size_t Set::size() const
 {
 #ifdef x_DEBUG
 	size_t tstSize = 0;
-	for (std::set<std::pair<IdentifierType, IdentifierType> >::iterator range = ranges.begin(); range != ranges.end(); ++range) {
+	for (SetType::const_iterator range = ranges.begin(); range != ranges.end(); ++range) {
 		tstSize += range->second - range->first + 1;
 	}
 	if (siz != tstSize) {
@@ -473,10 +454,7 @@ void Set::clear()
 
 Set::range_iterator Set::rangeLowerBound(IdentifierType id) const
 {
-	SetType::iterator it = ranges.lower_bound(make_pair(id, 0));
-	if (it != ranges.end() && it->first == id) {
-		return range_iterator(it);
-	}
+	SetType::const_iterator it = upper_bound(ranges.begin(), ranges.end(), id, RangeLow());
 	if (it != ranges.begin()) {
 		--it;
 	}
@@ -486,16 +464,12 @@ Set::range_iterator Set::rangeLowerBound(IdentifierType id) const
 void Set::insertRange(IdentifierType low, IdentifierType high)
 {
 	siz += high - low + 1;
-	SetType::iterator it = ranges.end();
-	if (it != ranges.begin()) {
-		--it;
 #ifdef _DEBUG
-		if (low == it->second) {
-			Logger::debug << "Strange ranges came to intersection, please, check." << endl;
-		}
-#endif
+	if (!ranges.empty() && low == ranges.back().second) {
+		Logger::debug << "Strange ranges came to intersection, please, check." << endl;
 	}
-	ranges.insert(it, make_pair(low, high));
+#endif
+	ranges.push_back(make_pair(low, high));
 }
 
 bool Set::empty() const
@@ -599,14 +573,14 @@ bool Set::intersection(const Set *set, PSet *intersection, PSet *complement) con
 	}
 	bool hasIntersection = false;
 
-	Set::range_iterator filterIt = set->rangeBegin();
-	Set::range_iterator setIt = rangeBegin();
-	Set::range_iterator setEnd = rangeEnd();
-	Set::range_iterator filterEnd = set->rangeEnd();
+	SetType::const_iterator filterIt = set->ranges.begin();
+	SetType::const_iterator filterEnd = set->ranges.end();
+	SetType::const_iterator setIt = ranges.begin();
+	SetType::const_iterator setEnd = ranges.end();
 
-	for (; setIt != setEnd; ++setIt) {
-		IdentifierType setLow = setIt.low();
-		IdentifierType setHigh = setIt.high();
+	while (setIt != setEnd) {
+		IdentifierType setLow = setIt->first;
+		IdentifierType setHigh = setIt->second;
 		if (filterIt == filterEnd) {
 			if (!intersection && !complement) {
 				return false;
@@ -617,10 +591,19 @@ bool Set::intersection(const Set *set, PSet *intersection, PSet *complement) con
 				break;
 			}
 		} else {
+			filterIt = skipRanges(filterIt, filterEnd, setLow);
+			if (filterIt == filterEnd) {
+				continue;
+			}
+			if (!complement && filterIt->first > setHigh) {
+				// ranges without a counterpart are needed only for the complement
+				setIt = skipRanges(setIt, setEnd, filterIt->first);
+				continue;
+			}
 			IdentifierType setCurr = setLow;
 			while (filterIt != filterEnd) {
-				IdentifierType filterLow = filterIt.low();
-				IdentifierType filterHigh = filterIt.high();
+				IdentifierType filterLow = filterIt->first;
+				IdentifierType filterHigh = filterIt->second;
 				if (filterHigh < setLow) {
 					++filterIt;
 				} else if (filterLow > setHigh) {
@@ -649,6 +632,7 @@ bool Set::intersection(const Set *set, PSet *intersection, PSet *complement) con
 				(*complement)->insertRange(setCurr, setHigh);
 			}
 		}
+		++setIt;
 	}
 
 //	PSet comp_check, inter_check;
@@ -719,6 +703,21 @@ bool Set::validate() const
 	return true;
 }
 
+Set::SetType::const_iterator Set::skipRanges(SetType::const_iterator it, SetType::const_iterator end, IdentifierType id)
+{
+	// returns the first range ending at or after id, galloping over long runs of skipped ranges
+	if (it == end || it->second >= id) {
+		return it;
+	}
+	size_t step = 1;
+	while ((size_t)(end - it) > step && (it + step)->second < id) {
+		it += step;
+		step <<= 1;
+	}
+	SetType::const_iterator last = (size_t)(end - it) > step ? it + step + 1 : end;
+	return lower_bound(it + 1, last, id, RangeHigh());
+}
+
 PSet Set::addAncestors(CPSet set, CPDimension dim)
 {
 	PSet result(new Set);
@@ -951,9 +950,7 @@ Area::Area(const vector<IdentifiersType> &idsArea) : area(idsArea.size()), areaS
 		if (idsArea[i].size() == 1 && idsArea[i][0] == ALL_IDENTIFIERS) {
 			s.reset(new Set(true));
 		} else {
-			for (size_t j = 0; j < idsArea[i].size(); j++) {
-				s->insert(idsArea[i][j]);
-			}
+			s->insert(idsArea[i].begin(), idsArea[i].end());
 		}
 		insert((IdentifierType)i, s, false);
 	}
@@ -1609,6 +1606,7 @@ PCubeArea CubeArea::expandBase(AggregationMaps *aggregationMaps, uint32_t *dimOr
 		CPDimension dimension = db->lookupDimension(*didit, false);
 
 		PSet s(new Set);
+		IdentifiersType bases; // base elements of several parents interleave, merged at once
 		bool singleElement = false;
 		if (elemCount(dim) == 1) {
 			singleElement = true;
@@ -1636,11 +1634,12 @@ PCubeArea CubeArea::expandBase(AggregationMaps *aggregationMaps, uint32_t *dimOr
 					}
 				} else {
 					for (WeightedSet::const_iterator bi = element->baseElementsBegin(); bi != element->baseElementsEnd(); ++bi) {
-						s->insert(bi.first());
+						bases.push_back(bi.first());
 					}
 				}
 			}
 		}
+		s->insertBulk(bases);
 #ifdef _DEBUG
 		if (!s->validate()) {
 			Logger::debug << "Gotcha! " << *s << endl;
@@ -1839,7 +1838,7 @@ ostream& operator<<(ostream& ostr, const vector<IdentifiersType> &cubePaths)
 
 ostream& operator<<(ostream& ostr, const Set &set)
 {
-	for (std::set<std::pair<IdentifierType, IdentifierType> >::iterator range = set.ranges.begin(); range != set.ranges.end(); ++range) {
+	for (Set::SetType::const_iterator range = set.ranges.begin(); range != set.ranges.end(); ++range) {
 		if (range != set.ranges.begin()) {
 			ostr << ',';
 		}
@@ -1878,25 +1877,14 @@ double WeightedSet::rangeWeight(IdentifierType rangeStart) const
 
 void WeightedSet::pushSorted(IdentifierType low, IdentifierType high, double weight)
 {
-	if (empty()) {
-		ranges.insert(make_pair(low, high));
+	if (!empty() && ranges.back().second + 1 == low && rangeWeight(ranges.back().first) == weight) {
+		// append
+		ranges.back().second = high;
+	} else {
+		ranges.push_back(make_pair(low, high));
 		if (weight != 1) {
 			weights[low] = weight;
 		}
-	} else {
-		SetType::reverse_iterator lastRange = ranges.rbegin();
-		if (lastRange->second + 1 == low && rangeWeight(lastRange->first) == weight) {
-			// append
-			pair<IdentifierType, IdentifierType> val = *lastRange;
-			val.second = high;
-			ranges.erase(--ranges.end());
-			ranges.insert(val);
-		} else {
-			ranges.insert(make_pair(low, high));
-			if (weight != 1) {
-				weights[low] = weight;
-			}
-		}
 	}
 	siz += high-low+1;
 }
@@ -1904,23 +1892,13 @@ void WeightedSet::pushSorted(IdentifierType low, IdentifierType high, double wei
 
 void WeightedSet::fastAdd(IdentifierType id, double weight)
 {
-	pair<SetType::iterator, bool> itb = ranges.insert(make_pair(id, id));
+	// weights of all added ids are summed up here, consolidate() sorts the ranges and drops weights of 1
+	pair<map<IdentifierType, double>::iterator, bool> itb = weights.insert(make_pair(id, weight));
 	if (itb.second) {
-		if (weight != 1) {
-			weights[id] = weight;
-		}
+		ranges.push_back(make_pair(id, id));
 		siz++;
 	} else {
-		map<IdentifierType, double>::iterator it = weights.find(id);
-		if (it == weights.end()) {
-			weights[id] = 1 + weight;
-		} else {
-			weights[id] += weight;
-		}
-
-		if (weights[id] == 1) {
-			weights.erase(weights.find(id));
-		}
+		itb.first->second += weight;
 	}
 }
 
@@ -1928,37 +1906,33 @@ void WeightedSet::fastAdd(IdentifierType id, double weight)
 void WeightedSet::consolidate()
 {
 	// consolidates WeightedSet - joins all one-id ranges into valid ranges used in WeightedSet
-	for (SetType::iterator it = ranges.begin(); it != ranges.end(); ++it) {
+	sort(ranges.begin(), ranges.end());
+	for (map<IdentifierType, double>::iterator it = weights.begin(); it != weights.end();) {
+		if (it->second == 1) {
+			weights.erase(it++);
+		} else {
+			++it;
+		}
+	}
+	if (ranges.empty()) {
+		return;
+	}
+	SetType::iterator last = ranges.begin();
+	double lastWeight = rangeWeight(last->first);
+	for (SetType::iterator it = last + 1; it != ranges.end(); ++it) {
 		double weight = rangeWeight(it->first);
-
-		while (true) {
-			SetType::iterator next = it;
-			++next;
-			if (next == ranges.end() || it->second + 1 != next->first) {
-				// no more ids to process or not continuous
-				break;
-			}
-
-			double nextWeight = rangeWeight(next->first);
-			if (nextWeight != weight) {
-				// different weights, cannot be joined
-				break;
-			}
-
-			// next will be joined into it, delete next
-			if (nextWeight != 1) {
-				weights.erase(weights.find(next->first));
-			}
-			ranges.erase(next);
-
+		if (last->second + 1 == it->first && weight == lastWeight) {
 			// join
-			pair<IdentifierType, IdentifierType> join = *it;
-			join.second++;
-			ranges.erase(it);
-			pair<SetType::iterator, bool> ins = ranges.insert(join);
-			it = ins.first;
+			last->second = it->second;
+			if (weight != 1) {
+				weights.erase(it->first);
+			}
+		} else {
+			*++last = *it;
+			lastWeight = weight;
 		}
 	}
+	ranges.erase(last + 1, ranges.end());
 }
 
 void WeightedSet::multiply(double factor)
@@ -102,16 +102,23 @@ private:
 	enum { MaxBinCharge = sizeof(gpuBinType) * 8 };
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief set of element ids
+///
+/// Stores disjoint ranges of ids sorted by their low id in one flat array, so
+/// lookups are binary searches and intersections scan contiguous memory.
+////////////////////////////////////////////////////////////////////////////////
+
 class Set : public boost::enable_shared_from_this<Set> {
 public:
-	typedef set<pair<IdentifierType, IdentifierType> > SetType;
+	typedef vector<pair<IdentifierType, IdentifierType> > SetType;
 
 	class Iterator  : public std::iterator<forward_iterator_tag, IdentifierType, ptrdiff_t, IdentifierType *, IdentifierType &> {
 	public:
 		Iterator(const Iterator &it);
 		Iterator();
-		Iterator(const SetType::iterator &it, const Set &s, bool end);
-		Iterator(const SetType::iterator &it, IdentifierType pos, const Set &s);
+		Iterator(const SetType::const_iterator &it, const Set &s, bool end);
+		Iterator(const SetType::const_iterator &it, IdentifierType pos, const Set &s);
 		Iterator(IdentifierType elemId, bool end);
 		IdentifierType operator*() const;
 		bool operator!=(const Iterator &it) const;
@@ -152,11 +159,14 @@ public:
 	virtual ~Set() {}
 	Set(const Set &set);
 	bool insert(IdentifierType id);
+	// unordered input is collected and merged in one pass, see insertBulk
 	template<typename T> void insert(T first, T last) {
-		for (; first != last; ++first) {
-			insert(*first);
-		}
+		IdentifiersType ids;
+		ids.insert(ids.end(), first, last);
+		insertBulk(ids);
 	}
+	// sorts ids (in place) and merges them into the ranges
+	void insertBulk(IdentifiersType &ids);
 	Iterator begin() const;
 	Iterator end() const;
 	Iterator find(IdentifierType id) const;
@@ -184,6 +194,7 @@ public:
 
 protected:
 	static void addAncestor(PSet set, CPDimension dim, IdentifierType elemId);
+	static SetType::const_iterator skipRanges(SetType::const_iterator it, SetType::const_iterator end, IdentifierType id);
 
 	SetType ranges;
 	size_t siz;
@@ -196,7 +207,7 @@ public:
 
 	class const_iterator : public Set::Iterator {
 	public:
-		const_iterator(const SetType::iterator &it, const WeightedSet &s, bool end) : Iterator(it, s, end), parent(&s) {}
+		const_iterator(const SetType::const_iterator &it, const WeightedSet &s, bool end) : Iterator(it, s, end), parent(&s) {}
 
 		IdentifierType first() const {return this->operator *();}
 		double second() const;
@@ -206,7 +217,7 @@ public:
 
 	class range_iterator : public Set::range_iterator {
 	public:
-		range_iterator(const SetType::iterator &it, const WeightedSet &s) : Set::range_iterator(it), it(it), parent(&s) {}
+		range_iterator(const SetType::const_iterator &it, const WeightedSet &s) : Set::range_iterator(it), it(it), parent(&s) {}
 
 		bool operator==(const range_iterator &it2) const {return it2.it == it;}
 		bool operator!=(const range_iterator &it2) const {return it2.it != it;}
@@ -342,6 +353,7 @@ protected:
 	bool isSingleCell() const {return !vpath.empty();}
 	PPathTranslator pathTranslator;
 	friend struct GpuArea;
+	friend class RuleAreaIndex;
 };
 
 class SubCubeList;
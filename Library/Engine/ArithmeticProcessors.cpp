@@ -27,6 +27,7 @@
  *
  */
 
+#include <algorithm>
 #include "Engine/ArithmeticProcessors.h"
 #include "Logger/Logger.h"
 
@@ -278,6 +279,92 @@ vector<CellValueStream *> *ArithmeticProcessor::moveAny(const IdentifiersType &m
 	return anyOperandActive ? &activeOperands : 0;
 }
 
+bool ArithmeticProcessor::nextBatch(CellBatch &batch)
+{
+	size_t ordinal = 0;
+	CellValueStream *operand = getBatchOperand(ordinal);
+	if (!operand) {
+		return CellValueStream::nextBatch(batch);
+	}
+	batch.clear();
+	if (!hasNext[ordinal]) {
+		return false;
+	}
+	bool result = operand->nextBatch(batch);
+	hasNext[ordinal] = result && !batch.isLast();
+	if (!result) {
+		return false;
+	}
+	activeOperands[ordinal] = operand;
+	calculate(ordinal, batch.getValues(), batch.size());
+	if (batch.hasCurrent()) {
+		key = operand->getKey();
+		const CellValue &operandVal = operand->getValue();
+		if (operandVal.isNumeric()) {
+			double numValue = operandVal.getNumeric();
+			calculate(ordinal, &numValue, 1);
+			value = numValue;
+		} else if (operandVal.isError()) {
+			value = operandVal;
+		} else {
+			throw ErrorException(ErrorException::ERROR_INTERNAL, "ArithmeticProcessor::nextBatch invalid operand type!");
+		}
+	} else {
+		batch.getKey(batch.size() - 1, key);
+		value = batch.getValue(batch.size() - 1);
+	}
+	return true;
+}
+
+CellValueStream *ArithmeticProcessor::getSingleOperand(size_t &ordinal)
+{
+	// one stream combined with the constant, nextAll has nothing to align
+	if (operandsCount != 2 || !constValue.isNumeric()) {
+		return 0;
+	}
+	if (streams.empty() && operandsCount) {
+		createInputProcessors();
+	}
+	CellValueStream *result = 0;
+	for (size_t i = 0; i < operandsCount; i++) {
+		if (streams[i]) {
+			if (result) {
+				return 0;
+			}
+			result = streams[i].get();
+			ordinal = i;
+		}
+	}
+	return result;
+}
+
+CellValueStream *ArithmeticProcessor::getLastOperand(size_t &ordinal)
+{
+	// the only stream not yet finished, nextAny has nothing to merge
+	if (streams.empty() && operandsCount) {
+		createInputProcessors();
+	}
+	bool firstCall = key.empty();
+	if (firstCall && operandsCount != 1) {
+		return 0;
+	}
+	CellValueStream *result = 0;
+	for (size_t i = 0; i < operandsCount; i++) {
+		if (hasNext[i]) {
+			if (result) {
+				return 0;
+			}
+			result = streams[i].get();
+			ordinal = i;
+		}
+	}
+	if (result && !firstCall && !activeOperands[ordinal]) {
+		// current value of the stream was not returned yet
+		return 0;
+	}
+	return result;
+}
+
 MultiplicationProcessor::MultiplicationProcessor(PEngineBase engine, CPPlanNode node) : ArithmeticProcessor(engine, node)
 {
 	if (constValue.getNumeric() == 0) {
@@ -335,6 +422,19 @@ bool MultiplicationProcessor::move(const IdentifiersType &key, bool *found)
 	return (operands != 0);
 }
 
+CellValueStream *MultiplicationProcessor::getBatchOperand(size_t &ordinal)
+{
+	return getSingleOperand(ordinal);
+}
+
+void MultiplicationProcessor::calculate(size_t ordinal, double *values, size_t count) const
+{
+	double factor = constValue.getNumeric();
+	for (size_t i = 0; i < count; i++) {
+		values[i] *= factor;
+	}
+}
+
 bool DivisionProcessor::next()
 {
 	vector<CellValueStream *> *operands = nextAll();
@@ -407,6 +507,32 @@ bool DivisionProcessor::move(const IdentifiersType &key, bool *found)
 	return (operands != 0);
 }
 
+CellValueStream *DivisionProcessor::getBatchOperand(size_t &ordinal)
+{
+	CellValueStream *result = getSingleOperand(ordinal);
+	if (result && ordinal && constValue.isEmpty()) {
+		// empty numerator, the result does not depend on the stream
+		return 0;
+	}
+	return result;
+}
+
+void DivisionProcessor::calculate(size_t ordinal, double *values, size_t count) const
+{
+	double constant = constValue.getNumeric();
+	if (ordinal) {
+		for (size_t i = 0; i < count; i++) {
+			values[i] = values[i] == 0 ? 0.0 : constant / values[i];
+		}
+	} else if (constant == 0) {
+		std::fill(values, values + count, 0.0);
+	} else {
+		for (size_t i = 0; i < count; i++) {
+			values[i] /= constant;
+		}
+	}
+}
+
 bool AdditionProcessor::next()
 {
 	vector<CellValueStream *> *operands = nextAny();
@@ -463,6 +589,20 @@ bool AdditionProcessor::move(const IdentifiersType &key, bool *found)
 	return (operands != 0);
 }
 
+CellValueStream *SubtractionProcessor::getBatchOperand(size_t &ordinal)
+{
+	return getLastOperand(ordinal);
+}
+
+void SubtractionProcessor::calculate(size_t ordinal, double *values, size_t count) const
+{
+	if (ordinal) {
+		for (size_t i = 0; i < count; i++) {
+			values[i] = -values[i];
+		}
+	}
+}
+
 bool SubtractionProcessor::next()
 {
 	vector<CellValueStream *> *operands = nextAny();
@@ -47,6 +47,7 @@ public:
 	virtual const GpuBinPath &getBinKey() const {pathTranslator->pathToBinPath(getKey(), const_cast<GpuBinPath &>(binPath)); return binPath;}
 	virtual void reset();
 	virtual bool move(const IdentifiersType &key, bool *found) = 0;
+	virtual bool nextBatch(CellBatch &batch);
 
 protected:
 	void createInputProcessors();
@@ -54,6 +55,14 @@ protected:
 	vector<CellValueStream *> *nextAny();
 	vector<CellValueStream *> *moveAll(const IdentifiersType &key, bool *found);
 	vector<CellValueStream *> *moveAny(const IdentifiersType &key, bool *found);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief operand whose batches can be calculated without aligning other streams
+	////////////////////////////////////////////////////////////////////////////////
+	virtual CellValueStream *getBatchOperand(size_t &ordinal) {return 0;}
+	virtual void calculate(size_t ordinal, double *values, size_t count) const {}
+	CellValueStream *getSingleOperand(size_t &ordinal);
+	CellValueStream *getLastOperand(size_t &ordinal);
 	CellValue value;
 	IdentifiersType key;
 	CellValue constValue;
@@ -74,6 +83,9 @@ public:
 
 	virtual bool next();
 	virtual bool move(const IdentifiersType &key, bool *found);
+protected:
+	virtual CellValueStream *getBatchOperand(size_t &ordinal);
+	virtual void calculate(size_t ordinal, double *values, size_t count) const;
 };
 
 class SERVER_CLASS DivisionProcessor : public ArithmeticProcessor {
@@ -83,6 +95,9 @@ public:
 
 	virtual bool next();
 	virtual bool move(const IdentifiersType &key, bool *found);
+protected:
+	virtual CellValueStream *getBatchOperand(size_t &ordinal);
+	virtual void calculate(size_t ordinal, double *values, size_t count) const;
 };
 
 class SERVER_CLASS AdditionProcessor : public ArithmeticProcessor {
@@ -93,6 +108,8 @@ public:
 
 	virtual bool next();
 	virtual bool move(const IdentifiersType &key, bool *found);
+protected:
+	virtual CellValueStream *getBatchOperand(size_t &ordinal) {return getLastOperand(ordinal);}
 };
 
 class SERVER_CLASS SubtractionProcessor : public ArithmeticProcessor {
@@ -103,6 +120,9 @@ public:
 
 	virtual bool next();
 	virtual bool move(const IdentifiersType &key, bool *found);
+protected:
+	virtual CellValueStream *getBatchOperand(size_t &ordinal);
+	virtual void calculate(size_t ordinal, double *values, size_t count) const;
 };
 
 }
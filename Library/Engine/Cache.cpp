@@ -149,7 +149,7 @@ private:
 	bool end;
 };
 
-ValueCache::QueryCache::QueryCache(CPCube cube, size_t initSize, ValueCache &cache) : cube(cube), areas(new CachedAreas), initSize(initSize), cache(cache)
+ValueCache::QueryCache::QueryCache(CPCube cube, size_t initSize, ValueCache &cache) : cube(cube), areas(new CachedAreas), initSize(initSize), cache(cache), changes(SHARDS_COUNT), insertedShared(false)
 {
 	inserted = CreateDoubleCellMap(cache.keySize);
 }
@@ -157,68 +157,59 @@ ValueCache::QueryCache::QueryCache(CPCube cube, size_t initSize, ValueCache &cac
 ValueCache::QueryCache::~QueryCache()
 {
 	if (areas->size() && Context::getContext(0, false)->getSaveToCache()) {
-		PStorageCpu storage;
-		PCachedAreas currAreas;
-		CubesWithDBs currDependencies;
-		{
-			WriteLocker wl(cache.mutex->getLock());
-			storage = cache.storage;
-			currAreas = cache.areas;
-			currDependencies = cache.sourceCubes;
-		}
-		currAreas.reset(new CachedAreas(*currAreas));
-		if (inserted->size()) {
-			storage = COMMITABLE_CAST(StorageCpu, storage->copy());
-			storage->commitExternalChanges(false, inserted->getValues(), inserted->size(), false);
-			storage->merge(CPCommitable(), PCommitable());
-		}
-
-		for (CachedAreas::iterator it = areas->begin(); it != areas->end(); ++it) {
-			CachedAreas::iterator currit = currAreas->find(it->first);
-			if (currit != currAreas->end()) {
-				currit->second.reset(new SubCubeList(*currit->second));
-				for (SubCubeList::iterator lit = it->second->begin(); lit != it->second->end(); ++lit) {
-					currit->second->insertAndMerge(*lit);
-				}
-			} else {
-				currAreas->insert(*it);
+		for (size_t shard = 0; shard < SHARDS_COUNT; shard++) {
+			if (changes[shard].areas->size()) {
+				cache.commit(shard, changes[shard]);
 			}
 		}
-		currDependencies.insert(sourceCubes.begin(), sourceCubes.end());
-		{
-			WriteLocker wl(cache.mutex->getLock());
-			cache.storage = storage;
-			cache.areas = currAreas;
-			cache.sourceCubes = currDependencies;
-		}
+		enforceBudget();
 	}
 }
 
-void ValueCache::QueryCache::insert(IdentifierType ruleId, CPCubeArea area, PDoubleCellMap vals, const CubesWithDBs &sourceCubes)
+void ValueCache::QueryCache::insert(IdentifierType ruleId, size_t shard, CPCubeArea area, PDoubleCellMap vals, const Footprints &sources, uint64_t computeTime)
 {
-	boost::shared_ptr<SubCubeList> currArea = findArea(ruleId);
-	currArea->insertAndMerge(area);
+	findArea(*areas, ruleId)->insertAndMerge(area);
 	insertVals(vals);
-	this->sourceCubes.insert(sourceCubes.begin(), sourceCubes.end());
+
+	ShardChanges &sc = changes[shard];
+	findArea(*sc.areas, ruleId)->insertAndMerge(area);
+	sc.values.push_back(vals);
+	sc.cells += area->getSize();
+	sc.computeTime += computeTime;
+	sc.entries.push_back(Entry());
+	sc.entries.back().ruleId = ruleId;
+	sc.entries.back().areas.push_back(area);
+	sc.entries.back().sources = sources;
 }
 
-void ValueCache::QueryCache::insert(IdentifierType ruleId, const list<PCubeArea> &ars, PDoubleCellMap vals, const CubesWithDBs &sourceCubes)
+void ValueCache::QueryCache::insert(IdentifierType ruleId, size_t shard, const list<PCubeArea> &ars, PDoubleCellMap vals, const Footprints &sources, uint64_t computeTime)
 {
-	boost::shared_ptr<SubCubeList> currArea = findArea(ruleId);
+	boost::shared_ptr<SubCubeList> currArea = findArea(*areas, ruleId);
+	ShardChanges &sc = changes[shard];
+	boost::shared_ptr<SubCubeList> shardArea = findArea(*sc.areas, ruleId);
+	sc.entries.push_back(Entry());
+	Entry &entry = sc.entries.back();
+	entry.ruleId = ruleId;
+	entry.sources = sources;
 	for (list<PCubeArea>::const_iterator it = ars.begin(); it != ars.end(); ++it) {
 		currArea->insertAndMerge(*it);
+		shardArea->insertAndMerge(*it);
+		sc.cells += (*it)->getSize();
+		entry.areas.push_back(*it);
 	}
 	insertVals(vals);
-	this->sourceCubes.insert(sourceCubes.begin(), sourceCubes.end());
+
+	sc.values.push_back(vals);
+	sc.computeTime += computeTime;
 }
 
-boost::shared_ptr<SubCubeList> ValueCache::QueryCache::findArea(IdentifierType ruleId)
+boost::shared_ptr<SubCubeList> ValueCache::QueryCache::findArea(CachedAreas &areas, IdentifierType ruleId)
 {
-	CachedAreas::iterator it = areas->find(ruleId);
+	CachedAreas::iterator it = areas.find(ruleId);
 	boost::shared_ptr<SubCubeList> currArea;
-	if (it == areas->end()) {
+	if (it == areas.end()) {
 		currArea.reset(new SubCubeList());
-		areas->insert(make_pair(ruleId, currArea));
+		areas.insert(make_pair(ruleId, currArea));
 	} else {
 		currArea = it->second;
 	}
@@ -242,18 +233,29 @@ PProcessorBase ValueCache::QueryCache::getFilteredValues(CPArea area, const Cell
 void ValueCache::QueryCache::insertVals(PDoubleCellMap vals)
 {
 	if (inserted->size()) {
+		if (insertedShared) {
+			// first map is kept by its shard too, don't modify it
+			PDoubleCellMap copy = CreateDoubleCellMap(cache.keySize);
+			PCellStream str = inserted->getValues();
+			while (str->next()) {
+				copy->set(str->getKey(), str->getDouble());
+			}
+			inserted = copy;
+			insertedShared = false;
+		}
 		PCellStream str = vals->getValues();
 		while (str->next()) {
 			inserted->set(str->getKey(), str->getDouble());
 		}
 	} else {
 		inserted = vals;
+		insertedShared = true;
 	}
 }
 
 ValueCache::CacheWriteProcessor::CacheWriteProcessor(QueryCache &cache, CPCubeArea area, PCellStream input, IdentifierType ruleId, size_t initSize) :
 		ProcessorBase(true, PEngineBase()), cache(cache), area(area), input(input), finished(false), nextCalled(false), ruleId(ruleId),
-		initSize(initSize), beginKey(*area->pathBegin()), shared(false)
+		initSize(initSize), beginKey(*area->pathBegin()), shared(false), shard(getShard(*area))
 {
 	if (cache.getBarrier()) {
 		inserted = CreateDoubleCellMap(cache.getKeySize());
@@ -265,8 +267,9 @@ void ValueCache::CacheWriteProcessor::onComplete()
 	if (inserted && !shared) {
 		if (nextCalled) {
 			shared = true;
+			uint64_t computeTime = (boost::posix_time::microsec_clock::universal_time() - startTime).total_microseconds();
 			if (finished) {
-				cache.insert(ruleId, area, inserted, sourceCubes);
+				cache.insert(ruleId, shard, area, inserted, sources, computeTime);
 			} else {
 				list<PCubeArea> result;
 				const IdentifiersType &endKey = input->getKey();
@@ -277,7 +280,7 @@ void ValueCache::CacheWriteProcessor::onComplete()
 				}
 				const IdentifiersType start = beginKey;
 				area->split(start, endKey, result, 0);
-				cache.insert(ruleId, result, inserted, sourceCubes);
+				cache.insert(ruleId, shard, result, inserted, sources, computeTime);
 			}
 		} else {
 			Logger::trace << "Processor created and was not read at all!" << endl;
@@ -297,9 +300,9 @@ ValueCache::CacheWriteProcessor::~CacheWriteProcessor()
 		if (Logger::isTrace()) {
 			ostringstream ss;
 			ss << "Cache dependences detected. Source Cubes: ";
-			for(CubesWithDBs::const_iterator srcCubeIt = sourceCubes.begin(); srcCubeIt != sourceCubes.end(); ++srcCubeIt) {
-				PDatabase db = context->getServer()->lookupDatabase(srcCubeIt->first, false);
-				PCube cube = db->lookupCube(srcCubeIt->second, false);
+			for(Footprints::const_iterator srcCubeIt = sources.begin(); srcCubeIt != sources.end(); ++srcCubeIt) {
+				PDatabase db = context->getServer()->lookupDatabase(srcCubeIt->first.first, false);
+				PCube cube = db->lookupCube(srcCubeIt->first.second, false);
 				ss << db->getName() << "/" << cube->getName() << " ";
 
 			}
@@ -312,6 +315,9 @@ ValueCache::CacheWriteProcessor::~CacheWriteProcessor()
 
 bool ValueCache::CacheWriteProcessor::next()
 {
+	if (!nextCalled) {
+		startTime = boost::posix_time::microsec_clock::universal_time();
+	}
 	bool ret = input->next();
 	nextCalled = true;
 	if (ret && inserted) {
@@ -383,84 +389,515 @@ bool ValueCache::CacheWriteProcessor::move(const IdentifiersType &key, bool *fou
 }
 
 void ValueCache::CacheWriteProcessor::addSourceCube(const dbID_cubeID &dbCubeId) {
-	sourceCubes.insert(dbCubeId);
+	sources[dbCubeId].setWhole();
 }
 
-ValueCache::ValueCache(size_t keySize, double cacheBarrier, size_t generation) : mutex(new PaloSharedMutex()), keySize(keySize), cacheBarrier(cacheBarrier), generation(generation)
+void ValueCache::CacheWriteProcessor::addSourceArea(const dbID_cubeID &dbCubeId, const Area &area) {
+	sources[dbCubeId].add(area);
+}
+
+void ValueCache::CacheWriteProcessor::addSourcePath(const dbID_cubeID &dbCubeId, const IdentifiersType &path) {
+	sources[dbCubeId].add(path);
+}
+
+// dimensions with more elements read are recorded as whole dimension
+static const size_t FOOTPRINT_ELEMENTS_LIMIT = 10000;
+
+void ValueCache::Footprint::add(const Area &area)
+{
+	if (whole) {
+		return;
+	}
+	if (sets.empty()) {
+		sets.resize(area.dimCount());
+	}
+	for (size_t dim = 0; dim < sets.size(); dim++) {
+		PSet &s = sets[dim];
+		if (!s) {
+			s.reset(new Set());
+		} else if (s->size() == (size_t)-1) {
+			continue;
+		}
+		if (area.elemCount(dim) > FOOTPRINT_ELEMENTS_LIMIT - s->size()) {
+			s.reset(new Set(true));
+		} else {
+			for (Area::ConstElemIter it = area.elemBegin(dim); it != area.elemEnd(dim); ++it) {
+				s->insert(*it);
+			}
+		}
+	}
+}
+
+void ValueCache::Footprint::add(const IdentifiersType &path)
+{
+	if (whole) {
+		return;
+	}
+	if (sets.empty()) {
+		sets.resize(path.size());
+	}
+	for (size_t dim = 0; dim < sets.size(); dim++) {
+		PSet &s = sets[dim];
+		if (!s) {
+			s.reset(new Set());
+		} else if (s->size() == (size_t)-1) {
+			continue;
+		}
+		if (s->size() >= FOOTPRINT_ELEMENTS_LIMIT) {
+			s.reset(new Set(true));
+		} else {
+			s->insert(path[dim]);
+		}
+	}
+}
+
+void ValueCache::Footprint::setWhole()
+{
+	whole = true;
+	sets.clear();
+}
+
+bool ValueCache::Footprint::isOverlapping(const Area &area) const
+{
+	if (whole) {
+		return true;
+	}
+	if (sets.empty()) {
+		// nothing read
+		return false;
+	}
+	for (size_t dim = 0; dim < sets.size(); dim++) {
+		CPSet changed = area.getDim(dim);
+		bool overlapping = false;
+		for (Set::range_iterator rit = sets[dim]->rangeBegin(); !overlapping && rit != sets[dim]->rangeEnd(); ++rit) {
+			Set::Iterator it = changed->lowerBound(rit.low());
+			overlapping = it != changed->end() && *it <= rit.high();
+		}
+		if (!overlapping) {
+			return false;
+		}
+	}
+	return true;
+}
+
+double ValueCache::budget = 10000000.0;
+std::atomic<double> ValueCache::inflation(0);
+std::atomic<uint64_t> ValueCache::totalValues(0);
+std::atomic<uint64_t> ValueCache::admissions(0);
+std::atomic<uint64_t> ValueCache::hits(0);
+std::atomic<uint64_t> ValueCache::evictions(0);
+std::atomic<uint64_t> ValueCache::evictedValues(0);
+std::atomic<uint64_t> ValueCache::rejectedCommits(0);
+std::atomic<uint64_t> ValueCache::invalidations(0);
+std::atomic<uint64_t> ValueCache::invalidatedAreas(0);
+
+const size_t ValueCache::SHARDS_COUNT;
+
+// all living caches, needed to find eviction victims
+static Mutex cachesLock;
+static set<ValueCache *> caches;
+
+ValueCache::Shard::Shard() : mutex(new PaloSharedMutex()), areas(new CachedAreas()), values(0), cells(0), found(0), computeTime(0), version(0), epoch(0), priority(0)
+{
+}
+
+ValueCache::ValueCache(size_t keySize, double cacheBarrier, size_t generation) :
+	shards(new Shard[SHARDS_COUNT]), keySize(keySize), cacheBarrier(cacheBarrier), valuesCount(0), revision(0), generation(generation)
 {
 	clear();
+	WriteLocker wl(&cachesLock);
+	caches.insert(this);
+}
+
+ValueCache::~ValueCache()
+{
+	{
+		WriteLocker wl(&cachesLock);
+		caches.erase(this);
+	}
+	totalValues.fetch_sub(valuesCount.load());
+}
+
+size_t ValueCache::getShard(const CubeArea &area)
+{
+	uint64_t hash = 0;
+	for (size_t dim = 0; dim < area.dimCount(); dim++) {
+		uint64_t h = area.elemCount(dim);
+		Area::ConstElemIter it = area.elemBegin(dim);
+		if (it != area.elemEnd(dim)) {
+			h = (h << 32) ^ *it;
+		}
+		hash = (hash ^ h) * 0x9E3779B97F4A7C15ULL;
+		hash ^= hash >> 29;
+	}
+	return size_t(hash % SHARDS_COUNT);
+}
+
+void ValueCache::clearShard(Shard &shard)
+{
+	valuesCount.fetch_sub(shard.values);
+	totalValues.fetch_sub(shard.values);
+	shard.storage.reset();
+	shard.areas.reset(new CachedAreas());
+	shard.sourceCubes.clear();
+	shard.entries.clear();
+	shard.values = 0;
+	shard.cells = 0;
+	shard.found = 0;
+	shard.computeTime = 0;
+	shard.version++;
+	shard.epoch++;
+	shard.priority = 0;
+	revision++;
 }
 
 bool ValueCache::clear()
 {
 	bool result = false;
-	WriteLocker w(mutex->getLock());
-	storage.reset(new StorageCpu(PPathTranslator(), true));
-	storage->merge(CPCommitable(), PCommitable());
-	areas.reset(new CachedAreas());
-	result = !sourceCubes.empty();
-	sourceCubes.clear();
-	found = 0;
+	for (size_t i = 0; i < SHARDS_COUNT; i++) {
+		Shard &shard = shards[i];
+		WriteLocker w(shard.mutex->getLock());
+		result |= !shard.sourceCubes.empty();
+		clearShard(shard);
+	}
 	generation++;
 	time(&invalidationTime);
 	return result;
 }
 
+double ValueCache::getPriority(const Shard &shard) const
+{
+	// GreedyDual-Size: expensive and small shards survive longer
+	double cost = double(shard.computeTime) + shard.cells;
+	return inflation.load() + cost / (shard.values ? shard.values : 1);
+}
+
+void ValueCache::commit(size_t shardIndex, const QueryCache::ShardChanges &changes)
+{
+	Shard &shard = shards[shardIndex];
+	for (;;) {
+		PStorageCpu storage;
+		PCachedAreas currAreas;
+		uint64_t version;
+		uint64_t epoch;
+		{
+			WriteLocker wl(shard.mutex->getLock());
+			storage = shard.storage;
+			currAreas = shard.areas;
+			version = shard.version;
+			epoch = shard.epoch;
+		}
+		if (storage) {
+			storage = COMMITABLE_CAST(StorageCpu, storage->copy());
+		} else {
+			storage.reset(new StorageCpu(PPathTranslator(), true));
+		}
+		for (vector<PDoubleCellMap>::const_iterator it = changes.values.begin(); it != changes.values.end(); ++it) {
+			if ((*it)->size()) {
+				storage->commitExternalChanges(false, (*it)->getValues(), (*it)->size(), false);
+			}
+		}
+		storage->merge(CPCommitable(), PCommitable());
+
+		currAreas.reset(new CachedAreas(*currAreas));
+		for (CachedAreas::iterator it = changes.areas->begin(); it != changes.areas->end(); ++it) {
+			CachedAreas::iterator currit = currAreas->find(it->first);
+			if (currit != currAreas->end()) {
+				currit->second.reset(new SubCubeList(*currit->second));
+				for (SubCubeList::iterator lit = it->second->begin(); lit != it->second->end(); ++lit) {
+					currit->second->insertAndMerge(*lit);
+				}
+			} else {
+				currAreas->insert(*it);
+			}
+		}
+
+		WriteLocker wl(shard.mutex->getLock());
+		if (shard.epoch != epoch) {
+			// shard was cleared or evicted in the meantime, values could be outdated
+			rejectedCommits++;
+			return;
+		}
+		if (shard.version != version) {
+			// concurrent commit to the same shard, merge again
+			continue;
+		}
+		size_t values = storage->valuesCount();
+		valuesCount.fetch_add(values - shard.values);
+		totalValues.fetch_add(values - shard.values);
+		shard.storage = storage;
+		shard.areas = currAreas;
+		for (list<QueryCache::Entry>::const_iterator it = changes.entries.begin(); it != changes.entries.end(); ++it) {
+			for (Footprints::const_iterator sit = it->sources.begin(); sit != it->sources.end(); ++sit) {
+				shard.sourceCubes.insert(sit->first);
+			}
+		}
+		shard.entries.insert(shard.entries.end(), changes.entries.begin(), changes.entries.end());
+		shard.values = values;
+		shard.cells += changes.cells;
+		shard.computeTime += changes.computeTime;
+		shard.version++;
+		shard.priority = getPriority(shard);
+		revision++;
+		admissions++;
+		return;
+	}
+}
+
+void ValueCache::enforceBudget()
+{
+	if (!budget || totalValues.load() <= budget) {
+		return;
+	}
+	WriteLocker wl(&cachesLock);
+	while (totalValues.load() > budget) {
+		ValueCache *victimCache = 0;
+		size_t victimShard = 0;
+		double victimPriority = 0;
+		for (set<ValueCache *>::const_iterator it = caches.begin(); it != caches.end(); ++it) {
+			for (size_t i = 0; i < SHARDS_COUNT; i++) {
+				const Shard &shard = (*it)->shards[i];
+				double priority = shard.priority.load();
+				if (shard.values && (!victimCache || priority < victimPriority)) {
+					victimCache = *it;
+					victimShard = i;
+					victimPriority = priority;
+				}
+			}
+		}
+		if (!victimCache) {
+			break;
+		}
+		Shard &shard = victimCache->shards[victimShard];
+		WriteLocker w(shard.mutex->getLock());
+		if (!shard.values) {
+			// emptied by concurrent clear
+			continue;
+		}
+		if (victimPriority > inflation.load()) {
+			inflation = victimPriority;
+		}
+		evictions++;
+		evictedValues += shard.values;
+		Logger::debug << "cache shard evicted, values: " << shard.values << " priority: " << victimPriority << endl;
+		victimCache->clearShard(shard);
+	}
+}
+
 PProcessorBase ValueCache::getWriter(CPCube cube, CPCubeArea area, PCellStream input, IdentifierType ruleId)
 {
 	Context *context = Context::getContext();
-	boost::shared_ptr<QueryCache> qc = context->getQueryCache(cube, storage->valuesCount(), *this);
+	boost::shared_ptr<QueryCache> qc = context->getQueryCache(cube, getValuesCount(), *this);
 	CacheWriteProcessor *cacheProc = new CacheWriteProcessor(*qc, area, input, ruleId, qc->getInitSize());
 	PProcessorBase result(cacheProc);
 	context->getCacheDependences().insert(cacheProc);
 	return result;
 }
 
-double ValueCache::getAreasAndStorage(PStorageCpu &stor, PCachedAreas &ars)
+void ValueCache::getSnapshots(Snapshots &snapshots)
 {
-	WriteLocker w(mutex->getLock());
-	stor = storage;
-	ars = areas;
-	return found;
+	for (size_t i = 0; i < SHARDS_COUNT; i++) {
+		Shard &shard = shards[i];
+		WriteLocker w(shard.mutex->getLock());
+		if (shard.storage && !shard.areas->empty()) {
+			snapshots.push_back(Snapshot(i, shard.storage, shard.areas));
+		}
+	}
 }
 
-void ValueCache::getStatistics(PStorageCpu cacheStorage, PCachedAreas cacheAreas, double cacheFound, size_t &areasCount, size_t &valuesCount, double &cellCount, double &foundCellsCount)
+void ValueCache::getStatistics(Statistics &stats)
 {
-	areasCount = 0;
-	valuesCount = cacheStorage->valuesCount();
-	cellCount = 0;
-	foundCellsCount = cacheFound;
-	for (CachedAreas::iterator ruleAreas = cacheAreas->begin(); ruleAreas != cacheAreas->end(); ++ruleAreas) {
-		areasCount += ruleAreas->second->size();
-		cellCount += ruleAreas->second->cellCount();
+	for (size_t i = 0; i < SHARDS_COUNT; i++) {
+		CPCachedAreas cacheAreas;
+		{
+			Shard &shard = shards[i];
+			WriteLocker w(shard.mutex->getLock());
+			if (!shard.values && shard.areas->empty()) {
+				continue;
+			}
+			cacheAreas = shard.areas;
+			stats.values += shard.values;
+			stats.found += shard.found;
+			stats.computeTime += shard.computeTime;
+			stats.shards++;
+		}
+		for (CachedAreas::const_iterator ruleAreas = cacheAreas->begin(); ruleAreas != cacheAreas->end(); ++ruleAreas) {
+			stats.areas += ruleAreas->second->size();
+			stats.cells += ruleAreas->second->cellCount();
+		}
 	}
 }
 
-void ValueCache::increaseFound(double f)
+void ValueCache::increaseFound(size_t shardIndex, double f)
 {
-	PStorageCpu cacheStorage;
-	PCachedAreas cacheAreas;
+	Shard &shard = shards[shardIndex];
 	double cacheFound;
-	if (Logger::isDebug()) {
-		WriteLocker w(mutex->getLock());
-		found += f;
-		cacheStorage = storage;
-		cacheAreas = areas;
-		cacheFound = found;
+	{
+		WriteLocker w(shard.mutex->getLock());
+		shard.found += f;
+		shard.priority = getPriority(shard);
+		cacheFound = shard.found;
 	}
-	if (cacheStorage && cacheAreas) {
-		double totalCellCount = 0;
-		size_t areasCount = 0;
-		size_t valuesCount;
-		double foundCellsCount;
-		getStatistics(cacheStorage, cacheAreas, cacheFound, areasCount, valuesCount, totalCellCount, foundCellsCount);
-		Logger::debug << "cells/areas/values in cache: " << totalCellCount << "/" << areasCount << "/" << valuesCount << " Cells found in cache: " <<  f << " Accumulated: " << foundCellsCount << endl;
+	hits++;
+	if (Logger::isDebug()) {
+		Statistics stats;
+		getStatistics(stats);
+		Logger::debug << "cells/areas/values in cache: " << stats.cells << "/" << stats.areas << "/" << stats.values << " Cells found in cache shard " << shardIndex << ": " <<  f << " Accumulated: " << cacheFound << endl;
 	}
 }
 
 bool ValueCache::isDepending(const dbID_cubeID &cubeId) const
 {
-	return sourceCubes.find(cubeId) != sourceCubes.end();
+	for (size_t i = 0; i < SHARDS_COUNT; i++) {
+		const Shard &shard = shards[i];
+		WriteLocker w(shard.mutex->getLock());
+		if (shard.sourceCubes.find(cubeId) != shard.sourceCubes.end()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void subtractArea(SubCubeList &areas, const CubeArea &area)
+{
+	SubCubeList result;
+	for (SubCubeList::iterator it = areas.begin(); it != areas.end(); ++it) {
+		PCubeArea intersection;
+		if (!it->second->intersection(area, &intersection, &result)) {
+			result.push_back(*it);
+		}
+	}
+	areas.swap(result);
+}
+
+bool ValueCache::invalidate(const dbID_cubeID &source, const vector<CPArea> &changed, list<CPCubeArea> &removed)
+{
+	bool result = false;
+	for (size_t i = 0; i < SHARDS_COUNT; i++) {
+		Shard &shard = shards[i];
+		WriteLocker w(shard.mutex->getLock());
+		if (shard.sourceCubes.find(source) == shard.sourceCubes.end()) {
+			continue;
+		}
+		PCachedAreas areas;
+		set<IdentifierType> copiedRules;
+		list<CPCubeArea> shardRemoved;
+		for (list<QueryCache::Entry>::iterator it = shard.entries.begin(); it != shard.entries.end();) {
+			Footprints::const_iterator fit = it->sources.find(source);
+			bool overlapping = false;
+			if (fit != it->sources.end()) {
+				for (vector<CPArea>::const_iterator ait = changed.begin(); !overlapping && ait != changed.end(); ++ait) {
+					overlapping = fit->second.isOverlapping(**ait);
+				}
+			}
+			if (!overlapping) {
+				++it;
+				continue;
+			}
+			if (!areas) {
+				areas.reset(new CachedAreas(*shard.areas));
+			}
+			CachedAreas::iterator rit = areas->find(it->ruleId);
+			if (rit != areas->end()) {
+				if (copiedRules.insert(it->ruleId).second) {
+					rit->second.reset(new SubCubeList(*rit->second));
+				}
+				for (list<CPCubeArea>::const_iterator ait = it->areas.begin(); ait != it->areas.end(); ++ait) {
+					subtractArea(*rit->second, **ait);
+				}
+				if (rit->second->empty()) {
+					areas->erase(rit);
+				}
+			}
+			shardRemoved.insert(shardRemoved.end(), it->areas.begin(), it->areas.end());
+			it = shard.entries.erase(it);
+		}
+		if (!areas) {
+			continue;
+		}
+		result = true;
+		invalidations++;
+		invalidatedAreas += shardRemoved.size();
+		removed.insert(removed.end(), shardRemoved.begin(), shardRemoved.end());
+		if (areas->empty()) {
+			clearShard(shard);
+			continue;
+		}
+
+		// drop values of removed areas, recalculated values can be empty
+		PStorageCpu storage(new StorageCpu(PPathTranslator(), true));
+		if (shard.storage) {
+			PDoubleCellMap kept = CreateDoubleCellMap(keySize);
+			PProcessorBase values = shard.storage->getCellValues(PArea());
+			while (values->next()) {
+				const IdentifiersType &key = values->getKey();
+				list<CPCubeArea>::const_iterator ait = shardRemoved.begin();
+				while (ait != shardRemoved.end() && (*ait)->find(key) == (*ait)->pathEnd()) {
+					++ait;
+				}
+				if (ait == shardRemoved.end()) {
+					kept->set(key, values->getDouble());
+				}
+			}
+			if (kept->size()) {
+				storage->commitExternalChanges(false, kept->getValues(), kept->size(), false);
+			}
+		}
+		storage->merge(CPCommitable(), PCommitable());
+		for (list<CPCubeArea>::const_iterator ait = shardRemoved.begin(); ait != shardRemoved.end(); ++ait) {
+			shard.cells -= (*ait)->getSize();
+		}
+		if (shard.cells < 0) {
+			shard.cells = 0;
+		}
+
+		size_t values = storage->valuesCount();
+		valuesCount.fetch_sub(shard.values - values);
+		totalValues.fetch_sub(shard.values - values);
+		shard.storage = storage;
+		shard.areas = areas;
+		shard.values = values;
+		shard.sourceCubes.clear();
+		for (list<QueryCache::Entry>::const_iterator it = shard.entries.begin(); it != shard.entries.end(); ++it) {
+			for (Footprints::const_iterator sit = it->sources.begin(); sit != it->sources.end(); ++sit) {
+				shard.sourceCubes.insert(sit->first);
+			}
+		}
+		shard.version++;
+		shard.epoch++;
+		shard.priority = getPriority(shard);
+		revision++;
+	}
+	return result;
+}
+
+void ValueCache::setBudget(double budget)
+{
+	ValueCache::budget = budget;
+}
+
+double ValueCache::getBudget()
+{
+	return budget;
+}
+
+ValueCache::GlobalStatistics ValueCache::getGlobalStatistics()
+{
+	GlobalStatistics stats;
+	stats.budget = budget;
+	stats.values = totalValues.load();
+	{
+		WriteLocker wl(&cachesLock);
+		stats.caches = caches.size();
+	}
+	stats.admissions = admissions.load();
+	stats.hits = hits.load();
+	stats.evictions = evictions.load();
+	stats.evictedValues = evictedValues.load();
+	stats.rejectedCommits = rejectedCommits.load();
+	stats.invalidations = invalidations.load();
+	stats.invalidatedAreas = invalidatedAreas.load();
+	return stats;
 }
 
 }
@@ -35,21 +35,93 @@
 #include "Engine/StorageCpu.h"
 #include "Olap/SubCubeList.h"
 
+#include <atomic>
+#include <boost/scoped_array.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 namespace palo {
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief cache of calculated values of a cube
+///
+/// Cached areas are spread over shards by hash of the area. Every shard has its
+/// own lock, storage and cost accounting (cells computed, compute time) and is
+/// the unit of eviction. All caches share one budget of cached values, when it
+/// is exceeded the shards with the lowest GreedyDual-Size priority are evicted
+/// (priority = inflation + cost / values, refreshed on every hit).
+///
+/// Every cached area keeps the footprint of the source cubes cells it was
+/// calculated from, a change of cells removes only the overlapping areas.
+/// Source cubes with active rules are always recorded as whole cube.
+////////////////////////////////////////////////////////////////////////////////
+
 class SERVER_CLASS ValueCache {
 public:
 	typedef map<IdentifierType, boost::shared_ptr<SubCubeList> > CachedAreas;
 	typedef boost::shared_ptr<CachedAreas> PCachedAreas;
 	typedef boost::shared_ptr<const CachedAreas> CPCachedAreas;
 
+	static const size_t SHARDS_COUNT = 16;
+
+	struct Snapshot {
+		Snapshot(size_t shard, PStorageCpu storage, CPCachedAreas areas) : shard(shard), storage(storage), areas(areas) {}
+
+		size_t shard;
+		PStorageCpu storage;
+		CPCachedAreas areas;
+	};
+	typedef vector<Snapshot> Snapshots;
+
+	struct Statistics {
+		Statistics() : areas(0), values(0), cells(0), found(0), computeTime(0), shards(0) {}
+
+		size_t areas;
+		size_t values;
+		double cells;
+		double found;
+		uint64_t computeTime;
+		size_t shards;
+	};
+
+	struct GlobalStatistics {
+		double budget;
+		uint64_t values;
+		uint64_t caches;
+		uint64_t admissions;
+		uint64_t hits;
+		uint64_t evictions;
+		uint64_t evictedValues;
+		uint64_t rejectedCommits;
+		uint64_t invalidations;
+		uint64_t invalidatedAreas;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief cells of one source cube read during calculation of cached values
+	///
+	/// Bounding box of the paths, no sets means unknown footprint (whole cube).
+	////////////////////////////////////////////////////////////////////////////////
+	struct Footprint {
+		Footprint() : whole(false) {}
+
+		void add(const Area &area);
+		void add(const IdentifiersType &path);
+		void setWhole();
+		bool isOverlapping(const Area &area) const;
+
+		vector<PSet> sets;
+		bool whole;
+	};
+	typedef map<dbID_cubeID, Footprint> Footprints;
+
 	class QueryCache {
+		friend class ValueCache;
 	public:
 		QueryCache(CPCube cube, size_t initSize, ValueCache &cache);
 		~QueryCache();
 
-		void insert(IdentifierType ruleId, CPCubeArea area, PDoubleCellMap vals, const CubesWithDBs &sourceCubes);
-		void insert(IdentifierType ruleId, const list<PCubeArea> &ars, PDoubleCellMap vals, const CubesWithDBs &sourceCubes);
+		void insert(IdentifierType ruleId, size_t shard, CPCubeArea area, PDoubleCellMap vals, const Footprints &sources, uint64_t computeTime);
+		void insert(IdentifierType ruleId, size_t shard, const list<PCubeArea> &ars, PDoubleCellMap vals, const Footprints &sources, uint64_t computeTime);
 
 		size_t getKeySize() {return cache.keySize;}
 		double getBarrier() {return cache.cacheBarrier;}
@@ -59,7 +131,23 @@ public:
 		PProcessorBase getFilteredValues(CPArea area, const CellValue *defaultValue);
 
 	private:
-		boost::shared_ptr<SubCubeList> findArea(IdentifierType ruleId);
+		struct Entry {
+			IdentifierType ruleId;
+			list<CPCubeArea> areas;
+			Footprints sources;
+		};
+
+		struct ShardChanges {
+			ShardChanges() : areas(new CachedAreas()), cells(0), computeTime(0) {}
+
+			PCachedAreas areas;
+			vector<PDoubleCellMap> values;
+			double cells;
+			uint64_t computeTime;
+			list<Entry> entries;
+		};
+
+		static boost::shared_ptr<SubCubeList> findArea(CachedAreas &areas, IdentifierType ruleId);
 		void insertVals(PDoubleCellMap vals);
 
 		CPCube cube;
@@ -67,7 +155,8 @@ public:
 		PCachedAreas areas;
 		size_t initSize;
 		ValueCache &cache;
-		CubesWithDBs sourceCubes;
+		vector<ShardChanges> changes;
+		bool insertedShared;
 	};
 
 	class CacheWriteProcessor : public ProcessorBase {
@@ -81,6 +170,8 @@ public:
 		virtual void reset();
 		virtual bool move(const IdentifiersType &key, bool *found);
 		void addSourceCube(const dbID_cubeID &dbCubeId);
+		void addSourceArea(const dbID_cubeID &dbCubeId, const Area &area);
+		void addSourcePath(const dbID_cubeID &dbCubeId, const IdentifiersType &path);
 		CPCubeArea getCubeArea() const {return area;}
 		PCellStream getInputProcessor() {return input;}
 	private:
@@ -94,35 +185,95 @@ public:
 		IdentifierType ruleId;
 		PDoubleCellMap inserted;
 		size_t initSize;
-		CubesWithDBs sourceCubes;
+		Footprints sources;
 		IdentifiersType beginKey;
 		bool shared;
+		size_t shard;
+		boost::posix_time::ptime startTime;
 	};
 
 	ValueCache(size_t keySize, double cacheBarrier, size_t generation);
-	~ValueCache() {}
+	~ValueCache();
 	bool clear();
 	PProcessorBase getWriter(CPCube cube, CPCubeArea area, PCellStream input, IdentifierType ruleId);
-	double getAreasAndStorage(PStorageCpu &stor, PCachedAreas &ars);
-	static void getStatistics(PStorageCpu cacheStorage, PCachedAreas cacheAreas, double cacheFound, size_t &areas, size_t &values, double &cells, double &foundCellsCount);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief storage and areas of all non-empty shards
+	////////////////////////////////////////////////////////////////////////////////
+	void getSnapshots(Snapshots &snapshots);
+
+	void getStatistics(Statistics &stats);
 	double getBarrier() const {return cacheBarrier;}
-	void increaseFound(double f);
+	void increaseFound(size_t shard, double f);
 	bool isDepending(const dbID_cubeID &cubeId) const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief removes cached areas calculated from changed cells of source cube
+	///
+	/// Removed areas are appended to removed, returns true if anything was removed.
+	////////////////////////////////////////////////////////////////////////////////
+	bool invalidate(const dbID_cubeID &source, const vector<CPArea> &changed, list<CPCubeArea> &removed);
 	size_t getGeneration() const {return generation;}
 	time_t getInvalidationTime() const {return invalidationTime;}
+	size_t getValuesCount() const {return valuesCount.load(std::memory_order_relaxed);}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief changes with every commit, invalidation and eviction
+	////////////////////////////////////////////////////////////////////////////////
+	uint64_t getRevision() const {return revision.load();}
+
+	static size_t getShard(const CubeArea &area);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief maximal number of values cached in all cubes, 0 means unlimited
+	////////////////////////////////////////////////////////////////////////////////
+	static void setBudget(double budget);
+	static double getBudget();
+	static GlobalStatistics getGlobalStatistics();
 
 private:
+	struct Shard {
+		Shard();
+
+		PSharedMutex mutex;
+		PStorageCpu storage;
+		PCachedAreas areas;
+		CubesWithDBs sourceCubes;
+		list<QueryCache::Entry> entries;
+		size_t values;
+		double cells;
+		double found;
+		uint64_t computeTime;
+		uint64_t version;
+		uint64_t epoch;
+		std::atomic<double> priority;
+	};
+
 	ValueCache(const ValueCache &);
 
-	PSharedMutex mutex;
-	PStorageCpu storage;
-	PCachedAreas areas;
+	void commit(size_t shard, const QueryCache::ShardChanges &changes);
+	void clearShard(Shard &shard);
+	double getPriority(const Shard &shard) const;
+	static void enforceBudget();
+
+	boost::scoped_array<Shard> shards;
 	size_t keySize;
 	double cacheBarrier;
-	double found;
-	CubesWithDBs sourceCubes;
+	std::atomic<size_t> valuesCount;
+	std::atomic<uint64_t> revision;
 	size_t generation;
 	time_t invalidationTime;
+
+	static double budget;
+	static std::atomic<double> inflation;
+	static std::atomic<uint64_t> totalValues;
+	static std::atomic<uint64_t> admissions;
+	static std::atomic<uint64_t> hits;
+	static std::atomic<uint64_t> evictions;
+	static std::atomic<uint64_t> evictedValues;
+	static std::atomic<uint64_t> rejectedCommits;
+	static std::atomic<uint64_t> invalidations;
+	static std::atomic<uint64_t> invalidatedAreas;
 };
 }
 
@@ -0,0 +1,810 @@
+/* 
+ *
+ * Copyright (C) 2006-2014 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * 
+ *
+ */
+
+//#define PROFILE_COLUMNAR
+
+#include "palo.h"
+#include "Logger/Logger.h"
+#include "Exceptions/ErrorException.h"
+#include "InputOutput/FileReader.h"
+#include "InputOutput/FileWriter.h"
+
+#include "Engine/ColumnarStorage.h"
+#include "Engine/StorageCpu.h"
+#include "Engine/AggregationProcessor.h"
+
+#ifdef PROFILE_COLUMNAR
+#include <boost/date_time/posix_time/ptime.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+using namespace boost::posix_time;
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COLUMNAR_SSE2 1
+#define COLUMNAR_AVX2 1
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+#define COLUMNAR_SSE2 1
+#include <intrin.h>
+#include <emmintrin.h>
+#endif
+
+namespace palo {
+
+////////////////////////////////////////////////////////////////////////////////
+// scan kernels
+////////////////////////////////////////////////////////////////////////////////
+
+static inline uint32_t lowestBit(uint32_t bits)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, bits);
+	return (uint32_t)index;
+#else
+	return (uint32_t)__builtin_ctz(bits);
+#endif
+}
+
+// x in [low, high] <=> (x - low) <= (high - low) in unsigned arithmetic
+static void selectRangeScalar(const uint32_t *column, size_t count, uint32_t low, uint32_t high, uint8_t *mask)
+{
+	uint32_t span = high - low;
+	for (size_t i = 0; i < count; i++) {
+		if (column[i] - low <= span) {
+			mask[i] = 0xFF;
+		}
+	}
+}
+
+static void andMaskScalar(uint8_t *mask, const uint8_t *other, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		mask[i] &= other[i];
+	}
+}
+
+static size_t selectRowsScalar(const uint8_t *mask, size_t count, uint32_t *rows, uint32_t first)
+{
+	size_t selected = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (mask[i]) {
+			rows[selected++] = first + (uint32_t)i;
+		}
+	}
+	return selected;
+}
+
+static void gatherAddScalar(const uint32_t *column, const uint32_t *rows, size_t count, uint32_t base, const uint32_t *table, uint32_t *sums, uint32_t *flags)
+{
+	for (size_t k = 0; k < count; k++) {
+		uint32_t entry = table[column[rows[k]] - base];
+		sums[k] += entry;
+		flags[k] |= entry;
+	}
+}
+
+#ifdef COLUMNAR_SSE2
+// unsigned comparison done as signed one on values with flipped highest bit
+static inline __m128i outOfRange4(const uint32_t *column, __m128i low, __m128i span, __m128i bias)
+{
+	__m128i x = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)column), low);
+	return _mm_cmpgt_epi32(_mm_xor_si128(x, bias), span);
+}
+
+static void selectRangeSse2(const uint32_t *column, size_t count, uint32_t low, uint32_t high, uint8_t *mask)
+{
+	const __m128i bias = _mm_set1_epi32((int)0x80000000);
+	const __m128i vlow = _mm_set1_epi32((int)low);
+	const __m128i vspan = _mm_xor_si128(_mm_set1_epi32((int)(high - low)), bias);
+	const __m128i ones = _mm_set1_epi32(-1);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i o01 = _mm_packs_epi32(outOfRange4(column + i, vlow, vspan, bias), outOfRange4(column + i + 4, vlow, vspan, bias));
+		__m128i o23 = _mm_packs_epi32(outOfRange4(column + i + 8, vlow, vspan, bias), outOfRange4(column + i + 12, vlow, vspan, bias));
+		__m128i out = _mm_packs_epi16(o01, o23);
+		__m128i m = _mm_loadu_si128((const __m128i *)(mask + i));
+		_mm_storeu_si128((__m128i *)(mask + i), _mm_or_si128(m, _mm_andnot_si128(out, ones)));
+	}
+	selectRangeScalar(column + i, count - i, low, high, mask + i);
+}
+
+static void andMaskSse2(uint8_t *mask, const uint8_t *other, size_t count)
+{
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i m = _mm_loadu_si128((const __m128i *)(mask + i));
+		__m128i o = _mm_loadu_si128((const __m128i *)(other + i));
+		_mm_storeu_si128((__m128i *)(mask + i), _mm_and_si128(m, o));
+	}
+	andMaskScalar(mask + i, other + i, count - i);
+}
+
+static size_t selectRowsSse2(const uint8_t *mask, size_t count, uint32_t *rows)
+{
+	const __m128i zero = _mm_setzero_si128();
+	size_t selected = 0;
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i m = _mm_loadu_si128((const __m128i *)(mask + i));
+		uint32_t bits = (uint32_t)(~_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero)) & 0xFFFF);
+		while (bits) {
+			rows[selected++] = (uint32_t)i + lowestBit(bits);
+			bits &= bits - 1;
+		}
+	}
+	return selected + selectRowsScalar(mask + i, count - i, rows + selected, (uint32_t)i);
+}
+#endif
+
+#ifdef COLUMNAR_AVX2
+static inline __m256i outOfRange8(const uint32_t *column, __m256i low, __m256i span, __m256i bias) __attribute__((target("avx2")));
+static inline __m256i outOfRange8(const uint32_t *column, __m256i low, __m256i span, __m256i bias)
+{
+	__m256i x = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)column), low);
+	return _mm256_cmpgt_epi32(_mm256_xor_si256(x, bias), span);
+}
+
+__attribute__((target("avx2")))
+static void selectRangeAvx2(const uint32_t *column, size_t count, uint32_t low, uint32_t high, uint8_t *mask)
+{
+	const __m256i bias = _mm256_set1_epi32((int)0x80000000);
+	const __m256i vlow = _mm256_set1_epi32((int)low);
+	const __m256i vspan = _mm256_xor_si256(_mm256_set1_epi32((int)(high - low)), bias);
+	const __m256i ones = _mm256_set1_epi32(-1);
+	// packs work within 128 bit lanes, this restores the order of 32 bit groups
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256i o01 = _mm256_packs_epi32(outOfRange8(column + i, vlow, vspan, bias), outOfRange8(column + i + 8, vlow, vspan, bias));
+		__m256i o23 = _mm256_packs_epi32(outOfRange8(column + i + 16, vlow, vspan, bias), outOfRange8(column + i + 24, vlow, vspan, bias));
+		__m256i out = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(o01, o23), order);
+		__m256i m = _mm256_loadu_si256((const __m256i *)(mask + i));
+		_mm256_storeu_si256((__m256i *)(mask + i), _mm256_or_si256(m, _mm256_andnot_si256(out, ones)));
+	}
+	selectRangeSse2(column + i, count - i, low, high, mask + i);
+}
+
+__attribute__((target("avx2")))
+static void gatherAddAvx2(const uint32_t *column, const uint32_t *rows, size_t count, uint32_t base, const uint32_t *table, uint32_t *sums, uint32_t *flags)
+{
+	const __m256i vbase = _mm256_set1_epi32((int)base);
+	size_t k = 0;
+	for (; k + 8 <= count; k += 8) {
+		__m256i r = _mm256_loadu_si256((const __m256i *)(rows + k));
+		__m256i ids = _mm256_i32gather_epi32((const int *)column, r, 4);
+		__m256i entries = _mm256_i32gather_epi32((const int *)table, _mm256_sub_epi32(ids, vbase), 4);
+		__m256i s = _mm256_loadu_si256((const __m256i *)(sums + k));
+		__m256i f = _mm256_loadu_si256((const __m256i *)(flags + k));
+		_mm256_storeu_si256((__m256i *)(sums + k), _mm256_add_epi32(s, entries));
+		_mm256_storeu_si256((__m256i *)(flags + k), _mm256_or_si256(f, entries));
+	}
+	gatherAddScalar(column, rows + k, count - k, base, table, sums + k, flags + k);
+}
+#endif
+
+struct ColumnarKernelTable {
+	void (*selectRange)(const uint32_t *, size_t, uint32_t, uint32_t, uint8_t *);
+	void (*andMask)(uint8_t *, const uint8_t *, size_t);
+	size_t (*selectRows)(const uint8_t *, size_t, uint32_t *);
+	void (*gatherAdd)(const uint32_t *, const uint32_t *, size_t, uint32_t, const uint32_t *, uint32_t *, uint32_t *);
+	const char *name;
+};
+
+static size_t selectRowsPlain(const uint8_t *mask, size_t count, uint32_t *rows)
+{
+	return selectRowsScalar(mask, count, rows, 0);
+}
+
+static ColumnarKernelTable selectKernels()
+{
+	ColumnarKernelTable table;
+	table.selectRange = selectRangeScalar;
+	table.andMask = andMaskScalar;
+	table.selectRows = selectRowsPlain;
+	table.gatherAdd = gatherAddScalar;
+	table.name = "scalar";
+#ifdef COLUMNAR_SSE2
+	table.selectRange = selectRangeSse2;
+	table.andMask = andMaskSse2;
+	table.selectRows = selectRowsSse2;
+	table.name = "sse2";
+#endif
+#ifdef COLUMNAR_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		table.selectRange = selectRangeAvx2;
+		table.gatherAdd = gatherAddAvx2;
+		table.name = "avx2";
+	}
+#endif
+	return table;
+}
+
+static const ColumnarKernelTable kernels = selectKernels();
+
+void ColumnarKernels::selectRange(const uint32_t *column, size_t count, uint32_t low, uint32_t high, uint8_t *mask)
+{
+	kernels.selectRange(column, count, low, high, mask);
+}
+
+void ColumnarKernels::andMask(uint8_t *mask, const uint8_t *other, size_t count)
+{
+	kernels.andMask(mask, other, count);
+}
+
+size_t ColumnarKernels::selectRows(const uint8_t *mask, size_t count, uint32_t *rows)
+{
+	return kernels.selectRows(mask, count, rows);
+}
+
+void ColumnarKernels::gatherAdd(const uint32_t *column, const uint32_t *rows, size_t count, uint32_t base, const uint32_t *table, uint32_t *sums, uint32_t *flags)
+{
+	kernels.gatherAdd(column, rows, count, base, table, sums, flags);
+}
+
+const char *ColumnarKernels::getImplementation()
+{
+	return kernels.name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ColumnarPage
+////////////////////////////////////////////////////////////////////////////////
+
+ColumnarPage::ColumnarPage(size_t dimCount) :
+	dimCount(dimCount), count(0), keys(dimCount * CELLS_PER_PAGE), values(CELLS_PER_PAGE), minIds(dimCount, NO_IDENTIFIER), maxIds(dimCount, 0)
+{
+}
+
+int ColumnarPage::compareLast(const IdentifiersType &key) const
+{
+	if (!count) {
+		return -1;
+	}
+	size_t row = count - 1;
+	for (size_t dim = 0; dim < dimCount; dim++) {
+		uint32_t id = keys[dim * CELLS_PER_PAGE + row];
+		if (id < key[dim]) {
+			return -1;
+		} else if (id > key[dim]) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void ColumnarPage::push_back(const IdentifierType *key, double value)
+{
+	for (size_t dim = 0; dim < dimCount; dim++) {
+		keys[dim * CELLS_PER_PAGE + count] = key[dim];
+		if (key[dim] < minIds[dim]) {
+			minIds[dim] = key[dim];
+		}
+		if (key[dim] > maxIds[dim]) {
+			maxIds[dim] = key[dim];
+		}
+	}
+	values[count++] = value;
+}
+
+void ColumnarPage::load(FileReader *file)
+{
+	uint32_t size;
+	file->getRaw((char *)&size, sizeof(uint32_t));
+	if (size > CELLS_PER_PAGE) {
+		throw ErrorException(ErrorException::ERROR_CORRUPT_FILE, "invalid size of columnar page");
+	}
+	count = size;
+	for (size_t dim = 0; dim < dimCount; dim++) {
+		uint32_t *column = &keys[dim * CELLS_PER_PAGE];
+		if (count) {
+			file->getRaw((char *)column, count * sizeof(uint32_t));
+		}
+		minIds[dim] = NO_IDENTIFIER;
+		maxIds[dim] = 0;
+		for (size_t row = 0; row < count; row++) {
+			if (column[row] < minIds[dim]) {
+				minIds[dim] = column[row];
+			}
+			if (column[row] > maxIds[dim]) {
+				maxIds[dim] = column[row];
+			}
+		}
+	}
+	if (count) {
+		file->getRaw((char *)&values[0], count * sizeof(double));
+	}
+}
+
+void ColumnarPage::save(FileWriter *file) const
+{
+	uint32_t size = (uint32_t)count;
+	file->appendRaw((const char *)&size, sizeof(uint32_t));
+	if (count) {
+		for (size_t dim = 0; dim < dimCount; dim++) {
+			file->appendRaw((const char *)&keys[dim * CELLS_PER_PAGE], count * sizeof(uint32_t));
+		}
+		file->appendRaw((const char *)&values[0], count * sizeof(double));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ColumnarPageList
+////////////////////////////////////////////////////////////////////////////////
+
+void ColumnarPageList::push_back(const IdentifiersType &key, double value)
+{
+	if (pages.empty() || pages.back()->full()) {
+		pages.push_back(PColumnarPage(new ColumnarPage(dimCount)));
+	}
+	pages.back()->push_back(&key[0], value);
+	for (size_t dim = 0; dim < dimCount; dim++) {
+		if (key[dim] < minIds[dim]) {
+			minIds[dim] = key[dim];
+		}
+		if (key[dim] > maxIds[dim]) {
+			maxIds[dim] = key[dim];
+		}
+	}
+	cellCount++;
+}
+
+size_t ColumnarPageList::findPage(const IdentifiersType &key, size_t fromPage) const
+{
+	size_t low = fromPage;
+	size_t high = pages.size();
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		if (pages[middle]->compareLast(key) < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+void ColumnarPageList::load(FileReader *file)
+{
+	uint32_t dims;
+	uint64_t count;
+	file->getRaw((char *)&dims, sizeof(uint32_t));
+	file->getRaw((char *)&count, sizeof(uint64_t));
+
+	dimCount = dims;
+	cellCount = 0;
+	pages.clear();
+	pages.reserve((size_t)count);
+	minIds.assign(dimCount, NO_IDENTIFIER);
+	maxIds.assign(dimCount, 0);
+	for (uint64_t i = 0; i < count; i++) {
+		PColumnarPage page(new ColumnarPage(dimCount));
+		page->load(file);
+		for (size_t dim = 0; dim < dimCount && page->size(); dim++) {
+			if (page->getMin(dim) < minIds[dim]) {
+				minIds[dim] = page->getMin(dim);
+			}
+			if (page->getMax(dim) > maxIds[dim]) {
+				maxIds[dim] = page->getMax(dim);
+			}
+		}
+		cellCount += page->size();
+		pages.push_back(page);
+	}
+}
+
+void ColumnarPageList::save(FileWriter *file) const
+{
+	uint32_t dims = (uint32_t)dimCount;
+	uint64_t count = pages.size();
+	file->appendRaw((const char *)&dims, sizeof(uint32_t));
+	file->appendRaw((const char *)&count, sizeof(uint64_t));
+	for (vector<PColumnarPage>::const_iterator it = pages.begin(); it != pages.end(); ++it) {
+		(*it)->save(file);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ColumnarProcessor
+////////////////////////////////////////////////////////////////////////////////
+
+const uint32_t ColumnarProcessor::MULTI_TARGET;
+const uint32_t ColumnarProcessor::NO_TARGET;
+
+ColumnarProcessor::ColumnarProcessor(StorageCpu &storage, CPColumnarPageList pages, CPArea area) :
+	ProcessorBase(true, PEngineBase()), pstorage(storage.shared_from_this()), storage(storage), pages(pages), area(area), dimCount(pages->getDimCount()),
+	mask(ColumnarPage::CELLS_PER_PAGE), dimMask(ColumnarPage::CELLS_PER_PAGE), rows(ColumnarPage::CELLS_PER_PAGE), vkey(dimCount), value(0)
+{
+	if (area) {
+		if (area->dimCount() != dimCount && pages->size()) {
+			throw ErrorException(ErrorException::ERROR_INTERNAL, "ColumnarProcessor: different key dimensionality");
+		}
+		for (size_t dim = 0; dim < area->dimCount(); dim++) {
+			sets.push_back(area->getDim(dim).get());
+		}
+	}
+	reset();
+}
+
+void ColumnarProcessor::reset()
+{
+	currentPage = NO_PAGE;
+	selectedCount = 0;
+	selectedPos = 0;
+	endReached = pages->pageCount() == 0;
+}
+
+bool ColumnarProcessor::filterDim(const ColumnarPage &page, size_t dim)
+{
+	const Set *set = sets[dim];
+	uint32_t pageMin = page.getMin(dim);
+	uint32_t pageMax = page.getMax(dim);
+
+	IdentifierType lows[MAX_SIMD_RANGES];
+	IdentifierType highs[MAX_SIMD_RANGES];
+	size_t rangesCount = 0;
+	bool tooManyRanges = false;
+	for (Set::range_iterator it = set->rangeLowerBound(pageMin); it != set->rangeEnd() && it.low() <= pageMax; ++it) {
+		if (it.high() < pageMin) {
+			continue;
+		}
+		if (it.low() <= pageMin && it.high() >= pageMax) {
+			// whole page is inside of one range
+			return true;
+		}
+		if (rangesCount == MAX_SIMD_RANGES) {
+			tooManyRanges = true;
+			break;
+		}
+		lows[rangesCount] = it.low();
+		highs[rangesCount] = it.high();
+		rangesCount++;
+	}
+	if (!rangesCount) {
+		return false;
+	}
+
+	size_t count = page.size();
+	const uint32_t *column = page.getColumn(dim);
+	if (tooManyRanges) {
+		for (size_t row = 0; row < count; row++) {
+			if (mask[row] && set->find(column[row]) == set->end()) {
+				mask[row] = 0;
+			}
+		}
+	} else {
+		memset(&dimMask[0], 0, count);
+		for (size_t i = 0; i < rangesCount; i++) {
+			ColumnarKernels::selectRange(column, count, lows[i], highs[i], &dimMask[0]);
+		}
+		ColumnarKernels::andMask(&mask[0], &dimMask[0], count);
+	}
+	return true;
+}
+
+bool ColumnarProcessor::selectPage(size_t pageNr)
+{
+	const ColumnarPage &page = pages->getPage(pageNr);
+	memset(&mask[0], 0xFF, page.size());
+	if (area) {
+		for (size_t dim = 0; dim < dimCount; dim++) {
+			if (!filterDim(page, dim)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool ColumnarProcessor::loadPage(size_t pageNr)
+{
+	for (; pageNr < pages->pageCount(); pageNr++) {
+		if (selectPage(pageNr)) {
+			selectedCount = ColumnarKernels::selectRows(&mask[0], pages->getPage(pageNr).size(), &rows[0]);
+			if (selectedCount) {
+				currentPage = pageNr;
+				selectedPos = 0;
+				return true;
+			}
+		}
+	}
+	currentPage = pages->pageCount();
+	selectedCount = 0;
+	selectedPos = 0;
+	endReached = true;
+	return false;
+}
+
+void ColumnarProcessor::readRow()
+{
+	const ColumnarPage &page = pages->getPage(currentPage);
+	uint32_t row = rows[selectedPos];
+	for (size_t dim = 0; dim < dimCount; dim++) {
+		vkey[dim] = page.getColumn(dim)[row];
+	}
+	value = page.getValues()[row];
+}
+
+int ColumnarProcessor::compareRow(const ColumnarPage &page, uint32_t row, const IdentifiersType &key) const
+{
+	for (size_t dim = 0; dim < dimCount; dim++) {
+		uint32_t id = page.getColumn(dim)[row];
+		if (id < key[dim]) {
+			return -1;
+		} else if (id > key[dim]) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+bool ColumnarProcessor::next()
+{
+	if (endReached) {
+		return false;
+	}
+	if (currentPage == NO_PAGE) {
+		if (!loadPage(0)) {
+			return false;
+		}
+	} else if (++selectedPos >= selectedCount) {
+		if (!loadPage(currentPage + 1)) {
+			return false;
+		}
+	}
+	readRow();
+	return true;
+}
+
+bool ColumnarProcessor::move(const IdentifiersType &key, bool *found)
+{
+	if (found) {
+		*found = false;
+	}
+	if (endReached) {
+		return false;
+	}
+	if (currentPage != NO_PAGE) {
+		int compare = key.compare(vkey);
+		if (compare <= 0) {
+			if (found) {
+				*found = !compare;
+			}
+			return true;
+		}
+	}
+
+	size_t pageNr = pages->findPage(key, currentPage == NO_PAGE ? 0 : currentPage);
+	if (pageNr != currentPage) {
+		if (!loadPage(pageNr)) {
+			return false;
+		}
+	}
+	if (currentPage == pageNr) {
+		// first selected row not lower than the key
+		const ColumnarPage &page = pages->getPage(currentPage);
+		size_t low = selectedPos;
+		size_t high = selectedCount;
+		while (low < high) {
+			size_t middle = low + (high - low) / 2;
+			if (compareRow(page, rows[middle], key) < 0) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+		if (low == selectedCount) {
+			if (!loadPage(currentPage + 1)) {
+				return false;
+			}
+		} else {
+			selectedPos = low;
+		}
+	}
+	readRow();
+	if (found) {
+		*found = key == vkey;
+	}
+	return true;
+}
+
+const CellValue &ColumnarProcessor::getValue()
+{
+	storage.convertToCellValue(cellvalue, value);
+	return cellvalue;
+}
+
+double ColumnarProcessor::getDouble()
+{
+	return value;
+}
+
+const IdentifiersType &ColumnarProcessor::getKey() const
+{
+	return currentPage == NO_PAGE ? EMPTY_KEY : vkey;
+}
+
+void ColumnarProcessor::aggregateMulti(HashValueStorage *hashStorage, const AggregationMap **parentMaps, const ColumnarPage &page, uint32_t row)
+{
+	for (size_t dim = 0; dim < dimCount; dim++) {
+		multiTargets[dim] = parentMaps[dim]->getTargets(page.getColumn(dim)[row]);
+		if (!multiTargets[dim].size()) {
+			return;
+		}
+	}
+	double cellValue = page.getValues()[row];
+	for (;;) {
+		uint32_t offset = 0;
+		double weight = 1.0;
+		for (size_t dim = 0; dim < dimCount; dim++) {
+			offset += hashStorage->offsets[dim][*multiTargets[dim] - hashStorage->firstIds[dim]];
+			weight *= multiTargets[dim].getWeight();
+		}
+		hashStorage->resultSet[offset] = 1;
+		hashStorage->results[offset] += cellValue * weight;
+
+		// next combination of targets
+		size_t dim = dimCount;
+		for (;;) {
+			if (!dim) {
+				return;
+			}
+			--dim;
+			++multiTargets[dim];
+			if (!multiTargets[dim].end()) {
+				break;
+			}
+			multiTargets[dim].reset();
+		}
+	}
+}
+
+void ColumnarProcessor::aggregate(HashValueStorage *hashStorage, const AggregationMap **parentMaps)
+{
+#ifdef PROFILE_COLUMNAR
+	ptime aggregationStart = microsec_clock::local_time();
+	size_t values = 0;
+	size_t pagesVisited = 0;
+#endif
+	endReached = true;
+	currentPage = pages->pageCount();
+	if (!pages->size()) {
+		return;
+	}
+
+	// per dimension lookup tables: offset of the only target or MULTI_TARGET/NO_TARGET flag
+	vector<uint32_t> tableBase(dimCount);
+	vector<uint32_t> tableEnd(dimCount);
+	vector<vector<uint32_t> > tables(dimCount);
+	vector<vector<double> > weights(dimCount);
+	for (size_t dim = 0; dim < dimCount; dim++) {
+		uint32_t base = pages->getMin(dim);
+		uint32_t end = pages->getMax(dim);
+		if (area) {
+			base = std::max(base, *sets[dim]->begin());
+			end = std::min(end, *(--sets[dim]->end()));
+		} else {
+			base = std::max(base, *parentMaps[dim]->getMinBaseId());
+			end = std::min(end, *parentMaps[dim]->getMaxBaseId());
+		}
+		if (base > end) {
+			return;
+		}
+		tableBase[dim] = base;
+		tableEnd[dim] = end;
+
+		vector<uint32_t> &table = tables[dim];
+		table.assign(end - base + 1, NO_TARGET);
+		bool hasWeights = parentMaps[dim]->hasWeights();
+		if (hasWeights) {
+			weights[dim].assign(end - base + 1, 1.0);
+		}
+		for (uint32_t id = base; ; id++) {
+			if (!area || sets[dim]->find(id) != sets[dim]->end()) {
+				AggregationMap::TargetReader targets = parentMaps[dim]->getTargets(id);
+				if (targets.size() > 1) {
+					table[id - base] = MULTI_TARGET;
+				} else if (targets.size() == 1) {
+					IdentifierType target = *targets;
+					if (target >= hashStorage->firstIds[dim] && target <= hashStorage->lastIds[dim]) {
+						table[id - base] = hashStorage->offsets[dim][target - hashStorage->firstIds[dim]];
+						if (hasWeights) {
+							weights[dim][id - base] = targets.getWeight();
+						}
+					}
+				}
+			}
+			if (id == end) {
+				break;
+			}
+		}
+	}
+
+	multiTargets.resize(dimCount);
+	vector<uint32_t> sums(ColumnarPage::CELLS_PER_PAGE);
+	vector<uint32_t> flags(ColumnarPage::CELLS_PER_PAGE);
+	for (size_t pageNr = 0; pageNr < pages->pageCount(); pageNr++) {
+		const ColumnarPage &page = pages->getPage(pageNr);
+		size_t count = page.size();
+		memset(&mask[0], 0xFF, count);
+		bool skip = false;
+		for (size_t dim = 0; dim < dimCount && !skip; dim++) {
+			if (page.getMax(dim) < tableBase[dim] || page.getMin(dim) > tableEnd[dim]) {
+				skip = true;
+			} else if (page.getMin(dim) < tableBase[dim] || page.getMax(dim) > tableEnd[dim]) {
+				memset(&dimMask[0], 0, count);
+				ColumnarKernels::selectRange(page.getColumn(dim), count, tableBase[dim], tableEnd[dim], &dimMask[0]);
+				ColumnarKernels::andMask(&mask[0], &dimMask[0], count);
+			}
+		}
+		if (skip) {
+			continue;
+		}
+		size_t selected = ColumnarKernels::selectRows(&mask[0], count, &rows[0]);
+		if (!selected) {
+			continue;
+		}
+#ifdef PROFILE_COLUMNAR
+		pagesVisited++;
+#endif
+		memset(&sums[0], 0, selected * sizeof(uint32_t));
+		memset(&flags[0], 0, selected * sizeof(uint32_t));
+		for (size_t dim = 0; dim < dimCount; dim++) {
+			ColumnarKernels::gatherAdd(page.getColumn(dim), &rows[0], selected, tableBase[dim], &tables[dim][0], &sums[0], &flags[0]);
+		}
+
+		const double *pageValues = page.getValues();
+		for (size_t k = 0; k < selected; k++) {
+			if (flags[k] & NO_TARGET) {
+				continue;
+			}
+			uint32_t row = rows[k];
+			if (flags[k] & MULTI_TARGET) {
+				aggregateMulti(hashStorage, parentMaps, page, row);
+				continue;
+			}
+			double cellValue = pageValues[row];
+			for (size_t dim = 0; dim < dimCount; dim++) {
+				if (!weights[dim].empty()) {
+					cellValue *= weights[dim][page.getColumn(dim)[row] - tableBase[dim]];
+				}
+			}
+			hashStorage->resultSet[sums[k]] = 1;
+			hashStorage->results[sums[k]] += cellValue;
+#ifdef PROFILE_COLUMNAR
+			values++;
+#endif
+		}
+	}
+#ifdef PROFILE_COLUMNAR
+	ptime aggregationEnd(microsec_clock::local_time());
+	Logger::info << "Columnar aggregation (" << ColumnarKernels::getImplementation() << ") of " << values << " values from " << pagesVisited << "/" << pages->pageCount() << " pages took " << (aggregationEnd - aggregationStart).total_microseconds() << " us" << endl;
+#endif
+}
+
+}
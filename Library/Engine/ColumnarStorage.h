@@ -0,0 +1,241 @@
+/* 
+ *
+ * Copyright (C) 2006-2014 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * 
+ *
+ */
+
+#ifndef OLAP_COLUMNAR_STORAGE_H_
+#define OLAP_COLUMNAR_STORAGE_H_
+
+#include "palo.h"
+#include "Engine/EngineBase.h"
+#include "Engine/AggregationMap.h"
+
+namespace palo {
+
+class FileReader;
+class FileWriter;
+class HashValueStorage;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief SIMD scan kernels over columnar pages
+///
+/// All kernels work on whole pages. The best implementation (AVX2, SSE2 or
+/// scalar) is selected once at runtime from the capabilities of the CPU.
+////////////////////////////////////////////////////////////////////////////////
+
+class ColumnarKernels {
+public:
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief sets mask[i] to 0xFF for every column[i] in [low, high]
+	////////////////////////////////////////////////////////////////////////////////
+	static void selectRange(const uint32_t *column, size_t count, uint32_t low, uint32_t high, uint8_t *mask);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief mask[i] &= other[i]
+	////////////////////////////////////////////////////////////////////////////////
+	static void andMask(uint8_t *mask, const uint8_t *other, size_t count);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief stores positions of all nonzero mask bytes into rows, returns their count
+	////////////////////////////////////////////////////////////////////////////////
+	static size_t selectRows(const uint8_t *mask, size_t count, uint32_t *rows);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief sums[k] += table[column[rows[k]] - base], flags[k] |= the same value
+	////////////////////////////////////////////////////////////////////////////////
+	static void gatherAdd(const uint32_t *column, const uint32_t *rows, size_t count, uint32_t base, const uint32_t *table, uint32_t *sums, uint32_t *flags);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief name of the selected implementation
+	////////////////////////////////////////////////////////////////////////////////
+	static const char *getImplementation();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief page of cells stored column by column
+///
+/// Every dimension has its own contiguous column of element ids and all values
+/// are stored in one column of doubles. Cells are sorted by key like in the
+/// instruction stream of StorageCpu. Minimum and maximum id of every column is
+/// kept to skip whole pages during area scans.
+////////////////////////////////////////////////////////////////////////////////
+
+class ColumnarPage {
+public:
+	static const uint32_t CELLS_PER_PAGE = 2048;
+
+	ColumnarPage(size_t dimCount);
+
+	size_t size() const {
+		return count;
+	}
+	bool full() const {
+		return count == CELLS_PER_PAGE;
+	}
+	const uint32_t *getColumn(size_t dim) const {
+		return &keys[dim * CELLS_PER_PAGE];
+	}
+	const double *getValues() const {
+		return &values[0];
+	}
+	uint32_t getMin(size_t dim) const {
+		return minIds[dim];
+	}
+	uint32_t getMax(size_t dim) const {
+		return maxIds[dim];
+	}
+	int compareLast(const IdentifiersType &key) const;
+
+	void push_back(const IdentifierType *key, double value);
+	void load(FileReader *file);
+	void save(FileWriter *file) const;
+
+private:
+	size_t dimCount;
+	size_t count;
+	vector<uint32_t> keys;
+	vector<double> values;
+	vector<uint32_t> minIds;
+	vector<uint32_t> maxIds;
+};
+
+typedef boost::shared_ptr<ColumnarPage> PColumnarPage;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief read-only sorted list of columnar pages
+////////////////////////////////////////////////////////////////////////////////
+
+class ColumnarPageList {
+public:
+	ColumnarPageList(size_t dimCount) : dimCount(dimCount), cellCount(0), minIds(dimCount, NO_IDENTIFIER), maxIds(dimCount, 0) {}
+
+	size_t getDimCount() const {
+		return dimCount;
+	}
+	size_t size() const {
+		return cellCount;
+	}
+	size_t pageCount() const {
+		return pages.size();
+	}
+	const ColumnarPage &getPage(size_t page) const {
+		return *pages[page];
+	}
+	uint32_t getMin(size_t dim) const {
+		return minIds[dim];
+	}
+	uint32_t getMax(size_t dim) const {
+		return maxIds[dim];
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief appends cell, keys have to come in ascending order
+	////////////////////////////////////////////////////////////////////////////////
+	void push_back(const IdentifiersType &key, double value);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief returns first page starting at fromPage whose last key is >= key
+	////////////////////////////////////////////////////////////////////////////////
+	size_t findPage(const IdentifiersType &key, size_t fromPage) const;
+
+	void load(FileReader *file);
+	void save(FileWriter *file) const;
+
+private:
+	size_t dimCount;
+	size_t cellCount;
+	vector<PColumnarPage> pages;
+	vector<uint32_t> minIds;
+	vector<uint32_t> maxIds;
+};
+
+typedef boost::shared_ptr<ColumnarPageList> PColumnarPageList;
+typedef boost::shared_ptr<const ColumnarPageList> CPColumnarPageList;
+
+class StorageCpu;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief sorted reader of columnar pages restricted to an area
+///
+/// Area restriction is evaluated page by page with SIMD range selection,
+/// pages outside of the area are skipped using their minimum and maximum ids.
+////////////////////////////////////////////////////////////////////////////////
+
+class ColumnarProcessor : public ProcessorBase {
+public:
+	ColumnarProcessor(StorageCpu &storage, CPColumnarPageList pages, CPArea area);
+	virtual ~ColumnarProcessor() {}
+
+	// CellStream interface
+	virtual bool next();
+	virtual const CellValue &getValue();
+	virtual double getDouble();
+	virtual const IdentifiersType &getKey() const;
+	virtual void reset();
+	virtual bool move(const IdentifiersType &key, bool *found);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief sums all cells of the area into hash storage, reader is at the end afterwards
+	////////////////////////////////////////////////////////////////////////////////
+	void aggregate(HashValueStorage *hashStorage, const AggregationMap **parentMaps);
+
+private:
+	static const size_t MAX_SIMD_RANGES = 8;
+
+	static const size_t NO_PAGE = size_t(-1);
+	static const uint32_t MULTI_TARGET = 0x40000000;
+	static const uint32_t NO_TARGET = 0x80000000;
+
+	bool selectPage(size_t page);
+	bool filterDim(const ColumnarPage &page, size_t dim);
+	bool loadPage(size_t page);
+	void readRow();
+	int compareRow(const ColumnarPage &page, uint32_t row, const IdentifiersType &key) const;
+	void aggregateMulti(HashValueStorage *hashStorage, const AggregationMap **parentMaps, const ColumnarPage &page, uint32_t row);
+
+	PCommitable pstorage;
+	StorageCpu &storage;
+	CPColumnarPageList pages;
+	CPArea area;
+	size_t dimCount;
+	vector<const Set *> sets;
+
+	size_t currentPage;
+	size_t selectedCount;
+	size_t selectedPos;
+	bool endReached;
+	vector<uint8_t> mask;
+	vector<uint8_t> dimMask;
+	vector<uint32_t> rows;
+	vector<AggregationMap::TargetReader> multiTargets;
+
+	IdentifiersType vkey;
+	double value;
+	CellValue cellvalue;
+};
+
+}
+
+#endif /* OLAP_COLUMNAR_STORAGE_H_ */
@@ -154,6 +154,37 @@ bool CombinationProcessor::next()
 	return hasNext[index];
 }
 
+bool CombinationProcessor::nextBatch(CellBatch &batch)
+{
+	if (inputs.empty() && children.size()) {
+		createInputProcessors(children);
+	}
+	size_t size = inputs.size();
+	if (index < 0 && size == 1) {
+		index = 0;
+		hasNext[0] = true;
+		isSame[0] = false;
+		hasSameKey = false;
+	} else if (index < 0 || hasSameKey) {
+		return CellValueStream::nextBatch(batch);
+	} else {
+		for (size_t i = 0; i < size; i++) {
+			if (hasNext[i] && (int)i != index) {
+				// other inputs have to be merged cell by cell
+				return CellValueStream::nextBatch(batch);
+			}
+		}
+	}
+	// only one input left, its batches pass through unchanged
+	batch.clear();
+	if (!hasNext[index]) {
+		return false;
+	}
+	bool result = inputs[index]->nextBatch(batch);
+	hasNext[index] = result && !batch.isLast();
+	return result;
+}
+
 bool lessDCP(PPlanNode left, PPlanNode right)
 {
 	const Area *la = left->getArea().get();
@@ -64,6 +64,7 @@ public:
 	CombinationProcessor(PEngineBase engine, vector<PProcessorBase> inputs, CPPathTranslator pathTranslator);
 	virtual ~CombinationProcessor() {}
 	virtual bool next();
+	virtual bool nextBatch(CellBatch &batch);
 	//virtual bool move(const IdentifiersType &key, bool *found); // TODO: -jj implement for better performance if needed
 
 private:
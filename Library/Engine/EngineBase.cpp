@@ -293,9 +293,9 @@ PProcessorBase EngineBase::createProcessor(CPPlanNode node, bool sortedOutput, b
 	switch (node->getType()) {
 	case UNION:
 		if (sortedOutput) {
-			return PProcessorBase(new CombinationProcessor(thisEngine, node->getChildren(), node->getArea()->getPathTranslator()));
+			return ContextArena::create<CombinationProcessor>(thisEngine, node->getChildren(), node->getArea()->getPathTranslator());
 		} else {
-			return PProcessorBase(new SequenceProcessor(thisEngine, node));
+			return ContextArena::create<SequenceProcessor>(thisEngine, node);
 		}
 	case SOURCE: {
 		const SourcePlanNode *pn = static_cast<const SourcePlanNode *>(node.get());
@@ -306,15 +306,15 @@ PProcessorBase EngineBase::createProcessor(CPPlanNode node, bool sortedOutput, b
 		PProcessorBase ret;
 		const AggregationPlanNode *apn = dynamic_cast<const AggregationPlanNode *>(node.get());
 		if (apn->getAggregationType() == AggregationPlanNode::SUM) {
-			ret.reset(new AggregationProcessor(thisEngine, node));
+			ret = ContextArena::create<AggregationProcessor>(thisEngine, node);
 			if (useCache && node->getCache()) {
 				ret = node->getCache()->getWriter(node->getCacheCube(), PCubeArea(new CubeArea(CPDatabase(), CPCube(), *node->getArea())), ret, NO_IDENTIFIER);
 			}
 		} else {
-			ret.reset(new AggregationFunctionProcessor(thisEngine, node));
+			ret = ContextArena::create<AggregationFunctionProcessor>(thisEngine, node);
 		}
 		if (apn->getCondition()) {
-			ret.reset(new FilteredReader(thisEngine, ret, apn->getCondition(), apn->getArea()));
+			ret = ContextArena::create<FilteredReader>(thisEngine, ret, apn->getCondition(), apn->getArea());
 		}
 		return ret;
 	}
@@ -322,34 +322,39 @@ PProcessorBase EngineBase::createProcessor(CPPlanNode node, bool sortedOutput, b
 		PProcessorBase ret;
 		const TransformationPlanNode *transformationPlanNode = dynamic_cast<const TransformationPlanNode *>(node.get());
 		if (transformationPlanNode->getSourceCubeId().first != NO_IDENTIFIER) {
-			Context::getContext()->setCacheDependence(transformationPlanNode->getSourceCubeId());
+			const vector<PPlanNode> &children = transformationPlanNode->getChildren();
+			if (children.empty() || !children[0]) {
+				Context::getContext()->setCacheDependence(transformationPlanNode->getSourceCubeId());
+			} else {
+				Context::getContext()->setCacheDependence(transformationPlanNode->getSourceCubeId(), *children[0]->getArea());
+			}
 		}
 		if (transformationPlanNode->getSetMultiMaps() && !transformationPlanNode->getSetMultiMaps()->isTrivialMapping()) {
-			boost::shared_ptr<TransformationMapProcessor> tmp(new TransformationMapProcessor(thisEngine, node, sortedOutput));
+			boost::shared_ptr<TransformationMapProcessor> tmp(ContextArena::create<TransformationMapProcessor>(thisEngine, node, sortedOutput));
 			if (tmp->isBrokenOrder()) {
 				ret = tmp->getSortedResults();
 			} else {
 				ret = tmp;
 			}
 		} else {
-			ret = PProcessorBase(new TransformationProcessor(thisEngine, node));
+			ret = ContextArena::create<TransformationProcessor>(thisEngine, node);
 		}
 		return ret;
 	}
 	case MULTIPLICATION: {
-		PProcessorBase ret(new MultiplicationProcessor(thisEngine, node));
+		PProcessorBase ret(ContextArena::create<MultiplicationProcessor>(thisEngine, node));
 		return ret;
 	}
 	case DIVISION: {
-		PProcessorBase ret(new DivisionProcessor(thisEngine, node));
+		PProcessorBase ret(ContextArena::create<DivisionProcessor>(thisEngine, node));
 		return ret;
 	}
 	case ADDITION: {
-		PProcessorBase ret(new AdditionProcessor(thisEngine, node));
+		PProcessorBase ret(ContextArena::create<AdditionProcessor>(thisEngine, node));
 		return ret;
 	}
 	case SUBTRACTION: {
-		PProcessorBase ret(new SubtractionProcessor(thisEngine, node));
+		PProcessorBase ret(ContextArena::create<SubtractionProcessor>(thisEngine, node));
 		return ret;
 	}
 	case CACHE: {
@@ -358,7 +363,7 @@ PProcessorBase EngineBase::createProcessor(CPPlanNode node, bool sortedOutput, b
 
 		if (pn->getDefaultValue() || pn->getRuleId() != NO_IDENTIFIER) {
 			// complete the info - ruleId and/or defaultValue
-			ret = PProcessorBase(new CompleteProcessor(pn->getArea(), pn->getDefaultValue(), pn->getRuleId(), ret));
+			ret = ContextArena::create<CompleteProcessor>(pn->getArea(), pn->getDefaultValue(), pn->getRuleId(), ret);
 		}
 		return ret;
 	}
@@ -366,13 +371,13 @@ PProcessorBase EngineBase::createProcessor(CPPlanNode node, bool sortedOutput, b
 		const QueryCachePlanNode *pn = dynamic_cast<const QueryCachePlanNode *>(node.get());
 		PProcessorBase ret(Context::getContext()->getQueryCache(pn->getCube())->getFilteredValues(node->getArea(), pn->getDefaultValue()));
 		if (pn->getRuleId() != NO_IDENTIFIER && pn->getDefaultValue()) {
-			ret = PProcessorBase(new CompleteProcessor(pn->getArea(), pn->getDefaultValue(), pn->getRuleId(), ret));
+			ret = ContextArena::create<CompleteProcessor>(pn->getArea(), pn->getDefaultValue(), pn->getRuleId(), ret);
 		}
 		return ret;
 	}
 	case CONSTANT: {
 		const ConstantPlanNode *cpn = dynamic_cast<const ConstantPlanNode *>(node.get());
-		return PProcessorBase(new ConstantProcessor(cpn->getArea(), cpn->getDefaultValue()));
+		return ContextArena::create<ConstantProcessor>(cpn->getArea(), cpn->getDefaultValue());
 	}
 	case CELLMAP: {
 		const CellMapPlanNode *cmpn = dynamic_cast<const CellMapPlanNode *>(node.get());
@@ -380,16 +385,16 @@ PProcessorBase EngineBase::createProcessor(CPPlanNode node, bool sortedOutput, b
 		if (cellMap) {
 			return cmpn->getCellMap()->getValues();
 		} else {
-			return PProcessorBase(new CellMapProcessor(thisEngine, node));
+			return ContextArena::create<CellMapProcessor>(thisEngine, node);
 		}
 	}
 	case COMPLETE: {
 		const CompletePlanNode *cpn = dynamic_cast<const CompletePlanNode *>(node.get());
-		PProcessorBase ret(new CompleteProcessor(thisEngine, cpn->getArea(), cpn->getDefaultValue(), cpn->getRuleId(), cpn->getChildren()[0]));
+		PProcessorBase ret(ContextArena::create<CompleteProcessor>(thisEngine, cpn->getArea(), cpn->getDefaultValue(), cpn->getRuleId(), cpn->getChildren()[0]));
 		return ret;
 	}
 	case QUANTIFICATION: {
-		return PProcessorBase(new DFilterQuantificationProcessor(thisEngine, node));
+		return ContextArena::create<DFilterQuantificationProcessor>(thisEngine, node);
 	}
 	default:
 		throw ErrorException(ErrorException::ERROR_INTERNAL, "Unsupported plan node type");
@@ -103,7 +103,7 @@ PProcessorBase EngineCpu::createProcessor(CPPlanNode node, bool sortedOutput, bo
 			if (session) {
 				user = session->getUser();
 			}
-			PProcessorBase processor = PProcessorBase(new CellRightProcessor(cellRightsPlanNode->getCubeArea(), user, cellRightsPlanNode->isForPropertyCube()));
+			PProcessorBase processor = ContextArena::create<CellRightProcessor>(cellRightsPlanNode->getCubeArea(), user, cellRightsPlanNode->isForPropertyCube());
 			return processor;
 		}
 		case LEGACY_RULE:
@@ -111,16 +111,16 @@ PProcessorBase EngineCpu::createProcessor(CPPlanNode node, bool sortedOutput, bo
 			CPLegacyRulePlanNode legacyRulePlanNode = boost::dynamic_pointer_cast<const LegacyRulePlanNode, const PlanNode>(node);
 			CPRule rule = legacyRulePlanNode->getRule();
 			if (legacyRulePlanNode->useMarkers()) {
-				PProcessorBase processor = PProcessorBase(new LegacyMarkedRule(thisEngine, legacyRulePlanNode));
+				PProcessorBase processor = ContextArena::create<LegacyMarkedRule>(thisEngine, legacyRulePlanNode);
 				if (useCache && legacyRulePlanNode->getCache()) {
 					processor = legacyRulePlanNode->getCache()->getWriter(node->getCacheCube(), PCubeArea(new CubeArea(CPDatabase(), CPCube(), *legacyRulePlanNode->getArea())), processor, legacyRulePlanNode->getRule()->getId());
 				}
 				if (legacyRulePlanNode->getDefaultValue()) {
-					processor = PProcessorBase(new CompleteProcessor(legacyRulePlanNode->getArea(), legacyRulePlanNode->getDefaultValue(), NO_RULE, processor));
+					processor = ContextArena::create<CompleteProcessor>(legacyRulePlanNode->getArea(), legacyRulePlanNode->getDefaultValue(), NO_RULE, processor);
 				}
 				return processor;
 			} else {
-				PProcessorBase processor = PProcessorBase(new LegacyRule(thisEngine, legacyRulePlanNode));
+				PProcessorBase processor = ContextArena::create<LegacyRule>(thisEngine, legacyRulePlanNode);
 				if (useCache && legacyRulePlanNode->getCache()) {
 					processor = legacyRulePlanNode->getCache()->getWriter(node->getCacheCube(), PCubeArea(new CubeArea(CPDatabase(), CPCube(), *legacyRulePlanNode->getArea())), processor, legacyRulePlanNode->getRule()->getId());
 				}
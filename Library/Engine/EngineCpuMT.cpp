@@ -35,6 +35,12 @@
 #include "Thread/ThreadPool.h"
 #include "Olap/Server.h"
 #include "Engine/StorageCpu.h"
+#include "Collections/FlatCellMap.h"
+#include "Engine/Legacy/CompiledRule.h"
+#include "Engine/Legacy/VirtualMachine.h"
+#include "Olap/NormalDatabase.h"
+#include "Olap/Rule.h"
+#include "Parser/RuleParserDriver.h"
 
 #include <boost/date_time.hpp>
 #include <boost/date_time/posix_time/ptime.hpp> //include all types plus i/o
@@ -81,10 +87,49 @@ ostream& operator<<(ostream& ostr, const TestBase &test)
 	return ostr;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief partial aggregation result with the range of its keys
+////////////////////////////////////////////////////////////////////////////////
+
+struct AggregationPartial {
+	AggregationPartial() {}
+	AggregationPartial(PDoubleCellMap cells);
+	bool operator<(const AggregationPartial &other) const {return first < other.first;}
+	PDoubleCellMap cells;
+	IdentifiersType first;
+	IdentifiersType last;
+};
+
+AggregationPartial::AggregationPartial(PDoubleCellMap cells) : cells(cells)
+{
+	PProcessorBase reader = cells->getValues();
+	while (reader->next()) {
+		const IdentifiersType &key = reader->getKey();
+		if (first.empty() || key < first) {
+			first = key;
+		}
+		if (last.empty() || last < key) {
+			last = key;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief planned partitions of one source, claimed one by one by the workers
+////////////////////////////////////////////////////////////////////////////////
+
+struct AggregationPartitions {
+	AggregationPartitions(const vector<boost::shared_ptr<StorageCpu::Processor> > &parts) : parts(parts), results(parts.size()), next(0) {}
+	vector<boost::shared_ptr<StorageCpu::Processor> > parts;
+	vector<AggregationPartial> results;	// one slot per partition, written only by the worker that claimed it
+	std::atomic<size_t> next;
+};
+typedef boost::shared_ptr<AggregationPartitions> PAggregationPartitions;
+
 class AggregationProcessorMT : public AggregationProcessor, public StorageCpu::ProcessorCallback {
 	friend class AggregationProcessorWorker;
 public:
-	AggregationProcessorMT(PEngineBase engine, CPPlanNode node) : AggregationProcessor(engine, node), reader(0), minJump(0), hashStorage(0) {}
+	AggregationProcessorMT(PEngineBase engine, CPPlanNode node) : AggregationProcessor(engine, node), con(0), reader(0), minJump(0), hashStorage(0) {}
 
 	virtual void readCallback();
 
@@ -92,36 +137,65 @@ protected:
 	virtual void aggregate();
 
 private:
+	static const size_t PARTITIONS_PER_CORE = 4;
+
+	void aggregatePartitions(const vector<boost::shared_ptr<StorageCpu::Processor> > &parts);
+	PDoubleCellMap mergePartitions(vector<AggregationPartial> &partials);
 	void createStorage(double resultSize) {
 		if (resultSize < 1000) {
 			hashStorage = new HashValueStorage(aggregationPlan->getArea());
 			storage.reset(hashStorage);
 		} else {
-			storage = CreateDoubleCellMap(aggregationPlan->getArea()->dimCount());
-			storage->setLimit(IdentifiersType(), (aggregationPlan->getMaxCount() == 0 ? 0 : aggregationPlan->getMaxCount() + 1));
+			storage = createTargetStorage();
 		}
 	}
 
 	boost::mutex dataMutex;
+	Context *con;	// context of the request, checked by the workers
 	StorageCpu::Processor *reader;
 	PThreadPool tp;
 	size_t minJump;
 	ThreadPool::ThreadGroup tg;
 	PDoubleCellMap threadStorage;
 	HashValueStorage *hashStorage;
+	vector<PAggregationPartitions> partitionResults;
 };
 
 class AggregationProcessorWorker : public AggregationProcessor, public ThreadPoolJob, public StorageCpu::ProcessorCallback {
 public:
 	AggregationProcessorWorker(PEngineBase engine, CPPlanNode node, ThreadPool::ThreadGroup &tg, const StorageCpu::Processor &p, size_t s, size_t e, PThreadPool tp, AggregationProcessorMT &parent);
+	AggregationProcessorWorker(PEngineBase engine, CPPlanNode node, ThreadPool::ThreadGroup &tg, PThreadPool tp, AggregationProcessorMT &parent, PAggregationPartitions partitions);
 	virtual void readCallback();
 
 private:
 	virtual void operator()();
+	PDoubleCellMap aggregateReader(StorageCpu::Processor &source);
 
 	StorageCpu::Processor reader;
 	PThreadPool tp;
 	AggregationProcessorMT &parent;
+	PAggregationPartitions partitions;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief adds one partial aggregation result into another
+////////////////////////////////////////////////////////////////////////////////
+
+class AggregationMergeWorker : public ThreadPoolJob {
+public:
+	AggregationMergeWorker(ThreadPool::ThreadGroup &tg, PDoubleCellMap &target, PDoubleCellMap source) : ThreadPoolJob(tg), target(target), source(source) {}
+
+private:
+	virtual void operator()() {
+		PProcessorBase sourceReader = source->getValues();
+		while (sourceReader->next()) {
+			target->add(sourceReader->getKey(), sourceReader->getDouble());
+		}
+		source.reset();
+	}
+
+	PDoubleCellMap &target;
+	PDoubleCellMap source;
 };
 
 AggregationProcessorWorker::AggregationProcessorWorker(PEngineBase engine, CPPlanNode node, ThreadPool::ThreadGroup &tg, const StorageCpu::Processor &p, size_t s, size_t e, PThreadPool tp, AggregationProcessorMT &parent) :
@@ -132,7 +206,42 @@ AggregationProcessorWorker::AggregationProcessorWorker(PEngineBase engine, CPPla
 	reader.endp = e ? e : reader.pageList->size();
 }
 
+AggregationProcessorWorker::AggregationProcessorWorker(PEngineBase engine, CPPlanNode node, ThreadPool::ThreadGroup &tg, PThreadPool tp, AggregationProcessorMT &parent, PAggregationPartitions partitions) :
+	AggregationProcessor(engine, node), ThreadPoolJob(tg), reader(*partitions->parts[0]), tp(tp), parent(parent), partitions(partitions)
+{
+}
+
 void AggregationProcessorWorker::operator()()
+{
+	if (partitions) {
+		for (size_t i = partitions->next++; i < partitions->parts.size(); i = partitions->next++) {
+			parent.con->check();
+			StorageCpu::Processor &part = *partitions->parts[i];
+			part.mtCallback = this;
+			PDoubleCellMap cells = aggregateReader(part);
+			if (cells) {
+				// key range is taken here, in parallel, for the merge
+				partitions->results[i] = AggregationPartial(cells);
+			}
+		}
+		return;
+	}
+
+	PDoubleCellMap result = aggregateReader(reader);
+	if (result) {
+		boost::unique_lock<boost::mutex> lock(parent.dataMutex);
+		if (parent.threadStorage) {
+			storageReader = result->getValues();
+			while (storageReader->next()) {
+				parent.threadStorage->add(storageReader->getKey(), storageReader->getDouble());
+			}
+		} else {
+			parent.threadStorage = result;
+		}
+	}
+}
+
+PDoubleCellMap AggregationProcessorWorker::aggregateReader(StorageCpu::Processor &source)
 {
 	double resultSize = aggregationPlan->getArea()->getSize();
 	HashValueStorage *hashStorage = 0;
@@ -140,8 +249,7 @@ void AggregationProcessorWorker::operator()()
 		hashStorage = new HashValueStorage(aggregationPlan->getArea());
 		storage.reset(hashStorage);
 	} else {
-		storage = CreateDoubleCellMap(aggregationPlan->getArea()->dimCount());
-		storage->setLimit(IdentifiersType(), (aggregationPlan->getMaxCount() == 0 ? 0 : aggregationPlan->getMaxCount() + 1));
+		storage = createTargetStorage();
 	}
 
 	initIntern();
@@ -149,51 +257,58 @@ void AggregationProcessorWorker::operator()()
 	bool hasVals = false;
 	if (hashStorage) {
 		hasVals = true;
-		reader.aggregate(hashStorage, &parentMaps[0]);
+		source.aggregate(hashStorage, &parentMaps[0]);
 	} else {
-		while (reader.next()) {
-			aggregateCell(reader.getKey(), reader.getValue().getNumeric());
-			hasVals = true;
-		}
-	}
-	if (hasVals) {
-		boost::unique_lock<boost::mutex> lock(parent.dataMutex);
-		if (parent.threadStorage) {
-			storageReader = storage->getValues();
-			while (storageReader->next()) {
-				parent.threadStorage->add(storageReader->getKey(), storageReader->getDouble());
+		size_t counter = 0;
+		while (source.next()) {
+			if (!(++counter % 10000)) {
+				parent.con->check();
 			}
-		} else {
-			parent.threadStorage = storage;
+			aggregateCell(&source.getKey()[0], source.getValue().getNumeric());
+			hasVals = true;
 		}
 	}
+	return hasVals ? storage : PDoubleCellMap();
 }
 
 void AggregationProcessorWorker::readCallback()
 {
+	parent.con->check();
+	if (partitions) {
+		// planned partitions are not split any further
+		return;
+	}
 	size_t s = reader.jump[reader.depth];
-	if (s < reader.endp && s - reader.pos > parent.minJump && reader.setSingle[reader.depth] == NO_IDENTIFIER && tp->hasFreeCore(true) && reader.nextValid(s)) {
-		size_t e = reader.endp;
-		reader.endp = s;
-		PThreadPoolJob w(new AggregationProcessorWorker(engine, planNode, getThreadGroup(), reader, s, e, tp, parent));
-		tp->addJob(w);
+	if (s < reader.endp && s - reader.pos > parent.minJump && reader.setSingle[reader.depth] == NO_IDENTIFIER && tp->admitSplit()) {
+		if (reader.nextValid(s)) {
+			size_t e = reader.endp;
+			reader.endp = s;
+			PThreadPoolJob w(new AggregationProcessorWorker(engine, planNode, getThreadGroup(), reader, s, e, tp, parent));
+			tp->addJob(w, 0, true);
+		} else {
+			tp->cancelAdmission();
+		}
 	}
 }
 
 void AggregationProcessorMT::readCallback()
 {
 	size_t s = reader->jump[reader->depth];
-	if (s < reader->endp && s - reader->pos > minJump && reader->setSingle[reader->depth] == NO_IDENTIFIER && tp->hasFreeCore(false) && reader->nextValid(s)) {
-		size_t e = reader->endp;
-		reader->endp = s;
-		PThreadPoolJob w(new AggregationProcessorWorker(engine, planNode, tg, *reader, s, e, tp, *this));
-		tp->addJob(w);
+	if (s < reader->endp && s - reader->pos > minJump && reader->setSingle[reader->depth] == NO_IDENTIFIER && tp->admitSplit()) {
+		if (reader->nextValid(s)) {
+			size_t e = reader->endp;
+			reader->endp = s;
+			PThreadPoolJob w(new AggregationProcessorWorker(engine, planNode, tg, *reader, s, e, tp, *this));
+			tp->addJob(w, 0, true);
+		} else {
+			tp->cancelAdmission();
+		}
 	}
 }
 
 void AggregationProcessorMT::aggregate()
 {
-	Context *con = Context::getContext();
+	con = Context::getContext();
 	tp = con->getServer()->getThreadPool();
 	tg = tp->createThreadGroup();
 
@@ -207,9 +322,15 @@ void AggregationProcessorMT::aggregate()
 			PCellStream sourceDataSP = createProcessor(*source, false);
 
 			reader = dynamic_cast<StorageCpu::Processor *>(sourceDataSP.get());
+			ColumnarProcessor *columnarReader = reader ? 0 : dynamic_cast<ColumnarProcessor *>(sourceDataSP.get());
 			if (reader && (*source)->getType() == SOURCE) {
 				minJump = (size_t)reader->pageList->maxPageSize() * 20;
 				reader->mtCallback = this;
+				vector<boost::shared_ptr<StorageCpu::Processor> > parts;
+				if (reader->partition(tp->getCoreCount() * PARTITIONS_PER_CORE, minJump, parts)) {
+					aggregatePartitions(parts);
+					continue;
+				}
 				if (!storage) {
 					createStorage(resultSize);
 				}
@@ -220,9 +341,14 @@ void AggregationProcessorMT::aggregate()
 						if (!storage) {
 							createStorage(resultSize);
 						}
-						aggregateCell(reader->getKey(), reader->getValue().getNumeric());
+						aggregateCell(&reader->getKey()[0], reader->getValue().getNumeric());
 					}
 				}
+			} else if (columnarReader && resultSize < 1000 && aggregationPlan->getAggregationType() == AggregationPlanNode::SUM) {
+				if (!storage) {
+					createStorage(resultSize);
+				}
+				columnarReader->aggregate(hashStorage, &parentMaps[0]);
 			} else {
 				CellValueStream *sourceData = sourceDataSP.get();
 				size_t counter = 0;
@@ -233,12 +359,27 @@ void AggregationProcessorMT::aggregate()
 					if (!storage) {
 						createStorage(resultSize);
 					}
-					aggregateCell(sourceData->getKey(), sourceData->getValue().getNumeric());
+					aggregateCell(&sourceData->getKey()[0], sourceData->getValue().getNumeric());
 				}
 			}
 		}
 
 		tp->join(tg);
+		if (!partitionResults.empty()) {
+			vector<AggregationPartial> partials;
+			if (threadStorage) {
+				partials.push_back(AggregationPartial(threadStorage));
+			}
+			for (vector<PAggregationPartitions>::iterator it = partitionResults.begin(); it != partitionResults.end(); ++it) {
+				for (vector<AggregationPartial>::iterator rit = (*it)->results.begin(); rit != (*it)->results.end(); ++rit) {
+					if (rit->cells) {
+						partials.push_back(*rit);
+					}
+				}
+			}
+			partitionResults.clear();
+			threadStorage = mergePartitions(partials);
+		}
 		if (threadStorage) {
 			if (storage) {
 				storageReader = threadStorage->getValues();
@@ -266,6 +407,86 @@ void AggregationProcessorMT::aggregate()
 	}
 }
 
+void AggregationProcessorMT::aggregatePartitions(const vector<boost::shared_ptr<StorageCpu::Processor> > &parts)
+{
+	// only admitted workers are started, each of them claims partitions until none is left
+	PAggregationPartitions partitions(new AggregationPartitions(parts));
+	partitionResults.push_back(partitions);
+	size_t workers = 0;
+	while (workers < parts.size() && tp->tryAdmit(false)) {
+		PThreadPoolJob w(new AggregationProcessorWorker(engine, planNode, tg, tp, *this, partitions));
+		tp->addJob(w, 0, true);
+		workers++;
+	}
+	if (!workers) {
+		// no free core, the partitions are aggregated by a single job
+		PThreadPoolJob w(new AggregationProcessorWorker(engine, planNode, tg, tp, *this, partitions));
+		tp->addJob(w);
+	}
+}
+
+PDoubleCellMap AggregationProcessorMT::mergePartitions(vector<AggregationPartial> &partials)
+{
+	// results with disjoint key ranges are concatenated, only overlapping ones are merged
+	sort(partials.begin(), partials.end());
+
+	vector<vector<PDoubleCellMap> > groups;
+	IdentifiersType groupLast;
+	for (vector<AggregationPartial>::iterator it = partials.begin(); it != partials.end(); ++it) {
+		if (groups.empty() || groupLast < it->first) {
+			groups.push_back(vector<PDoubleCellMap>());
+			groupLast = it->last;
+		} else if (groupLast < it->last) {
+			groupLast = it->last;
+		}
+		groups.back().push_back(it->cells);
+	}
+
+	// pairwise tree within the overlapping groups, every level merges its pairs in parallel
+	for (;;) {
+		ThreadPool::ThreadGroup mergeGroup = tp->createThreadGroup();
+		bool merging = false;
+		for (vector<vector<PDoubleCellMap> >::iterator git = groups.begin(); git != groups.end(); ++git) {
+			for (size_t i = 0; i + 1 < git->size(); i += 2) {
+				PThreadPoolJob w(new AggregationMergeWorker(mergeGroup, (*git)[i], (*git)[i + 1]));
+				tp->addJob(w);
+				merging = true;
+			}
+		}
+		if (!merging) {
+			break;
+		}
+		tp->join(mergeGroup);
+		for (vector<vector<PDoubleCellMap> >::iterator git = groups.begin(); git != groups.end(); ++git) {
+			vector<PDoubleCellMap> merged;
+			merged.reserve(git->size() / 2 + 1);
+			for (size_t i = 0; i < git->size(); i += 2) {
+				merged.push_back((*git)[i]);
+			}
+			git->swap(merged);
+		}
+	}
+
+	// concatenate the disjoint groups into the largest one
+	PDoubleCellMap result;
+	for (vector<vector<PDoubleCellMap> >::iterator git = groups.begin(); git != groups.end(); ++git) {
+		if (!result || result->size() < git->front()->size()) {
+			result = git->front();
+		}
+	}
+	for (vector<vector<PDoubleCellMap> >::iterator git = groups.begin(); git != groups.end(); ++git) {
+		if (git->front() != result) {
+			storageReader = git->front()->getValues();
+			while (storageReader->next()) {
+				result->set(storageReader->getKey(), storageReader->getDouble());
+			}
+		}
+	}
+	storageReader.reset();
+	con->check();
+	return result;
+}
+
 PCommitable EngineCpuMT::copy() const
 {
 	checkNotCheckedOut();
@@ -309,24 +530,393 @@ private:
 	ThreadPoolTestWorker *worker;
 };
 
-//static void testThreadPool()
-//{
-//	TestBase test("void");
-//	test.run();
-//	cout << test << endl;
-//	TestThreads tt;
-//	tt.run();
-//	cout << tt << endl;
-//	cout << tt.uSecondsPerIteration()-test.uSecondsPerIteration() << endl;
-//}
+class TestCellMapAdd : public TestBase
+{
+public:
+	TestCellMapAdd(string name, bool flat, size_t cells, size_t targets) : TestBase(name), flat(flat), cells(cells), keys(cells * DIMS) {
+		for (size_t i = 0; i < keys.size(); i++) {
+			keys[i] = IdentifierType(rand() % (i % DIMS == DIMS - 1 ? targets : 1000));
+		}
+		vector<uint32_t> bits(DIMS, 20);
+		layout.init(bits);
+	}
+	virtual void step() {
+		PDoubleCellMap map;
+		if (flat) {
+			map.reset(new FlatHashCellMap<1>(layout));
+		} else {
+			map = CreateDoubleCellMap(DIMS);
+		}
+		for (size_t i = 0; i < cells; i++) {
+			map->add(&keys[i * DIMS], 1.0);
+		}
+		PProcessorBase reader = map->getValues();
+		while (reader->next()) {
+		}
+	}
+private:
+	static const size_t DIMS = 3;
+	bool flat;
+	size_t cells;
+	IdentifiersType keys;
+	FlatKeyLayout<1> layout;
+};
+
+class TestRuleEvaluation : public TestBase
+{
+public:
+	// computes the rule targets of 'area' with or without the threaded code of the rules
+	TestRuleEvaluation(string name, CPCube cube, PCubeArea area, bool compile) : TestBase(name), cube(cube), area(area), compile(compile), sum(0) {}
+	virtual void step() {
+		bool enabled = paloLegacy::CompiledRule::isEnabled();
+		paloLegacy::CompiledRule::setEnabled(compile);
+		sum = 0;
+		PCellStream cs = cube->calculateArea(area, CubeArea::ALL, ALL_RULES, true, UNLIMITED_SORTED_PLAN);
+		while (cs->next()) {
+			sum += cs->getValue().getNumeric();
+		}
+		paloLegacy::CompiledRule::setEnabled(enabled);
+	}
+	double getSum() const {return sum;} // of the last step
+private:
+	CPCube cube;
+	PCubeArea area;
+	bool compile;
+	double sum;
+};
+
+class TestRuleLookup : public TestBase
+{
+public:
+	// computes 'cells' single cells of 'area' one by one, every one looks up its rule
+	TestRuleLookup(string name, CPCube cube, PCubeArea area, size_t cells) : TestBase(name), cube(cube), sum(0) {
+		CPDatabase db = area->getDatabase();
+		IdentifiersType path(area->dimCount());
+		for (size_t i = 0; i < cells; i++) {
+			for (size_t d = 0; d < path.size(); d++) {
+				CPSet s = area->getDim(d);
+				Set::Iterator it = s->begin();
+				for (size_t skip = rand() % s->size(); skip; skip--) {
+					++it;
+				}
+				path[d] = *it;
+			}
+			areas.push_back(PCubeArea(new CubeArea(db, cube, path)));
+		}
+	}
+	virtual void step() {
+		for (vector<PCubeArea>::const_iterator it = areas.begin(); it != areas.end(); ++it) {
+			PCellStream cs = cube->calculateArea(*it, CubeArea::ALL, ALL_RULES, true, UNLIMITED_SORTED_PLAN);
+			if (cs->next()) {
+				sum += cs->getValue().getNumeric();
+			}
+		}
+	}
+private:
+	CPCube cube;
+	vector<PCubeArea> areas;
+	double sum;
+};
+
+class TestSetIntersection : public TestBase
+{
+public:
+	// queried set with 'queried' random ids of 'elements', rules targeting runs of 'ruleRange' ids
+	TestSetIntersection(string name, size_t elements, size_t queried, size_t rules, size_t ruleRange) : TestBase(name), query(new Set) {
+		while (query->size() < queried) {
+			query->insert(IdentifierType(rand() % elements));
+		}
+		for (size_t i = 0; i < rules; i++) {
+			PSet ruleSet(new Set);
+			IdentifierType low = IdentifierType(rand() % elements);
+			ruleSet->insertRange(low, IdentifierType(min(elements, low + ruleRange) - 1));
+			ruleSets.push_back(ruleSet);
+		}
+	}
+	virtual void step() {
+		for (vector<PSet>::const_iterator it = ruleSets.begin(); it != ruleSets.end(); ++it) {
+			PSet intersection;
+			PSet complement;
+			if ((*it)->intersection(query.get(), 0, 0)) {
+				query->intersection(it->get(), &intersection, &complement);
+			}
+		}
+	}
+private:
+	PSet query;
+	vector<PSet> ruleSets;
+};
+
+class TestSetBuild : public TestBase
+{
+public:
+	// builds a set of 'count' unordered ids of 'elements' one by one or in bulk
+	TestSetBuild(string name, size_t elements, size_t count, bool bulk) : TestBase(name), ids(count), bulk(bulk) {
+		for (size_t i = 0; i < count; i++) {
+			ids[i] = IdentifierType(rand() % elements);
+		}
+	}
+	virtual void step() {
+		Set s;
+		if (bulk) {
+			s.insert(ids.begin(), ids.end());
+		} else {
+			for (IdentifiersType::const_iterator it = ids.begin(); it != ids.end(); ++it) {
+				s.insert(*it);
+			}
+		}
+	}
+private:
+	IdentifiersType ids;
+	bool bulk;
+};
+
+#ifdef ENABLE_TEST_MODE
+static void testSetIntersection()
+{
+	size_t queried[] = {10, 1000, 100000};
+	for (size_t i = 0; i < sizeof(queried) / sizeof(queried[0]); i++) {
+		TestSetIntersection wide("Set intersection, wide rules", 200000, queried[i], 100, 10000);
+		wide.run();
+		cout << wide << endl;
+		TestSetIntersection narrow("Set intersection, narrow rules", 200000, queried[i], 1000, 10);
+		narrow.run();
+		cout << narrow << endl;
+	}
+	size_t built[] = {1000, 100000};
+	for (size_t i = 0; i < sizeof(built) / sizeof(built[0]); i++) {
+		TestSetBuild single("Set build, unordered inserts", 10000000, built[i], false);
+		single.run();
+		cout << single << endl;
+		TestSetBuild bulk("Set build, bulk insert", 10000000, built[i], true);
+		bulk.run();
+		cout << bulk << endl;
+	}
+}
+
+static void testCellMaps()
+{
+	size_t sizes[] = {10000, 1000000, 10000000};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		TestCellMapAdd leafMap("CellLeafMap", false, sizes[i], 1000);
+		leafMap.run();
+		cout << leafMap << endl;
+		TestCellMapAdd flatMap("FlatHashCellMap", true, sizes[i], 1000);
+		flatMap.run();
+		cout << flatMap << endl;
+	}
+}
+
+static void testThreadPool()
+{
+	TestBase test("void");
+	test.run();
+	cout << test << endl;
+	TestThreads tt;
+	tt.run();
+	cout << tt << endl;
+	cout << tt.uSecondsPerIteration()-test.uSecondsPerIteration() << endl;
+}
+
+static const string BENCHMARK_DATABASE = "EngineBenchmark";
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief creates a cube Rows x Measures with random values in A and B
+////////////////////////////////////////////////////////////////////////////////
+
+static void createBenchmarkCube(size_t rows, const vector<string> &rules)
+{
+	PServer server = Context::getContext()->getServerCopy();
+	PDatabase db = server->addDatabase(BENCHMARK_DATABASE, PUser(), NormalDatabase::DB_TYPE, false);
+
+	PDimension rowDim = db->addDimension(server, "Rows", PUser(), false, false, false);
+	IdentifiersType rowIds;
+	for (size_t i = 0; i < rows; i++) {
+		rowIds.push_back(rowDim->addElement(server, db, NO_IDENTIFIER, "R" + StringUtils::convertToString((uint32_t)i), Element::NUMERIC, PUser(), false)->getIdentifier());
+	}
+	PDimension measureDim = db->addDimension(server, "Measures", PUser(), false, false, false);
+	IdentifiersType measureIds;
+	const char *measures[] = {"A", "B", "C", "D"};
+	for (size_t i = 0; i < sizeof(measures) / sizeof(measures[0]); i++) {
+		measureIds.push_back(measureDim->addElement(server, db, NO_IDENTIFIER, measures[i], Element::NUMERIC, PUser(), false)->getIdentifier());
+	}
+
+	IdentifiersType dims;
+	dims.push_back(rowDim->getId());
+	dims.push_back(measureDim->getId());
+	PCube cube = db->addCube(server, "Values", &dims, PUser(), false, false, false);
+
+	set<PCube> changedCubes;
+	IdentifiersType path(2);
+	for (size_t i = 0; i < rows; i++) {
+		path[0] = rowIds[i];
+		for (size_t m = 0; m < 2; m++) {
+			path[1] = measureIds[m];
+			cube->setCellValue(server, db, PCubeArea(new CubeArea(db, cube, path)), CellValue(double(rand() % 1000)), PLockedCells(), PUser(), boost::shared_ptr<PaloSession>(), false, false, DEFAULT, false, 0, changedCubes, false, CubeArea::BASE_NUMERIC);
+		}
+	}
+	cube->commitChanges(false, PUser(), changedCubes, false);
+
+	for (vector<string>::const_iterator it = rules.begin(); it != rules.end(); ++it) {
+		RuleParserDriver driver;
+		driver.parse(*it);
+		PRuleNode ruleNode(driver.getResult());
+		string errorMsg;
+		if (!ruleNode || !ruleNode->validate(server, db, cube, errorMsg)) {
+			throw ErrorException(ErrorException::ERROR_PARSING_RULE, "cannot create benchmark rule " + *it + ": " + errorMsg);
+		}
+		cube->createRule(server, db, ruleNode, *it, "", "", true, PUser(), false, 0, 0);
+	}
+
+	if (!server->commit()) {
+		throw ErrorException(ErrorException::ERROR_INTERNAL, "cannot create benchmark database");
+	}
+}
+
+static void deleteBenchmarkCube()
+{
+	PServer server = Context::getContext()->getServerCopy();
+	PDatabase db = server->lookupDatabaseByName(BENCHMARK_DATABASE, true);
+	PDatabaseList dbs = server->getDatabaseList(true);
+	server->setDatabaseList(dbs);
+	dbs->set(db);
+	server->deleteDatabase(db, PUser(), false);
+	server->commit();
+}
+
+static PCubeArea benchmarkArea(CPDatabase &db, CPCube &cube, const string &measure)
+{
+	PServer server = Context::getContext()->getServer();
+	db = server->lookupDatabaseByName(BENCHMARK_DATABASE, false);
+	cube = db->lookupCubeByName("Values", false);
+	CPDimension rowDim = db->lookupDimensionByName("Rows", false);
+	CPDimension measureDim = db->lookupDimensionByName("Measures", false);
+
+	vector<IdentifiersType> ids(2);
+	ElementsType rows = rowDim->getElements(PUser(), false);
+	for (ElementsType::const_iterator it = rows.begin(); it != rows.end(); ++it) {
+		ids[0].push_back((*it)->getIdentifier());
+	}
+	ids[1].push_back(measureDim->lookupElementByName(measure, false)->getIdentifier());
+	return PCubeArea(new CubeArea(db, cube, ids));
+}
+
+static void testRuleEvaluation()
+{
+	// IF makes the rules run cell by cell instead of in blocks
+	vector<string> rules;
+	rules.push_back("['C'] = IF(['A'] > ['B'], ['A'] * 1.1 - ['B'], ['B'] / 2 + ['A'])");
+	rules.push_back("['D'] = IF(['A'] > 500, ABS(['A'] - ['B']) * 2, SQRT(['B']) + ['A'] / 3)");
+	createBenchmarkCube(20000, rules);
+
+	const char *measures[] = {"C", "D"};
+	for (size_t i = 0; i < sizeof(measures) / sizeof(measures[0]); i++) {
+		CPDatabase db;
+		CPCube cube;
+		PCubeArea area = benchmarkArea(db, cube, measures[i]);
+		TestRuleEvaluation interpreted(string("rule ") + measures[i] + ", 20000 cells, interpreted", cube, area, false);
+		interpreted.run();
+		cout << interpreted << endl;
+		TestRuleEvaluation compiled(string("rule ") + measures[i] + ", 20000 cells, threaded code", cube, area, true);
+		compiled.run();
+		cout << compiled << endl;
+		if (fabs(interpreted.getSum() - compiled.getSum()) > 1e-9 * fabs(interpreted.getSum())) {
+			cout << "test failed!" << endl;
+		}
+	}
+	deleteBenchmarkCube();
+}
+
+static void testRuleLookup()
+{
+	// one rule per row, IF makes D read C cell by cell through the rule engine
+	const size_t rows = 1000;
+	vector<string> rules;
+	for (size_t i = 0; i < rows; i++) {
+		string row = StringUtils::convertToString((uint32_t)i);
+		rules.push_back("['R" + row + "','C'] = ['A'] * 2 + " + row);
+	}
+	rules.push_back("['D'] = IF(['B'] > 500, ['C'], ['C'] + 1)");
+	createBenchmarkCube(rows, rules);
+
+	CPDatabase db;
+	CPCube cube;
+	PCubeArea area = benchmarkArea(db, cube, "C");
+	TestRuleLookup single("rule lookup, 1001 rules, 100 single cells of C", cube, area, 100);
+	single.run();
+	cout << single << endl;
+	area = benchmarkArea(db, cube, "D");
+	TestRuleEvaluation chained("rule lookup, 1001 rules, 1000 cells of D reading C", cube, area, false);
+	chained.run();
+	cout << chained << endl;
+	deleteBenchmarkCube();
+}
+
+static void testCubeRelease()
+{
+	// a cached plan holds its cube, the superseded version must still be freed by the next commit
+	vector<string> rules;
+	rules.push_back("['C'] = ['A'] * 2");
+	createBenchmarkCube(100, rules);
+
+	boost::weak_ptr<const Cube> oldCube;
+	IdentifiersType path(2);
+	{
+		CPDatabase db;
+		CPCube cube;
+		PCubeArea area = benchmarkArea(db, cube, "C");
+		PCellStream cs = cube->calculateArea(area, CubeArea::ALL, ALL_RULES, true, UNLIMITED_SORTED_PLAN);
+		while (cs->next()) {
+		}
+		if (!cube->getPlanCache()->getStatistics().plans) {
+			cout << "cube release: no plan cached" << endl;
+		}
+		oldCube = cube;
+		path[0] = *area->elemBegin(0);
+		path[1] = db->lookupDimensionByName("Measures", false)->lookupElementByName("A", false)->getIdentifier();
+	}
+	// end of the request, its context refers to the cube as well
+	Context::reset();
+
+	PServer server = Context::getContext()->getServerCopy();
+	PDatabase db = server->lookupDatabaseByName(BENCHMARK_DATABASE, true);
+	PDatabaseList dbs = server->getDatabaseList(true);
+	server->setDatabaseList(dbs);
+	dbs->set(db);
+	PCube cube = db->findCubeByName("Values", PUser(), true, true);
+	PCubeList cubes = db->getCubeList(true);
+	db->setCubeList(cubes);
+	cubes->set(cube);
+	set<PCube> changedCubes;
+	cube->setCellValue(server, db, PCubeArea(new CubeArea(db, cube, path)), CellValue(1.0), PLockedCells(), PUser(), boost::shared_ptr<PaloSession>(), false, false, DEFAULT, false, 0, changedCubes, false, CubeArea::BASE_NUMERIC);
+	cube->commitChanges(false, PUser(), changedCubes, false);
+	server->commit();
+	cube.reset();
+	db.reset();
+	dbs.reset();
+	server.reset();
+	Context::reset();
+
+	cout << "cube release: old cube version " << (oldCube.expired() ? "freed" : "still referenced") << endl;
+	if (!oldCube.expired()) {
+		cout << "test failed!" << endl;
+	}
+	deleteBenchmarkCube();
+}
+
+void EngineCpuMT::runBenchmarks()
+{
+	testThreadPool();
+	testCellMaps();
+	testSetIntersection();
+	testRuleEvaluation();
+	testRuleLookup();
+	testCubeRelease();
+}
+#endif
 
 PProcessorBase EngineCpuMT::createProcessor(CPPlanNode node, bool sortedOutput, bool useCache)
 {
-//	static bool once = true;
-//	if (once) {
-//		testThreadPool();
-//		once = false;
-//	}
 	if (node->getType() == AGGREGATION) {
 		PProcessorBase ret;
 		const AggregationPlanNode *apn = dynamic_cast<const AggregationPlanNode *>(node.get());
@@ -38,6 +38,15 @@ public:
 	EngineCpuMT() : EngineCpu() {}
 	virtual PCommitable copy() const;
 	virtual PProcessorBase createProcessor(CPPlanNode node, bool sortedOutput, bool useCache = true);
+
+#ifdef ENABLE_TEST_MODE
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief runs the engine benchmarks and prints their results
+	////////////////////////////////////////////////////////////////////////////////
+
+	static void runBenchmarks();
+#endif
+
 private:
 	EngineCpuMT(const EngineCpuMT &s) : EngineCpu(s) {};
 };
@@ -0,0 +1,434 @@
+/* 
+ *
+ * Copyright (C) 2006-2014 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * 
+ *
+ */
+
+#include "Engine/Legacy/CompiledRule.h"
+#include "Engine/Streams.h"
+#include "Olap/Rule.h"
+#include "VirtualMachine/BytecodeGenerator.h"
+
+#include <math.h>
+
+namespace paloLegacy {
+
+bool CompiledRule::enabled = false;
+
+PCompiledRule CompiledRule::get(const ERule &rule)
+{
+	if (!enabled || !rule.arule) {
+		return PCompiledRule();
+	}
+	PCompiledRule result = rule.arule->getCompiled();
+	if (!result) {
+		uint64_t evalCounter = 0;
+		rule.arule->getEvalCounters(&evalCounter, 0);
+		if (evalCounter < HOT_EVALUATIONS) {
+			// interpreted until the rule is hot
+			return PCompiledRule();
+		}
+		result.reset(new CompiledRule(rule));
+		rule.arule->setCompiled(result);
+	}
+	return result->isEmpty() ? PCompiledRule() : result;
+}
+
+CompiledRule::CompiledRule(const ERule &rule)
+{
+	if (!translate(rule)) {
+		code.clear();
+	}
+}
+
+bool CompiledRule::translate(const ERule &rule)
+{
+	const size_t NO_INSTRUCTION = (size_t)-1;
+	vector<size_t> starts(rule.gc_bc_nr, NO_INSTRUCTION);
+	vector<uint32_t> targets;
+	size_t pushes = 0;
+
+	code.reserve(rule.gc_bc_nr);
+	for (uint32_t pc = 0; pc < rule.gc_bc_nr;) {
+		uint32_t position = pc;
+		Bytecode bc = rule.bytecode[pc++];
+		Instruction ins;
+		ins.handler = getHandler(bc);
+		ins.constant = 0.0;
+		ins.operand = 0;
+		ins.target = 0;
+		if (!ins.handler) {
+			return false;
+		}
+		uint32_t target = 0;
+		switch (bc) {
+		case bytecode_generator::PUSH_DBL:
+			pushes++;
+			break;
+		case bytecode_generator::LD_CONST_DBL:
+			ins.operand = rule.bytecode[pc++];
+			if (ins.operand >= rule.gc_dbl_const_nr) {
+				return false;
+			}
+			ins.constant = rule.dbl_consts[ins.operand];
+			pushes++;
+			break;
+		case bytecode_generator::LD_SRC_HIT_DBL:
+		case bytecode_generator::LD_SRC_DBL:
+			ins.operand = rule.bytecode[pc++];
+			if (ins.operand >= rule.gc_copy_nr || !rule.source_precalc[ins.operand]) {
+				return false;
+			}
+			pushes++;
+			break;
+		case bytecode_generator::JUMP:
+		case bytecode_generator::JUMP_IF_NOT:
+			target = rule.bytecode[pc++];
+			target += pc;
+			break;
+		}
+		if (pc > rule.gc_bc_nr) {
+			return false;
+		}
+		starts[position] = code.size();
+		targets.push_back(target);
+		code.push_back(ins);
+	}
+	if (code.empty() || pushes >= MAX_STACK) {
+		return false;
+	}
+	// jumps point to bytecode positions, resolve them to instructions
+	for (size_t i = 0; i < code.size(); i++) {
+		if (code[i].handler == &jump || code[i].handler == &jumpIfNot) {
+			if (targets[i] >= starts.size() || starts[targets[i]] == NO_INSTRUCTION) {
+				return false;
+			}
+			code[i].target = &code[starts[targets[i]]];
+		}
+	}
+	return true;
+}
+
+CompiledRule::Handler CompiledRule::getHandler(Bytecode code)
+{
+	switch (code) {
+	case bytecode_generator::NOP:
+		return &nop;
+	case bytecode_generator::HALT:
+		return &halt;
+	case bytecode_generator::PUSH_DBL:
+		return &push;
+	case bytecode_generator::PULL_DBL:
+		return &pull;
+	case bytecode_generator::SWAP_DBL:
+		return &swap;
+	case bytecode_generator::LD_CONST_DBL:
+		return &loadConstant;
+	case bytecode_generator::LD_SRC_HIT_DBL:
+	case bytecode_generator::LD_SRC_DBL:
+		return &loadSource;
+	case bytecode_generator::JUMP:
+		return &jump;
+	case bytecode_generator::JUMP_IF_NOT:
+		return &jumpIfNot;
+	case bytecode_generator::OP2_SUM_DBL:
+		return &op2<bytecode_generator::OP2_SUM_DBL>;
+	case bytecode_generator::OP2_DIFF_DBL:
+		return &op2<bytecode_generator::OP2_DIFF_DBL>;
+	case bytecode_generator::OP2_PROD_DBL:
+		return &op2<bytecode_generator::OP2_PROD_DBL>;
+	case bytecode_generator::OP2_QUO_DBL:
+		return &op2<bytecode_generator::OP2_QUO_DBL>;
+	case bytecode_generator::OP2_EQ_DBL:
+		return &op2<bytecode_generator::OP2_EQ_DBL>;
+	case bytecode_generator::OP2_NE_DBL:
+		return &op2<bytecode_generator::OP2_NE_DBL>;
+	case bytecode_generator::OP2_LT_DBL:
+		return &op2<bytecode_generator::OP2_LT_DBL>;
+	case bytecode_generator::OP2_LE_DBL:
+		return &op2<bytecode_generator::OP2_LE_DBL>;
+	case bytecode_generator::OP2_LOG_DBL:
+		return &op2<bytecode_generator::OP2_LOG_DBL>;
+	case bytecode_generator::OP2_MOD_DBL:
+		return &op2<bytecode_generator::OP2_MOD_DBL>;
+	case bytecode_generator::OP2_POWER_DBL:
+		return &op2<bytecode_generator::OP2_POWER_DBL>;
+	case bytecode_generator::OP2_QUOTIENT_DBL:
+		return &op2<bytecode_generator::OP2_QUOTIENT_DBL>;
+	case bytecode_generator::OP2_ROUND_DBL:
+		return &op2<bytecode_generator::OP2_ROUND_DBL>;
+	case bytecode_generator::OP1_NOT_DBL:
+		return &op1<bytecode_generator::OP1_NOT_DBL>;
+	case bytecode_generator::OP1_ABS_DBL:
+		return &op1<bytecode_generator::OP1_ABS_DBL>;
+	case bytecode_generator::OP1_ACOS_DBL:
+		return &op1<bytecode_generator::OP1_ACOS_DBL>;
+	case bytecode_generator::OP1_ASIN_DBL:
+		return &op1<bytecode_generator::OP1_ASIN_DBL>;
+	case bytecode_generator::OP1_ATAN_DBL:
+		return &op1<bytecode_generator::OP1_ATAN_DBL>;
+	case bytecode_generator::OP1_CEILING_DBL:
+		return &op1<bytecode_generator::OP1_CEILING_DBL>;
+	case bytecode_generator::OP1_COS_DBL:
+		return &op1<bytecode_generator::OP1_COS_DBL>;
+	case bytecode_generator::OP1_EVEN_DBL:
+		return &op1<bytecode_generator::OP1_EVEN_DBL>;
+	case bytecode_generator::OP1_EXP_DBL:
+		return &op1<bytecode_generator::OP1_EXP_DBL>;
+	case bytecode_generator::OP1_FLOOR_DBL:
+	case bytecode_generator::OP1_INT_DBL:
+	case bytecode_generator::OP1_TRUNC_DBL:
+		return &op1<bytecode_generator::OP1_FLOOR_DBL>;
+	case bytecode_generator::OP1_LN_DBL:
+		return &op1<bytecode_generator::OP1_LN_DBL>;
+	case bytecode_generator::OP1_LOG10_DBL:
+		return &op1<bytecode_generator::OP1_LOG10_DBL>;
+	case bytecode_generator::OP1_ODD_DBL:
+		return &op1<bytecode_generator::OP1_ODD_DBL>;
+	case bytecode_generator::OP1_SIGN_DBL:
+		return &op1<bytecode_generator::OP1_SIGN_DBL>;
+	case bytecode_generator::OP1_SIN_DBL:
+		return &op1<bytecode_generator::OP1_SIN_DBL>;
+	case bytecode_generator::OP1_SQRT_DBL:
+		return &op1<bytecode_generator::OP1_SQRT_DBL>;
+	case bytecode_generator::OP1_TAN_DBL:
+		return &op1<bytecode_generator::OP1_TAN_DBL>;
+	default:
+		// strings, PALO functions, PALO.DATA, STET and CONTINUE need the virtual machine
+		return 0;
+	}
+}
+
+bool CompiledRule::run(const vector<CellValueStream *> &sources, CellValue &result) const
+{
+	Slot stack[MAX_STACK];
+	State state;
+	state.val.value = 0.0;
+	state.val.empty = true;
+	state.sp = stack;
+	state.sources = &sources;
+	state.fallback = false;
+
+	for (const Instruction *ins = &code[0]; ins; ins = ins->handler(ins, state)) {
+	}
+	if (state.fallback) {
+		return false;
+	}
+	if (state.val.empty) {
+		result = CellValue();
+	} else {
+		result = state.val.value;
+	}
+	return true;
+}
+
+const CompiledRule::Instruction *CompiledRule::nop(const Instruction *ins, State &state)
+{
+	return ins + 1;
+}
+
+const CompiledRule::Instruction *CompiledRule::halt(const Instruction *ins, State &state)
+{
+	return 0;
+}
+
+const CompiledRule::Instruction *CompiledRule::push(const Instruction *ins, State &state)
+{
+	*state.sp++ = state.val;
+	return ins + 1;
+}
+
+const CompiledRule::Instruction *CompiledRule::pull(const Instruction *ins, State &state)
+{
+	state.val = *--state.sp;
+	return ins + 1;
+}
+
+const CompiledRule::Instruction *CompiledRule::swap(const Instruction *ins, State &state)
+{
+	std::swap(state.val, state.sp[-1]);
+	return ins + 1;
+}
+
+const CompiledRule::Instruction *CompiledRule::loadConstant(const Instruction *ins, State &state)
+{
+	*state.sp++ = state.val;
+	state.val.value = ins->constant;
+	state.val.empty = false;
+	return ins + 1;
+}
+
+const CompiledRule::Instruction *CompiledRule::loadSource(const Instruction *ins, State &state)
+{
+	*state.sp++ = state.val;
+	CellValueStream *source = (*state.sources)[ins->operand];
+	if (source) {
+		const CellValue &value = source->getValue();
+		if (!value.isNumeric()) {
+			state.fallback = true;
+			return 0;
+		}
+		state.val.empty = value.isEmpty();
+		state.val.value = state.val.empty ? 0.0 : value.getNumeric();
+	} else {
+		state.val.value = 0.0;
+		state.val.empty = true;
+	}
+	return ins + 1;
+}
+
+const CompiledRule::Instruction *CompiledRule::jump(const Instruction *ins, State &state)
+{
+	return ins->target;
+}
+
+const CompiledRule::Instruction *CompiledRule::jumpIfNot(const Instruction *ins, State &state)
+{
+	bool condition = state.val.value != 0.0;
+	state.val = *--state.sp;
+	return condition ? ins + 1 : ins->target;
+}
+
+template <Bytecode OP> const CompiledRule::Instruction *CompiledRule::op1(const Instruction *ins, State &state)
+{
+	double v = state.val.value;
+	double result = 0.0;
+	switch (OP) {
+	case bytecode_generator::OP1_NOT_DBL:
+		result = v == 0.0 ? 1.0 : 0.0;
+		break;
+	case bytecode_generator::OP1_ABS_DBL:
+		result = 0 <= v ? v : -v;
+		break;
+	case bytecode_generator::OP1_ACOS_DBL:
+		result = -1.0 <= v && v <= 1.0 ? acos(v) : 0.0;
+		break;
+	case bytecode_generator::OP1_ASIN_DBL:
+		result = -1.0 <= v && v <= 1.0 ? asin(v) : 0.0;
+		break;
+	case bytecode_generator::OP1_ATAN_DBL:
+		result = atan(v);
+		break;
+	case bytecode_generator::OP1_CEILING_DBL:
+		result = ceil(v);
+		break;
+	case bytecode_generator::OP1_COS_DBL:
+		result = cos(v);
+		break;
+	case bytecode_generator::OP1_EVEN_DBL:
+		result = round(v / 2) * 2;
+		break;
+	case bytecode_generator::OP1_EXP_DBL:
+		result = exp(v);
+		break;
+	case bytecode_generator::OP1_FLOOR_DBL:
+		result = floor(v);
+		break;
+	case bytecode_generator::OP1_LN_DBL:
+		result = 0.0 < v ? log(v) : 0.0;
+		break;
+	case bytecode_generator::OP1_LOG10_DBL:
+		result = 0.0 < v ? log10(v) : 0.0;
+		break;
+	case bytecode_generator::OP1_ODD_DBL:
+		result = round((v - 1) / 2) * 2 + 1;
+		break;
+	case bytecode_generator::OP1_SIGN_DBL:
+		result = 0 < v ? 1.0 : (v < 0 ? -1.0 : 0.0);
+		break;
+	case bytecode_generator::OP1_SIN_DBL:
+		result = sin(v);
+		break;
+	case bytecode_generator::OP1_SQRT_DBL:
+		result = 0.0 <= v ? sqrt(v) : 0.0;
+		break;
+	case bytecode_generator::OP1_TAN_DBL:
+		result = tan(v);
+		break;
+	}
+	state.val.value = result;
+	state.val.empty = false;
+	return ins + 1;
+}
+
+template <Bytecode OP> const CompiledRule::Instruction *CompiledRule::op2(const Instruction *ins, State &state)
+{
+	double l = (--state.sp)->value;
+	double r = state.val.value;
+	double result = 0.0;
+	switch (OP) {
+	case bytecode_generator::OP2_SUM_DBL:
+		result = l + r;
+		break;
+	case bytecode_generator::OP2_DIFF_DBL:
+		result = l - r;
+		break;
+	case bytecode_generator::OP2_PROD_DBL:
+		result = l * r;
+		break;
+	case bytecode_generator::OP2_QUO_DBL:
+		result = r == 0.0 ? 0.0 : l / r;
+		break;
+	case bytecode_generator::OP2_EQ_DBL:
+		result = l == r ? 1.0 : 0.0;
+		break;
+	case bytecode_generator::OP2_NE_DBL:
+		result = l != r ? 1.0 : 0.0;
+		break;
+	case bytecode_generator::OP2_LT_DBL:
+		result = l < r ? 1.0 : 0.0;
+		break;
+	case bytecode_generator::OP2_LE_DBL:
+		result = l <= r ? 1.0 : 0.0;
+		break;
+	case bytecode_generator::OP2_LOG_DBL:
+		result = 0 < l && 0 < r ? log(l) / log(r) : 0.0;
+		break;
+	case bytecode_generator::OP2_MOD_DBL:
+		result = r != 0.0 ? l - floor(l / r) * r : 0.0;
+		break;
+	case bytecode_generator::OP2_POWER_DBL:
+		result = pow(l, r);
+		break;
+	case bytecode_generator::OP2_QUOTIENT_DBL:
+		result = r != 0.0 ? trunc(l / r) : 0.0;
+		break;
+	case bytecode_generator::OP2_ROUND_DBL:
+		if (0 < r) {
+			double scale = pow((double)10, int(r));
+			result = round(l * scale) / scale;
+		} else if (r < 0) {
+			double scale = pow((double)10, -int(r));
+			result = round(l / scale) * scale;
+		} else {
+			result = round(l);
+		}
+		break;
+	}
+	state.val.value = result;
+	state.val.empty = false;
+	return ins + 1;
+}
+
+}
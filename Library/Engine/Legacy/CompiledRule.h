@@ -0,0 +1,133 @@
+/* 
+ *
+ * Copyright (C) 2006-2014 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * 
+ *
+ */
+
+#ifndef COMPILED_RULE_H
+#define COMPILED_RULE_H
+
+#include "palo.h"
+#include "Engine/Legacy/Engine.h"
+
+using namespace palo;
+
+namespace paloLegacy {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief rule bytecode translated to threaded code
+///
+/// Each instruction holds the function executing it and its decoded operand,
+/// so evaluating a cell is a chain of direct calls instead of the opcode switch
+/// of virtual_machine::compute. Only numeric rules reading precalculated
+/// sources are translated, other rules stay empty and run in the virtual
+/// machine. The translation is kept by the Rule and dropped with its definition.
+////////////////////////////////////////////////////////////////////////////////
+
+class CompiledRule {
+public:
+	static const uint64_t HOT_EVALUATIONS = 10000;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief returns the threaded code of a rule evaluated often enough, or null
+	////////////////////////////////////////////////////////////////////////////////
+
+	static boost::shared_ptr<const CompiledRule> get(const ERule &rule);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief enables translation of hot rules
+	////////////////////////////////////////////////////////////////////////////////
+
+	static void setEnabled(bool enabled) {
+		CompiledRule::enabled = enabled;
+	}
+
+	static bool isEnabled() {
+		return enabled;
+	}
+
+	CompiledRule(const ERule &rule);
+
+	bool isEmpty() const {
+		return code.empty();
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief computes one cell from the values of the precalculated sources
+	///
+	/// Returns false if a source value is not a number, the virtual machine has
+	/// to compute such a cell.
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool run(const vector<CellValueStream *> &sources, CellValue &result) const;
+
+private:
+	struct Slot {
+		double value;
+		bool empty;
+	};
+
+	struct State {
+		Slot val;
+		Slot *sp;
+		const vector<CellValueStream *> *sources;
+		bool fallback;
+	};
+
+	struct Instruction;
+	typedef const Instruction *(*Handler)(const Instruction *ins, State &state);
+
+	struct Instruction {
+		Handler handler;
+		double constant;
+		uint32_t operand;
+		const Instruction *target;
+	};
+
+	static const size_t MAX_STACK = 64;
+
+	bool translate(const ERule &rule);
+	static Handler getHandler(Bytecode code);
+
+	static const Instruction *nop(const Instruction *ins, State &state);
+	static const Instruction *halt(const Instruction *ins, State &state);
+	static const Instruction *push(const Instruction *ins, State &state);
+	static const Instruction *pull(const Instruction *ins, State &state);
+	static const Instruction *swap(const Instruction *ins, State &state);
+	static const Instruction *loadConstant(const Instruction *ins, State &state);
+	static const Instruction *loadSource(const Instruction *ins, State &state);
+	static const Instruction *jump(const Instruction *ins, State &state);
+	static const Instruction *jumpIfNot(const Instruction *ins, State &state);
+	template <Bytecode OP> static const Instruction *op1(const Instruction *ins, State &state);
+	template <Bytecode OP> static const Instruction *op2(const Instruction *ins, State &state);
+
+	static bool enabled;
+	vector<Instruction> code;
+};
+
+typedef boost::shared_ptr<const CompiledRule> PCompiledRule;
+
+}
+
+#endif
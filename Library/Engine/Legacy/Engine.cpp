@@ -225,11 +225,19 @@ ERule *ECube::findRule(IdentifierType ruleId)
 	return 0;
 }
 
+void ECube::getCandidates(const EElementId *path, RuleAreaIndex::Mask &mask) const
+{
+	mask.clear();
+	if (areaIndex) {
+		areaIndex->addCandidates(path, mask);
+	}
+}
+
 
 ERule::ERule(ECube *cube, CPRule rule) : cube(cube), nr_rule(rule->getId()), dest_area(0), is_base(0), is_cons(0), marker_flag(0), ubm_flag(0),
 	ubm_rulesTested(0), ubm_noMoreRules(0),	bytecode(0), dbl_consts(0), str_consts(0), source_precalc(0), copy_mask(0),
 	copy_source(0),	gc_bc_nr(0), gc_bc_max(0), gc_dbl_const_nr(0), gc_dbl_const_max(0), gc_str_const_nr(0), gc_str_const_max(0),
-	gc_copy_nr(0), precalcStet(0), arule(rule.get())
+	gc_copy_nr(0), precalcStet(0), arule(rule.get()), areaPosition(RuleAreaIndex::NO_POSITION)
 {
 }
 
@@ -615,6 +623,9 @@ ECube *NewEntryCube(const Cube &acube, const Database &db, const EngineBase &eng
 	result = new ECube((uint32_t)acube.getDimensions()->size(), (uint32_t)activeRules.size(), acube, db);
 
 	try {
+		if (result->nrRules >= ECube::MIN_INDEXED_RULES) {
+			result->areaIndex = acube.getRuleList(false)->getAreaIndex();
+		}
 		for (i = 0; i < result->nrDimensions; i++) {
 			result->dimensions[i] = new EDimension(CONST_COMMITABLE_CAST(Database, context->getParent(acube.shared_from_this()))->lookupDimension(acube.getDimensions()->at(i), false));
 			result->dimensions[i]->init();
@@ -624,6 +635,9 @@ ECube *NewEntryCube(const Cube &acube, const Database &db, const EngineBase &eng
 			CPRule arule = activeRules[i];
 			if (arule->isActive()) {
 				rule = new ERule(result, arule);
+				if (result->areaIndex) {
+					rule->areaPosition = result->areaIndex->getPosition(arule->getId());
+				}
 				try {
 					rule->init();
 				} catch(...) {
@@ -136,6 +136,8 @@ public:
 	ECube(uint32_t nrDimensions, uint32_t nrRules, const Cube &cube, const Database	&database);
 	~ECube();
 	ERule *findRule(IdentifierType ruleId);
+	// mask of the rules whose destination may contain path, empty if every rule has to be checked
+	void getCandidates(const EElementId *path, RuleAreaIndex::Mask &mask) const;
 	uint32_t 	nrDimensions;
 	EDimension	*dimensions[MAX_DIMENSIONS];
 	uint32_t	nrRules;
@@ -145,6 +147,8 @@ public:
 	const Database *database;
 	PStorageBase numStorage;
 	PStorageBase strStorage;
+	CPRuleAreaIndex areaIndex; // set for cubes with MIN_INDEXED_RULES and more
+	static const uint32_t MIN_INDEXED_RULES = 8;
 };
 
 /****************************************************************************
@@ -174,6 +178,9 @@ public:
 	ERule(ECube *cube, CPRule rule);
 	~ERule();
 	void init();
+	bool isCandidate(const RuleAreaIndex::Mask &mask) const {
+		return mask.empty() || areaPosition == RuleAreaIndex::NO_POSITION || RuleAreaIndex::isCandidate(mask, areaPosition);
+	}
 
 	ECube		*cube;
 
@@ -213,6 +220,7 @@ public:
 	uint8_t		precalcStet;
 
 	const Rule *arule;
+	size_t		areaPosition; /* position in ECube::areaIndex */
 private:
 	static const size_t MAX_MASK_SIZE = 256;
 };
@@ -36,6 +36,7 @@
 #include "Engine/EngineCpu.h"
 #include "VirtualMachine/BytecodeGenerator.h"
 #include "Parser/FunctionNodeDateformat.h"
+#include "Collections/CellMap.h"
 
 using namespace palo;
 
@@ -216,8 +217,10 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 							bool new_call = false;
 
 							if (is_consolidation(path_t, *rule->cube)) {
+								RuleAreaIndex::Mask candidates;
+								rule->cube->getCandidates(path_t, candidates);
 								for (list<ERule*>::iterator it = rule->cube->rules_c.begin(); it != rule->cube->rules_c.end(); ++it) {
-									if (IsPathInArea((*it)->dest_area, path_t)) {
+									if ((*it)->isCandidate(candidates) && IsPathInArea((*it)->dest_area, path_t)) {
 										/* rules that apply to cons cells should never have marker */
 										/* even if the code does have a marker the following code  */
 										/* will not crash, but simply return 0 for the marker      */
@@ -247,6 +250,7 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 								/* if no applicable rule is found, treat this as an area           */
 								m_mem_context->m_recursion_stack.push(rule->cube->acube, 0, path_t);
 								const IdentifiersType cp(path_t, path_t + rule->cube->acube->getDimensions()->size());
+								ContextArena::Scope arenaScope;
 								PCubeArea calcArea(new CubeArea(adb, acube, cp));
 								PCellStream cs = rule->cube->acube->calculateArea(calcArea, CubeArea::CONSOLIDATED, INDIRECT_RULES, true, 0);
 								CellValue result;
@@ -260,8 +264,10 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 								m_mem_context->writeQueryCache(acube, path_t, dbl_t, false);
 							} else { // cell is base
 								// loop over the rules
+								RuleAreaIndex::Mask candidates;
+								rule->cube->getCandidates(path_t, candidates);
 								for (list<ERule*>::iterator it = rule->cube->rules_n.begin(); it != rule->cube->rules_n.end(); ++it) {
-									if (IsBasePathInArea((*it)->dest_area, path_t)) {
+									if ((*it)->isCandidate(candidates) && IsBasePathInArea((*it)->dest_area, path_t)) {
 										if ((*it)->ubm_flag) {
 											if (crt_pc == bytecode_generator::LD_SRC_STR) {
 												PUSH(bytecode_generator::RET_LD_SRC_STR)
@@ -424,6 +430,7 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 
 		case bytecode_generator::CALL_DATA_STR:
 		case bytecode_generator::CALL_DATA_DBL: {
+			uint32_t callPosition = (uint32_t)(pc - rule->bytecode - 1);
 			i = *pc++; // parameters count
 //			Logger::debug << "Stack size: " << (sp - stack) << endl;
 			if (!checkStackErrors(i)) {
@@ -484,7 +491,6 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 				break;
 //				throw ErrorException(ErrorException::ERROR_INVALID_COORDINATES, "", rule->nr_rule);
 			}
-			context->setCacheDependence(dbID_cubeID(adb->getId(), acube->getId()));
 			for (j = 0; j < dims; j++) {
 				if (dimensionOrdinal && dimensionOrdinal[j] != -1) {
 					path_t[j] = path[dimensionOrdinal[j]];
@@ -520,12 +526,15 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 				}
 			}
 			if (j >= dims) { // all dimensions processed
+				context->setCacheDependence(dbID_cubeID(adb->getId(), acube->getId()), IdentifiersType(path_t, path_t + dims));
 				ECube * cube = NewEntryCube(*acube, *adb, *engine, context);
 
 				bool isStr = is_string(path_t, *cube);
 
 				bool isString;
-				if (m_mem_context->readQueryCache(acube, path_t, dbl_t, isString)) {
+				if (!isStr && paloDataPrefetch && dimensionOrdinal && m_stack.is_empty() && paloDataPrefetch->find(callPosition, adb, acube, dimensionOrdinal, dimensionElements, path_t, result)) {
+					// read together with the other cells of the target area
+				} else if (m_mem_context->readQueryCache(acube, path_t, dbl_t, isString)) {
 					if (isString) {
 						StringStorageCpu *st = dynamic_cast<StringStorageCpu*>(engine->getStorage(acube->getStringStorageId()).get());
 						st->convertToCellValue(result, dbl_t);
@@ -546,11 +555,14 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 					if (isStr) {
 						bool rulecalculated = false;
 						// loop over the rules
+						RuleAreaIndex::Mask candidates;
+						cube->getCandidates(path_t, candidates);
 						for (list<ERule*>::iterator it = cube->rules_n.begin(); it != cube->rules_n.end(); ++it) {
-							if (IsPathInArea((*it)->dest_area, path_t)) {
+							if ((*it)->isCandidate(candidates) && IsPathInArea((*it)->dest_area, path_t)) {
 								// check rule recursion
 								m_mem_context->m_recursion_stack.push(cube->acube, rule->arule, path_t);
 								const IdentifiersType cp(path_t, path_t + cube->acube->getDimensions()->size());
+								ContextArena::Scope arenaScope;
 								PCubeArea calcArea(new CubeArea(adb, acube, cp));
 								PCellStream cs = cube->acube->calculateArea(calcArea, CubeArea::BASE_STRING, RulesType(ALL_RULES | NO_RULE_IDS), true, 0);
 								if (cs && cs->next()) {
@@ -578,8 +590,10 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 
 						if (is_consolidation(path_t, *cube)) {
 							/* loop over the rules                                             */
+							RuleAreaIndex::Mask candidates;
+							cube->getCandidates(path_t, candidates);
 							for (list<ERule*>::iterator it = cube->rules_c.begin(); it != cube->rules_c.end(); ++it) {
-								if (IsPathInArea((*it)->dest_area, path_t)) {
+								if ((*it)->isCandidate(candidates) && IsPathInArea((*it)->dest_area, path_t)) {
 									/* rules that apply to cons cells should never have marker */
 									/* even if the code does have a marker the following code  */
 									/* will not crash, but simply return 0 for the marker      */
@@ -610,6 +624,7 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 							/* if no applicable rule is found, treat this as an area           */
 							m_mem_context->m_recursion_stack.push(cube->acube, 0, path_t);
 							const IdentifiersType cp(path_t, path_t + cube->acube->getDimensions()->size());
+							ContextArena::Scope arenaScope;
 							PCubeArea calcArea(new CubeArea(adb, acube, cp));
 							PCellStream cs = cube->acube->calculateArea(calcArea, CubeArea::CONSOLIDATED, INDIRECT_RULES, true, 0);
 							if (cs && cs->next()) {
@@ -622,8 +637,10 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 							m_mem_context->writeQueryCache(acube, path_t, dbl_t, false);
 						} else { // cell is base
 							// loop over the rules
+							RuleAreaIndex::Mask candidates;
+							cube->getCandidates(path_t, candidates);
 							for (list<ERule*>::iterator it = cube->rules_n.begin(); it != cube->rules_n.end(); ++it) {
-								if (IsBasePathInArea((*it)->dest_area, path_t)) {
+								if ((*it)->isCandidate(candidates) && IsBasePathInArea((*it)->dest_area, path_t)) {
 									if ((*it)->ubm_flag) {
 										if (crt_pc == bytecode_generator::CALL_DATA_STR) {
 											PUSH(bytecode_generator::RET_CALL_DATA_STR);
@@ -714,11 +731,13 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 			} else {
 				plist = &rule->cube->rules_n;
 			}
+			RuleAreaIndex::Mask candidates;
+			rule->cube->getCandidates(path, candidates);
 			list<ERule*>::iterator end_it = plist->end();
 			list<ERule*>::iterator it = find(plist->begin(), end_it, rule);
 			do {
 				++it;
-			} while (it != end_it && !IsPathInArea((*it)->dest_area, path));
+			} while (it != end_it && !((*it)->isCandidate(candidates) && IsPathInArea((*it)->dest_area, path)));
 			if (it != end_it) {
 				PUSH(bytecode_generator::RET_LD_SRC_DBL)
 				rule = *it;
@@ -732,6 +751,7 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 				CellValue val;
 				CPDatabase adb = CONST_COMMITABLE_CAST(Database, context->getParent(rule->cube->acube->shared_from_this()));
 				const IdentifiersType cp(path, path + rule->cube->acube->getDimensions()->size());
+				ContextArena::Scope arenaScope;
 				PCubeArea calcArea(new CubeArea(adb, CONST_COMMITABLE_CAST(Cube, rule->cube->acube->shared_from_this()), cp));
 				PCellStream cs = rule->cube->acube->calculateArea(calcArea, CubeArea::ALL, INDIRECT_RULES, true, 0);
 				if (cs && cs->next()) {
@@ -759,6 +779,7 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 					m_mem_context->m_recursion_stack.push(rule->cube->acube, rule->arule, path);
 					CellValue val;
 					CPDatabase adb = CONST_COMMITABLE_CAST(Database, context->getParent(rule->cube->acube->shared_from_this()));
+					ContextArena::Scope arenaScope;
 					PCubeArea calcArea(new CubeArea(adb, CONST_COMMITABLE_CAST(Cube, rule->cube->acube->shared_from_this()), apath));
 					PCellStream cs = rule->cube->acube->calculateArea(calcArea, CubeArea::ALL, RulesType(INDIRECT_RULES | NOCACHE), true, 0);
 					if (cs && cs->next()) {
@@ -2004,4 +2025,100 @@ void virtual_machine::compute(EngineBase *engine, IdentifierType *path, ERule* s
 		}
 	}
 }
+
+bool PaloDataPrefetch::find(uint32_t position, CPDatabase adb, CPCube acube, const int16_t *dimensionOrdinal, const IdentifierType *dimensionElements, const IdentifierType *path, CellValue &value)
+{
+	Call &call = calls[position];
+	if (call.disabled) {
+		return false;
+	}
+	if (!call.values) {
+		if (++call.count < PREFETCH_AFTER_CALLS) {
+			return false;
+		}
+		if (!prefetch(call, adb, acube, dimensionOrdinal, dimensionElements)) {
+			call.disabled = true;
+			return false;
+		}
+	}
+	double numeric;
+	if (call.values->get(path, numeric)) {
+		value = numeric;
+	} else {
+		map<IdentifiersType, CellValue>::const_iterator it = call.others.find(IdentifiersType(path, path + acube->getDimensions()->size()));
+		value = it == call.others.end() ? CellValue::NullNumeric : it->second;
+	}
+	return true;
+}
+
+bool PaloDataPrefetch::prefetch(Call &call, CPDatabase adb, CPCube acube, const int16_t *dimensionOrdinal, const IdentifierType *dimensionElements)
+{
+	// cells of the rule's own cube may depend on the area being calculated
+	if (acube.get() == rule->cube->acube) {
+		return false;
+	}
+	size_t dims = acube->getDimensions()->size();
+	PCubeArea sourceArea(new CubeArea(adb, acube, dims));
+	vector<bool> usedOrdinals(targetArea->dimCount(), false);
+	for (size_t i = 0; i < dims; i++) {
+		if (dimensionOrdinal[i] != -1) {
+			// a target dimension used twice would read a cross product instead of a diagonal
+			if (usedOrdinals[dimensionOrdinal[i]]) {
+				return false;
+			}
+			usedOrdinals[dimensionOrdinal[i]] = true;
+			sourceArea->insert(i, targetArea->getDim(dimensionOrdinal[i]));
+		} else if (dimensionElements && dimensionElements[i] != NO_IDENTIFIER) {
+			PSet s(new Set);
+			s->insert(dimensionElements[i]);
+			sourceArea->insert(i, s);
+		} else {
+			return false;
+		}
+	}
+
+	try {
+		if (rule->arule->isCustom()) {
+			if (User::checkUser(user)) {
+				User::RightSetting rs(User::checkCellDataRightCube(adb, acube));
+				acube->checkAreaAccessRight(adb, user, sourceArea, rs, false, RIGHT_READ, 0);
+			}
+		} else {
+			User::checkRuleDatabaseRight(user.get(), rule->cube->database->getId(), adb->getId());
+		}
+	} catch (ErrorException &) {
+		// single cells report the error
+		return false;
+	}
+
+	size_t depth = mem_context->m_recursion_stack.size();
+	if (mem_context->m_recursion_stack.push(sourceArea, rule->arule)) {
+		mem_context->m_recursion_stack.clean(depth);
+		return false;
+	}
+	PDoubleCellMap values = CreateDoubleCellMap(dims);
+	map<IdentifiersType, CellValue> others;
+	try {
+		PCellStream cs = acube->calculateArea(sourceArea, CubeArea::NUMERIC, RulesType(ALL_RULES | NO_RULE_IDS), true, UNLIMITED_UNSORTED_PLAN);
+		while (cs && cs->next()) {
+			const CellValue &v = cs->getValue();
+			if (v.isNumeric() && !v.isError()) {
+				values->set(cs->getKey(), v.getNumeric());
+			} else {
+				others[cs->getKey()] = v;
+			}
+		}
+	} catch (ErrorException &e) {
+		mem_context->m_recursion_stack.clean(depth);
+		if (e.getErrorType() == ErrorException::ERROR_STOPPED_BY_ADMIN) {
+			throw;
+		}
+		return false;
+	}
+	mem_context->m_recursion_stack.clean(depth);
+	call.values = values;
+	call.others.swap(others);
+	return true;
+}
+
 }
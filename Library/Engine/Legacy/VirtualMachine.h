@@ -49,6 +49,48 @@ class VMCache : public ElemNameCache
 {
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief PALO.DATA values read for the whole target area of a rule
+///
+/// A PALO.DATA call with a resolved cube whose elements are target elements or
+/// constants reads its source area, mapped from the target area, by a single
+/// calculateArea once it was called often enough. Further cells of the target
+/// area look the values up here instead of calculating one cell each.
+////////////////////////////////////////////////////////////////////////////////
+
+class PaloDataPrefetch {
+public:
+	static const size_t PREFETCH_AFTER_CALLS = 64;
+
+	PaloDataPrefetch(CPCubeArea targetArea, ERule *rule, RulesContext *mem_context, PUser user) :
+		targetArea(targetArea), rule(rule), mem_context(mem_context), user(user) {}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief gets the value of a PALO.DATA call of the rule at bytecode position
+	///
+	/// Returns false if the call is not prefetched, the caller computes the cell.
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool find(uint32_t position, CPDatabase adb, CPCube acube, const int16_t *dimensionOrdinal, const IdentifierType *dimensionElements, const IdentifierType *path, CellValue &value);
+
+private:
+	struct Call {
+		Call() : count(0), disabled(false) {}
+		size_t count;
+		bool disabled;
+		PDoubleCellMap values;
+		map<IdentifiersType, CellValue> others; // strings and errors
+	};
+
+	bool prefetch(Call &call, CPDatabase adb, CPCube acube, const int16_t *dimensionOrdinal, const IdentifierType *dimensionElements);
+
+	CPCubeArea targetArea;
+	ERule *rule;
+	RulesContext *mem_context;
+	PUser user;
+	map<uint32_t, Call> calls;
+};
+
 class virtual_machine {
 private:
 
@@ -168,6 +210,7 @@ private:
 
 	vector<CellValueStream *> *sourceStreams;
 	VMCache *vmCache;
+	PaloDataPrefetch *paloDataPrefetch;
 	PUser user;
 
 	struct machine_state {
@@ -313,7 +356,7 @@ public:
 	void compute(EngineBase *engine, IdentifierType *path, ERule* rule, double defValue, bool notFoundStatus);
 
 	virtual_machine(RulesContext* mem_context, CellValue* ptrValue) :
-		m_mem_context(mem_context), ptrValue(ptrValue), context(mem_context->context), sourceStreams(0), vmCache(0)
+		m_mem_context(mem_context), ptrValue(ptrValue), context(mem_context->context), sourceStreams(0), vmCache(0), paloDataPrefetch(0)
 	{
 		stack = preallocated_stacks::get_instance().get(handle);
 
@@ -328,6 +371,7 @@ public:
 
 	void setSourceStreams(vector<CellValueStream *> *sourceStreams) {this->sourceStreams = sourceStreams;}
 	void setCache(VMCache *vmCache) {this->vmCache = vmCache;}
+	void setPaloDataPrefetch(PaloDataPrefetch *paloDataPrefetch) {this->paloDataPrefetch = paloDataPrefetch;}
 	void setUser(PUser user) {this->user = user;}
 };
 }
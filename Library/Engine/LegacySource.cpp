@@ -41,7 +41,7 @@ using namespace paloLegacy;
 namespace palo {
 
 LegacyRule::LegacyRule(PEngineBase engine, CPPlanNode node) :
-		ProcessorBase(true, engine), engine(engine), isValidPath(false), node(node)
+		ProcessorBase(true, engine), engine(engine), isValidPath(false), batchProgram(false), batchStackSize(0), batchCount(0), batchPos(0), batchCurrent(false), batchEnd(false), node(node)
 {
 	Context *context = Context::getContext();
 	legacyRulePlanNode = dynamic_cast<const LegacyRulePlanNode *>(node.get());
@@ -56,6 +56,10 @@ LegacyRule::LegacyRule(PEngineBase engine, CPPlanNode node) :
 	erule = ecube->findRule(rule->getId());
 	if (erule && erule->arule) {
 		generateSources();
+		batchProgram = isBatchProgram();
+		if (!batchProgram) {
+			compiledRule = CompiledRule::get(*erule);
+		}
 	} else {
 		stringstream msg;
 		msg << "rule " << rule->getId() << " not found in database " <<  db->getName() << ", cube " << cube->getName() << ", erule";
@@ -70,6 +74,7 @@ LegacyRule::LegacyRule(PEngineBase engine, CPPlanNode node) :
 
 	boost::shared_ptr<PaloSession> session = Context::getContext()->getSession();
 	user = session ? session->getUser() : PUser();
+	paloDataPrefetch.reset(new PaloDataPrefetch(area, erule, mem_context, user));
 }
 
 LegacyRule::~LegacyRule()
@@ -270,16 +275,22 @@ void LegacyRule::computeCell()
 			}
 		}
 
-		// apply the rule
-		virtual_machine machine(mem_context, &value);
-		machine.setSourceStreams(&sourceStreamsCopy);
-		machine.setCache(&vmCache);
-		machine.setUser(user);
+		if (compiledRule && compiledRule->run(sourceStreamsCopy, value)) {
+			mem_context->writeQueryCache(cube, &vkey[0], value.getNumeric(), false);
+			erule->arule->increaseEvalCounter(value.getNumeric() == 0.0);
+		} else {
+			// apply the rule
+			virtual_machine machine(mem_context, &value);
+			machine.setSourceStreams(&sourceStreamsCopy);
+			machine.setCache(&vmCache);
+			machine.setPaloDataPrefetch(paloDataPrefetch.get());
+			machine.setUser(user);
 
-		// Todo: -jj- not optimal - instead of using CellStatus::NotFoundStatus we should define LegacyUbmMarkedRule and define source processor driving the calculation
-		EPath vkeyCopy;
-		memcpy(vkeyCopy, &vkey[0], vkey.size() * sizeof(IdentifierType));
-		machine.compute(engine.get(), &vkeyCopy[0], erule, defValue, notFoundStatus);
+			// Todo: -jj- not optimal - instead of using CellStatus::NotFoundStatus we should define LegacyUbmMarkedRule and define source processor driving the calculation
+			EPath vkeyCopy;
+			memcpy(vkeyCopy, &vkey[0], vkey.size() * sizeof(IdentifierType));
+			machine.compute(engine.get(), &vkeyCopy[0], erule, defValue, notFoundStatus);
+		}
 		if (value.isEmpty() && generateEmptyResults) {	// if value is empty - make sure it has correct type
 			value = *legacyRulePlanNode->getDefaultValue();
 		}
@@ -295,8 +306,266 @@ void LegacyRule::computeCell()
 	value.setRuleId(erule->nr_rule);
 }
 
+bool LegacyRule::isBatchProgram()
+{
+	if (generateEmptyResults && !legacyRulePlanNode->getDefaultValue()->isNumeric()) {
+		return false;
+	}
+	// the program has no jumps, so its stack depth is known at each instruction
+	size_t depth = 0;
+	for (uint32_t pc = 0; pc < erule->gc_bc_nr;) {
+		switch (erule->bytecode[pc++]) {
+		case bytecode_generator::NOP:
+			break;
+		case bytecode_generator::HALT:
+			return true;
+		case bytecode_generator::PUSH_DBL:
+			depth++;
+			break;
+		case bytecode_generator::PULL_DBL:
+			if (!depth) {
+				return false;
+			}
+			depth--;
+			break;
+		case bytecode_generator::SWAP_DBL:
+			if (!depth) {
+				return false;
+			}
+			break;
+		case bytecode_generator::LD_CONST_DBL:
+			pc++;
+			depth++;
+			break;
+		case bytecode_generator::LD_SRC_HIT_DBL:
+		case bytecode_generator::LD_SRC_DBL: {
+			Bytecode source = erule->bytecode[pc++];
+			if (source >= erule->gc_copy_nr || !erule->source_precalc[source]) {
+				return false;
+			}
+			depth++;
+			break;
+		}
+		case bytecode_generator::OP2_SUM_DBL:
+		case bytecode_generator::OP2_DIFF_DBL:
+		case bytecode_generator::OP2_PROD_DBL:
+		case bytecode_generator::OP2_QUO_DBL:
+			if (!depth) {
+				return false;
+			}
+			depth--;
+			break;
+		default:
+			// strings, conditions, functions, CALL_DATA, STET and CONTINUE need the virtual machine
+			return false;
+		}
+		if (depth > batchStackSize) {
+			batchStackSize = depth;
+		}
+	}
+	return false;
+}
+
+void LegacyRule::copyColumn(size_t from, size_t to)
+{
+	memcpy(&batchValues[to * BATCH_SIZE], &batchValues[from * BATCH_SIZE], batchCount * sizeof(double));
+	memcpy(&batchEmpty[to * BATCH_SIZE], &batchEmpty[from * BATCH_SIZE], batchCount);
+}
+
+bool LegacyRule::gatherSources(size_t cell)
+{
+	size_t column = 1 + batchStackSize;
+	for (uint32_t source = 0; source < sourceStreamsSP.size(); source++) {
+		double &sourceValue = batchValues[(column + source) * BATCH_SIZE + cell];
+		uint8_t &sourceEmpty = batchEmpty[(column + source) * BATCH_SIZE + cell];
+		sourceValue = 0.0;
+		sourceEmpty = 1;
+		if (!sourceStreamsNext[source]) {
+			continue;
+		}
+		bool exactMatch = false;
+		sourceStreamsNext[source] = sourceStreams[source]->move(vkey, &exactMatch);
+		if (!sourceStreamsNext[source]) {
+			sourceStreamsSP[source].reset();
+			sourceStreams[source] = 0;
+		} else if (exactMatch) {
+			const CellValue &sv = sourceStreams[source]->getValue();
+			if (!sv.isNumeric()) {
+				// errors and strings are left to the virtual machine
+				return false;
+			}
+			if (!sv.isEmpty()) {
+				sourceValue = sv.getNumeric();
+				sourceEmpty = 0;
+			}
+		}
+	}
+	return true;
+}
+
+void LegacyRule::evaluateBatch()
+{
+	// column 0 is the val_0 register of the virtual machine, the stack follows
+	double *val = &batchValues[0];
+	uint8_t *valEmpty = &batchEmpty[0];
+	size_t sp = 1;
+	size_t sourceColumn = 1 + batchStackSize;
+
+	std::fill(val, val + batchCount, 0.0);
+	std::fill(valEmpty, valEmpty + batchCount, 1);
+
+	for (uint32_t pc = 0;;) {
+		Bytecode code = erule->bytecode[pc++];
+		switch (code) {
+		case bytecode_generator::NOP:
+			break;
+
+		case bytecode_generator::HALT: {
+			CPCube acube = CONST_COMMITABLE_CAST(Cube, erule->cube->acube->shared_from_this());
+			size_t dims = vkey.size();
+			for (size_t cell = 0; cell < batchCount; cell++) {
+				mem_context->writeQueryCache(acube, &batchKeys[cell * dims], val[cell], false);
+				erule->arule->increaseEvalCounter(val[cell] == 0.0);
+			}
+			return;
+		}
+
+		case bytecode_generator::PUSH_DBL:
+			copyColumn(0, sp++);
+			break;
+
+		case bytecode_generator::PULL_DBL:
+			copyColumn(--sp, 0);
+			break;
+
+		case bytecode_generator::SWAP_DBL:
+			std::swap_ranges(val, val + batchCount, &batchValues[(sp - 1) * BATCH_SIZE]);
+			std::swap_ranges(valEmpty, valEmpty + batchCount, &batchEmpty[(sp - 1) * BATCH_SIZE]);
+			break;
+
+		case bytecode_generator::LD_CONST_DBL:
+			copyColumn(0, sp++);
+			std::fill(val, val + batchCount, erule->dbl_consts[erule->bytecode[pc++]]);
+			std::fill(valEmpty, valEmpty + batchCount, 0);
+			break;
+
+		case bytecode_generator::LD_SRC_HIT_DBL:
+		case bytecode_generator::LD_SRC_DBL:
+			copyColumn(0, sp++);
+			copyColumn(sourceColumn + erule->bytecode[pc++], 0);
+			break;
+
+		default: {
+			const double *op = &batchValues[--sp * BATCH_SIZE];
+			switch (code) {
+			case bytecode_generator::OP2_SUM_DBL:
+				for (size_t cell = 0; cell < batchCount; cell++) {
+					val[cell] = op[cell] + val[cell];
+				}
+				break;
+			case bytecode_generator::OP2_DIFF_DBL:
+				for (size_t cell = 0; cell < batchCount; cell++) {
+					val[cell] = op[cell] - val[cell];
+				}
+				break;
+			case bytecode_generator::OP2_PROD_DBL:
+				for (size_t cell = 0; cell < batchCount; cell++) {
+					val[cell] = op[cell] * val[cell];
+				}
+				break;
+			case bytecode_generator::OP2_QUO_DBL:
+				for (size_t cell = 0; cell < batchCount; cell++) {
+					val[cell] = val[cell] ? op[cell] / val[cell] : 0.0;
+				}
+				break;
+			default:
+				throw ErrorException(ErrorException::ERROR_INTERNAL, "invalid bytecode in LegacyRule::evaluateBatch()");
+			}
+			std::fill(valEmpty, valEmpty + batchCount, 0);
+			break;
+		}
+		}
+	}
+}
+
+bool LegacyRule::fillBatch()
+{
+	batchCount = 0;
+	batchPos = 0;
+	if (batchEnd) {
+		return false;
+	}
+	size_t dims = cube->getDimensions()->size();
+	if (batchKeys.empty()) {
+		size_t columns = 1 + batchStackSize + sourceStreamsSP.size();
+		batchKeys.resize(BATCH_SIZE * dims);
+		batchValues.resize(BATCH_SIZE * columns);
+		batchEmpty.resize(BATCH_SIZE * columns);
+	}
+	mem_context->context->check();
+
+	while (batchCount < BATCH_SIZE) {
+		if (isValidPath) {
+			++path;
+		} else {
+			path = area->pathBegin();
+			isValidPath = true;
+		}
+		if (path == area->pathEnd()) {
+			batchEnd = true;
+			break;
+		}
+		vkey = *path;
+		bool gathered = false;
+		try {
+			gathered = gatherSources(batchCount);
+		} catch (ErrorException &e) {
+			if (e.getErrorType() == ErrorException::ERROR_STOPPED_BY_ADMIN) {
+				throw e;
+			}
+		}
+		if (!gathered) {
+			batchCurrent = true;
+			break;
+		}
+		std::copy(vkey.begin(), vkey.end(), batchKeys.begin() + batchCount * dims);
+		batchCount++;
+	}
+	if (batchCount) {
+		evaluateBatch();
+	}
+	return batchCount || batchCurrent;
+}
+
 bool LegacyRule::next()
 {
+	if (batchProgram && !globalError.isError()) {
+		size_t dims = cube->getDimensions()->size();
+		for (;;) {
+			while (batchPos < batchCount) {
+				size_t cell = batchPos++;
+				if (batchEmpty[cell] && !generateEmptyResults) {
+					continue;
+				}
+				vkey.assign(batchKeys.begin() + cell * dims, batchKeys.begin() + (cell + 1) * dims);
+				value = batchEmpty[cell] ? *legacyRulePlanNode->getDefaultValue() : CellValue(batchValues[cell]);
+				value.setRuleId(erule->nr_rule);
+				return true;
+			}
+			if (batchCurrent) {
+				batchCurrent = false;
+				batchCount = 0;
+				vkey = *path;
+				computeCell();
+				if (generateEmptyResults || !value.isEmpty()) {
+					return true;
+				}
+			}
+			if (!fillBatch()) {
+				return false;
+			}
+		}
+	}
 	for (;;) {
 		if (isValidPath) {
 			++path;
@@ -350,6 +619,10 @@ void LegacyRule::reset()
 {
 	isValidPath = false;
 	vkey.clear();
+	batchCount = 0;
+	batchPos = 0;
+	batchCurrent = false;
+	batchEnd = false;
 	for (size_t src = 0; src < sourceStreams.size(); ++src) {
 		if(sourceStreams[src]) {
 			sourceStreams[src]->reset();
@@ -33,6 +33,7 @@
 #include "palo.h"
 #include "Engine/Area.h"
 #include "Engine/Legacy/Engine.h"
+#include "Engine/Legacy/CompiledRule.h"
 #include "Engine/Legacy/VirtualMachine.h"
 
 using namespace paloLegacy;
@@ -73,12 +74,31 @@ private:
 	vector<ProcessorBase *> sourceStreams;
 	vector<bool> sourceStreamsNext;
 	VMCache vmCache;
+
+	// batch evaluation of rules computing only arithmetic of precalculated sources
+	static const size_t BATCH_SIZE = 256;
+	bool batchProgram;
+	size_t batchStackSize;
+	size_t batchCount;
+	size_t batchPos;
+	bool batchCurrent; // the batch stopped at a cell the virtual machine has to compute
+	bool batchEnd;
+	vector<IdentifierType> batchKeys;
+	vector<double> batchValues; // columns: result, stack, sources
+	vector<uint8_t> batchEmpty;
 private:
 	// Engine
 	RulesContext *mem_context;
 	ERule *erule;
+	PCompiledRule compiledRule;
+	boost::shared_ptr<PaloDataPrefetch> paloDataPrefetch;
 	bool generateEmptyResults;
 	void generateSources();
+	bool isBatchProgram();
+	bool fillBatch();
+	bool gatherSources(size_t cell);
+	void evaluateBatch();
+	void copyColumn(size_t from, size_t to);
 protected:
 	void computeCell();
 	IdentifiersType vkey;
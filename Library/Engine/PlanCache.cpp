@@ -0,0 +1,199 @@
+/* 
+ *
+ * Copyright (C) 2006-2014 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * 
+ *
+ */
+
+#include "Engine/PlanCache.h"
+#include "Thread/WriteLocker.h"
+#include "Olap/Context.h"
+#include "Olap/Server.h"
+#include "Olap/Database.h"
+#include "Olap/Cube.h"
+
+namespace palo {
+
+const size_t PlanCache::MAX_PLANS;
+const size_t PlanCache::MAX_SIGNATURE_SIZE;
+
+PlanCache::PlanCache() : hits(0), misses(0), uncacheable(0), retired(false)
+{
+}
+
+bool PlanCache::createSignature(const CubeArea &area, const Signature &prefix, Signature &signature)
+{
+	signature = prefix;
+	signature.push_back(area.dimCount());
+	for (size_t dim = 0; dim < area.dimCount(); dim++) {
+		if (area.elemCount(dim) == 1) {
+			IdentifierType id = *area.elemBegin(dim);
+			signature.push_back(1);
+			signature.push_back(id);
+			signature.push_back(id);
+			continue;
+		}
+		CPSet s = area.getDim(dim);
+		if (!s) {
+			signature.push_back(0);
+			continue;
+		}
+		signature.push_back(s->getRangesCount());
+		for (Set::range_iterator it = s->rangeBegin(); it != s->rangeEnd(); ++it) {
+			signature.push_back(it.low());
+			signature.push_back(it.high());
+		}
+		if (signature.size() > MAX_SIGNATURE_SIZE) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PlanCache::inspect(const PlanNode &node, Entry &entry)
+{
+	switch (node.getType()) {
+	case CACHE:
+	case QUERY_CACHE:
+	case CELL_RIGHTS:
+		return false;
+	case TRANSFORMATION: {
+		const TransformationPlanNode *transformationPlanNode = dynamic_cast<const TransformationPlanNode *>(&node);
+		const dbID_cubeID &sourceCubeId = transformationPlanNode->getSourceCubeId();
+		if (sourceCubeId.first != NO_IDENTIFIER) {
+			CPDatabase db = Context::getContext()->getServer()->lookupDatabase(sourceCubeId.first, false);
+			CPCube cube = db ? db->lookupCube(sourceCubeId.second, false) : CPCube();
+			if (!cube) {
+				return false;
+			}
+			Dependency dependency;
+			dependency.cubeId = sourceCubeId;
+			dependency.dbToken = db->getToken();
+			dependency.cube = cube;
+			entry.dependencies.push_back(dependency);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+	if (node.getCache()) {
+		entry.cacheWriter = true;
+	}
+	const vector<PPlanNode> &children = node.getChildren();
+	for (vector<PPlanNode>::const_iterator it = children.begin(); it != children.end(); ++it) {
+		if (*it && !inspect(**it, entry)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PlanCache::isValid(const Entry &entry, uint64_t cacheRevision)
+{
+	if (entry.cacheWriter && entry.cacheRevision != cacheRevision) {
+		// calculated values could be in the value cache now
+		return false;
+	}
+	for (vector<Dependency>::const_iterator it = entry.dependencies.begin(); it != entry.dependencies.end(); ++it) {
+		CPDatabase db = Context::getContext()->getServer()->lookupDatabase(it->cubeId.first, false);
+		CPCube cube = db ? db->lookupCube(it->cubeId.second, false) : CPCube();
+		if (!cube || db->getToken() != it->dbToken || cube != it->cube.lock()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+PPlanNode PlanCache::find(const Signature &signature, uint64_t cacheRevision)
+{
+	WriteLocker wl(&lock);
+	map<Signature, Entry>::iterator it = plans.find(signature);
+	if (it != plans.end()) {
+		if (isValid(it->second, cacheRevision)) {
+			lru.splice(lru.end(), lru, it->second.lru);
+			hits++;
+			return it->second.plan;
+		}
+		lru.erase(it->second.lru);
+		plans.erase(it);
+	}
+	misses++;
+	return PPlanNode();
+}
+
+void PlanCache::insert(const Signature &signature, PPlanNode plan, uint64_t cacheRevision)
+{
+	if (!plan) {
+		return;
+	}
+	Entry entry;
+	entry.plan = plan;
+	entry.cacheRevision = cacheRevision;
+	entry.cacheWriter = false;
+	if (!inspect(*plan, entry)) {
+		uncacheable++;
+		return;
+	}
+
+	WriteLocker wl(&lock);
+	if (retired) {
+		return;
+	}
+	map<Signature, Entry>::iterator it = plans.find(signature);
+	if (it != plans.end()) {
+		lru.erase(it->second.lru);
+		plans.erase(it);
+	}
+	while (plans.size() >= MAX_PLANS) {
+		plans.erase(lru.front());
+		lru.pop_front();
+	}
+	entry.lru = lru.insert(lru.end(), signature);
+	plans.insert(make_pair(signature, entry));
+}
+
+void PlanCache::retire()
+{
+	// entries are released outside of the lock, their plans may own cubes
+	map<Signature, Entry> released;
+	{
+		WriteLocker wl(&lock);
+		retired = true;
+		released.swap(plans);
+		lru.clear();
+	}
+}
+
+PlanCache::Statistics PlanCache::getStatistics() const
+{
+	Statistics stats;
+	stats.hits = hits.load();
+	stats.misses = misses.load();
+	stats.uncacheable = uncacheable.load();
+	WriteLocker wl(&lock);
+	stats.plans = plans.size();
+	return stats;
+}
+
+}
@@ -0,0 +1,116 @@
+/* 
+ *
+ * Copyright (C) 2006-2014 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * 
+ *
+ */
+
+#ifndef OLAP_ENGINE_PLAN_CACHE_H
+#define OLAP_ENGINE_PLAN_CACHE_H 1
+
+#include "palo.h"
+#include "Engine/EngineBase.h"
+#include "Thread/Mutex.h"
+
+#include <atomic>
+#include <boost/weak_ptr.hpp>
+
+namespace palo {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief cache of created plans of a cube
+///
+/// Plans are keyed by the database token (dimension changes), the cube token,
+/// revision of the rules, the calculation parameters and the element ranges of
+/// the area. Every cube change creates a new cube object with an empty cache.
+/// Plans reading the value cache or user dependent plans are not stored, plans
+/// writing to the value cache are replanned after the value cache changed.
+/// Plans reading other cubes remember their objects and database tokens.
+/// Cached plans hold the cube they were created for, so the cache of a
+/// superseded cube version is retired after the commit to free that version.
+////////////////////////////////////////////////////////////////////////////////
+
+class SERVER_CLASS PlanCache {
+public:
+	typedef vector<uint64_t> Signature;
+
+	struct Statistics {
+		Statistics() : hits(0), misses(0), uncacheable(0), plans(0) {}
+
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t uncacheable;
+		size_t plans;
+	};
+
+	static const size_t MAX_PLANS = 256;
+	static const size_t MAX_SIGNATURE_SIZE = 4096;
+
+	PlanCache();
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief key of the area and calculation parameters, false if too large
+	////////////////////////////////////////////////////////////////////////////////
+	static bool createSignature(const CubeArea &area, const Signature &prefix, Signature &signature);
+
+	PPlanNode find(const Signature &signature, uint64_t cacheRevision);
+	void insert(const Signature &signature, PPlanNode plan, uint64_t cacheRevision);
+	Statistics getStatistics() const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief drops all plans and ignores further inserts
+	////////////////////////////////////////////////////////////////////////////////
+	void retire();
+
+private:
+	struct Dependency {
+		dbID_cubeID cubeId;
+		uint32_t dbToken;
+		boost::weak_ptr<const Cube> cube;
+	};
+
+	struct Entry {
+		PPlanNode plan;
+		uint64_t cacheRevision;
+		bool cacheWriter;
+		vector<Dependency> dependencies;
+		list<Signature>::iterator lru;
+	};
+
+	PlanCache(const PlanCache &);
+
+	static bool inspect(const PlanNode &node, Entry &entry);
+	static bool isValid(const Entry &entry, uint64_t cacheRevision);
+
+	mutable Mutex lock;
+	map<Signature, Entry> plans;
+	list<Signature> lru;
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> uncacheable;
+	bool retired;
+};
+
+}
+
+#endif
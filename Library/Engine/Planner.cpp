@@ -30,6 +30,7 @@
 #include "Olap/Server.h"
 #include "Olap/SubCubeList.h"
 #include "Olap/Rule.h"
+#include "Olap/RulesList.h"
 #include "Engine/EngineCpu.h"
 
 #include "Parser/SourceNode.h"
@@ -73,6 +74,16 @@ bool Planner::extractRules(SubCubeList &areas, RuleNode::RuleOption ruleType, Ru
 	SubCubeList nextAreas;
 	bool result = false;
 
+	// only rules whose destination area overlaps some of the areas are intersected
+	CPRuleAreaIndex areaIndex = rules->getAreaIndex();
+	RuleAreaIndex::Mask candidates(areaIndex->getWords(), 0);
+	for (SubCubeList::const_iterator area = areas.begin(); area != areas.end(); ++area) {
+		areaIndex->addCandidates(*area->second, candidates);
+	}
+	if (RuleAreaIndex::isEmpty(candidates)) {
+		return false;
+	}
+
 #ifdef SORT_RULES_BY_POSITION
 	// get active rules
 	activeRules = cube->getRules(PUser(), true);
@@ -94,8 +105,15 @@ bool Planner::extractRules(SubCubeList &areas, RuleNode::RuleOption ruleType, Ru
 	}
 
 	for (; iter != activeRules.end(); ++iter) {
+		if (!areaIndex->isCandidateRule(candidates, (*iter)->getId())) {
+			continue;
+		}
 #else
-	for (RuleList::ConstIterator iter = rules->const_begin(); iter != rules->const_end(); ++iter) {
+	size_t position = 0;
+	for (RuleList::ConstIterator iter = rules->const_begin(); iter != rules->const_end(); ++iter, ++position) {
+		if (!RuleAreaIndex::isCandidate(candidates, position)) {
+			continue;
+		}
 #endif
 		CPRule rule = CONST_COMMITABLE_CAST(Rule, *iter);
 		const Area *ruleDestinationArea = rule->getDestinationArea();
@@ -175,6 +193,15 @@ bool Planner::extractCached(SubCubeList &areas, RulesAreas &cached, const ValueC
 	return result;
 }
 
+bool Planner::extractCached(SubCubeList &areas, vector<RulesAreas> &cached, const ValueCache::Snapshots &cache, IdentifierType ruleIdFilter)
+{
+	bool result = false;
+	for (size_t i = 0; i < cache.size() && !areas.empty(); i++) {
+		result |= extractCached(areas, cached[i], cache[i].areas, ruleIdFilter);
+	}
+	return result;
+}
+
 bool Planner::extractQueryCached(SubCubeList &areas, RulesAreas &cached, IdentifierType ruleIdFilter)
 {
 	bool result = false;
@@ -384,12 +411,12 @@ void Planner::createRuleNodes(vector<PPlanNode> &nodes, RulesAreas &rulesAreas,
 					rulePlanNode = createRulePlan(ruleArea->second, rule, constResult, valid);
 					// Todo: -jj- set related rule identification for performance counter in processor
 					if (rulePlanNode && (completeRuleId || ruleDefaultValue)) {
-						rulePlanNode = PPlanNode(new CompletePlanNode(ruleArea->second, rulePlanNode, ruleDefaultValue, completeRuleId ? rule->getId() : NO_RULE));
+						rulePlanNode = ContextArena::create<CompletePlanNode>(ruleArea->second, rulePlanNode, ruleDefaultValue, completeRuleId ? rule->getId() : NO_RULE);
 					}
 				}
 			}
 			if (!rulePlanNode) {
-				rulePlanNode = PPlanNode(new LegacyRulePlanNode(ruleArea->second->getDatabase(), cube, ruleArea->second, rule, ruleDefaultValue, cube->getCache(), allowMarkers && rule->hasMarkers()));
+				rulePlanNode = ContextArena::create<LegacyRulePlanNode>(ruleArea->second->getDatabase(), cube, ruleArea->second, rule, ruleDefaultValue, cube->getCache(), allowMarkers && rule->hasMarkers());
 			}
 			saveNode(rulePlanNode);
 			nodes.push_back(rulePlanNode);
@@ -407,7 +434,7 @@ PPlanNode Planner::checkInfiniteRecursion()
 			if (intersectionArea) {
 				Logger::warning << "Endless recursion in rule found! Database: " << area->getDatabase()->getName() << " Cube:" << area->getCube()->getName() << " RuleId: " << currentRule->getId() <<  endl;
 				CellValue value(ErrorException::ERROR_RULE_HAS_CIRCULAR_REF);
-				return PPlanNode(new ConstantPlanNode(area, value));
+				return ContextArena::create<ConstantPlanNode>(area, value);
 			}
 		}
 		tstPlanner = tstPlanner->parentPlanner;
@@ -447,20 +474,20 @@ PPlanNode Planner::createPlan(CubeArea::CellType cellType, RulesType useRulesTyp
 	SubCubeList stringAreas;
 	SubCubeList numericAreas;
 	SubCubeList consolidatedAreas;
-	RulesAreas cachedAreas;
+	vector<RulesAreas> cachedAreas;
 	RulesAreas queryCachedAreas;
 	RulesAreas numericBaseRulesAreas;
 	RulesAreas numericConsRulesAreas;
 	RulesAreas numericMarkedRulesAreas;
 	RulesAreas stringRulesAreas;
-	ValueCache::PCachedAreas cachedArs;
-	PStorageCpu cacheStorage;
+	ValueCache::Snapshots cacheSnapshots;
 	bool suppressEmptyPlanMessage = false;
 
 	bool useCache = !(useRulesType & NOCACHE) && ((useRulesType & ALL_RULES) != NO_RULES);
 
 	if (useCache) {
-		cube->getCache()->getAreasAndStorage(cacheStorage, cachedArs);
+		cube->getCache()->getSnapshots(cacheSnapshots);
+		cachedAreas.resize(cacheSnapshots.size());
 	}
 
 	if (CubeArea::baseOnly(cellType) && calcRules == NO_RULES && skipEmpty) {
@@ -503,7 +530,7 @@ PPlanNode Planner::createPlan(CubeArea::CellType cellType, RulesType useRulesTyp
 				}
 				for (RulesAreas::iterator rule = numericConsRulesAreas.begin(); rule != numericConsRulesAreas.end(); ++rule) {
 					if (useCache) {
-						anyCached |= extractCached(rule->second, cachedAreas, cachedArs, rule->first);
+						anyCached |= extractCached(rule->second, cachedAreas, cacheSnapshots, rule->first);
 						anyQueryCached |= extractQueryCached(rule->second, queryCachedAreas, rule->first);
 					}
 					totalRuleAreas += rule->second.size();
@@ -511,7 +538,7 @@ PPlanNode Planner::createPlan(CubeArea::CellType cellType, RulesType useRulesTyp
 				}
 				for (RulesAreas::iterator rule = numericBaseRulesAreas.begin(); rule != numericBaseRulesAreas.end(); ++rule) {
 					if (useCache) {
-						anyCached |= extractCached(rule->second, cachedAreas, cachedArs, rule->first);
+						anyCached |= extractCached(rule->second, cachedAreas, cacheSnapshots, rule->first);
 						anyQueryCached |= extractQueryCached(rule->second, queryCachedAreas, rule->first);
 					}
 					totalRuleAreas += rule->second.size();
@@ -519,7 +546,7 @@ PPlanNode Planner::createPlan(CubeArea::CellType cellType, RulesType useRulesTyp
 				}
 				for (RulesAreas::iterator rule = numericMarkedRulesAreas.begin(); rule != numericMarkedRulesAreas.end(); ++rule) {
 					if (useCache) {
-						anyCached |= extractCached(rule->second, cachedAreas, cachedArs, rule->first);
+						anyCached |= extractCached(rule->second, cachedAreas, cacheSnapshots, rule->first);
 						anyQueryCached |= extractQueryCached(rule->second, queryCachedAreas, rule->first);
 					}
 					totalRuleAreas += rule->second.size();
@@ -533,9 +560,9 @@ PPlanNode Planner::createPlan(CubeArea::CellType cellType, RulesType useRulesTyp
 
 		if (baseStrings) {
 			for (SubCubeList::iterator it = stringAreas.begin(); it != stringAreas.end(); ++it) {
-				PPlanNode node = PPlanNode(new SourcePlanNode(cube->getStringStorageId(), it->second, cube->getObjectRevision()));
+				PPlanNode node = ContextArena::create<SourcePlanNode>(cube->getStringStorageId(), it->second, cube->getObjectRevision());
 				if (defaultStrValue && node) {
-					node = PPlanNode(new CompletePlanNode(it->second, node, defaultStrValue, NO_RULE));
+					node = ContextArena::create<CompletePlanNode>(it->second, node, defaultStrValue, NO_RULE);
 				}
 				saveNode(node);
 				planNodes.push_back(node);
@@ -543,9 +570,9 @@ PPlanNode Planner::createPlan(CubeArea::CellType cellType, RulesType useRulesTyp
 		}
 		if (baseNumeric) {
 			for (SubCubeList::iterator it = numericAreas.begin(); it != numericAreas.end(); ++it) {
-				PPlanNode node = PPlanNode(new SourcePlanNode(cube->getNumericStorageId(), it->second, cube->getObjectRevision()));
+				PPlanNode node = ContextArena::create<SourcePlanNode>(cube->getNumericStorageId(), it->second, cube->getObjectRevision());
 				if (defaultNumValue && node) {
-					node = PPlanNode(new CompletePlanNode(it->second, node, defaultNumValue, NO_RULE));
+					node = ContextArena::create<CompletePlanNode>(it->second, node, defaultNumValue, NO_RULE);
 				}
 				saveNode(node);
 				planNodes.push_back(node);
@@ -553,7 +580,7 @@ PPlanNode Planner::createPlan(CubeArea::CellType cellType, RulesType useRulesTyp
 		}
 		if (anyConsolidation) {
 			if (useCache) {
-				anyCached |= extractCached(consolidatedAreas, cachedAreas, cachedArs, NO_IDENTIFIER);
+				anyCached |= extractCached(consolidatedAreas, cachedAreas, cacheSnapshots, NO_IDENTIFIER);
 				anyQueryCached |= extractQueryCached(consolidatedAreas, queryCachedAreas, NO_IDENTIFIER);
 			}
 			for (SubCubeList::const_iterator it = consolidatedAreas.begin(); it != consolidatedAreas.end(); ++it) {
@@ -587,9 +614,9 @@ PPlanNode Planner::createPlan(CubeArea::CellType cellType, RulesType useRulesTyp
 					baseNodes.push_back(node);
 				}
 				createRuleNodes(baseNodes, baseRulesAreas, 0, false, true);
-				PPlanNode aggregationNode = PPlanNode(new AggregationPlanNode(it->second, baseNodes, aggregationMaps, useCache ? cube->getCache() : 0, useCache ? cube : CPCube(), AggregationPlanNode::SUM, blockSize));
+				PPlanNode aggregationNode = ContextArena::create<AggregationPlanNode>(it->second, baseNodes, aggregationMaps, useCache ? cube->getCache() : 0, useCache ? cube : CPCube(), AggregationPlanNode::SUM, blockSize);
 				if (defaultNumValue && aggregationNode) {
-					aggregationNode = PPlanNode(new CompletePlanNode(it->second, aggregationNode, defaultNumValue, NO_RULE));
+					aggregationNode = ContextArena::create<CompletePlanNode>(it->second, aggregationNode, defaultNumValue, NO_RULE);
 				}
 				saveNode(aggregationNode);
 				planNodes.push_back(aggregationNode);
@@ -603,25 +630,27 @@ PPlanNode Planner::createPlan(CubeArea::CellType cellType, RulesType useRulesTyp
 			createRuleNodes(planNodes, stringRulesAreas, defaultStrValue, completeRuleId, true);
 		}
 		if (anyCached) {
-			double found = 0;
-			for (RulesAreas::const_iterator ruleIt = cachedAreas.begin(); ruleIt != cachedAreas.end(); ++ruleIt) {
-				CellValue ruleDefaultValue;
-				const CellValue *paramDefaultValue = defaultNumValue;
-				if (defaultNumValue && ruleIt->first != NO_IDENTIFIER) {
-					ruleDefaultValue = CellValue::NullNumeric;
-					ruleDefaultValue.setRuleId(ruleIt->first);
-					paramDefaultValue = &ruleDefaultValue;
+			for (size_t shard = 0; shard < cachedAreas.size(); shard++) {
+				double found = 0;
+				for (RulesAreas::const_iterator ruleIt = cachedAreas[shard].begin(); ruleIt != cachedAreas[shard].end(); ++ruleIt) {
+					CellValue ruleDefaultValue;
+					const CellValue *paramDefaultValue = defaultNumValue;
+					if (defaultNumValue && ruleIt->first != NO_IDENTIFIER) {
+						ruleDefaultValue = CellValue::NullNumeric;
+						ruleDefaultValue.setRuleId(ruleIt->first);
+						paramDefaultValue = &ruleDefaultValue;
+					}
+					for (SubCubeList::const_iterator it = ruleIt->second.begin(); it != ruleIt->second.end(); ++it) {
+						PPlanNode cacheNode = ContextArena::create<CachePlanNode>(it->second, paramDefaultValue, cacheSnapshots[shard].storage, ruleIt->first);
+						saveNode(cacheNode);
+						planNodes.push_back(cacheNode);
+						found += it->second->getSize();
+					}
 				}
-				for (SubCubeList::const_iterator it = ruleIt->second.begin(); it != ruleIt->second.end(); ++it) {
-					PPlanNode cacheNode = PPlanNode(new CachePlanNode(it->second, paramDefaultValue, cacheStorage, ruleIt->first));
-					saveNode(cacheNode);
-					planNodes.push_back(cacheNode);
-					found += it->second->getSize();
+				if (found) {
+					cube->getCache()->increaseFound(cacheSnapshots[shard].shard, found);
 				}
 			}
-			if (found) {
-				cube->getCache()->increaseFound(found);
-			}
 		}
 		if (anyQueryCached) {
 			for (RulesAreas::const_iterator ruleIt = queryCachedAreas.begin(); ruleIt != queryCachedAreas.end(); ++ruleIt) {
@@ -633,7 +662,7 @@ PPlanNode Planner::createPlan(CubeArea::CellType cellType, RulesType useRulesTyp
 					paramDefaultValue = &ruleDefaultValue;
 				}
 				for (SubCubeList::const_iterator it = ruleIt->second.begin(); it != ruleIt->second.end(); ++it) {
-					PPlanNode cacheNode = PPlanNode(new QueryCachePlanNode(it->second, paramDefaultValue, ruleIt->first, cube));
+					PPlanNode cacheNode = ContextArena::create<QueryCachePlanNode>(it->second, paramDefaultValue, ruleIt->first, cube);
 					saveNode(cacheNode);
 					planNodes.push_back(cacheNode);
 				}
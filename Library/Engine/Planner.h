@@ -48,6 +48,7 @@ public:
 	void setCurrentRule(CPRule rule) {currentRule = rule;}
 private:
 	bool extractCached(SubCubeList &areas, RulesAreas &cached, const ValueCache::CPCachedAreas &cache, IdentifierType ruleIdFilter);
+	bool extractCached(SubCubeList &areas, vector<RulesAreas> &cached, const ValueCache::Snapshots &cache, IdentifierType ruleIdFilter);
 	bool extractQueryCached(SubCubeList &areas, RulesAreas &cached, IdentifierType ruleIdFilter);
     void extractAreas(SubCubeList &areas, SubCubeList &inputAreas, bool &result, RulesAreas &cached, IdentifierType ruleId);
 	PPlanNode createRulePlan(CPCubeArea area, CPRule rule, double &constResult, bool &supported, Node *node = 0);
@@ -48,6 +48,7 @@
 #include "Collections/CellBuffer.h"
 #include "InputOutput/FileUtils.h"
 #include "Exceptions/ErrorException.h"
+#include "Thread/WriteLocker.h"
 
 #include <boost/date_time.hpp>
 #include <boost/date_time/posix_time/ptime.hpp> //include all types plus i/o
@@ -76,12 +77,18 @@ static int TST_CHUNK = 0; //57
 
 static INSTR *pINSTR;
 
+// file format of instruction pages stored at aligned offsets
+static const uint32_t ALIGNED_INSTRUCTION_PAGES = 2;
+static const uint32_t NEW_DELTA_PAGE = 0xFFFFFFFF;	// page stored in the delta itself
+
+bool StorageCpu::mapPages = false;
+
 static const int ELEM_SIZE[] = {0,1,2,4};
 static const int VALUE_SIZE[] = {0,1,4,8,4};
 
 StorageCpu::StorageCpu(PPathTranslator pathTranslator, bool indexEnabled) :
 	StorageBase(pathTranslator), valCount(0), emptySpace(0), index2(indexEnabled ? new vector<Bookmark> : 0),
-	delCount(0), indexEnabled(indexEnabled), pageList(new SlimVector<uint8_t>(STORAGE_PAGE_SIZE))
+	delCount(0), pageFormat(INSTRUCTION_PAGES), columnarSourceSize(0), columnarReads(0), columnarBuilding(false), indexEnabled(indexEnabled), pageList(new SlimVector<uint8_t>(STORAGE_PAGE_SIZE))
 {
 	if (!pINSTR) {
 		pINSTR = new INSTR[256];
@@ -98,8 +105,13 @@ StorageCpu::StorageCpu(PPathTranslator pathTranslator, bool indexEnabled) :
 
 StorageCpu::StorageCpu(const StorageCpu &storage) :
 	StorageBase(storage), endStack(storage.endStack), valCount(storage.valCount), emptySpace(storage.emptySpace), index2(storage.index2),
-	delCount(0), longJumps(storage.longJumps), indexEnabled(storage.indexEnabled), changedCells(storage.changedCells), changeNodes(storage.changeNodes), pageList(storage.pageList)
+	delCount(0), longJumps(storage.longJumps), pageFormat(storage.pageFormat), columnarSourceSize(0), columnarReads(0), columnarBuilding(false),
+	indexEnabled(storage.indexEnabled), changedCells(storage.changedCells), changeNodes(storage.changeNodes), pageList(storage.pageList)
 {
+	WriteLocker locker(&storage.columnarLock);
+	columnar = storage.columnar;
+	columnarSource = storage.columnarSource;
+	columnarSourceSize = storage.columnarSourceSize;
 }
 
 ostream& operator<<(ostream& ostr, const vector<size_t>& v)
@@ -353,6 +365,13 @@ void StorageCpu::buildIndex()
 
 PProcessorBase StorageCpu::getCellValues(CPArea area)
 {
+	if (pageFormat == COLUMNAR_PAGES) {
+		PColumnarPageList list = getColumnar();
+		if (list) {
+			return PProcessorBase(new ColumnarProcessor(*this, list, area));
+		}
+	}
+
 	Processor *processor = 0;
 	if (area) {
 		if (index2 && !index2->empty()) {
@@ -985,8 +1004,8 @@ PStorageBase StorageCpuCommitWorker::start(StorageCpu::Processor oldDataReader,
 
 		StorageCpuCommitWorker *sw = new StorageCpuCommitWorker(tp, tg, segmentReaderSP, changesBuffer->getValues(), seqNr, additive, results, lockedChanges);
 		PThreadPoolJob w(sw);
-		if (/*false && */hasNext && tp->hasFreeCore(false)) {
-			tp->addJob(w);
+		if (/*false && */hasNext && tp->tryAdmit(false)) {
+			tp->addJob(w, 0, true);
 		} else {
 			(*sw)();
 		}
@@ -1293,9 +1312,20 @@ bool StorageCpu::merge(const CPCommitable &o, const PCommitable &p)
 			endStack = storage->endStack;
 			index2 = storage->index2;
 			longJumps = storage->longJumps;
+			WriteLocker locker(&storage->columnarLock);
+			columnar = storage->columnar;
+			columnarSource = storage->columnarSource;
+			columnarSourceSize = storage->columnarSourceSize;
 		}
 	}
 	if (ret) {
+		// a stale columnar copy is dropped, readers of the new version build it again
+		if (pageFormat != COLUMNAR_PAGES || !isColumnarValid()) {
+			columnar.reset();
+			columnarSource.reset();
+			columnarSourceSize = 0;
+		}
+		columnarReads = 0;
 		commitintern();
 	}
 	return ret;
@@ -1317,10 +1347,154 @@ void StorageCpu::setStack(vector<ElemRestriction> &newStack)
 	}
 }
 
+void StorageCpu::setPageFormat(PageFormat format)
+{
+	checkCheckedOut();
+	pageFormat = format;
+}
+
+PColumnarPageList StorageCpu::createColumnar() const
+{
+	PColumnarPageList list;
+	Processor reader(const_cast<StorageCpu &>(*this), pageList.get(), PPathTranslator());
+	while (reader.next()) {
+		const IdentifiersType &key = reader.getKey();
+		if (!list) {
+			list.reset(new ColumnarPageList(key.size()));
+		}
+		list->push_back(key, reader.getDouble());
+	}
+	if (!list) {
+		list.reset(new ColumnarPageList(0));
+	}
+	return list;
+}
+
+PColumnarPageList StorageCpu::getColumnar() const
+{
+	boost::shared_ptr<SlimVector<uint8_t> > source = pageList;
+	size_t sourceSize = source->size();
+	{
+		WriteLocker locker(&columnarLock);
+		if (isColumnarValid()) {
+			return columnar;
+		}
+		// only committed versions are worth the scan, a single read is served by the instruction stream
+		if (isCheckedOut() || columnarBuilding || ++columnarReads < COLUMNAR_BUILD_READS) {
+			return PColumnarPageList();
+		}
+		columnarBuilding = true;
+	}
+
+	PColumnarPageList list;
+	try {
+		list = createColumnar();
+	} catch (...) {
+		WriteLocker locker(&columnarLock);
+		columnarBuilding = false;
+		throw;
+	}
+
+	WriteLocker locker(&columnarLock);
+	columnarBuilding = false;
+	if (pageList == source && source->size() == sourceSize) {
+		columnar = list;
+		columnarSource = source;
+		columnarSourceSize = sourceSize;
+	}
+	return list;
+}
+
+bool StorageCpu::isColumnarValid() const
+{
+	return columnar && columnarSource.lock() == pageList && columnarSourceSize == pageList->size();
+}
+
 void StorageCpu::load(FileReader *file, uint32_t fileVersion)
 {
-	pageList->load(file);
+	bool aligned = false;
+	if (fileVersion >= 3) {
+		uint32_t format;
+		file->getRaw((char *)&format, sizeof(uint32_t));
+		if (format == COLUMNAR_PAGES) {
+			PColumnarPageList list(new ColumnarPageList(0));
+			list->load(file);
+
+			// convert columnar pages back to instruction stream
+			if (!pageList->isCheckedOut()) {
+				pageList = COMMITABLE_CAST(SlimVector<uint8_t>, pageList->copy());
+			}
+			Writer sw(*this, false);
+			IdentifiersType key(list->getDimCount());
+			for (size_t page = 0; page < list->pageCount(); page++) {
+				const ColumnarPage &columnarPage = list->getPage(page);
+				for (uint32_t row = 0; row < columnarPage.size(); row++) {
+					for (size_t dim = 0; dim < key.size(); dim++) {
+						key[dim] = columnarPage.getColumn(dim)[row];
+					}
+					sw.push_back(key, columnarPage.getValues()[row]);
+				}
+			}
+			buildIndex();
 
+			pageFormat = COLUMNAR_PAGES;
+			columnar = list;
+			columnarSource = pageList;
+			columnarSourceSize = pageList->size();
+			return;
+		} else if (format != INSTRUCTION_PAGES && format != ALIGNED_INSTRUCTION_PAGES) {
+			throw ErrorException(ErrorException::ERROR_CORRUPT_FILE, "unknown storage page format");
+		}
+		pageFormat = INSTRUCTION_PAGES;
+		aligned = format == ALIGNED_INSTRUCTION_PAGES;
+		if (aligned) {
+			pageList->loadAligned(file);
+		} else {
+			pageList->load(file);
+		}
+	} else {
+		pageList->load(file);
+	}
+
+	loadLayout(file, fileVersion);
+
+	if (aligned) {
+		uint64_t i;
+		uint32_t i1;
+		uint32_t i2;
+		uint64_t u64;
+
+		// stored index, building it would read all mapped pages
+		file->getRaw((char *)&i, sizeof(uint64_t));
+		if (i) {
+			boost::shared_ptr<vector<Bookmark> > index(new vector<Bookmark>((size_t)i));
+			for (vector<Bookmark>::iterator bit = index->begin(); bit != index->end(); ++bit) {
+				file->getRaw((char *)&u64, sizeof(uint64_t));
+				bit->setPosition((size_t)u64, 0);
+				file->getRaw((char *)&i1, sizeof(uint32_t));
+				IdentifiersType &key = bit->getKey();
+				vector<size_t> &offsets = bit->getOffsets();
+				key.resize(i1);
+				offsets.resize(i1);
+				for (uint32_t dim = 0; dim < i1; dim++) {
+					file->getRaw((char *)&i2, sizeof(uint32_t));
+					key[dim] = i2;
+					file->getRaw((char *)&u64, sizeof(uint64_t));
+					offsets[dim] = (size_t)u64;
+				}
+			}
+			if (indexEnabled) {
+				index2 = index;
+				return;
+			}
+		}
+	}
+
+	buildIndex();
+}
+
+void StorageCpu::loadLayout(FileReader *file, uint32_t fileVersion)
+{
 	uint64_t i;
 	uint32_t i1;
 	uint32_t i2;
@@ -1369,14 +1543,101 @@ void StorageCpu::load(FileReader *file, uint32_t fileVersion)
 			Logger::debug << "Loaded jumps: " << longJumps << endl;
 		}
 	}
+}
 
-	buildIndex();
+void StorageCpu::getCheckpoint(PageCheckpoint &checkpoint, bool checkIn) const
+{
+	const vector<Slim<uint8_t>::PSlimPage> &pages = pageList->getPages();
+	checkpoint.clear();
+	checkpoint.resize(pages.size());
+	for (size_t i = 0; i < pages.size(); i++) {
+		if (checkIn) {
+			pages[i]->checkIn();
+		}
+		if (!pages[i]->isCheckedOut()) {
+			checkpoint[i] = pages[i];
+		}
+	}
+}
+
+size_t StorageCpu::saveDelta(FileWriter *file, const PageCheckpoint &checkpoint) const
+{
+	// pages are copied on write, a page of the checkpoint still alive is unchanged
+	map<const SlimPage<uint8_t> *, uint32_t> saved;
+	for (uint32_t i = 0; i < checkpoint.size(); i++) {
+		Slim<uint8_t>::PSlimPage page = checkpoint[i].lock();
+		if (page) {
+			saved[page.get()] = i;
+		}
+	}
+
+	const vector<Slim<uint8_t>::PSlimPage> &pages = pageList->getPages();
+	uint32_t size = (uint32_t)pages.size();
+	file->appendRaw((const char *)&size, sizeof(uint32_t));
+
+	size_t written = 0;
+	if (size) {
+		uint32_t pageMemorySize = pageList->maxPageSize();
+		file->appendRaw((const char *)&pageMemorySize, sizeof(uint32_t));
+
+		for (vector<Slim<uint8_t>::PSlimPage>::const_iterator pit = pages.begin(); pit != pages.end(); ++pit) {
+			map<const SlimPage<uint8_t> *, uint32_t>::const_iterator sit = saved.find(pit->get());
+			uint32_t ref = sit == saved.end() ? NEW_DELTA_PAGE : sit->second;
+			file->appendRaw((const char *)&ref, sizeof(uint32_t));
+			if (ref == NEW_DELTA_PAGE) {
+				(*pit)->save(file);
+				written++;
+			}
+		}
+	}
+	saveLayout(file);
+	return written;
 }
 
-void StorageCpu::save(FileWriter *file) const
+size_t StorageCpu::loadDelta(FileReader *file, bool apply)
 {
-	pageList->save(file);
+	uint32_t size;
+	file->getRaw((char *)&size, sizeof(uint32_t));
+
+	boost::shared_ptr<SlimVector<uint8_t> > list(new SlimVector<uint8_t>(STORAGE_PAGE_SIZE));
+	size_t read = 0;
+	if (size) {
+		uint32_t pageMemorySize;
+		file->getRaw((char *)&pageMemorySize, sizeof(uint32_t));
+		list.reset(new SlimVector<uint8_t>(pageMemorySize));
+
+		const vector<Slim<uint8_t>::PSlimPage> &previous = pageList->getPages();
+		vector<Slim<uint8_t>::PSlimPage> &pages = list->getPages();
+		pages.reserve(size);
+		for (uint32_t i = 0; i < size; i++) {
+			uint32_t ref;
+			file->getRaw((char *)&ref, sizeof(uint32_t));
+			if (ref == NEW_DELTA_PAGE) {
+				Slim<uint8_t>::PSlimPage page(new SlimPage<uint8_t>(pageMemorySize));
+				page->load(file);
+				pages.push_back(page);
+				read++;
+			} else if (!apply) {
+				continue;
+			} else if (ref < previous.size()) {
+				pages.push_back(previous[ref]);
+			} else {
+				throw ErrorException(ErrorException::ERROR_CORRUPT_FILE, "unknown page in cube delta");
+			}
+		}
+	}
+	// skipped deltas leave an incomplete storage behind, the caller drops it
+	pageList = list;
+	loadLayout(file, 3);
+	if (apply) {
+		// the columnar copy is rebuilt from the new instruction stream when needed
+		buildIndex();
+	}
+	return read;
+}
 
+void StorageCpu::saveLayout(FileWriter *file) const
+{
 	uint64_t i = valCount;
 	file->appendRaw((const char *)&i, sizeof(uint64_t));
 
@@ -1418,6 +1679,77 @@ void StorageCpu::save(FileWriter *file) const
 	}
 }
 
+void StorageCpu::assignLoaded(StorageCpu &loaded)
+{
+	pageList = loaded.pageList;
+	valCount = loaded.valCount;
+	emptySpace = loaded.emptySpace;
+	endStack = loaded.endStack;
+	longJumps = loaded.longJumps;
+	index2 = loaded.index2;
+	pageFormat = loaded.pageFormat;
+	columnar = loaded.columnar;
+	columnarSource = loaded.columnarSource;
+	columnarSourceSize = loaded.columnarSourceSize;
+}
+
+void StorageCpu::save(FileWriter *file, uint32_t fileVersion) const
+{
+	if (fileVersion < 3) {
+		pageList->save(file);
+		saveLayout(file);
+		return;
+	}
+
+	uint32_t format = pageFormat;
+	bool aligned = pageFormat == INSTRUCTION_PAGES && mapPages && file->getRawPosition() >= 0;
+	if (aligned) {
+		format = ALIGNED_INSTRUCTION_PAGES;
+	}
+	file->appendRaw((const char *)&format, sizeof(uint32_t));
+	if (pageFormat == COLUMNAR_PAGES) {
+		PColumnarPageList list;
+		{
+			WriteLocker locker(&columnarLock);
+			if (isColumnarValid()) {
+				list = columnar;
+			}
+		}
+		if (!list) {
+			list = createColumnar();
+		}
+		list->save(file);
+		return;
+	}
+
+	if (aligned) {
+		pageList->saveAligned(file);
+	} else {
+		pageList->save(file);
+	}
+
+	saveLayout(file);
+
+	if (aligned) {
+		uint64_t i = index2 ? index2->size() : 0;
+		file->appendRaw((const char *)&i, sizeof(uint64_t));
+		if (index2) {
+			for (vector<Bookmark>::const_iterator bit = index2->begin(); bit != index2->end(); ++bit) {
+				i = bit->getPosition();
+				file->appendRaw((const char *)&i, sizeof(uint64_t));
+				uint32_t dims = (uint32_t)bit->getKey().size();
+				file->appendRaw((const char *)&dims, sizeof(uint32_t));
+				for (uint32_t dim = 0; dim < dims; dim++) {
+					uint32_t id = bit->getKey()[dim];
+					file->appendRaw((const char *)&id, sizeof(uint32_t));
+					i = dim < bit->getOffsets().size() ? bit->getOffsets()[dim] : 0;
+					file->appendRaw((const char *)&i, sizeof(uint64_t));
+				}
+			}
+		}
+	}
+}
+
 string StorageCpu::keytoString(const IdentifiersType& key)
 {
 	stringstream ret;
@@ -1442,6 +1774,7 @@ void StorageCpu::updateOld(CPStorageBase o)
 	StorageBase::updateOld(o);
 	CPStorageCpu st = CONST_COMMITABLE_CAST(StorageCpu, o);
 	pageList->setOld(st->pageList->getOld() ? st->pageList->getOld() : st->pageList);
+	pageFormat = st->pageFormat;
 }
 
 bool StorageCpu::validate(bool thorough)
@@ -2560,6 +2893,18 @@ const CellValue &StorageCpu::Processor::getValue()
 	return cellvalue;
 }
 
+bool StorageCpu::Processor::nextBatch(CellBatch &batch)
+{
+	if (!storage.isNumeric()) {
+		return CellValueStream::nextBatch(batch);
+	}
+	batch.clear();
+	while (!batch.full() && Processor::next()) {
+		batch.push_back(vkey, value);
+	}
+	return !batch.empty();
+}
+
 double StorageCpu::Processor::getDouble()
 {
 	return value;
@@ -2835,6 +3180,57 @@ void StorageCpu::Processor::indexStorage()
 	buildIndex();
 }
 
+static bool bookmarkPositionLess(const StorageCpu::Bookmark &bookmark, size_t position)
+{
+	return bookmark.getPosition() < position;
+}
+
+bool StorageCpu::Processor::partition(size_t count, size_t minSize, vector<boost::shared_ptr<Processor> > &parts) const
+{
+	const vector<Bookmark> *index = storage.index2.get();
+	if (!index || index->empty() || endp <= pos || pageList != storage.pageList.get()) {
+		return false;
+	}
+	size_t length = endp - pos;
+	if (minSize && length / minSize < count) {
+		count = length / minSize;
+	}
+	if (count < 2) {
+		return false;
+	}
+
+	vector<const Bookmark *> starts;
+	for (size_t i = 1; i < count; i++) {
+		size_t splitPos = pos + length / count * i;
+		// bookmarks are ordered by position as well as by key
+		vector<Bookmark>::const_iterator bit = lower_bound(index->begin(), index->end(), splitPos, bookmarkPositionLess);
+		if (bit == index->end()) {
+			break;
+		}
+		if (bit->getPosition() <= pos || bit->getPosition() >= endp || (!starts.empty() && starts.back() == &*bit)) {
+			continue;
+		}
+		starts.push_back(&*bit);
+	}
+	if (starts.empty()) {
+		return false;
+	}
+
+	parts.clear();
+	boost::shared_ptr<Processor> first(new Processor(*this));
+	first->endp = starts.front()->getPosition();
+	parts.push_back(first);
+	for (vector<const Bookmark *>::const_iterator it = starts.begin(); it != starts.end(); ++it) {
+		size_t partEnd = it + 1 == starts.end() ? endp : (*(it + 1))->getPosition();
+		if (area) {
+			parts.push_back(boost::shared_ptr<Processor>(new Processor(storage, pageList, area, partEnd, *it)));
+		} else {
+			parts.push_back(boost::shared_ptr<Processor>(new Processor(storage, pageList, storage.pathTranslator, partEnd, *it)));
+		}
+	}
+	return true;
+}
+
 vector<StorageCpu::ElemRestriction> StorageCpu::Processor::getStack(bool previous)
 {
 	vector<ElemRestriction> result;
@@ -3827,9 +4223,39 @@ void StringStorageCpu::load(FileReader *file, uint32_t fileVersion)
 	}
 }
 
-void StringStorageCpu::save(FileWriter *file) const
+void StringStorageCpu::assignLoaded(StorageCpu &loaded)
+{
+	StorageCpu::assignLoaded(loaded);
+	destroyStringMap();
+	strings = dynamic_cast<StringStorageCpu &>(loaded).strings;
+}
+
+size_t StringStorageCpu::saveDelta(FileWriter *file, const PageCheckpoint &checkpoint) const
+{
+	size_t written = StorageCpu::saveDelta(file, checkpoint);
+	// strings are appended and rebuilt as a whole, they are saved completely
+	strings->save(file);
+	return written;
+}
+
+size_t StringStorageCpu::loadDelta(FileReader *file, bool apply)
+{
+	size_t read = StorageCpu::loadDelta(file, apply);
+	PStringVector newStrings(new StringVector());
+	newStrings->load(file);
+	if (newStrings->getPages().empty()) {
+		newStrings->push("");
+	}
+	if (apply) {
+		destroyStringMap();
+		strings = newStrings;
+	}
+	return read;
+}
+
+void StringStorageCpu::save(FileWriter *file, uint32_t fileVersion) const
 {
-	StorageCpu::save(file);
+	StorageCpu::save(file, fileVersion);
 	strings->save(file);
 }
 
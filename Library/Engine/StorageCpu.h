@@ -37,6 +37,8 @@
 #include "Collections/SlimVector.h"
 #include "Collections/CellMap.h"
 #include "Collections/StringVector.h"
+#include "Engine/ColumnarStorage.h"
+#include "Thread/Mutex.h"
 
 namespace palo {
 
@@ -167,6 +169,14 @@ public:
 		Bookmark getBookmark() const;
 		void indexStorage();
 
+		////////////////////////////////////////////////////////////////////////////////
+		/// @brief splits the unread rest of the stream into balanced position ranges
+		///
+		/// Ranges start at page bookmarks of the storage index. Returns false if the
+		/// storage is not indexed or the rest is too short for two ranges.
+		////////////////////////////////////////////////////////////////////////////////
+		bool partition(size_t count, size_t minSize, vector<boost::shared_ptr<Processor> > &parts) const;
+
 		vector<StorageCpu::ElemRestriction> getStack(bool previous);
 
 		// Current value
@@ -193,6 +203,7 @@ public:
 		virtual const IdentifiersType &getKey() const;
 		virtual void reset();
 		virtual bool move(const IdentifiersType &key, bool *found);
+		virtual bool nextBatch(CellBatch &batch);
 		bool moveBefore(const IdentifiersType *key);
 		bool nextValid(size_t pos);
 	private:
@@ -234,6 +245,18 @@ public:
 		friend class StorageCpuCommitWorker;
 	};
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief format of pages used for reading
+	///
+	/// INSTRUCTION_PAGES - compressed instruction stream only
+	/// COLUMNAR_PAGES - additional read-only columnar copy of the instruction
+	/// stream built by repeated reads of a committed version, area scans use
+	/// SIMD kernels on it
+	////////////////////////////////////////////////////////////////////////////////
+	enum PageFormat {
+		INSTRUCTION_PAGES = 0, COLUMNAR_PAGES = 1
+	};
+
 	StorageCpu(PPathTranslator pathTranslator, bool indexEnabled);
 	friend ostream& operator<<(ostream& ostr, const StorageCpu& ds);
 //	void clear();
@@ -255,12 +278,65 @@ public:
 	}
 	uint64_t getLastDeletionCount();
 
+	PageFormat getPageFormat() const {
+		return pageFormat;
+	}
+	void setPageFormat(PageFormat format);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief saves instruction pages page-aligned, loading maps them from the file
+	////////////////////////////////////////////////////////////////////////////////
+	static void setMapPages(bool map) {
+		mapPages = map;
+	}
+	static bool getMapPages() {
+		return mapPages;
+	}
+
 	// Commitable
 	bool merge(const CPCommitable &o, const PCommitable &p);
 	PCommitable copy() const;
 
 	virtual void load(FileReader *file, uint32_t fileVersion);
-	virtual void save(FileWriter *file) const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief saves the storage in the given cube file version
+	///
+	/// Version 2 files hold the instruction stream only, newer versions start
+	/// with the page format.
+	////////////////////////////////////////////////////////////////////////////////
+	virtual void save(FileWriter *file, uint32_t fileVersion) const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief takes over the cells of a storage loaded outside of the engine
+	////////////////////////////////////////////////////////////////////////////////
+
+	virtual void assignLoaded(StorageCpu &loaded);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief pages of the storage as written to a file
+	///
+	/// Pages are copied on write, so a page of the checkpoint which is still
+	/// alive has not changed. Checked out pages can still be written in place
+	/// and are left out unless checkIn makes them read-only.
+	////////////////////////////////////////////////////////////////////////////////
+
+	typedef vector<boost::weak_ptr<SlimPage<uint8_t> > > PageCheckpoint;
+	void getCheckpoint(PageCheckpoint &checkpoint, bool checkIn) const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief saves the pages changed since the checkpoint, returns their number
+	////////////////////////////////////////////////////////////////////////////////
+
+	virtual size_t saveDelta(FileWriter *file, const PageCheckpoint &checkpoint) const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief applies a delta written by saveDelta, returns the number of pages read
+	///
+	/// Without apply the delta is only read past.
+	////////////////////////////////////////////////////////////////////////////////
+
+	virtual size_t loadDelta(FileReader *file, bool apply);
 
 	static string keytoString(const IdentifiersType& key);
 
@@ -299,6 +375,8 @@ private:
 
 	vector<ElemRestriction> endStack;
 	void setStack(vector<ElemRestriction> &newStack);
+	void loadLayout(FileReader *file, uint32_t fileVersion);
+	void saveLayout(FileWriter *file) const;
 	bool validate(bool thorough);
 
 	size_t valCount;
@@ -309,6 +387,23 @@ private:
 	uint64_t delCount;
 	const static size_t LONG_JUMP_START_VALUE = 4000000000ul; // 1; //80000000000ul; //16 * 1024;
 	vector<size_t> longJumps;
+
+	static const size_t COLUMNAR_BUILD_READS = 2;	// area reads of one version before its columnar copy is built
+
+	PColumnarPageList createColumnar() const;
+	PColumnarPageList getColumnar() const;
+	bool isColumnarValid() const;
+
+	static bool mapPages;
+
+	PageFormat pageFormat;
+	// columnar copy, built by readers of the committed storage
+	mutable Mutex columnarLock;
+	mutable PColumnarPageList columnar;
+	mutable boost::weak_ptr<SlimVector<uint8_t> > columnarSource;	// instruction stream the columnar copy was built from
+	mutable size_t columnarSourceSize;
+	mutable size_t columnarReads;
+	mutable bool columnarBuilding;
 protected:
 	bool indexEnabled;
 	PDoubleCellMap changedCells;
@@ -353,7 +448,10 @@ public:
 	virtual PCellStream commitChanges(bool checkLocks, bool add, bool disjunctive);
 
 	virtual void load(FileReader *file, uint32_t fileVersion);
-	virtual void save(FileWriter *file) const;
+	virtual void save(FileWriter *file, uint32_t fileVersion) const;
+	virtual void assignLoaded(StorageCpu &loaded);
+	virtual size_t saveDelta(FileWriter *file, const PageCheckpoint &checkpoint) const;
+	virtual size_t loadDelta(FileReader *file, bool apply);
 
 	virtual double convertToDouble(const CellValue &value);
 	virtual void convertToCellValue(CellValue &value, double d) const;
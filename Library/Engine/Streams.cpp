@@ -77,6 +77,23 @@ bool CellValueStream::move(const IdentifiersType &key, bool *found)
 	return result;
 }
 
+bool CellValueStream::nextBatch(CellBatch &batch)
+{
+	batch.clear();
+	while (!batch.full()) {
+		if (!next()) {
+			return !batch.empty();
+		}
+		const CellValue &value = getValue();
+		if (!value.isNumeric()) {
+			batch.setCurrent();
+			return true;
+		}
+		batch.push_back(getKey(), value.getNumeric(), value.getRuleId());
+	}
+	return true;
+}
+
 const IdentifiersType CellValueStream::EMPTY_KEY;
 
 }
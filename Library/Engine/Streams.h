@@ -39,6 +39,70 @@ namespace palo {
 
 class CellValue;
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief block of numeric cells read from a stream by one call
+///
+/// Keys are stored one after another, each value keeps the id of the rule
+/// which calculated it. If the stream reaches a cell which is not a number
+/// (string, error), the batch ends before it and hasCurrent() is set: the
+/// stream stays on that cell for getKey()/getValue().
+/// A batch which is neither full nor stopped at such a cell is the last one.
+////////////////////////////////////////////////////////////////////////////////
+
+class SERVER_CLASS CellBatch {
+public:
+	static const size_t CAPACITY = 256;
+
+	CellBatch() : count(0), dims(0), current(false) {}
+
+	void clear() {
+		count = 0;
+		current = false;
+	}
+	size_t size() const {return count;}
+	bool empty() const {return !count;}
+	bool full() const {return count == CAPACITY;}
+	size_t dimCount() const {return dims;}
+
+	void push_back(const IdentifiersType &key, double value, IdentifierType ruleId = NO_RULE) {
+		if (!count) {
+			setDimCount(key.size());
+		}
+		std::copy(key.begin(), key.end(), keys.begin() + count * dims);
+		ruleIds[count] = ruleId;
+		values[count++] = value;
+	}
+	void push_back(const IdentifierType *key, double value, IdentifierType ruleId = NO_RULE) {
+		std::copy(key, key + dims, keys.begin() + count * dims);
+		ruleIds[count] = ruleId;
+		values[count++] = value;
+	}
+	void setDimCount(size_t dimCount) {
+		dims = dimCount;
+		if (keys.size() < dims * CAPACITY) {
+			keys.resize(dims * CAPACITY);
+		}
+	}
+
+	const IdentifierType *getKey(size_t i) const {return &keys[i * dims];}
+	void getKey(size_t i, IdentifiersType &key) const {key.assign(keys.begin() + i * dims, keys.begin() + (i + 1) * dims);}
+	double getValue(size_t i) const {return values[i];}
+	IdentifierType getRuleId(size_t i) const {return ruleIds[i];}
+	double *getValues() {return values;}
+
+	void setCurrent() {current = true;}
+	bool hasCurrent() const {return current;}
+	bool isLast() const {return !current && count < CAPACITY;}
+
+private:
+	size_t count;
+	size_t dims;
+	bool current;
+	vector<IdentifierType> keys;
+	double values[CAPACITY];
+	IdentifierType ruleIds[CAPACITY];
+};
+
 class SERVER_CLASS CellValueStream {
 public:
 	virtual ~CellValueStream() {}
@@ -54,6 +118,13 @@ public:
 	virtual void reset() = 0;
 	virtual bool move(const IdentifiersType &key, bool *found);
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief reads up to CellBatch::CAPACITY cells, false at the end of stream
+	///
+	/// After the call the stream stays on the last read cell, next() continues.
+	////////////////////////////////////////////////////////////////////////////////
+	virtual bool nextBatch(CellBatch &batch);
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// @brief returns -1 if key1 < key2, 0 if key1 == key2, +1 if key1 > key2
 	////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,131 @@
+/* 
+ *
+ * Copyright (C) 2006-2014 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * 
+ *
+ */
+
+#include "HttpServer/HttpCompressor.h"
+
+#include "Logger/Logger.h"
+
+namespace palo {
+
+size_t HttpCompressor::threshold = 0;
+
+// /////////////////////////////////////////////////////////////////////////////
+// constructors and destructors
+// /////////////////////////////////////////////////////////////////////////////
+
+HttpCompressor::HttpCompressor() :
+	current(IDENTITY)
+{
+	memset(&stream, 0, sizeof(stream));
+}
+
+HttpCompressor::~HttpCompressor()
+{
+	if (current != IDENTITY) {
+		deflateEnd(&stream);
+	}
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// public methods
+// /////////////////////////////////////////////////////////////////////////////
+
+HttpCompressor::Encoding HttpCompressor::choose(int accepted, size_t length)
+{
+	if (!threshold || length < threshold) {
+		return IDENTITY;
+	}
+	if (accepted & GZIP) {
+		return GZIP;
+	}
+	if (accepted & DEFLATE) {
+		return DEFLATE;
+	}
+	return IDENTITY;
+}
+
+const char * HttpCompressor::getName(Encoding encoding)
+{
+	switch (encoding) {
+	case GZIP:
+		return "gzip";
+	case DEFLATE:
+		return "deflate";
+	default:
+		return "identity";
+	}
+}
+
+bool HttpCompressor::compress(StringBuffer& body, Encoding encoding)
+{
+	if (current != encoding) {
+		if (current != IDENTITY) {
+			deflateEnd(&stream);
+			memset(&stream, 0, sizeof(stream));
+			current = IDENTITY;
+		}
+
+		// window bits above 15 select the gzip wrapper
+		int windowBits = encoding == GZIP ? 15 + 16 : 15;
+
+		if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			Logger::warning << "cannot initialize " << getName(encoding) << " compression" << endl;
+			return false;
+		}
+		current = encoding;
+	} else if (deflateReset(&stream) != Z_OK) {
+		return false;
+	}
+
+	output.clear();
+	output.reserve(deflateBound(&stream, (uLong)body.length()));
+
+	stream.next_in = (Bytef *)body.begin();
+	stream.avail_in = (uInt)body.length();
+
+	char chunk[16384];
+	int res;
+
+	do {
+		stream.next_out = (Bytef *)chunk;
+		stream.avail_out = sizeof(chunk);
+
+		res = deflate(&stream, Z_FINISH);
+
+		if (res != Z_OK && res != Z_STREAM_END) {
+			Logger::warning << getName(encoding) << " compression failed with " << res << endl;
+			return false;
+		}
+
+		output.appendData(chunk, sizeof(chunk) - stream.avail_out);
+	} while (res != Z_STREAM_END);
+
+	body.swap(&output);
+	return true;
+}
+
+}
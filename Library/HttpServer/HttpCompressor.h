@@ -0,0 +1,105 @@
+/* 
+ *
+ * Copyright (C) 2006-2014 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * 
+ *
+ */
+
+#ifndef HTTP_SERVER_HTTP_COMPRESSOR_H
+#define HTTP_SERVER_HTTP_COMPRESSOR_H 1
+
+#include "palo.h"
+
+#include <zlib.h>
+
+#include "Collections/StringBuffer.h"
+
+namespace palo {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief deflate state of a client connection
+///
+/// The zlib stream is allocated on first use and reset for every following
+/// response of the connection, so its buffers are not allocated per request.
+////////////////////////////////////////////////////////////////////////////////
+
+class SERVER_CLASS HttpCompressor {
+public:
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief content encodings, used as bit set by HttpRequest
+	////////////////////////////////////////////////////////////////////////////////
+
+	enum Encoding {
+		IDENTITY = 0, DEFLATE = 1, GZIP = 2
+	};
+
+public:
+	HttpCompressor();
+	~HttpCompressor();
+
+public:
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief sets minimum body size in bytes to compress, 0 disables compression
+	////////////////////////////////////////////////////////////////////////////////
+
+	static void setThreshold(size_t threshold) {
+		HttpCompressor::threshold = threshold;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief chooses the encoding for a body from the accepted encodings
+	////////////////////////////////////////////////////////////////////////////////
+
+	static Encoding choose(int accepted, size_t length);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief returns the Content-Encoding name
+	////////////////////////////////////////////////////////////////////////////////
+
+	static const char * getName(Encoding encoding);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief compresses the body in place, returns false on zlib errors
+	///
+	/// The uncompressed buffer is kept as output buffer for the next response.
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool compress(StringBuffer& body, Encoding encoding);
+
+private:
+	HttpCompressor(const HttpCompressor&);
+	HttpCompressor& operator=(const HttpCompressor&);
+
+private:
+	static size_t threshold;
+
+	z_stream stream;
+	Encoding current;
+	StringBuffer output;
+};
+
+}
+
+#endif
@@ -33,6 +33,7 @@
 #include <iostream>
 
 #include "Collections/StringBuffer.h"
+#include "HttpServer/HttpCompressor.h"
 
 #include "Logger/Logger.h"
 
@@ -43,7 +44,7 @@ namespace palo {
 // /////////////////////////////////////////////////////////////////////////////
 
 HttpRequest::HttpRequest(const string& path, HttpRequestHandler* httpRequestHandler) :
-	httpRequestHandler(httpRequestHandler), type(HTTP_REQUEST_ILLEGAL), requestPath(path), contentLength(0)
+	httpRequestHandler(httpRequestHandler), type(HTTP_REQUEST_ILLEGAL), requestPath(path), acceptedEncodings(0), contentLength(0)
 {
 }
 
@@ -128,6 +129,10 @@ void HttpRequest::extractHeader(char* begin, char* end)
 							for (; reqe < endnl && *reqe != SPC; reqe++) {
 							}
 
+							if (reqe < endnl) {
+								protocol = string(reqe + 1, endnl);
+							}
+
 							string value(space + 1, reqe);
 							headerFields[key] = value;
 
@@ -145,6 +150,10 @@ void HttpRequest::extractHeader(char* begin, char* end)
 						string value(space + 1, endnl);
 						headerFields[key] = value;
 
+						if (key == "Accept-Encoding") {
+							setAcceptEncoding(space + 1, endnl);
+						}
+
 						if (key == "Content-Length") {
 							char *p;
 							long int result = strtol(value.c_str(), &p, 10);
@@ -228,6 +237,54 @@ const map<string, string>& HttpRequest::getValues() const
 	return requestFields;
 }
 
+// /////////////////////////////////////////////////////////////////////////////
+// protected methods
+// /////////////////////////////////////////////////////////////////////////////
+
+void HttpRequest::setAcceptEncoding(const char* begin, const char* end)
+{
+	acceptedEncodings = 0;
+
+	while (begin < end) {
+		const char* next = begin;
+
+		for (; next < end && *next != ','; ++next) {
+		}
+
+		// token up to an optional ";q=" weight, q=0 rejects the encoding
+		const char* token = begin;
+
+		for (; token < next && *token == ' '; ++token) {
+		}
+
+		const char* tokenEnd = token;
+
+		for (; tokenEnd < next && *tokenEnd != ';' && *tokenEnd != ' '; ++tokenEnd) {
+		}
+
+		bool rejected = false;
+
+		for (const char* q = tokenEnd; q + 2 < next; ++q) {
+			if (q[0] == 'q' && q[1] == '=') {
+				rejected = strtod(string(q + 2, next).c_str(), 0) <= 0.0;
+				break;
+			}
+		}
+
+		if (!rejected) {
+			string name(token, tokenEnd);
+
+			if (name == "gzip" || name == "x-gzip") {
+				acceptedEncodings |= HttpCompressor::GZIP;
+			} else if (name == "deflate") {
+				acceptedEncodings |= HttpCompressor::DEFLATE;
+			}
+		}
+
+		begin = next + 1;
+	}
+}
+
 // /////////////////////////////////////////////////////////////////////////////
 // private methods
 // /////////////////////////////////////////////////////////////////////////////
@@ -189,6 +189,22 @@ public:
 		return contentLength;
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief returns the protocol of the request line, e.g. "HTTP/1.1"
+	////////////////////////////////////////////////////////////////////////////////
+
+	const string& getProtocol() const {
+		return protocol;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief returns the HttpCompressor::Encoding bits of Accept-Encoding
+	////////////////////////////////////////////////////////////////////////////////
+
+	int getAcceptedEncodings() const {
+		return acceptedEncodings;
+	}
+
 #ifdef ENABLE_TRACE_OPTION
 	const string& getHeaderString() const {
 		return headerString;
@@ -200,6 +216,13 @@ public:
 #endif
 
 protected:
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief parses the value of the Accept-Encoding header
+	////////////////////////////////////////////////////////////////////////////////
+
+	void setAcceptEncoding(const char* begin, const char* end);
+
 	static inline int hex2int(char ch) {
 		if ('0' <= ch && ch <= '9') {
 			return ch - '0';
@@ -223,6 +246,8 @@ protected:
 	HttpRequestType type;
 
 	string requestPath;
+	string protocol;
+	int acceptedEncodings;
 
 	map<string, string> headerFields;
 
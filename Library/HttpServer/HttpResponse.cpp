@@ -42,7 +42,7 @@ namespace palo {
 // /////////////////////////////////////////////////////////////////////////////
 
 HttpResponse::HttpResponse(HttpResponseCode code) :
-	code(code), contentType("text/plain;charset=utf-8")
+	code(code), contentType("text/plain;charset=utf-8"), chunked(false)
 {
 }
 
@@ -113,8 +113,12 @@ const StringBuffer& HttpResponse::getHeader()
 	header.appendText(getResponseString(code));
 	header.appendText(CRNL + "Server: Palo" + CRNL + "Connection: Keep-Alive" + CRNL + "Content-Type: ");
 	header.appendText(contentType);
-	header.appendText(CRNL + "Content-Length: ");
-	header.appendInteger((uint32_t)body.length());
+	if (chunked) {
+		header.appendText(CRNL + "Transfer-Encoding: chunked");
+	} else {
+		header.appendText(CRNL + "Content-Length: ");
+		header.appendInteger((uint32_t)body.length());
+	}
 	header.appendText(CRNL);
 
 	if (!tokenName.empty()) {
@@ -157,6 +157,25 @@ public:
         fields.push_back(field);
     }
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief switches the response to chunked transfer encoding
+	///
+	/// A chunked header carries no Content-Length, the body is sent in pieces
+	/// while it is being generated.
+	////////////////////////////////////////////////////////////////////////////////
+
+	void setChunked() {
+		chunked = true;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief true if the response uses chunked transfer encoding
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool isChunked() const {
+		return chunked;
+	}
+
 protected:
 	HttpResponse(const HttpResponse&);
 	HttpResponse& operator=(const HttpResponse&);
@@ -178,6 +197,8 @@ private:
 	IdentifierType clientData;
 
     list<pair<string, string> > fields;
+
+	bool chunked;
 };
 
 }
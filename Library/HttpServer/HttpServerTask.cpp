@@ -47,12 +47,14 @@
 
 namespace palo {
 
+bool HttpServerTask::chunkedResponses = false;
+
 // /////////////////////////////////////////////////////////////////////////////
 // constructors and destructors
 // /////////////////////////////////////////////////////////////////////////////
 
 HttpServerTask::HttpServerTask(socket_t fd, HttpServer* server, JobAnalyser* analyzer) :
-	IoTask(fd, fd), ReadWriteTask(fd, fd), analyzer(analyzer), server(server), readPosition(0), bodyPosition(0), bodyLength(0), work(false), bShutdown(false)
+	IoTask(fd, fd), ReadWriteTask(fd, fd), analyzer(analyzer), server(server), readPosition(0), bodyPosition(0), bodyLength(0), work(false), bShutdown(false), chunkedStream(false)
 {
 	httpRequestPending = false;
 	httpRequest = 0;
@@ -122,6 +124,42 @@ void HttpServerTask::handleJobRequest(HttpJobRequest* jobRequest)
 	handleDone();
 }
 
+bool HttpServerTask::canSendChunks() const
+{
+	return chunkedResponses && httpRequest != 0 && httpRequest->getProtocol() == "HTTP/1.1";
+}
+
+bool HttpServerTask::sendChunk(HttpResponse* response)
+{
+	StringBuffer& body = response->getBody();
+
+	if (body.empty()) {
+		return true;
+	}
+
+	StringBuffer * buffer = new StringBuffer();
+
+	if (!chunkedStream) {
+		response->setChunked();
+		buffer->replaceText(response->getHeader());
+		chunkedStream = true;
+	}
+
+	appendChunk(buffer, body);
+	body.clear();
+
+	writeBuffers.push_back(buffer);
+	fillWriteBuffer();
+
+	while (hasWriteBuffer()) {
+		if (!handleWrite()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 // /////////////////////////////////////////////////////////////////////////////
 // IoTask
 // /////////////////////////////////////////////////////////////////////////////
@@ -354,6 +392,44 @@ void HttpServerTask::addResponse(HttpResponse* response)
 {
 	StringBuffer * buffer;
 
+	if (chunkedStream) {
+		chunkedStream = false;
+
+		if (!response->isChunked()) {
+			// the job failed after a part of the result was sent, the only
+			// way to tell the client is to drop the connection
+			Logger::warning << "chunked response aborted, closing connection" << endl;
+			response->getBody().clear();
+#if defined(_MSC_VER)
+			shutdown(readSocket, SD_BOTH);
+#else
+			shutdown(readSocket, SHUT_RDWR);
+#endif
+			return;
+		}
+
+		// last data chunk and terminating zero-length chunk
+		buffer = new StringBuffer();
+		appendChunk(buffer, response->getBody());
+		buffer->appendText("0\r\n\r\n");
+
+		writeBuffers.push_back(buffer);
+		response->getBody().clear();
+		fillWriteBuffer();
+
+		return;
+	}
+
+	// compress large bodies for clients accepting it, this runs on the
+	// thread of the job and not in the loop serving the connections
+	if (httpRequest != 0) {
+		HttpCompressor::Encoding encoding = HttpCompressor::choose(httpRequest->getAcceptedEncodings(), response->getBody().length());
+
+		if (encoding != HttpCompressor::IDENTITY && compressor.compress(response->getBody(), encoding)) {
+			response->setHeaderField(make_pair(string("Content-Encoding"), string(HttpCompressor::getName(encoding))));
+		}
+	}
+
 	// save header
 	buffer = new StringBuffer();
 	buffer->replaceText(response->getHeader());
@@ -368,6 +444,27 @@ void HttpServerTask::addResponse(HttpResponse* response)
 	fillWriteBuffer();
 }
 
+void HttpServerTask::appendChunk(StringBuffer *buffer, const StringBuffer& data)
+{
+	if (data.empty()) {
+		return;
+	}
+
+	static const char HEX[] = "0123456789abcdef";
+
+	char size[2 * sizeof(size_t)];
+	char *p = size + sizeof(size);
+
+	for (size_t len = data.length(); len; len >>= 4) {
+		*--p = HEX[len & 0xf];
+	}
+
+	buffer->appendText(p, size + sizeof(size) - p);
+	buffer->appendText("\r\n");
+	buffer->appendText(data);
+	buffer->appendText("\r\n");
+}
+
 void HttpServerTask::completedWriteBuffer()
 {
 	fillWriteBuffer();
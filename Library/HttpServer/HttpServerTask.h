@@ -36,6 +36,7 @@
 
 #include "Scheduler/ReadWriteTask.h"
 #include "Scheduler/JobTask.h"
+#include "HttpServer/HttpCompressor.h"
 #include "HttpServer/HttpJobRequest.h"
 #include "Dispatcher/JobAnalyser.h"
 
@@ -79,6 +80,32 @@ public:
 
 	void handleJobRequest(HttpJobRequest*);
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief enables chunked responses for HTTP/1.1 clients
+	////////////////////////////////////////////////////////////////////////////////
+
+	static void setChunkedResponses(bool enabled) {
+		chunkedResponses = enabled;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief true if the current response may be streamed in chunks
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool canSendChunks() const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief sends the body generated so far as one chunk
+	///
+	/// The first call sends the header with chunked transfer encoding. The
+	/// write blocks until the client has taken the data, so a slow client
+	/// throttles the job instead of the body piling up in memory. The body is
+	/// cleared afterwards, the rest is sent as last chunk by handleDone.
+	/// Returns false if the connection failed.
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool sendChunk(HttpResponse*);
+
 public:
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -185,8 +212,12 @@ protected:
 private:
 	void fillWriteBuffer();
 	void addResponse(HttpResponse*);
+	void appendChunk(StringBuffer *buffer, const StringBuffer& data);
 	string extractRequestPath();
 
+private:
+	static bool chunkedResponses;
+
 private:
 	JobAnalyser * analyzer;
 	HttpServer * server;
@@ -201,6 +232,8 @@ private:
 	size_t bodyLength;
 	bool work;
 	bool bShutdown;
+	bool chunkedStream;
+	HttpCompressor compressor;
 };
 
 }
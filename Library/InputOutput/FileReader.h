@@ -67,6 +67,33 @@ public:
 	virtual int32_t getLineNumber() = 0;
 	virtual void getRaw(char *p, streamsize size) = 0;
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief file offset of the next raw read, -1 if the file has no plain offsets
+	////////////////////////////////////////////////////////////////////////////////
+
+	virtual int64_t getRawPosition() {
+		return -1;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief continues raw reading at an offset returned by getRawPosition
+	////////////////////////////////////////////////////////////////////////////////
+
+	virtual bool setRawPosition(int64_t position) {
+		return false;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief maps the next size bytes copy-on-write and skips them
+	///
+	/// Returns an empty pointer if the file cannot be mapped at the current
+	/// position, the caller reads the data by getRaw then.
+	////////////////////////////////////////////////////////////////////////////////
+
+	virtual boost::shared_ptr<char> mapRaw(streamsize size) {
+		return boost::shared_ptr<char>();
+	}
+
 	FileName getFileName() {
 		return fileName;
 	}
@@ -41,6 +41,13 @@
 
 #include <iostream>
 
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace palo {
 FileReaderTXT::FileReaderTXT(const FileName& fileName) :
 	FileReader(fileName), data(false), section(false), endOfFile(false), sectionName()
@@ -129,6 +136,67 @@ void FileReaderTXT::getRaw(char *p, streamsize size)
 	}
 }
 
+int64_t FileReaderTXT::getRawPosition()
+{
+	if (inputFile == 0) {
+		return -1;
+	}
+	return (int64_t)inputFile->tellg();
+}
+
+bool FileReaderTXT::setRawPosition(int64_t position)
+{
+	if (inputFile == 0 || position < 0) {
+		return false;
+	}
+	inputFile->clear();
+	inputFile->seekg((streamoff)position, ios::beg);
+	return !inputFile->fail();
+}
+
+#ifndef _MSC_VER
+struct MappedRegionRelease {
+	MappedRegionRelease(size_t size) : size(size) {}
+	void operator()(char *p) const {
+		munmap(p, size);
+	}
+	size_t size;
+};
+#endif
+
+boost::shared_ptr<char> FileReaderTXT::mapRaw(streamsize size)
+{
+#ifndef _MSC_VER
+	int64_t pos = getRawPosition();
+	if (pos < 0 || size <= 0 || pos % sysconf(_SC_PAGESIZE)) {
+		return boost::shared_ptr<char>();
+	}
+	int fd = open(fileName.fullPath().c_str(), O_RDONLY);
+	struct stat st;
+	if (fd == -1 || fstat(fd, &st) || st.st_size < pos + size) {
+		if (fd != -1) {
+			close(fd);
+		}
+		return boost::shared_ptr<char>();
+	}
+	// private writable mapping, pages are copied by the kernel when written
+	void *p = mmap(0, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, (off_t)pos);
+	close(fd);
+	if (p == MAP_FAILED) {
+		Logger::warning << "cannot map file '" << fileName.fullPath() << "' (" << strerror(errno) << ")" << endl;
+		return boost::shared_ptr<char>();
+	}
+	inputFile->seekg(size, ios::cur);
+	if (inputFile->fail()) {
+		munmap(p, (size_t)size);
+		throw FileOpenException("error during reading", fileName.fullPath());
+	}
+	return boost::shared_ptr<char>((char *)p, MappedRegionRelease((size_t)size));
+#else
+	return boost::shared_ptr<char>();
+#endif
+}
+
 void FileReaderTXT::processSection(const string& line)
 {
 	size_t end = line.find("]", 1);
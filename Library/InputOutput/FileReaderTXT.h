@@ -194,6 +194,9 @@ public:
 	}
 
 	virtual void getRaw(char *p, streamsize size);
+	virtual int64_t getRawPosition();
+	virtual bool setRawPosition(int64_t position);
+	virtual boost::shared_ptr<char> mapRaw(streamsize size);
 
 protected:
 
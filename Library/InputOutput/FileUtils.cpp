@@ -36,6 +36,8 @@
 #include "Exceptions/ErrorException.h"
 #include "Exceptions/ParameterException.h"
 
+#include <fcntl.h>
+
 #ifdef _MSC_VER
 #include <direct.h>
 #include <io.h>
@@ -219,6 +221,37 @@ FileUtils::paloofstream *FileUtils::newOfstreamAppend(const string& filename)
 	return s;
 }
 
+int FileUtils::openSyncDescriptor(const FileName& fileName)
+{
+	// nothing is written through the descriptor, syncing it covers the data
+	// written by any stream of the file
+#if defined(_MSC_VER)
+	return _open(fileName.fullPath().c_str(), _O_WRONLY | _O_APPEND);
+#else
+	return open(fileName.fullPath().c_str(), O_WRONLY | O_APPEND);
+#endif
+}
+
+bool FileUtils::syncDescriptor(int fd)
+{
+#if defined(_MSC_VER)
+	return _commit(fd) == 0;
+#elif defined(__APPLE__)
+	return fsync(fd) == 0;
+#else
+	return fdatasync(fd) == 0;
+#endif
+}
+
+void FileUtils::closeSyncDescriptor(int fd)
+{
+#if defined(_MSC_VER)
+	_close(fd);
+#else
+	close(fd);
+#endif
+}
+
 bool FileUtils::isReadable(const FileName& fileName)
 {
 	FILE* file = fopen(fileName.fullPath().c_str(), "r");
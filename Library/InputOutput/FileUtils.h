@@ -111,6 +111,21 @@ public:
 	////////////////////////////////////////////////////////////////////////////////
 	static bool isReadable(const FileName& fileName);
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief opens a descriptor to sync an existing file, returns -1 on error
+	////////////////////////////////////////////////////////////////////////////////
+	static int openSyncDescriptor(const FileName& fileName);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief writes the data of the file to disk, returns false on error
+	////////////////////////////////////////////////////////////////////////////////
+	static bool syncDescriptor(int fd);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief closes a descriptor returned by openSyncDescriptor
+	////////////////////////////////////////////////////////////////////////////////
+	static void closeSyncDescriptor(int fd);
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// @brief returns true if a file could be removed
 	////////////////////////////////////////////////////////////////////////////////
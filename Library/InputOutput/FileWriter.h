@@ -73,6 +73,7 @@ public:
 	virtual void nextLine() = 0;
 	virtual void appendRaw(const string& value) = 0;
 	virtual void appendRaw(const char *p, streamsize size) = 0;
+	virtual int64_t getRawPosition() {return -1;}
 	static void deleteFile(const FileName& fileName);
 	static int32_t getFileSize(const FileName& fileName);
 	static FileWriter *getFileWriter(const FileName& fileName);
@@ -542,6 +542,14 @@ void FileWriterTXT::appendRaw(const char *p, streamsize size)
 	outputFile->write(p, size);
 }
 
+int64_t FileWriterTXT::getRawPosition()
+{
+	if (outputFile == 0) {
+		return -1;
+	}
+	return (int64_t)outputFile->tellp();
+}
+
 void FileWriterTXT::writeBuffer()
 {
 	if (outputFile == 0) {
@@ -166,6 +166,8 @@ public:
 
 	virtual void appendRaw(const char *p, streamsize size);
 
+	virtual int64_t getRawPosition();
+
 private:
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -35,6 +35,7 @@
 #include "Logger/Logger.h"
 
 #include <iostream>
+#include <boost/crc.hpp>
 
 namespace palo {
 
@@ -77,17 +78,52 @@ const string JournalFileReader::JOURNAL_ELEMENTS_BULK_STOP = "ELEMENTS_BULK_STOP
 
 // common
 const string JournalFileReader::JOURNAL_VERSION = "VERSION";
+const string JournalFileReader::JOURNAL_RECORD = "RECORD";
 
 // minimal version required
 const JournalFileReader::Version JournalFileReader::minVersion = JournalFileReader::Version(5, 1, 5594);
 
 
 JournalFileReader::JournalFileReader(const FileName& fileName) :
-	FileReader(fileName)
+	FileReader(fileName), recordType(RECORD_NONE)
 {
 	lastFileId = 0;
 }
 
+uint32_t JournalFileReader::recordChecksum(const char *data, size_t size)
+{
+	boost::crc_32_type crc;
+	crc.process_bytes(data, size);
+	return crc.checksum();
+}
+
+void JournalFileReader::readRecord()
+{
+	recordType = RECORD_NONE;
+	record.clear();
+	if (lastFileId < 0 || !reader->isDataLine() || reader->getDataString(3) != JOURNAL_RECORD) {
+		return;
+	}
+	RecordType type = (RecordType)reader->getDataInteger(4);
+	size_t length = (size_t)reader->getDataInteger(5);
+	uint32_t checksum = (uint32_t)strtoul(reader->getDataString(6).c_str(), 0, 10);
+	record.resize(length);
+	try {
+		if (length) {
+			reader->getRaw(&record[0], (streamsize)length);
+		}
+	} catch (const FileOpenException &) {
+		// journal ends inside the record
+		record.clear();
+	}
+	if (record.size() != length || recordChecksum(record.data(), record.size()) != checksum) {
+		Logger::warning << "skipping damaged record in journal '" << fileName.fullPath() << "'" << endl;
+		record.clear();
+		return;
+	}
+	recordType = type;
+}
+
 bool JournalFileReader::openFile(bool throwError, bool skipMessage)
 {
 	// find first journal file
@@ -98,7 +134,11 @@ bool JournalFileReader::openFile(bool throwError, bool skipMessage)
 
 	reader.reset(FileReader::getFileReader(FileName(fileName.path, se.str(), fileName.extension)));
 
-	return reader->openFile(throwError, skipMessage);
+	bool result = reader->openFile(throwError, skipMessage);
+	if (result) {
+		readRecord();
+	}
+	return result;
 }
 
 void JournalFileReader::nextLine(bool strip)
@@ -106,7 +146,7 @@ void JournalFileReader::nextLine(bool strip)
 	if (!reader->isEndOfFile()) {
 		reader->nextLine(strip);
 
-		if (reader->isEndOfFile()) {
+		if (reader->isEndOfFile() && lastFileId >= 0) {
 
 			// check next journal file
 			stringstream filename;
@@ -123,6 +163,7 @@ void JournalFileReader::nextLine(bool strip)
 				reader->openFile(true, false);
 			}
 		}
+		readRecord();
 	}
 }
 
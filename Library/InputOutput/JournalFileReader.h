@@ -82,6 +82,22 @@ public:
 
 	// common
 	static const string JOURNAL_VERSION;
+	static const string JOURNAL_RECORD;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief types of binary records
+	///
+	/// A record is a line "time;user;event;RECORD;type;length;crc32;" followed
+	/// by length bytes of payload.
+	////////////////////////////////////////////////////////////////////////////////
+	enum RecordType {
+		RECORD_NONE = 0, RECORD_CELL_REPLACE_DOUBLE = 1
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief checksum of a record payload
+	////////////////////////////////////////////////////////////////////////////////
+	static uint32_t recordChecksum(const char *data, size_t size);
 
 	struct Version {
 		int release;
@@ -111,7 +127,7 @@ public:
 	////////////////////////////////////////////////////////////////////////////////
 
 	JournalFileReader(const FileName& fileName);
-	JournalFileReader(boost::shared_ptr<FileReader> stringVectorReader, const FileName &fileName) : FileReader(fileName) {this->reader = stringVectorReader;}
+	JournalFileReader(boost::shared_ptr<FileReader> stringVectorReader, const FileName &fileName) : FileReader(fileName), lastFileId(-1), recordType(RECORD_NONE) {this->reader = stringVectorReader;}
 
 public:
 
@@ -152,6 +168,25 @@ public:
 
 	void gotoTimeStamp(long int seconds, long int useconds);
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief type of the current binary record, RECORD_NONE for text commands
+	///
+	/// A record whose payload is truncated or fails the checksum is reported
+	/// as RECORD_NONE.
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool isRecord() const {
+		return recordType != RECORD_NONE;
+	}
+
+	RecordType getRecordType() const {
+		return recordType;
+	}
+
+	const string &getRecord() const {
+		return record;
+	}
+
 	const Version& getVersion() const {
 		return version;
 	}
@@ -163,9 +198,13 @@ public:
 	}
 
 private:
-	int lastFileId;
+	void readRecord();
+
+	int lastFileId; // -1 if all commands are read by the given reader
 	Version version;
 	boost::shared_ptr<FileReader> reader;
+	RecordType recordType;
+	string record;
 };
 
 }
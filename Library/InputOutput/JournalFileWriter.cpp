@@ -29,6 +29,8 @@
  */
 
 #include <boost/scoped_array.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "InputOutput/JournalFileWriter.h"
 
@@ -79,6 +81,114 @@ ContextBuffer::int_type ContextBuffer::sync()
 	return 0;
 }
 
+JournalSyncHandle::JournalSyncHandle(const FileName& fileName) :
+	fd(FileUtils::openSyncDescriptor(fileName)), path(fileName.fullPath())
+{
+	if (fd == -1) {
+		Logger::warning << "cannot open journal file '" << path << "' for syncing" << endl;
+	}
+}
+
+JournalSyncHandle::~JournalSyncHandle()
+{
+	if (fd != -1) {
+		FileUtils::closeSyncDescriptor(fd);
+	}
+}
+
+bool JournalSyncHandle::sync()
+{
+	return fd != -1 && FileUtils::syncDescriptor(fd);
+}
+
+bool JournalSync::syncJournals = false;
+const int JournalSync::SYNC_ATTEMPTS;
+const size_t JournalSync::FAILED_ROUNDS;
+
+JournalSync::JournalSync() :
+	lastRequested(0), lastSynced(0), running(false)
+{
+}
+
+JournalSync &JournalSync::instance()
+{
+	static JournalSync journalSync;
+	return journalSync;
+}
+
+void JournalSync::setSyncJournals(bool sync)
+{
+	syncJournals = sync;
+}
+
+uint64_t JournalSync::add(PJournalSyncHandle handle)
+{
+	boost::mutex::scoped_lock lock(m);
+	if (!running) {
+		running = true;
+		boost::thread(boost::bind(&JournalSync::run, this));
+	}
+	pending[handle.get()] = handle;
+	requested.notify_one();
+	return ++lastRequested;
+}
+
+bool JournalSync::wait(uint64_t ticket)
+{
+	boost::mutex::scoped_lock lock(m);
+	while (lastSynced < ticket) {
+		synced.wait(lock);
+	}
+	for (list<pair<uint64_t, uint64_t> >::const_iterator it = failedRounds.begin(); it != failedRounds.end(); ++it) {
+		if (it->first <= ticket && ticket <= it->second) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void JournalSync::run()
+{
+	map<JournalSyncHandle *, PJournalSyncHandle> files;
+	boost::mutex::scoped_lock lock(m);
+	while (true) {
+		while (pending.empty()) {
+			requested.wait(lock);
+		}
+		files.swap(pending);
+		uint64_t firstTicket = lastSynced + 1;
+		uint64_t ticket = lastRequested;
+
+		// new commits are collected for the next round meanwhile
+		lock.unlock();
+		bool ok = true;
+		for (map<JournalSyncHandle *, PJournalSyncHandle>::iterator it = files.begin(); it != files.end(); ++it) {
+			bool fileSynced = false;
+			for (int attempt = 0; attempt < SYNC_ATTEMPTS && !fileSynced; attempt++) {
+				if (attempt) {
+					boost::this_thread::sleep(boost::posix_time::milliseconds(10 * attempt));
+				}
+				fileSynced = it->second->sync();
+			}
+			if (!fileSynced) {
+				Logger::error << "cannot sync journal file '" << it->second->getPath() << "'" << endl;
+				ok = false;
+			}
+		}
+		files.clear();
+		lock.lock();
+
+		if (!ok) {
+			failedRounds.push_back(make_pair(firstTicket, ticket));
+			if (failedRounds.size() > FAILED_ROUNDS) {
+				failedRounds.pop_front();
+			}
+		}
+		lastSynced = ticket;
+		synced.notify_all();
+	}
+}
+
 JournalMem::JournalMem(JournalFile *file) :
 	FileWriterTXT(FileName()), buf(file)
 {
@@ -91,6 +201,13 @@ JournalMem::~JournalMem()
 	outputFile = 0;
 }
 
+bool JournalFile::binaryRecords = false;
+
+void JournalFile::setBinaryRecords(bool binary)
+{
+	binaryRecords = binary;
+}
+
 JournalFile::JournalFile(const FileName& fileName, PSharedMutex filelock, IdentifierType db, IdentifierType cube) :
 	fileName(fileName), db(db), cube(cube), firstLine(true), filelock(filelock), fileSize(0)
 {
@@ -135,6 +252,9 @@ void JournalFile::openFile()
 	fileSize = FileWriter::getFileSize(lastFileName);
 	writer.reset(FileWriter::getFileWriter(lastFileName));
 	writer->openFile(true);
+	if (JournalSync::isSyncJournals()) {
+		syncHandle.reset(new JournalSyncHandle(lastFileName));
+	}
 
 	// check size of found journal file
 	if (last != next) {
@@ -148,6 +268,8 @@ void JournalFile::closeFile()
 		writer->closeFile();
 		writer.reset();
 	}
+	// a sync still pending keeps the descriptor open
+	syncHandle.reset();
 }
 
 void JournalMem::appendCommand(const string& user, const string& event, const string& command)
@@ -161,6 +283,18 @@ void JournalMem::appendCommand(const string& user, const string& event, const st
 	*outputFile << StringUtils::escapeString(user) << ";" << StringUtils::escapeString(event) << ";" << command << ";";
 }
 
+void JournalMem::appendRecord(const string& user, const string& event, uint32_t type, const string& payload)
+{
+	appendCommand(user, event, JournalFileReader::JOURNAL_RECORD);
+	*outputFile << type << ";" << payload.size() << ";" << JournalFileReader::recordChecksum(payload.data(), payload.size()) << ";";
+	setFirstValue(false);
+	nextLine();
+
+	// the payload follows the header line, the next command starts after it
+	outputFile->write(payload.data(), (streamsize)payload.size());
+	outputFile->flush();
+}
+
 bool JournalFile::checkFileSize()
 {
 	if (fileSize > 100000000) {
@@ -175,6 +309,9 @@ bool JournalFile::checkFileSize()
 		fileSize = 0;
 		writer.reset(FileWriter::getFileWriter(lastFileName));
 		writer->openFile(true);
+		if (JournalSync::isSyncJournals()) {
+			syncHandle.reset(new JournalSyncHandle(lastFileName));
+		}
 	}
 
 	return !(lastFileId == 0 && fileSize == 0); // return true if journal is non-empty
@@ -250,8 +387,9 @@ void JournalFile::archiveJournalFiles(const FileName& fileName)
 	}
 }
 
-void JournalFile::flush(ContextStream &str)
+uint64_t JournalFile::flush(ContextStream &str)
 {
+	uint64_t ticket = 0;
 	bool cont = true;
 	if (db != (IdentifierType) - 1) {
 		PDatabase d = Context::getContext()->getServer()->lookupDatabase(db, false);
@@ -293,7 +431,12 @@ void JournalFile::flush(ContextStream &str)
 
 		fileSize += str.str().length();
 		writer->appendRaw(str.str());
+
+		if (syncHandle) {
+			ticket = JournalSync::instance().add(syncHandle);
+		}
 	}
+	return ticket;
 }
 
 void JournalFile::clear()
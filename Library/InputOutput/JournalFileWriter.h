@@ -36,6 +36,10 @@
 #include "InputOutput/FileWriterTXT.h"
 #include "boost/enable_shared_from_this.hpp"
 
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 namespace palo {
 
 class ContextStream;
@@ -56,12 +60,95 @@ public:
 	JournalMem(JournalFile *file);
 	virtual ~JournalMem();
 	void appendCommand(const string& user, const string& event, const string& command);
+	void appendRecord(const string& user, const string& event, uint32_t type, const string& payload);
 	void flush() {outputFile->flush();}
 
 private:
 	ContextBuffer buf;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief descriptor of a journal file kept open for syncing
+///
+/// Opened together with the journal's writer and closed when the last pending
+/// sync of the file is done, so a rotated file is still synced.
+////////////////////////////////////////////////////////////////////////////////
+
+class SERVER_CLASS JournalSyncHandle : private boost::noncopyable {
+public:
+	JournalSyncHandle(const FileName& fileName);
+	~JournalSyncHandle();
+
+	bool sync();
+
+	const string &getPath() const {
+		return path;
+	}
+
+private:
+	int fd;
+	string path;
+};
+
+typedef boost::shared_ptr<JournalSyncHandle> PJournalSyncHandle;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief writes journal files to disk in groups
+///
+/// Commits register the journal files they have appended to and wait for their
+/// ticket. One thread syncs all files registered so far at once, commits
+/// arriving meanwhile are synced together by the next round. A file failing
+/// to sync is retried, if it still fails all commits of the round fail and
+/// Server::commit stops the server.
+////////////////////////////////////////////////////////////////////////////////
+
+class SERVER_CLASS JournalSync : private boost::noncopyable {
+public:
+	static JournalSync &instance();
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief enables syncing of journal files on commit
+	////////////////////////////////////////////////////////////////////////////////
+
+	static void setSyncJournals(bool sync);
+
+	static bool isSyncJournals() {
+		return syncJournals;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief registers a written journal file, returns the ticket to wait for
+	////////////////////////////////////////////////////////////////////////////////
+
+	uint64_t add(PJournalSyncHandle handle);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief waits until all files registered up to the ticket are synced
+	///
+	/// Returns false if a file of the ticket's round could not be synced.
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool wait(uint64_t ticket);
+
+private:
+	static const int SYNC_ATTEMPTS = 3;
+	static const size_t FAILED_ROUNDS = 64;
+
+	JournalSync();
+	void run();
+
+	static bool syncJournals;
+
+	boost::mutex m;
+	boost::condition_variable requested;
+	boost::condition_variable synced;
+	map<JournalSyncHandle *, PJournalSyncHandle> pending;
+	list<pair<uint64_t, uint64_t> > failedRounds;
+	uint64_t lastRequested;
+	uint64_t lastSynced;
+	bool running;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief journal file writer
 ////////////////////////////////////////////////////////////////////////////////
@@ -81,6 +168,16 @@ public:
 
 	static void archiveJournalFiles(const FileName& fileName);
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief writes cell changes as binary records
+	////////////////////////////////////////////////////////////////////////////////
+
+	static void setBinaryRecords(bool binary);
+
+	static bool isBinaryRecords() {
+		return binaryRecords;
+	}
+
 public:
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -95,7 +192,11 @@ public:
 
 	virtual ~JournalFile();
 
-	void flush(ContextStream &str);
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief appends the records of a job, returns the sync ticket or 0
+	////////////////////////////////////////////////////////////////////////////////
+
+	uint64_t flush(ContextStream &str);
 	void clear();
 	virtual void closeFile();
 
@@ -113,8 +214,11 @@ private:
 	bool firstLine;
 
 	boost::shared_ptr<FileWriter> writer;
+	PJournalSyncHandle syncHandle;
 	PSharedMutex filelock;
 	size_t fileSize;
+
+	static bool binaryRecords;
 };
 
 }
@@ -34,11 +34,12 @@
 
 #include "Engine/Legacy/Engine.h"
 #include "Olap/Rule.h"
+#include "InputOutput/JournalFileWriter.h"
 
 namespace palo {
 
 Context::Context() : svsChangeStatusContext(SVS_NONE), updateToken(true), refreshUsers(false), optimistic(true), worker(false),
-	filteredFromMarkers(0), rulesContext(0), stopJob(NO_STOP), ignoreStopJob(false), inJournal(false), task(0), saveToCache(true)
+	filteredFromMarkers(0), rulesContext(0), stopJob(NO_STOP), ignoreStopJob(false), inJournal(false), journalTicket(0), task(0), saveToCache(true)
 {
 	if (getServer()) {
 		PEngineList engineList = getServer()->getEngineList(false);
@@ -184,8 +185,21 @@ void Context::setJournalIsFirst(PJournalFile journal, bool isFirst)
 void Context::flushJournals()
 {
 	for (std::map<PJournalFile, pair<ContextStream, bool> >::iterator it = journalstreams.begin(); it != journalstreams.end(); ++it) {
-		it->first->flush(it->second.first);
+		uint64_t ticket = it->first->flush(it->second.first);
+		if (ticket > journalTicket) {
+			journalTicket = ticket;
+		}
+	}
+}
+
+bool Context::syncJournals()
+{
+	if (journalTicket) {
+		uint64_t ticket = journalTicket;
+		journalTicket = 0;
+		return JournalSync::instance().wait(ticket);
 	}
+	return true;
 }
 
 void Context::deleteJournalStream(PJournalFile journal)
@@ -217,6 +231,22 @@ void Context::addDatabaseToDelete(PDatabase db)
 	dbsToDelete.push_back(db);
 }
 
+void Context::addSupersededCube(CPCube cube)
+{
+	supersededCubes.push_back(cube);
+}
+
+void Context::retireSupersededCubes(bool committed)
+{
+	if (committed) {
+		// cached plans own their cube, drop them so that the old version can be freed
+		for (list<CPCube>::iterator it = supersededCubes.begin(); it != supersededCubes.end(); ++it) {
+			(*it)->getPlanCache()->retire();
+		}
+	}
+	supersededCubes.clear();
+}
+
 void Context::addNewMarkerRule(IdentifierType db, IdentifierType cube, IdentifierType rule)
 {
 	newMarkerRules.insert(make_pair(db, make_pair(cube, rule)));
@@ -374,13 +404,37 @@ void Context::reset(bool wasNew)
 	if (context.get() && context->isWorker()) {
 		context->setTask(NULL);
 		context.release()->setWorker(false);
-	} else {
+	} else if (context.get()) {
+		// objects still using the arena keep it, new allocations go to the heap
+		context->arena.reset();
 		if (wasNew) {
 			context.reset();
 		}
 	}
 }
 
+void Context::enableArena()
+{
+	if (!arena && !worker) {
+		arena.reset(new ContextArena());
+		arenaOwner = boost::this_thread::get_id();
+	}
+}
+
+PContextArena Context::getArena() const
+{
+	if (arena && arenaOwner == boost::this_thread::get_id()) {
+		return arena;
+	}
+	return PContextArena();
+}
+
+PContextArena Context::getCurrentArena()
+{
+	Context *c = context.get();
+	return c ? c->getArena() : PContextArena();
+}
+
 int16_t Context::savePaloDataCube(CPCube cube, CPDatabase db)
 {
 	size_t pos = 0;
@@ -439,4 +493,41 @@ void Context::setCacheDependence(const dbID_cubeID &dbCubeId)
 	}
 }
 
+// values of a cube with rules depend on other cells than the ones read,
+// such a source is recorded as whole cube
+bool Context::hasRuleSource(const dbID_cubeID &dbCubeId)
+{
+	PDatabase db = getServer()->lookupDatabase(dbCubeId.first, false);
+	CPCube cube = db ? db->lookupCube(dbCubeId.second, false) : CPCube();
+	return !cube || cube->hasActiveRule();
+}
+
+void Context::setCacheDependence(const dbID_cubeID &dbCubeId, const Area &area)
+{
+	if (cacheDependences.empty()) {
+		return;
+	}
+	if (hasRuleSource(dbCubeId)) {
+		setCacheDependence(dbCubeId);
+		return;
+	}
+	for (Context::CacheDependences::iterator cdit = cacheDependences.begin(); cdit != cacheDependences.end(); ++cdit) {
+		(*cdit)->addSourceArea(dbCubeId, area);
+	}
+}
+
+void Context::setCacheDependence(const dbID_cubeID &dbCubeId, const IdentifiersType &path)
+{
+	if (cacheDependences.empty()) {
+		return;
+	}
+	if (hasRuleSource(dbCubeId)) {
+		setCacheDependence(dbCubeId);
+		return;
+	}
+	for (Context::CacheDependences::iterator cdit = cacheDependences.begin(); cdit != cacheDependences.end(); ++cdit) {
+		(*cdit)->addSourcePath(dbCubeId, path);
+	}
+}
+
 }
@@ -36,8 +36,10 @@
 #include "Thread/Mutex.h"
 #include "Exceptions/ErrorException.h"
 #include <boost/thread/tss.hpp>
+#include <boost/thread/thread.hpp>
 #include "Engine/EngineBase.h"
 #include "Engine/Cache.h"
+#include "Olap/ContextArena.h"
 #include "Scheduler/IoTask.h"
 
 namespace paloLegacy {
@@ -246,6 +248,7 @@ public:
 	void setJournalIsFirst(PJournalFile journal, bool isFirst);
 	void deleteJournalStream(PJournalFile journal);
 	void flushJournals();
+	bool syncJournals();
 	////////////////////////////////////////////////////////////////////////////////
 	/// @}
 	////////////////////////////////////////////////////////////////////////////////
@@ -364,6 +367,16 @@ public:
 	/// @}
 	////////////////////////////////////////////////////////////////////////////////
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @{
+	/// @name Internal functions for releasing superseded cube versions
+	////////////////////////////////////////////////////////////////////////////////
+	void addSupersededCube(CPCube cube);
+	void retireSupersededCubes(bool committed);
+	////////////////////////////////////////////////////////////////////////////////
+	/// @}
+	////////////////////////////////////////////////////////////////////////////////
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// @{
 	/// @name Internal functions for faster Marker loading
@@ -448,6 +461,9 @@ public:
 
 	CacheDependences &getCacheDependences() {return cacheDependences;}
 	void setCacheDependence(const dbID_cubeID &dbCubeId);
+	void setCacheDependence(const dbID_cubeID &dbCubeId, const Area &area);
+	void setCacheDependence(const dbID_cubeID &dbCubeId, const IdentifiersType &path);
+	bool hasRuleSource(const dbID_cubeID &dbCubeId);
 
 	void setInJournal(bool value) {
 		inJournal = value;
@@ -461,6 +477,18 @@ public:
 		task = t;
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @{
+	/// @name Per request memory arena.
+	/// Enabled for request contexts only (not for workers), released by reset().
+	////////////////////////////////////////////////////////////////////////////////
+	void enableArena();
+	PContextArena getArena() const;
+	static PContextArena getCurrentArena();
+	////////////////////////////////////////////////////////////////////////////////
+	/// @}
+	////////////////////////////////////////////////////////////////////////////////
+
 private:
 	enum JobStatus {
 		NO_STOP, ADMIN_STOP, LOGOUT_STOP
@@ -482,6 +510,7 @@ private:
 	map<IdentifierType, string> renamedUsers;
 	std::list<PCube> cubesToDelete;
 	std::list<PDatabase> dbsToDelete;
+	std::list<CPCube> supersededCubes;
 	RuleIds newMarkerRules;
 	bool optimistic;
 	bool worker;
@@ -495,8 +524,11 @@ private:
 	bool ignoreStopJob;
 	CacheDependences cacheDependences;
 	bool inJournal;
+	uint64_t journalTicket;
 	IoTask *task;
 	bool saveToCache;
+	PContextArena arena;
+	boost::thread::id arenaOwner;
 };
 
 #define COMMITABLE_CAST(a, b) boost::dynamic_pointer_cast<a, Commitable>(b)
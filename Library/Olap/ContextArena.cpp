@@ -0,0 +1,178 @@
+/* 
+ *
+ * Copyright (C) 2006-2014 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * 
+ *
+ */
+
+#include "Olap/ContextArena.h"
+#include "Olap/Context.h"
+
+namespace palo {
+
+std::atomic<uint64_t> ContextArena::totalArenas(0);
+std::atomic<uint64_t> ContextArena::totalAllocations(0);
+std::atomic<uint64_t> ContextArena::totalBytes(0);
+std::atomic<uint64_t> ContextArena::totalBlocks(0);
+std::atomic<uint64_t> ContextArena::totalHeapAllocations(0);
+
+const size_t ContextArena::BLOCK_SIZE;
+const size_t ContextArena::ALIGNMENT;
+
+ContextArena::ContextArena() : heapScopes(0), position(0), free(0), allocations(0), bytes(0), owner(boost::this_thread::get_id())
+{
+}
+
+ContextArena::~ContextArena()
+{
+	for (vector<char *>::iterator it = blocks.begin(); it != blocks.end(); ++it) {
+		delete[] *it;
+	}
+	totalArenas.fetch_add(1, std::memory_order_relaxed);
+	totalAllocations.fetch_add(allocations, std::memory_order_relaxed);
+	totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+	totalBlocks.fetch_add(blocks.size(), std::memory_order_relaxed);
+}
+
+void *ContextArena::allocateSlow(size_t size)
+{
+	if (size > BLOCK_SIZE / 4) {
+		// big objects get their own block, the current one stays usable
+		char *block = new char[size];
+		blocks.push_back(block);
+		blockSizes.push_back(size);
+		return block;
+	}
+	char *block = new char[BLOCK_SIZE];
+	blocks.push_back(block);
+	blockSizes.push_back(BLOCK_SIZE);
+	position = block + size;
+	free = BLOCK_SIZE - size;
+	return block;
+}
+
+void ContextArena::deallocateMarked(void *p)
+{
+	// only objects allocated after the innermost mark count, anything older
+	// keeps the mark alive and the scope does not rewind
+	Mark &m = marks.back();
+	char *c = static_cast<char *>(p);
+	bool inScope = c >= m.position && c < m.position + m.free;
+	for (size_t i = m.blockCount; !inScope && i < blocks.size(); i++) {
+		inScope = c >= blocks[i] && c < blocks[i] + blockSizes[i];
+	}
+	if (inScope && m.live) {
+		--m.live;
+	}
+}
+
+void ContextArena::mark()
+{
+	Mark m;
+	m.blockCount = blocks.size();
+	m.position = position;
+	m.free = free;
+	m.live = 0;
+	marks.push_back(m);
+}
+
+void ContextArena::release()
+{
+	Mark m = marks.back();
+	marks.pop_back();
+	if (m.live) {
+		// something survived the scope, the enclosing mark inherits it
+		if (!marks.empty()) {
+			marks.back().live += m.live;
+		}
+		return;
+	}
+	for (size_t i = m.blockCount; i < blocks.size(); i++) {
+		delete[] blocks[i];
+	}
+	totalBlocks.fetch_add(blocks.size() - m.blockCount, std::memory_order_relaxed);
+	blocks.resize(m.blockCount);
+	blockSizes.resize(m.blockCount);
+	position = m.position;
+	free = m.free;
+}
+
+ContextArena::Scope::Scope() : arena(ContextArena::current())
+{
+	if (arena) {
+		arena->mark();
+	}
+}
+
+ContextArena::Scope::~Scope()
+{
+	if (arena) {
+		arena->release();
+	}
+}
+
+ContextArena::HeapScope::HeapScope() : arena(ContextArena::current())
+{
+	if (arena) {
+		++arena->heapScopes;
+	}
+}
+
+ContextArena::HeapScope::~HeapScope()
+{
+	if (arena) {
+		--arena->heapScopes;
+	}
+}
+
+PContextArena ContextArena::current()
+{
+	PContextArena arena = Context::getCurrentArena();
+	if (arena && arena->heapScopes) {
+		return PContextArena();
+	}
+	return arena;
+}
+
+ContextArena::Counters ContextArena::getCounters() const
+{
+	Counters result;
+	result.arenas = 1;
+	result.allocations = allocations;
+	result.bytes = bytes;
+	result.blocks = blocks.size();
+	return result;
+}
+
+ContextArena::Counters ContextArena::getTotalCounters()
+{
+	Counters result;
+	result.arenas = totalArenas.load(std::memory_order_relaxed);
+	result.allocations = totalAllocations.load(std::memory_order_relaxed);
+	result.bytes = totalBytes.load(std::memory_order_relaxed);
+	result.blocks = totalBlocks.load(std::memory_order_relaxed);
+	result.heapAllocations = totalHeapAllocations.load(std::memory_order_relaxed);
+	return result;
+}
+
+}
@@ -0,0 +1,265 @@
+/* 
+ *
+ * Copyright (C) 2006-2014 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * 
+ *
+ */
+
+#ifndef OLAP_CONTEXT_ARENA_H
+#define OLAP_CONTEXT_ARENA_H 1
+
+#include "palo.h"
+
+#include <atomic>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace palo {
+
+class ContextArena;
+typedef boost::shared_ptr<ContextArena> PContextArena;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief monotonic allocator owned by a request context
+///
+/// Memory is taken from fixed size blocks and never given back one object at
+/// a time; all blocks are freed together when the last object allocated from
+/// the arena is destroyed. Objects hold the arena through ArenaAllocator, so
+/// anything outliving the request (cache writers, ...) stays valid.
+/// Allocation is not synchronized, only the thread that enabled the arena in
+/// its context gets it from current().
+/// A Scope marks the arena for a sub-query; when everything allocated inside
+/// the scope is gone at its end, the memory is rewound to the mark.
+////////////////////////////////////////////////////////////////////////////////
+
+class SERVER_CLASS ContextArena {
+public:
+	struct Counters {
+		Counters() : arenas(0), allocations(0), bytes(0), blocks(0), heapAllocations(0) {}
+
+		uint64_t arenas;
+		uint64_t allocations;
+		uint64_t bytes;
+		uint64_t blocks;
+		uint64_t heapAllocations;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief marks the arena of the current context for a sub-query
+	////////////////////////////////////////////////////////////////////////////////
+	class SERVER_CLASS Scope {
+	public:
+		Scope();
+		~Scope();
+
+	private:
+		Scope(const Scope &);
+		Scope &operator=(const Scope &);
+
+		PContextArena arena;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief objects created in this scope go to the heap
+	///
+	/// For objects kept beyond the request (cached plans), they must not hold
+	/// the request's arena.
+	////////////////////////////////////////////////////////////////////////////////
+	class SERVER_CLASS HeapScope {
+	public:
+		HeapScope();
+		~HeapScope();
+
+	private:
+		HeapScope(const HeapScope &);
+		HeapScope &operator=(const HeapScope &);
+
+		PContextArena arena;
+	};
+
+	static const size_t BLOCK_SIZE = 64 * 1024;
+	static const size_t ALIGNMENT = 16;
+
+	ContextArena();
+	~ContextArena();
+
+	void *allocate(size_t size) {
+		size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+		++allocations;
+		bytes += size;
+		if (!marks.empty()) {
+			++marks.back().live;
+		}
+		if (size > free) {
+			return allocateSlow(size);
+		}
+		void *result = position;
+		position += size;
+		free -= size;
+		return result;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief object allocated from the arena was destroyed
+	////////////////////////////////////////////////////////////////////////////////
+	void deallocate(void *p) {
+		if (!marks.empty() && owner == boost::this_thread::get_id()) {
+			deallocateMarked(p);
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief arena of the current thread's context or empty pointer
+	////////////////////////////////////////////////////////////////////////////////
+	static PContextArena current();
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief counters of the arena
+	////////////////////////////////////////////////////////////////////////////////
+	Counters getCounters() const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief counters summed over all released arenas
+	////////////////////////////////////////////////////////////////////////////////
+	static Counters getTotalCounters();
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief creates shared object in the arena of the current context
+	////////////////////////////////////////////////////////////////////////////////
+	template<typename T, typename... Args> static boost::shared_ptr<T> create(Args&&... args);
+
+	static void countHeapAllocation() {
+		totalHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	ContextArena(const ContextArena &);
+	ContextArena &operator=(const ContextArena &);
+
+	struct Mark {
+		size_t blockCount;
+		char *position;
+		size_t free;
+		uint64_t live;
+	};
+
+	void *allocateSlow(size_t size);
+	void deallocateMarked(void *p);
+	void mark();
+	void release();
+
+	vector<char *> blocks;
+	vector<size_t> blockSizes;
+	vector<Mark> marks;
+	size_t heapScopes;
+	char *position;
+	size_t free;
+	uint64_t allocations;
+	uint64_t bytes;
+	boost::thread::id owner;
+
+	static std::atomic<uint64_t> totalArenas;
+	static std::atomic<uint64_t> totalAllocations;
+	static std::atomic<uint64_t> totalBytes;
+	static std::atomic<uint64_t> totalBlocks;
+	static std::atomic<uint64_t> totalHeapAllocations;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief standard allocator on top of the context arena
+///
+/// Default constructed allocator binds to the arena of the current context,
+/// without one it falls back to the global heap.
+/// Usage: boost::allocate_shared<T>(ArenaAllocator<T>(), args...)
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename T> class ArenaAllocator {
+public:
+	typedef T value_type;
+	typedef T *pointer;
+	typedef const T *const_pointer;
+	typedef T &reference;
+	typedef const T &const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U> struct rebind {
+		typedef ArenaAllocator<U> other;
+	};
+
+	ArenaAllocator() : arena(ContextArena::current()) {}
+	explicit ArenaAllocator(const PContextArena &arena) : arena(arena) {}
+	template<typename U> ArenaAllocator(const ArenaAllocator<U> &o) : arena(o.getArena()) {}
+
+	pointer allocate(size_type n, const void * = 0) {
+		if (arena) {
+			return static_cast<pointer>(arena->allocate(n * sizeof(T)));
+		}
+		ContextArena::countHeapAllocation();
+		return static_cast<pointer>(::operator new(n * sizeof(T)));
+	}
+
+	void deallocate(pointer p, size_type) {
+		if (arena) {
+			arena->deallocate(p);
+		} else {
+			::operator delete(p);
+		}
+	}
+
+	size_type max_size() const {
+		return size_t(-1) / sizeof(T);
+	}
+
+	template<typename U, typename... Args> void construct(U *p, Args&&... args) {
+		::new((void *)p) U(std::forward<Args>(args)...);
+	}
+
+	template<typename U> void destroy(U *p) {
+		p->~U();
+	}
+
+	const PContextArena &getArena() const {
+		return arena;
+	}
+
+	template<typename U> bool operator==(const ArenaAllocator<U> &o) const {
+		return arena == o.getArena();
+	}
+
+	template<typename U> bool operator!=(const ArenaAllocator<U> &o) const {
+		return arena != o.getArena();
+	}
+
+private:
+	PContextArena arena;
+};
+
+template<typename T, typename... Args> boost::shared_ptr<T> ContextArena::create(Args&&... args)
+{
+	return boost::allocate_shared<T>(ArenaAllocator<T>(), std::forward<Args>(args)...);
+}
+
+}
+
+#endif
@@ -111,11 +111,16 @@ bool Cube::ignoreCellData = false; // for DEBUGGING only
 double Cube::cacheBarrier = 1000000.0;
 
 const string Cube::PREFIX_ATTRIBUTE_CUBE = "#_";
-const uint32_t Cube::CUBE_FILE_VERSION = 2;
+const uint32_t Cube::CUBE_FILE_VERSION = 3;
+const uint32_t Cube::CUBE_FILE_VERSION_COMPATIBLE = 2;
 const string Cube::CSV = "csv";
 const string Cube::BIN = "bin";
 const string Cube::CSVTMP = "tmp";
 const string Cube::BINTMP = "btmp";
+const string Cube::DELTA = "delta";
+const string Cube::DELTA_SECTION = "DELTA";
+const string Cube::DELTA_END_SECTION = "END";
+const size_t Cube::COMPACTION_RATIO = 4; // compact when deltas exceed a quarter of the pages
 
 const string Cube::NUMERIC_SECTION = "NUMERIC";
 const string Cube::STRING_SECTION = "STRING";
@@ -130,6 +135,28 @@ const uint32_t Cube::markerRebuildLimit = 100000;
 
 bool Cube::saveCSV = true;
 
+size_t Cube::loadThreads = 0;
+
+bool Cube::incrementalSave = false;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief state of the delta file of a cube
+///
+/// Guarded by the file lock of the cube.
+////////////////////////////////////////////////////////////////////////////////
+
+struct Cube::CubeDelta {
+	CubeDelta() : seq(0), basePages(0), deltaPages(0), valid(false) {}
+	uint32_t seq;			// last delta written or loaded, the BIN file stores the last one it contains
+	size_t basePages;		// pages in the BIN file
+	size_t deltaPages;		// pages in the delta file
+	bool valid;				// the checkpoints match the BIN and delta files
+	StorageCpu::PageCheckpoint numeric;
+	StorageCpu::PageCheckpoint strings;
+	PThreadPool pool;
+	ThreadPool::ThreadGroup compaction;
+};
+
 
 bool Cube::ltMarker::operator()(const PRuleMarker &m1, const PRuleMarker &m2) const
 {
@@ -161,12 +188,22 @@ void Cube::setSaveCSV(bool save)
 	saveCSV = save;
 }
 
+void Cube::setLoadThreads(size_t threads)
+{
+	loadThreads = threads;
+}
+
+void Cube::setIncrementalSave(bool incremental)
+{
+	incrementalSave = incremental;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // constructors and destructors
 ////////////////////////////////////////////////////////////////////////////////
 Cube::Cube(PDatabase db, const string& name, const IdentifiersType *dimensions, Cube::SaveType saveType) :
 	Commitable(name), token(rand()), clientCacheToken(new IdHolder), dimensions(*dimensions), rules(new RuleList()), deletable(true),
-	renamable(true), numericStorageId(NO_IDENTIFIER), stringStorageId(NO_IDENTIFIER), markerStorageId(NO_IDENTIFIER), locks(new LockList()),
+	renamable(true), numericStorageId(NO_IDENTIFIER), stringStorageId(NO_IDENTIFIER), markerStorageId(NO_IDENTIFIER), delta(new CubeDelta), locks(new LockList()),
 	filelock(new PaloSharedMutex), rulefilelock(new PaloSharedMutex), saveType(saveType), wholeCubeLocked(false),
 	cache(dimensions->size(), cacheBarrier, 0), additiveCommit(false), delCount(0)
 {
@@ -203,7 +240,7 @@ Cube::Cube(const Cube& c) :
 	Commitable(c), token(c.token), clientCacheToken(c.clientCacheToken), dimensions(c.dimensions), rules(c.rules), deletable(c.deletable),
 	renamable(c.renamable), cubeWorker(c.cubeWorker), hasArea(c.hasArea), workerAreaIdentifiers(c.workerAreaIdentifiers), workerAreas(c.workerAreas),
 	numericStorageId(c.numericStorageId), stringStorageId(c.stringStorageId), markerStorageId(c.markerStorageId), cellsStatus(c.cellsStatus),
-	rulesStatus(c.rulesStatus), fileName(c.fileName), ruleFileName(c.ruleFileName), journalFile(c.journalFile), journal(Server::ignoreJournal || !journalFile ? 0 : new JournalMem(journalFile.get())), hasLock(c.hasLock), locks(c.locks),
+	rulesStatus(c.rulesStatus), fileName(c.fileName), ruleFileName(c.ruleFileName), journalFile(c.journalFile), journal(Server::ignoreJournal || !journalFile ? 0 : new JournalMem(journalFile.get())), delta(c.delta), hasLock(c.hasLock), locks(c.locks),
 	fromMarkers(c.fromMarkers), toMarkers(c.toMarkers), filelock(c.filelock), rulefilelock(c.rulefilelock), saveType(c.saveType),
 	wholeCubeLocked(c.wholeCubeLocked), pathTranslator(c.pathTranslator), cache(c.dimensions.size(), cacheBarrier, c.getCache()->getGeneration()),
 	additiveCommit(c.additiveCommit), delCount(c.delCount)
@@ -274,7 +311,7 @@ PCube Cube::loadCubeFromType(FileReader* file, PDatabase database, IdentifierTyp
 	}
 }
 
-bool Cube::loadCubeOverview(FileReader *file, timeval &tv, uint32_t &file_version, uint32_t &endianness)
+bool Cube::loadCubeOverview(FileReader *file, timeval &tv, uint32_t &file_version, uint32_t &endianness, uint32_t &deltaSeq)
 {
 	bool ret = true;
 	if (file->isSectionLine() && file->getSection() == "CUBE") {
@@ -288,6 +325,7 @@ bool Cube::loadCubeOverview(FileReader *file, timeval &tv, uint32_t &file_versio
 
 			file_version = file->getDataInteger(1);
 			endianness = file->getDataInteger(2);
+			deltaSeq = file->getDataInteger(3);
 			file->nextLine();
 		} else {
 			ret = false;
@@ -423,7 +461,9 @@ bool Cube::loadCubeCells(FileReader *fr, PDatabase db, bool checkAlias, bool bin
 			if (fr->isSectionLine() && fr->getSection() == NUMERIC_SECTION) {
 				PStorageBase numericCpuStorage = cpuEngine->getCreateStorage(numericStorageId, pathTranslator, EngineBase::Numeric);
 				st = dynamic_cast<StorageCpu *>(numericCpuStorage.get());
-				st->load(fr, fileVersion);
+				if (!takePreloaded(fr, st, true)) {
+					st->load(fr, fileVersion);
+				}
 				fr->nextLine();
 
 				if (getType() == GPUTYPE) {
@@ -435,7 +475,9 @@ bool Cube::loadCubeCells(FileReader *fr, PDatabase db, bool checkAlias, bool bin
 			if (ret && fr->isSectionLine() && fr->getSection() == STRING_SECTION) {
 				PStorageBase stringStorage = cpuEngine->getCreateStorage(stringStorageId, pathTranslator, EngineBase::String);
 				st = dynamic_cast<StorageCpu *>(stringStorage.get());
-				st->load(fr, fileVersion);
+				if (!takePreloaded(fr, st, false)) {
+					st->load(fr, fileVersion);
+				}
 			} else {
 				ret = false;
 			}
@@ -560,20 +602,14 @@ void Cube::processJournalCommand(PServer server, PDatabase db, CPCube thisCube,
 		if (lockedPaths && !lockedPaths->empty()) {
 			lockedCells = PLockedCells(new LockedCells(db, thisCube, lockedPaths));
 		}
-
-		try {
-			PCubeArea cellPath(new CubeArea(db, thisCube, ids));
-			CubeArea::CellType cellType = cellPath->getType(cellPath->pathBegin());
-			if (cellType == CubeArea::CONSOLIDATED && replaceBulkState != Cube::In) {
-				commitChanges(false, PUser(), changedCubes, false); // commit previous changes, this command reads data
-			}
-			if (replaceBulkState == Cube::First) {
-				replaceBulkState = Cube::In;
-			}
-
-			setCellValue(server, db, cellPath, value, lockedCells, PUser(), boost::shared_ptr<PaloSession>(), false, addValue, splashMode, false, 0, changedCubes, true, cellType);
-		} catch (ErrorException &e) {
-			Logger::debug << "journal file command: " << JournalFileReader::JOURNAL_CELL_REPLACE_DOUBLE << " - " << e.getMessage() << endl;
+		replayCellReplace(server, db, thisCube, ids, splashMode, value, addValue, lockedCells, replaceBulkState, changedCubes);
+	} else if (command == JournalFileReader::JOURNAL_RECORD) {
+		IdentifiersType ids;
+		SplashMode splashMode;
+		double value;
+		bool addValue;
+		if (decodeCellRecord(history, ids, splashMode, value, addValue)) {
+			replayCellReplace(server, db, thisCube, ids, splashMode, value, addValue, PLockedCells(), replaceBulkState, changedCubes);
 		}
 	} else if (command == JournalFileReader::JOURNAL_CELL_REPLACE_STRING) {
 		IdentifiersType ids = history.getDataIdentifiers(4);
@@ -729,6 +765,119 @@ boost::shared_ptr<JournalFileReader> Cube::initJournalProcess()
 	return journalReader;
 }
 
+void Cube::replayCellReplace(PServer server, PDatabase db, CPCube thisCube, const IdentifiersType &ids, SplashMode splashMode, double value, bool addValue, PLockedCells lockedCells, InBulkEnum &replaceBulkState, set<PCube> &changedCubes)
+{
+	try {
+		PCubeArea cellPath(new CubeArea(db, thisCube, ids));
+		CubeArea::CellType cellType = cellPath->getType(cellPath->pathBegin());
+		if (cellType == CubeArea::CONSOLIDATED && replaceBulkState != Cube::In) {
+			commitChanges(false, PUser(), changedCubes, false); // commit previous changes, this command reads data
+		}
+		if (replaceBulkState == Cube::First) {
+			replaceBulkState = Cube::In;
+		}
+
+		setCellValue(server, db, cellPath, value, lockedCells, PUser(), boost::shared_ptr<PaloSession>(), false, addValue, splashMode, false, 0, changedCubes, true, cellType);
+	} catch (ErrorException &e) {
+		Logger::debug << "journal file command: " << JournalFileReader::JOURNAL_CELL_REPLACE_DOUBLE << " - " << e.getMessage() << endl;
+	}
+}
+
+bool Cube::decodeCellRecord(const JournalFileReader &history, IdentifiersType &ids, SplashMode &splashMode, double &value, bool &addValue)
+{
+	const string &record = history.getRecord();
+	if (history.getRecordType() != JournalFileReader::RECORD_CELL_REPLACE_DOUBLE || record.size() < sizeof(uint32_t)) {
+		return false;
+	}
+	const char *p = record.data();
+	const char *end = p + record.size();
+	uint32_t dims;
+	memcpy(&dims, p, sizeof(dims));
+	p += sizeof(dims);
+	if ((size_t)(end - p) != dims * sizeof(uint32_t) + sizeof(int32_t) + sizeof(double) + sizeof(uint8_t)) {
+		return false;
+	}
+	ids.resize(dims);
+	for (uint32_t dim = 0; dim < dims; dim++, p += sizeof(uint32_t)) {
+		uint32_t u;
+		memcpy(&u, p, sizeof(u));
+		ids[dim] = u;
+	}
+	int32_t mode;
+	memcpy(&mode, p, sizeof(mode));
+	memcpy(&value, p + sizeof(mode), sizeof(value));
+	splashMode = (SplashMode)mode;
+	addValue = p[sizeof(mode) + sizeof(value)] != 0;
+	return true;
+}
+
+bool Cube::readJournalCell(CPDatabase db, JournalFileReader &history, IdentifiersType &ids, double &value, bool &addValue) const
+{
+	// markers, locked cells and GPU storages need the whole setCellValue
+	if ((getType() != NORMALTYPE && getType() != USER_INFOTYPE) || !fromMarkers.empty() || history.getVersion().isUnknown() || history.getVersion().isOld()) {
+		return false;
+	}
+	try {
+		const string &command = history.getDataString(3);
+		if (command == JournalFileReader::JOURNAL_CELL_REPLACE_DOUBLE) {
+			PPaths lockedPaths = history.getDataPaths(8);
+			if (lockedPaths && !lockedPaths->empty()) {
+				return false;
+			}
+			ids = history.getDataIdentifiers(4);
+			value = history.getDataDouble(6);
+			addValue = history.getDataBool(7, false);
+		} else if (command == JournalFileReader::JOURNAL_RECORD) {
+			SplashMode splashMode;
+			if (!decodeCellRecord(history, ids, splashMode, value, addValue)) {
+				return false;
+			}
+		} else {
+			return false;
+		}
+
+		// only numeric base cells, same as CubeArea::getType without the context
+		if (ids.size() != dimensions.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < dimensions.size(); i++) {
+			CPDimension dimension = db->lookupDimension(dimensions[i], false);
+			if (!dimension) {
+				return false;
+			}
+			if (dimension->getDimensionType() == Dimension::VIRTUAL) {
+				continue;
+			}
+			Element *element = dimension->lookupElement(ids[i], false);
+			if (!element || element->getElementType() != Element::NUMERIC || element->isStringConsolidation()) {
+				return false;
+			}
+		}
+	} catch (const ErrorException &) {
+		// replayed and reported by processJournalCommand
+		return false;
+	}
+	return true;
+}
+
+PStorageBase Cube::beginJournalCells(bool addValue)
+{
+	checkCheckedOut();
+	if (!fromMarkers.empty()) {
+		// marker rules created after the cells were read
+		return PStorageBase();
+	}
+	if (addValue != additiveCommit) {
+		commitChangesIntern(true, PUser(), false);
+	}
+	additiveCommit = addValue;
+	cellsStatus = CHANGED;
+	updateClientCacheToken();
+
+	PEngineBase engineCpu = Context::getContext()->getServerCopy()->getEngine(EngineBase::CPU, true);
+	return engineCpu->getCreateStorage(numericStorageId, pathTranslator, EngineBase::Numeric);
+}
+
 void Cube::processCubeJournal(PServer server, PDatabase db)
 {
 	boost::shared_ptr<JournalFileReader> history = initJournalProcess();
@@ -868,6 +1017,7 @@ void Cube::loadCubeIntern(PServer server, PDatabase db, bool processJournal, boo
 	}
 
 	updateClientCacheToken();
+	waitForCompaction();
 
 	{
 		WriteLocker wl(filelock->getLock());
@@ -939,11 +1089,13 @@ void Cube::loadFromFile(PServer server, PDatabase db, bool loadCells, bool check
 
 	timeval tv;
 	bool err = false;
+	delta->valid = false;
 	if (binary) {
 		uint32_t ver;
 		uint32_t endianness;
+		uint32_t deltaSeq = 0;
 
-		if (loadCubeOverview(fr.get(), tv, ver, endianness)) {
+		if (loadCubeOverview(fr.get(), tv, ver, endianness, deltaSeq)) {
 			if (!ver || ver > CUBE_FILE_VERSION) {
 				Logger::error << "unknown file version of cube '" << getName() << "'" << endl;
 				err = true;
@@ -969,12 +1121,15 @@ void Cube::loadFromFile(PServer server, PDatabase db, bool loadCells, bool check
 						Logger::error << "invalid section in cube '" << getName() << "'" << endl;
 					}
 					err = true;
+				} else {
+					loadCubeDeltas(server, deltaSeq);
 				}
 			} else {
 				Logger::error << "section line not found for cube '" << getName() << "'" << endl;
 				err = true;
 			}
 		}
+		preloaded.reset();
 		if (err) {
 			FileName fn(*fileName, CSV);
 			fr.reset(FileReader::getFileReader(fn));
@@ -1002,7 +1157,128 @@ void Cube::loadFromFile(PServer server, PDatabase db, bool loadCells, bool check
 	}
 }
 
-void Cube::saveCubeOverview(FileWriter *file, PServer server, PDatabase db, timeval &tv, bool binary)
+class CubePreloadJob : public ThreadPoolJob {
+public:
+	CubePreloadJob(ThreadPool::ThreadGroup &tg, PCube cube, const FileName &fileName, uint32_t endian, Semaphore &slots)
+	: ThreadPoolJob(tg), cube(cube), fileName(fileName), endian(endian), slots(slots) {}
+private:
+	virtual void operator()();
+
+	PCube cube;
+	FileName fileName;
+	uint32_t endian;
+	Semaphore &slots;
+};
+
+void CubePreloadJob::operator()()
+{
+	SemaphoreReleaser sr(slots);
+	try {
+		cube->preloadCubeCells(fileName, endian);
+	} catch (const ErrorException &e) {
+		Logger::warning << "cannot read cells of cube '" << cube->getName() << "' in parallel: " << e.getMessage() << endl;
+	} catch (const std::exception &e) {
+		Logger::warning << "cannot read cells of cube '" << cube->getName() << "' in parallel: " << e.what() << endl;
+	}
+}
+
+void Cube::preloadCells(PServer server, const vector<PCube> &cubes, const vector<FileName> &fileNames)
+{
+	PThreadPool tp = server->getThreadPool();
+	size_t threads = loadThreads ? loadThreads : tp->getCoreCount();
+	if (ignoreCellData || threads < 2 || cubes.size() < 2) {
+		return;
+	}
+
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+	uint32_t endian = server->isBigEndian() ? bigEndian : littleEndian;
+	Semaphore slots;
+	slots.set(threads);
+	ThreadPool::ThreadGroup tg = tp->createThreadGroup();
+	size_t count = 0;
+
+	for (size_t i = 0; i < cubes.size(); i++) {
+		ItemType type = cubes[i]->getType();
+		if ((type != NORMALTYPE && type != GPUTYPE && type != USER_INFOTYPE) || !FileUtils::isReadable(FileName(fileNames[i], BIN))) {
+			continue;
+		}
+		// at most 'threads' files are open at the same time
+		slots.wait();
+		tp->addJob(PThreadPoolJob(new CubePreloadJob(tg, cubes[i], fileNames[i], endian, slots)));
+		count++;
+	}
+	tp->join(tg);
+
+	if (count) {
+		size_t dur = (size_t)(boost::posix_time::microsec_clock::local_time() - start).total_milliseconds();
+		Logger::info << "read cells of " << count << " cubes with " << threads << " threads in " << dur << " ms" << endl;
+	}
+}
+
+void Cube::preloadCubeCells(const FileName &cubeFileName, uint32_t endian)
+{
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+	boost::shared_ptr<FileReader> fr(FileReader::getFileReader(FileName(cubeFileName, BIN)));
+	if (!fr->openFile(false, true)) {
+		return;
+	}
+
+	timeval tv;
+	uint32_t ver;
+	uint32_t endianness;
+	uint32_t deltaSeq;
+	if (!loadCubeOverview(fr.get(), tv, ver, endianness, deltaSeq) || !ver || ver > CUBE_FILE_VERSION || endianness != endian) {
+		return;
+	}
+
+	// alias sections are checked against the dimensions by loadCubeCells
+	while (!fr->isEndOfFile() && !(fr->isSectionLine() && fr->getSection() == NUMERIC_SECTION)) {
+		fr->nextLine();
+	}
+	if (fr->isEndOfFile()) {
+		return;
+	}
+
+	boost::shared_ptr<PreloadedCells> cells(new PreloadedCells());
+	cells->numericPos = fr->getRawPosition();
+	if (cells->numericPos < 0) {
+		return; // encrypted file, offsets are not known
+	}
+	StorageCpu *numeric = new StorageCpu(pathTranslator, true);
+	cells->numeric.reset(numeric);
+	numeric->load(fr.get(), ver);
+	cells->numericEnd = fr->getRawPosition();
+
+	fr->nextLine();
+	if (fr->isSectionLine() && fr->getSection() == STRING_SECTION) {
+		cells->stringPos = fr->getRawPosition();
+		StringStorageCpu *strings = new StringStorageCpu(pathTranslator);
+		cells->strings.reset(strings);
+		strings->load(fr.get(), ver);
+		cells->stringEnd = fr->getRawPosition();
+	}
+	preloaded = cells;
+
+	size_t dur = (size_t)(boost::posix_time::microsec_clock::local_time() - start).total_milliseconds();
+	Logger::info << "read cells of cube '" << getName() << "' in " << dur << " ms" << endl;
+}
+
+bool Cube::takePreloaded(FileReader *fr, StorageCpu *st, bool numeric)
+{
+	if (!preloaded) {
+		return false;
+	}
+	PStorageBase loaded = numeric ? preloaded->numeric : preloaded->strings;
+	int64_t pos = numeric ? preloaded->numericPos : preloaded->stringPos;
+	int64_t end = numeric ? preloaded->numericEnd : preloaded->stringEnd;
+	if (!loaded || fr->getRawPosition() != pos || !fr->setRawPosition(end)) {
+		return false;
+	}
+	st->assignLoaded(*dynamic_cast<StorageCpu *>(loaded.get()));
+	return true;
+}
+
+void Cube::saveCubeOverview(FileWriter *file, PServer server, PDatabase db, timeval &tv, bool binary, uint32_t fileVersion)
 {
 	if (!binary) {
 		file->appendComment("PALO CUBE DATA");
@@ -1015,9 +1291,11 @@ void Cube::saveCubeOverview(FileWriter *file, PServer server, PDatabase db, time
 	file->appendTimeStamp(tv);
 	if (binary) {
 		//file version
-		file->appendInteger(CUBE_FILE_VERSION);
+		file->appendInteger(fileVersion);
 		//endianness
 		file->appendInteger(server->isBigEndian() ? bigEndian : littleEndian);
+		//last delta contained
+		file->appendInteger(delta->seq);
 	} else {
 		vector<int32_t> sizes;
 		for (IdentifiersType::iterator it = dimensions.begin(); it != dimensions.end(); ++it) {
@@ -1029,7 +1307,7 @@ void Cube::saveCubeOverview(FileWriter *file, PServer server, PDatabase db, time
 	file->nextLine();
 }
 
-void Cube::saveCubeCells(FileWriter *file, PServer server, PDatabase db, bool checkAlias, bool binary)
+void Cube::saveCubeCells(FileWriter *file, PServer server, PDatabase db, bool checkAlias, bool binary, uint32_t fileVersion)
 {
 	CPCube thisCube = CONST_COMMITABLE_CAST(Cube, shared_from_this());
 	PCubeArea area(new CubeArea(db, thisCube, dimensions.size()));
@@ -1079,7 +1357,7 @@ void Cube::saveCubeCells(FileWriter *file, PServer server, PDatabase db, bool ch
 	if (binary) {
 		PEngineBase engine = server->getEngine();
 		StorageCpu *st = dynamic_cast<StorageCpu *>(engine->getStorage(numericStorageId).get());
-		st->save(file);
+		st->save(file, fileVersion);
 		file->nextLine();
 	} else {
 		int32_t valuesCounter = 0;
@@ -1115,7 +1393,7 @@ void Cube::saveCubeCells(FileWriter *file, PServer server, PDatabase db, bool ch
 	if (binary) {
 		PEngineBase engine = server->getEngine();
 		StorageCpu *st = dynamic_cast<StorageCpu *>(engine->getStorage(stringStorageId).get());
-		st->save(file);
+		st->save(file, fileVersion);
 		file->nextLine();
 	} else {
 		PCellStream cs = calculateArea(area, CubeArea::BASE_STRING, NO_RULES, true, 0);
@@ -1164,7 +1442,6 @@ void Cube::saveCubeIntern(PServer server, PDatabase db, bool checkIgnore, bool c
 	}
 
 	if (cellsStatus == CHANGED) {
-		WriteLocker wl(filelock->getLock());
 		bool saveCells = true;
 		if (checkIgnore) {
 			saveCells = checkIgnore ? !ignoreCellData && (getType() == GPUTYPE || getType() == NORMALTYPE || getType() == USER_INFOTYPE) : true;
@@ -1173,13 +1450,18 @@ void Cube::saveCubeIntern(PServer server, PDatabase db, bool checkIgnore, bool c
 			checkAlias = false;
 		}
 
-		bool hasBin = FileUtils::isReadable(FileName(*fileName, BIN)); // hasBin is false when the cube was loaded from CSV or it was just created, hasBin is true if a value in the existing cube was changed
-		bool hasCsv = FileUtils::isReadable(FileName(*fileName, CSV));
-		timeval tv;
-		gettimeofday(&tv, 0);
-		saveToFile(server, db, saveCells, checkAlias, tv, true);
-		if (hasBin || !hasCsv) { //don't save CSV if the cube was loaded from it
-			saveToFile(server, db, saveCells, checkAlias, tv, false);
+		if (!saveCells || !saveCubeDelta(server, db, checkAlias)) {
+			waitForCompaction();
+			WriteLocker wl(filelock->getLock());
+			bool hasBin = FileUtils::isReadable(FileName(*fileName, BIN)); // hasBin is false when the cube was loaded from CSV or it was just created, hasBin is true if a value in the existing cube was changed
+			bool hasCsv = FileUtils::isReadable(FileName(*fileName, CSV));
+			timeval tv;
+			gettimeofday(&tv, 0);
+			saveToFile(server, db, saveCells, checkAlias, tv, true);
+			if (hasBin || !hasCsv) { //don't save CSV if the cube was loaded from it
+				saveToFile(server, db, saveCells, checkAlias, tv, false);
+			}
+			resetDelta(server, saveCells && !hasAliasDimension(db, checkAlias));
 		}
 	}
 
@@ -1203,6 +1485,256 @@ void Cube::saveCubeIntern(PServer server, PDatabase db, bool checkIgnore, bool c
 	setStatus(LOADED);
 }
 
+class CubeCompactionJob : public ThreadPoolJob {
+public:
+	CubeCompactionJob(boost::shared_ptr<Cube::CubeDelta> delta, const string &cubeName, const FileName &fileName, PSharedMutex filelock, PStorageBase numeric, PStorageBase strings, uint32_t endian)
+	: ThreadPoolJob(delta->compaction), delta(delta), cubeName(cubeName), fileName(fileName), filelock(filelock), numeric(numeric), strings(strings), endian(endian),
+	  seq(delta->seq), basePages(delta->numeric.size() + delta->strings.size()) {}
+private:
+	virtual void operator()();
+
+	boost::shared_ptr<Cube::CubeDelta> delta;
+	string cubeName;
+	FileName fileName;
+	PSharedMutex filelock;
+	PStorageBase numeric;	// committed storages are not changed any more
+	PStorageBase strings;
+	uint32_t endian;
+	uint32_t seq;
+	size_t basePages;
+};
+
+void CubeCompactionJob::operator()()
+{
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+	FileName ftmp(fileName, Cube::BINTMP);
+	try {
+		timeval tv;
+		gettimeofday(&tv, 0);
+		boost::shared_ptr<FileWriter> fw(FileWriter::getFileWriter(ftmp));
+		fw->openFile();
+		fw->appendSection("CUBE");
+		fw->appendTimeStamp(tv);
+		fw->appendInteger(Cube::CUBE_FILE_VERSION);
+		fw->appendInteger(endian);
+		fw->appendInteger(seq);
+		fw->nextLine();
+		fw->appendSection(Cube::NUMERIC_SECTION);
+		dynamic_cast<StorageCpu *>(numeric.get())->save(fw.get(), Cube::CUBE_FILE_VERSION);
+		fw->nextLine();
+		fw->appendSection(Cube::STRING_SECTION);
+		dynamic_cast<StorageCpu *>(strings.get())->save(fw.get(), Cube::CUBE_FILE_VERSION);
+		fw->nextLine();
+		fw->closeFile();
+
+		WriteLocker wl(filelock->getLock());
+		FileUtils::remove(FileName(fileName, Cube::BIN));
+		if (!FileUtils::rename(ftmp, FileName(fileName, Cube::BIN))) {
+			Logger::error << "cannot rename compacted file of cube '" << cubeName << "'" << endl;
+			return;
+		}
+		if (delta->seq == seq) {
+			// no delta was appended meanwhile, older ones are skipped on load otherwise
+			FileUtils::remove(FileName(fileName, Cube::DELTA));
+			delta->deltaPages = 0;
+		}
+		delta->basePages = basePages;
+	} catch (const ErrorException &e) {
+		Logger::warning << "compaction of cube '" << cubeName << "' failed: " << e.getMessage() << endl;
+		FileUtils::remove(ftmp);
+		return;
+	}
+
+	size_t dur = (size_t)(boost::posix_time::microsec_clock::local_time() - start).total_milliseconds();
+	Logger::info << "compacted cube '" << cubeName << "' in " << dur << " ms" << endl;
+}
+
+bool Cube::hasAliasDimension(CPDatabase db, bool checkAlias) const
+{
+	if (checkAlias) {
+		for (size_t i = 0; i < dimensions.size(); i++) {
+			if (db->lookupDimension(dimensions[i], false)->getDimensionType() == Dimension::ALIAS) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool Cube::saveCubeDelta(PServer server, PDatabase db, bool checkAlias)
+{
+	// alias mappings and csv values are only written by full saves
+	if (!incrementalSave || saveCSV || !delta->valid || hasAliasDimension(db, checkAlias)) {
+		return false;
+	}
+
+	PEngineBase engine = server->getEngine();
+	PStorageBase numericStorage = engine->getStorage(numericStorageId);
+	PStorageBase stringStorage = engine->getStorage(stringStorageId);
+	StorageCpu *numeric = dynamic_cast<StorageCpu *>(numericStorage.get());
+	StorageCpu *strings = dynamic_cast<StorageCpu *>(stringStorage.get());
+	if (!numeric || !strings) {
+		return false;
+	}
+
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+	size_t written = 0;
+	{
+		WriteLocker wl(filelock->getLock());
+		try {
+			timeval tv;
+			gettimeofday(&tv, 0);
+			boost::shared_ptr<FileWriter> fw(FileWriter::getFileWriter(FileName(*fileName, DELTA)));
+			fw->openFile(true);
+			fw->appendSection(DELTA_SECTION);
+			fw->appendInteger(delta->seq + 1);
+			fw->appendTimeStamp(tv);
+			fw->nextLine();
+			fw->appendSection(NUMERIC_SECTION);
+			written = numeric->saveDelta(fw.get(), delta->numeric);
+			fw->nextLine();
+			fw->appendSection(STRING_SECTION);
+			written += strings->saveDelta(fw.get(), delta->strings);
+			fw->nextLine();
+			fw->appendSection(DELTA_END_SECTION);
+			fw->closeFile();
+		} catch (const ErrorException &e) {
+			// deltas appended after a broken one would not be loaded
+			Logger::warning << "cannot save delta of cube '" << getName() << "', saving the whole cube: " << e.getMessage() << endl;
+			delta->valid = false;
+			return false;
+		}
+
+		delta->seq++;
+		delta->deltaPages += written;
+		numeric->getCheckpoint(delta->numeric, false);
+		strings->getCheckpoint(delta->strings, false);
+	}
+
+	size_t dur = (size_t)(boost::posix_time::microsec_clock::local_time() - start).total_milliseconds();
+	Logger::info << "saved " << written << " changed pages of cube '" << getName() << "' in " << dur << " ms" << endl;
+
+	if (delta->deltaPages * COMPACTION_RATIO > delta->basePages && !numericStorage->isCheckedOut() && !stringStorage->isCheckedOut()) {
+		startCompaction(server, numericStorage, stringStorage);
+	}
+	return true;
+}
+
+void Cube::loadCubeDeltas(PServer server, uint32_t baseSeq)
+{
+	delta->seq = baseSeq;
+	delta->deltaPages = 0;
+
+	PEngineBase cpuEngine = server->getEngine(EngineBase::CPU, true);
+	PStorageBase numericStorage = cpuEngine->getCreateStorage(numericStorageId, pathTranslator, EngineBase::Numeric);
+	PStorageBase stringStorage = cpuEngine->getCreateStorage(stringStorageId, pathTranslator, EngineBase::String);
+	StorageCpu *numeric = dynamic_cast<StorageCpu *>(numericStorage.get());
+	StorageCpu *strings = dynamic_cast<StorageCpu *>(stringStorage.get());
+
+	bool complete = true;
+	FileName fn(*fileName, DELTA);
+	if (getType() != GPUTYPE && FileUtils::isReadable(fn)) {
+		boost::shared_ptr<FileReader> fr(FileReader::getFileReader(fn));
+		fr->openFile(true, false);
+
+		size_t applied = 0;
+		try {
+			while (fr->isSectionLine() && fr->getSection() == DELTA_SECTION) {
+				fr->nextLine();
+				uint32_t seq = (uint32_t)fr->getDataInteger(0);
+				bool apply = seq > delta->seq; // older deltas are contained in the BIN file
+				if (apply && seq != delta->seq + 1) {
+					throw FileFormatException("missing cube delta", fr.get());
+				}
+				fr->nextLine();
+
+				// a delta is applied completely or not at all
+				StorageCpu numericDelta(pathTranslator, true);
+				numericDelta.assignLoaded(*numeric);
+				StringStorageCpu stringDelta(pathTranslator);
+				stringDelta.assignLoaded(*strings);
+
+				size_t pages = 0;
+				if (!fr->isSectionLine() || fr->getSection() != NUMERIC_SECTION) {
+					throw FileFormatException("section 'NUMERIC' not found", fr.get());
+				}
+				pages += numericDelta.loadDelta(fr.get(), apply);
+				fr->nextLine();
+				if (!fr->isSectionLine() || fr->getSection() != STRING_SECTION) {
+					throw FileFormatException("section 'STRING' not found", fr.get());
+				}
+				pages += stringDelta.loadDelta(fr.get(), apply);
+				fr->nextLine();
+				if (!fr->isSectionLine() || fr->getSection() != DELTA_END_SECTION) {
+					throw FileFormatException("incomplete cube delta", fr.get());
+				}
+				fr->nextLine();
+
+				if (apply) {
+					numeric->assignLoaded(numericDelta);
+					strings->assignLoaded(stringDelta);
+					delta->seq = seq;
+					delta->deltaPages += pages;
+					applied++;
+				}
+			}
+		} catch (const ErrorException &e) {
+			Logger::warning << "delta file of cube '" << getName() << "' ends after delta " << delta->seq << ": " << e.getMessage() << endl;
+			complete = false;
+		}
+		if (applied) {
+			Logger::info << "applied " << applied << " deltas to cube '" << getName() << "'" << endl;
+		}
+	}
+
+	// deltas appended to a broken file would not be loaded, the next save rewrites the cube
+	delta->valid = complete && incrementalSave && getType() != GPUTYPE;
+	if (delta->valid) {
+		numeric->getCheckpoint(delta->numeric, true);
+		strings->getCheckpoint(delta->strings, true);
+		delta->basePages = delta->numeric.size() + delta->strings.size();
+	}
+}
+
+void Cube::resetDelta(PServer server, bool valid)
+{
+	// the BIN file contains all deltas now
+	if (FileUtils::isReadable(FileName(*fileName, DELTA))) {
+		FileUtils::remove(FileName(*fileName, DELTA));
+	}
+	delta->deltaPages = 0;
+	delta->valid = valid && incrementalSave && getType() != GPUTYPE;
+	if (delta->valid) {
+		PEngineBase engine = server->getEngine();
+		StorageCpu *numeric = dynamic_cast<StorageCpu *>(engine->getStorage(numericStorageId).get());
+		StorageCpu *strings = dynamic_cast<StorageCpu *>(engine->getStorage(stringStorageId).get());
+		numeric->getCheckpoint(delta->numeric, false);
+		strings->getCheckpoint(delta->strings, false);
+		delta->basePages = delta->numeric.size() + delta->strings.size();
+	} else {
+		delta->numeric.clear();
+		delta->strings.clear();
+	}
+}
+
+void Cube::startCompaction(PServer server, PStorageBase numeric, PStorageBase strings)
+{
+	if (delta->compaction && delta->compaction->count) {
+		return; // still running
+	}
+	delta->pool = server->getThreadPool();
+	delta->compaction = delta->pool->createThreadGroup(true);
+	uint32_t endian = server->isBigEndian() ? bigEndian : littleEndian;
+	delta->pool->addJob(PThreadPoolJob(new CubeCompactionJob(delta, getName(), *fileName, filelock, numeric, strings, endian)));
+}
+
+void Cube::waitForCompaction()
+{
+	if (delta->compaction) {
+		delta->pool->join(delta->compaction, false);
+	}
+}
+
 void Cube::saveToFile(PServer server, PDatabase db, bool saveCells, bool checkAlias, timeval &tv, bool binary)
 {
 	FileName ftmp(*fileName, binary ? BINTMP : CSVTMP);
@@ -1212,10 +1744,11 @@ void Cube::saveToFile(PServer server, PDatabase db, bool saveCells, bool checkAl
 	boost::shared_ptr<FileWriter> fw(FileWriter::getFileWriter(ftmp));
 	fw->openFile();
 
-	saveCubeOverview(fw.get(), server, db, tv, binary);
+	uint32_t fileVersion = getSaveFileVersion();
+	saveCubeOverview(fw.get(), server, db, tv, binary, fileVersion);
 
 	if (saveCells) {
-		saveCubeCells(fw.get(), server, db, checkAlias, binary);
+		saveCubeCells(fw.get(), server, db, checkAlias, binary, fileVersion);
 	}
 
 	if (!binary) {
@@ -1297,6 +1830,11 @@ void Cube::setCubeFileAndLoad(PServer server, PDatabase db, const FileName& file
 
 void Cube::deleteCubeFiles()
 {
+	waitForCompaction();
+	if (FileUtils::isReadable(FileName(*fileName, DELTA))) {
+		FileUtils::remove(FileName(*fileName, DELTA));
+	}
+
 	// delete cube file from disk
 	if (FileUtils::isReadable(FileName(*fileName, BIN))) {
 		FileWriter::deleteFile(FileName(*fileName, BIN));
@@ -1500,6 +2038,37 @@ size_t Cube::sizeFilledMarkerCells() const
 	return values;
 }
 
+uint32_t Cube::getSaveFileVersion() const
+{
+	// deltas, mapped and columnar pages need version 3, otherwise older servers can read the file
+	if (incrementalSave || StorageCpu::getMapPages() || hasColumnarPages()) {
+		return CUBE_FILE_VERSION;
+	}
+	return CUBE_FILE_VERSION_COMPATIBLE;
+}
+
+bool Cube::hasColumnarPages() const
+{
+	if (numericStorageId != NO_IDENTIFIER) {
+		PEngineBase engine = Context::getContext()->getServer()->getEngine();
+		StorageCpu *st = dynamic_cast<StorageCpu *>(engine->getStorage(numericStorageId).get());
+		return st && st->getPageFormat() == StorageCpu::COLUMNAR_PAGES;
+	}
+	return false;
+}
+
+void Cube::setColumnarPages(PServer server, bool columnar)
+{
+	checkCheckedOut();
+	PEngineBase engine = server->getEngine(EngineBase::CPU, true);
+	StorageCpu *st = dynamic_cast<StorageCpu *>(engine->getCreateStorage(numericStorageId, pathTranslator, EngineBase::Numeric).get());
+	StorageCpu::PageFormat format = columnar ? StorageCpu::COLUMNAR_PAGES : StorageCpu::INSTRUCTION_PAGES;
+	if (st && st->getPageFormat() != format) {
+		st->setPageFormat(format);
+		cellsStatus = CHANGED;
+	}
+}
+
 void Cube::clearCells(PServer server, PDatabase db, PUser user, bool useJournal)
 {
 	checkCheckedOut();
@@ -2353,16 +2922,33 @@ ResultStatus Cube::setCellValue(PServer server, PDatabase db, PCubeArea spCellPa
 			journal->appendIdentifiers((*it).begin(), (*it).end());
 			journal->appendEscapeString(value);
 		} else {
-			journal->appendCommand(server->getUsername(user), server->getEvent(), JournalFileReader::JOURNAL_CELL_REPLACE_DOUBLE);
-			journal->appendIdentifiers((*it).begin(), (*it).end());
-			journal->appendInteger(splashMode);
-			if (addValue && (splashMode == DISABLED || splashMode == DEFAULT)) {
-				journal->appendDouble(origValue.getNumeric());
+			double journalValue = addValue && (splashMode == DISABLED || splashMode == DEFAULT) ? origValue.getNumeric() : value.getNumeric();
+			CPPaths lockedPaths = lockedCells ? lockedCells->getLockedPaths() : CPPaths();
+			if (JournalFile::isBinaryRecords() && (!lockedPaths || lockedPaths->empty())) {
+				// uint32 dimensions, uint32 ids, int32 splash mode, double value, uint8 add
+				const IdentifiersType &ids = *it;
+				uint32_t dims = (uint32_t)ids.size();
+				int32_t mode = splashMode;
+				uint8_t add = addValue ? 1 : 0;
+				string payload;
+				payload.reserve(sizeof(dims) + dims * sizeof(uint32_t) + sizeof(mode) + sizeof(journalValue) + sizeof(add));
+				payload.append((const char *)&dims, sizeof(dims));
+				for (IdentifiersType::const_iterator id = ids.begin(); id != ids.end(); ++id) {
+					uint32_t u = *id;
+					payload.append((const char *)&u, sizeof(u));
+				}
+				payload.append((const char *)&mode, sizeof(mode));
+				payload.append((const char *)&journalValue, sizeof(journalValue));
+				payload.append((const char *)&add, sizeof(add));
+				journal->appendRecord(server->getUsername(user), server->getEvent(), JournalFileReader::RECORD_CELL_REPLACE_DOUBLE, payload);
 			} else {
-				journal->appendDouble(value.getNumeric());
+				journal->appendCommand(server->getUsername(user), server->getEvent(), JournalFileReader::JOURNAL_CELL_REPLACE_DOUBLE);
+				journal->appendIdentifiers((*it).begin(), (*it).end());
+				journal->appendInteger(splashMode);
+				journal->appendDouble(journalValue);
+				journal->appendBool(addValue);
+				journal->appendPaths(lockedPaths);
 			}
-			journal->appendBool(addValue);
-			journal->appendPaths(lockedCells ? lockedCells->getLockedPaths() : CPPaths());
 		}
 		journal->nextLine();
 	}
@@ -2703,7 +3289,38 @@ PProcessorBase Cube::evaluatePlan(PPlanNode plan, EngineBase::Type engineType, b
 
 PCellStream Cube::calculateArea(PCubeArea area, CubeArea::CellType type, RulesType paramRulesType, bool skipEmpty, uint64_t blockSize) const
 {
-	PPlanNode plan = createPlan(area, type, paramRulesType, skipEmpty, blockSize);
+	PPlanNode plan;
+	PlanCache::Signature signature;
+	bool usePlanCache = false;
+	uint64_t cacheRevision = cache.getRevision();
+	if (!isCheckedOut()) {
+		// committed cube doesn't change, only dimensions can
+		CPDatabase db = CONST_COMMITABLE_CAST(Database, Context::getContext()->getParent(shared_from_this()));
+		if (db) {
+			PlanCache::Signature prefix;
+			prefix.push_back(db->getToken());
+			prefix.push_back(token);
+			prefix.push_back(rules ? rules->getObjectRevision() : 0);
+			prefix.push_back(type);
+			prefix.push_back(paramRulesType);
+			prefix.push_back(skipEmpty);
+			prefix.push_back(blockSize);
+			usePlanCache = PlanCache::createSignature(*area, prefix, signature);
+		}
+	}
+	if (usePlanCache) {
+		plan = getPlanCache()->find(signature, cacheRevision);
+	}
+	if (!plan) {
+		if (usePlanCache) {
+			// cached plan outlives the request, keep it off the request's arena
+			ContextArena::HeapScope heapScope;
+			plan = createPlan(area, type, paramRulesType, skipEmpty, blockSize);
+			getPlanCache()->insert(signature, plan, cacheRevision);
+		} else {
+			plan = createPlan(area, type, paramRulesType, skipEmpty, blockSize);
+		}
+	}
 	PCellStream result;
 	if (plan) {
 		result = evaluatePlan(plan, EngineBase::ANY, blockSize != UNLIMITED_UNSORTED_PLAN);
@@ -3930,6 +4547,9 @@ bool Cube::merge(const CPCommitable &o, const PCommitable &p)
 			rule->onCubeChange(db, cube);
 		}
 	}
+	if (ret && cube != 0) {
+		context->addSupersededCube(cube);
+	}
 	if (ret) {
 		commitintern();
 	}
@@ -49,6 +49,7 @@
 #include "Engine/EngineBase.h"
 #include "Engine/Streams.h"
 #include "Engine/Cache.h"
+#include "Engine/PlanCache.h"
 
 namespace palo {
 class PaloSession;
@@ -151,6 +152,24 @@ public:
 
 	static void setSaveCSV(bool save);
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief sets the number of cube files read in parallel on load, 0 for all cores
+	////////////////////////////////////////////////////////////////////////////////
+	static void setLoadThreads(size_t threads);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief saves only changed storage pages to a delta file appended on save
+	////////////////////////////////////////////////////////////////////////////////
+	static void setIncrementalSave(bool incremental);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief reads the binary cell data of cubes in parallel before they are loaded
+	///
+	/// Only the storages are read by the thread pool, the following loadCube
+	/// takes them over if the file was not changed meanwhile.
+	////////////////////////////////////////////////////////////////////////////////
+	static void preloadCells(PServer server, const vector<PCube> &cubes, const vector<FileName> &fileNames);
+
 public:
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -419,6 +438,18 @@ public:
 
 	size_t sizeFilledMarkerCells() const;
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief returns true if numeric cells are read from columnar pages
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool hasColumnarPages() const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief switches page format of numeric cells, stored with next cube save
+	////////////////////////////////////////////////////////////////////////////////
+
+	void setColumnarPages(PServer server, bool columnar);
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// @}
 	////////////////////////////////////////////////////////////////////////////////
@@ -664,13 +695,37 @@ public:
 	enum InBulkEnum { Not, First, In };
 	boost::shared_ptr<JournalFileReader> initJournalProcess();
 	void processJournalCommand(PServer server, PDatabase db, CPCube thisCube, JournalFileReader &journalReader, InBulkEnum &replaceBulkState, set<PCube> &changedCubes);
+	void replayCellReplace(PServer server, PDatabase db, CPCube thisCube, const IdentifiersType &ids, SplashMode splashMode, double value, bool addValue, PLockedCells lockedCells, InBulkEnum &replaceBulkState, set<PCube> &changedCubes);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief reads the current journal line if it sets a numeric base cell
+	///
+	/// Returns false for any other command and for cells which need the whole
+	/// setCellValue (markers, locked cells). Does not use the context, journals
+	/// of different cubes can be read in parallel.
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool readJournalCell(CPDatabase db, JournalFileReader &history, IdentifiersType &ids, double &value, bool &addValue) const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief prepares the numeric storage for cells read by readJournalCell
+	///
+	/// The returned storage takes the cells of this cube only, it can be
+	/// filled in parallel to the storages of other cubes. Returns 0 if the
+	/// cells have to be replayed by replayCellReplace.
+	////////////////////////////////////////////////////////////////////////////////
+
+	PStorageBase beginJournalCells(bool addValue);
+
+private:
+	static bool decodeCellRecord(const JournalFileReader &history, IdentifiersType &ids, SplashMode &splashMode, double &value, bool &addValue);
 
 protected:
 
 	bool loadCubeCells(FileReader *fr, PDatabase db, bool checkAlias, bool binary, bool &diffAlias, uint32_t fileversion);
 
 	//load of bin file
-	bool loadCubeOverview(FileReader *file, timeval &tv, uint32_t &file_version, uint32_t &endianness);
+	bool loadCubeOverview(FileReader *file, timeval &tv, uint32_t &file_version, uint32_t &endianness, uint32_t &deltaSeq);
 	//load of csv file
 	void loadCubeOverview(FileReader *file, timeval &tv);
 
@@ -680,9 +735,15 @@ protected:
 
 	void loadCubeRules(PServer server, PDatabase db);
 
-	void saveCubeOverview(FileWriter *file, PServer server, PDatabase db, timeval &tv, bool binary);
+	void saveCubeOverview(FileWriter *file, PServer server, PDatabase db, timeval &tv, bool binary, uint32_t fileVersion);
 
-	void saveCubeCells(FileWriter *file, PServer server, PDatabase db, bool checkAlias, bool binary);
+	void saveCubeCells(FileWriter *file, PServer server, PDatabase db, bool checkAlias, bool binary, uint32_t fileVersion);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief returns the oldest binary file version able to hold the cube
+	////////////////////////////////////////////////////////////////////////////////
+
+	uint32_t getSaveFileVersion() const;
 
 	void saveCubeRule(FileWriter* file, CPRule rule, CPDatabase db);
 
@@ -693,15 +754,42 @@ protected:
 
 private:
 	static const uint32_t CUBE_FILE_VERSION;
+	static const uint32_t CUBE_FILE_VERSION_COMPATIBLE;
 	static const string CSV;
 	static const string BIN;
 	static const string CSVTMP;
 	static const string BINTMP;
+	static const string DELTA;
+	static const string DELTA_SECTION;
+	static const string DELTA_END_SECTION;
+	static const size_t COMPACTION_RATIO;
 	static const int littleEndian;
 	static const int bigEndian;
 	static const uint32_t maxNewMarkerCount;
 	static const uint32_t markerRebuildLimit;
 
+	struct PreloadedCells {
+		PreloadedCells() : numericPos(-1), numericEnd(-1), stringPos(-1), stringEnd(-1) {}
+		int64_t numericPos;	// raw file offsets of the storages
+		int64_t numericEnd;
+		int64_t stringPos;
+		int64_t stringEnd;
+		PStorageBase numeric;
+		PStorageBase strings;
+	};
+	friend class CubePreloadJob;
+
+	struct CubeDelta;
+	friend class CubeCompactionJob;
+
+	void preloadCubeCells(const FileName &cubeFileName, uint32_t endian);
+	bool hasAliasDimension(CPDatabase db, bool checkAlias) const;
+	bool saveCubeDelta(PServer server, PDatabase db, bool checkAlias);
+	void loadCubeDeltas(PServer server, uint32_t baseSeq);
+	void resetDelta(PServer server, bool valid);
+	void startCompaction(PServer server, PStorageBase numeric, PStorageBase strings);
+	void waitForCompaction();
+	bool takePreloaded(FileReader *fr, StorageCpu *st, bool numeric);
 	void loadFromFile(PServer server, PDatabase db, bool loadCells, bool checkAlias, bool binary);
 	void saveToFile(PServer server, PDatabase db, bool saveCells, bool checkAlias, timeval &tv, bool binary);
 	bool isInArea(const Area *cellPath, string &areaIdentifier) const;
@@ -746,6 +834,8 @@ public:
 
 	ValueCache *getCache() const {return const_cast<ValueCache *>(&cache);}
 
+	PlanCache *getPlanCache() const {return const_cast<PlanCache *>(&planCache);}
+
 #ifdef ENABLE_GPU_SERVER
 	bool optimizeNumericStorage(PEngineBase engine);
 #endif
@@ -783,6 +873,13 @@ protected:
 
 	static bool ignoreCellData;
 
+	static size_t loadThreads;
+
+	static bool incrementalSave;
+
+	boost::shared_ptr<PreloadedCells> preloaded;
+	boost::shared_ptr<CubeDelta> delta;	// shared by all versions of the cube
+
 	bool hasLock;
 	PLockList locks;
 
@@ -800,6 +897,8 @@ protected:
 
 	ValueCache cache;
 
+	PlanCache planCache;
+
 	AsyncResults pendingWrites;
 	bool additiveCommit;
 
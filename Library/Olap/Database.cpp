@@ -35,6 +35,7 @@
 #include "Olap/Database.h"
 
 #include <algorithm>
+#include <deque>
 #include <iostream>
 
 #include "Exceptions/FileFormatException.h"
@@ -66,6 +67,7 @@
 #include "Olap/UserInfoDimension.h"
 #include "Olap/UserInfoDatabase.h"
 
+#include "Thread/ThreadPool.h"
 #include "Thread/WriteLocker.h"
 
 namespace palo {
@@ -247,10 +249,6 @@ PCube Database::loadDatabaseCube(PServer server, FileReader* file)
 	cube->setDeletable(deleteable);
 	cube->setRenamable(renamable);
 
-//	cout << name << endl;
-	// addCube to DB and load cell data
-	addCube(server, cube, false, false, NULL, NULL, NULL, false);
-
 	file->nextLine();
 
 	return cube;
@@ -288,8 +286,25 @@ void Database::loadDatabaseCubes(PServer server, FileReader *file)
 	if (file->isSectionLine() && file->getSection() == "CUBES") {
 		IdentifierType maxId = 0;
 		file->nextLine();
+		vector<PCube> loaded;
+		vector<FileName> fileNames;
 		while (file->isDataLine()) {
 			PCube cube = loadDatabaseCube(server, file);
+			loaded.push_back(cube);
+			fileNames.push_back(computeCubeFileName(*fileName, cube->getId()));
+		}
+
+		// cell data of all cubes is read in parallel, rules and journals are loaded serially by addCube
+		Cube::preloadCells(server, loaded, fileNames);
+
+		for (vector<PCube>::iterator it = loaded.begin(); it != loaded.end(); ++it) {
+			PCube cube = *it;
+			boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+			// addCube to DB and load cell data
+			addCube(server, cube, false, false, NULL, NULL, NULL, false);
+			size_t dur = (size_t)(boost::posix_time::microsec_clock::local_time() - start).total_milliseconds();
+			Logger::info << "loaded cube '" << cube->getName() << "' in " << dur << " ms" << endl;
+
 			if (cube->getStatus() == Cube::LOADED) {
 				cube->setStatus(Cube::UNLOADED); // cube journal to be processed later
 			}
@@ -829,6 +844,12 @@ void Database::loadDatabase(PServer server, bool addSystemDimension)
 	status = LOADED;
 }
 
+struct journalCell {
+	timeval tv;
+	IdentifiersType ids;
+	double value;
+};
+
 struct journalStruct {
 	timeval tv;
 	set<PCube> changedCubes;
@@ -836,8 +857,190 @@ struct journalStruct {
 	PCube pcube;
 	boost::shared_ptr<JournalFileReader> history;
 	Cube::InBulkEnum inBulk;
+	deque<journalCell> cells; // numeric base cells read ahead of history
+	bool addCells;
+	size_t applyCells; // cells of the current round
+	bool single; // current line of history is replayed by processJournalCommand
+};
+
+// numeric base cells read ahead of one cube journal
+static const size_t JOURNAL_CELLS_BATCH = 65536;
+
+static bool isBefore(const timeval &a, const timeval &b)
+{
+	return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_usec < b.tv_usec);
+}
+
+static void readTimeStamp(journalStruct &js)
+{
+	long int sec, usec;
+	js.history->getTimeStamp(&sec, &usec, 0);
+	js.tv.tv_sec = sec;
+	js.tv.tv_usec = usec;
+}
+
+static void readJournalCells(CPDatabase db, journalStruct &js, const timeval *limit)
+{
+	journalCell cell;
+	bool addValue;
+	while (js.cells.size() < JOURNAL_CELLS_BATCH && js.history->isDataLine()) {
+		readTimeStamp(js);
+		if (limit && isBefore(*limit, js.tv)) {
+			break;
+		}
+		if (!js.pcube->readJournalCell(db, *js.history, cell.ids, cell.value, addValue)) {
+			js.single = js.cells.empty();
+			break;
+		}
+		if (js.cells.empty()) {
+			js.addCells = addValue;
+		} else if (addValue != js.addCells) {
+			break;
+		}
+		cell.tv = js.tv;
+		js.cells.push_back(cell);
+		js.history->nextLine();
+	}
+	if (js.history->isDataLine()) {
+		readTimeStamp(js);
+	}
+}
+
+static void applyJournalCells(journalStruct &js, PStorageBase storage)
+{
+	StorageBase::OperationType opType = js.addCells ? StorageBase::ADD_ALL : StorageBase::SET;
+	for (size_t i = 0; i < js.applyCells; i++) {
+		const journalCell &cell = js.cells[i];
+		storage->setCellValue(PArea(new Area(cell.ids, false)), CellValue(cell.value), opType);
+	}
+}
+
+class JournalReadJob : public ThreadPoolJob {
+public:
+	JournalReadJob(ThreadPool::ThreadGroup &tg, CPDatabase db, journalStruct &js, const timeval *limit)
+	: ThreadPoolJob(tg), db(db), js(js), limit(limit) {}
+private:
+	virtual void operator()();
+
+	CPDatabase db;
+	journalStruct &js;
+	const timeval *limit;
+};
+
+void JournalReadJob::operator()()
+{
+	readJournalCells(db, js, limit);
+}
+
+class JournalApplyJob : public ThreadPoolJob {
+public:
+	JournalApplyJob(ThreadPool::ThreadGroup &tg, journalStruct &js, PStorageBase storage)
+	: ThreadPoolJob(tg), js(js), storage(storage) {}
+private:
+	virtual void operator()();
+
+	journalStruct &js;
+	PStorageBase storage;
 };
 
+void JournalApplyJob::operator()()
+{
+	applyJournalCells(js, storage);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief replays runs of numeric base cells of the cube journals
+///
+/// Each cube journal is read ahead up to the next database command, which may
+/// change the elements, and up to the first command of another kind. The cells
+/// before the earliest command left over are written to the storages of their
+/// cubes, one job per cube. The commands left over are replayed one by one in
+/// timestamp order. Returns the number of cells written.
+////////////////////////////////////////////////////////////////////////////////
+
+static size_t replayJournalCells(PServer server, PDatabase db, vector<journalStruct> &journals)
+{
+	const timeval *limit = 0;
+	for (vector<journalStruct>::iterator it = journals.begin(); it != journals.end(); ++it) {
+		if (!it->pcube) {
+			limit = &it->tv;
+		}
+	}
+
+	PThreadPool tp = server->getThreadPool();
+	vector<journalStruct *> reads;
+	for (vector<journalStruct>::iterator it = journals.begin(); it != journals.end(); ++it) {
+		if (it->pcube && it->cells.empty() && !it->single && it->history->isDataLine() && (!limit || !isBefore(*limit, it->tv))) {
+			const string &command = it->history->getDataString(3);
+			if (command == JournalFileReader::JOURNAL_CELL_REPLACE_DOUBLE || command == JournalFileReader::JOURNAL_RECORD) {
+				reads.push_back(&*it);
+			}
+		}
+	}
+	if (reads.size() == 1) {
+		readJournalCells(db, *reads[0], limit);
+	} else if (!reads.empty()) {
+		ThreadPool::ThreadGroup tg = tp->createThreadGroup();
+		for (vector<journalStruct *>::iterator it = reads.begin(); it != reads.end(); ++it) {
+			tp->addJob(PThreadPoolJob(new JournalReadJob(tg, db, **it, limit)));
+		}
+		tp->join(tg);
+	}
+
+	// cells up to the earliest command left over can be written
+	const timeval *until = 0;
+	for (vector<journalStruct>::iterator it = journals.begin(); it != journals.end(); ++it) {
+		if ((!it->pcube || it->history->isDataLine()) && (!until || isBefore(it->tv, *until))) {
+			until = &it->tv;
+		}
+	}
+
+	size_t count = 0;
+	vector<pair<journalStruct *, PStorageBase> > applies;
+	for (vector<journalStruct>::iterator it = journals.begin(); it != journals.end(); ++it) {
+		it->applyCells = 0;
+		while (it->applyCells < it->cells.size() && (!until || !isBefore(*until, it->cells[it->applyCells].tv))) {
+			it->applyCells++;
+		}
+		if (!it->applyCells) {
+			continue;
+		}
+		count += it->applyCells;
+		PStorageBase storage = it->pcube->beginJournalCells(it->addCells);
+		if (storage) {
+			applies.push_back(make_pair(&*it, storage));
+		} else {
+			for (size_t i = 0; i < it->applyCells; i++) {
+				const journalCell &cell = it->cells[i];
+				it->pcube->replayCellReplace(server, db, it->cpcube, cell.ids, DEFAULT, cell.value, it->addCells, PLockedCells(), it->inBulk, it->changedCubes);
+			}
+		}
+		if (it->inBulk == Cube::First) {
+			it->inBulk = Cube::In;
+		}
+	}
+	if (applies.size() == 1) {
+		applyJournalCells(*applies[0].first, applies[0].second);
+	} else if (!applies.empty()) {
+		ThreadPool::ThreadGroup tg = tp->createThreadGroup();
+		for (vector<pair<journalStruct *, PStorageBase> >::iterator it = applies.begin(); it != applies.end(); ++it) {
+			tp->addJob(PThreadPoolJob(new JournalApplyJob(tg, *it->first, it->second)));
+		}
+		tp->join(tg);
+	}
+
+	for (size_t i = journals.size(); i-- > 0;) {
+		journalStruct &js = journals[i];
+		js.cells.erase(js.cells.begin(), js.cells.begin() + js.applyCells);
+		if (js.pcube && js.cells.empty() && !js.history->isDataLine()) {
+			// nothing more in this journal
+			js.pcube->commitChanges(false, PUser(), js.changedCubes, false);
+			journals.erase(journals.begin() + i);
+		}
+	}
+	return count;
+}
+
 void Database::processJournalsChronologically(PServer server, FileReader *file, bool &dbChanged)
 {
 	Context::getContext()->setInJournal(true);
@@ -856,14 +1059,14 @@ void Database::processJournalsChronologically(PServer server, FileReader *file,
 
 			journalStruct js;
 			CPCube thisCube = CONST_COMMITABLE_CAST(Cube, cube->shared_from_this());
-			long int sec, usec;
-			history->getTimeStamp(&sec, &usec, 0);
-			js.tv.tv_sec = sec;
-			js.tv.tv_usec = usec;
 			js.cpcube = thisCube;
 			js.pcube = cube;
 			js.history = history;
 			js.inBulk = Cube::Not;
+			js.addCells = false;
+			js.applyCells = 0;
+			js.single = false;
+			readTimeStamp(js);
 			journals.push_back(js);
 		}
 	}
@@ -871,13 +1074,14 @@ void Database::processJournalsChronologically(PServer server, FileReader *file,
 	boost::shared_ptr<JournalFileReader> history = initJournalProcess();
 	if (history && history->isDataLine()) {
 		journalStruct js;
-		long int sec, usec;
-		history->getTimeStamp(&sec, &usec, 0);
-		js.tv.tv_sec = sec;
-		js.tv.tv_usec = usec;
 		js.cpcube = CPCube();
 		js.pcube = PCube();
 		js.history = history;
+		js.inBulk = Cube::Not;
+		js.addCells = false;
+		js.applyCells = 0;
+		js.single = false;
+		readTimeStamp(js);
 		journals.push_back(js);
 	}
 
@@ -885,19 +1089,27 @@ void Database::processJournalsChronologically(PServer server, FileReader *file,
 	vector<vector<string> > elementBulkCommands;
 	IdentifierType bulkDimId = NO_IDENTIFIER;
 
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+	size_t cells = 0;
+
 	if (!journals.empty()) {
 		Logger::info << "found non-empty journal(s) in database " << getName() << ", processing started" << endl;
 	}
 
 	while (!journals.empty()) { // while any journal contains commands
-		vector<journalStruct>::iterator min = journals.begin();
-		vector<journalStruct>::iterator it = min;
-		++it;
-		for (; it != journals.end(); ++it) {
-			if (it->tv.tv_sec < min->tv.tv_sec || (it->tv.tv_sec == min->tv.tv_sec && it->tv.tv_usec < min->tv.tv_usec)) {
+		// numeric base cells are written in batches, per cube in parallel
+		cells += replayJournalCells(server, db, journals);
+
+		vector<journalStruct>::iterator min = journals.end();
+		for (vector<journalStruct>::iterator it = journals.begin(); it != journals.end(); ++it) {
+			if (it->cells.empty() && (min == journals.end() || isBefore(it->tv, min->tv))) {
 				min = it;
 			}
 		}
+		if (min == journals.end()) {
+			continue;
+		}
+		min->single = false;
 
 		vector<PCube> newCubes;
 
@@ -912,10 +1124,7 @@ void Database::processJournalsChronologically(PServer server, FileReader *file,
 
 		min->history->nextLine();
 		if (min->history->isDataLine()) {
-			long int sec, usec;
-			min->history->getTimeStamp(&sec, &usec, 0);
-			min->tv.tv_sec = sec;
-			min->tv.tv_usec = usec;
+			readTimeStamp(*min);
 		} else {
 			// nothing more in this journal
 			if (min->pcube) { // not a database journal
@@ -935,18 +1144,23 @@ void Database::processJournalsChronologically(PServer server, FileReader *file,
 
 			journalStruct js;
 			CPCube thisCube = CONST_COMMITABLE_CAST(Cube, cube->shared_from_this());
-			long int sec, usec;
-			history->getTimeStamp(&sec, &usec, 0);
-			js.tv.tv_sec = sec;
-			js.tv.tv_usec = usec;
 			js.cpcube = thisCube;
 			js.pcube = cube;
 			js.history = history;
 			js.inBulk = Cube::Not;
+			js.addCells = false;
+			js.applyCells = 0;
+			js.single = false;
+			readTimeStamp(js);
 			journals.push_back(js);
 		}
 	}
 
+	if (cells) {
+		size_t dur = (size_t)(boost::posix_time::microsec_clock::local_time() - start).total_milliseconds();
+		Logger::info << "replayed journals of database " << getName() << " with " << cells << " cells written in batches in " << dur << " ms" << endl;
+	}
+
 	Context::getContext()->setInJournal(false);
 }
 
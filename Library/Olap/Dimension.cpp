@@ -793,7 +793,7 @@ ElementsType Dimension::getElements(PUser user, bool onlyRoot, uint64_t *hiddenC
 		result.reserve(totalElements);
 	}
 
-	User::ElemRightsMap *elemRights = 0;
+	const User::ElemRightsTable *elemRights = 0;
 	RightsType minRight = RIGHT_READ;
 	const IdentifiersType *userGroups = 0;
 
@@ -803,7 +803,7 @@ ElementsType Dimension::getElements(PUser user, bool onlyRoot, uint64_t *hiddenC
 			if (dimRights->maxRight < RIGHT_READ) {
 				return result;
 			}
-			elemRights = dimRights->elemRights.get();
+			elemRights = dimRights->elemTable.get();
 			minRight = dimRights->minRight;
 			userGroups = &user->getUserGroups();
 		}
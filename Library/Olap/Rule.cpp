@@ -31,6 +31,8 @@
 #include "Olap/Rule.h"
 #include "Olap/RuleMarker.h"
 #include "Engine/EngineBase.h"
+#include "Engine/Legacy/CompiledRule.h"
+#include "Thread/WriteLocker.h"
 
 #include "Exceptions/ParameterException.h"
 #include "Exceptions/DefragmentationException.h"
@@ -126,6 +128,7 @@ bool Rule::containsRestricted(const Area *cellPath) const
 bool Rule::setActive(bool isActive, PServer server, PDatabase db, PCube cube, string* errMsg)
 {
 	checkCheckedOut();
+	setCompiled(boost::shared_ptr<const paloLegacy::CompiledRule>());
 	if (isActive == false) {
 		if (activeRule && rule) {
 			definition = getTextRepresentation(db, cube);
@@ -228,6 +231,7 @@ void Rule::optimizeRule(CPDatabase db, CPCube cube)
 
 void Rule::onCubeChange(CPDatabase db, CPCube cube)
 {
+	setCompiled(boost::shared_ptr<const paloLegacy::CompiledRule>());
 	if (isActive()) {
 		optimizeRule(db, cube);
 		computeContains(db, cube);
@@ -499,6 +503,18 @@ Rule::Rule(const Rule &other) : Commitable(other)
 	custom = other.custom;
 }
 
+boost::shared_ptr<const paloLegacy::CompiledRule> Rule::getCompiled() const
+{
+	WriteLocker wl(&compiledLock);
+	return compiled;
+}
+
+void Rule::setCompiled(boost::shared_ptr<const paloLegacy::CompiledRule> compiled) const
+{
+	WriteLocker wl(&compiledLock);
+	this->compiled = compiled;
+}
+
 PCommitable Rule::copy() const
 {
 	checkNotCheckedOut();
@@ -34,9 +34,14 @@
 #include "palo.h"
 
 #include "Parser/RuleNode.h"
+#include "Thread/Mutex.h"
 
 #define SORT_RULES_BY_POSITION
 
+namespace paloLegacy {
+class CompiledRule;
+}
+
 namespace palo {
 class ExprNode;
 typedef boost::shared_ptr<ExprNode> PExprNode;
@@ -132,6 +137,7 @@ public:
 		rule = node;
 
 		resetCounter();
+		setCompiled(boost::shared_ptr<const paloLegacy::CompiledRule>());
 		if (rule) {
 			setDefinitionFromRuleNode(db, cube);
 		} else {
@@ -303,6 +309,18 @@ public:
 			ncthis.evalNullCounter++;
 		}
 	}
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief gets the threaded code of the rule, null if not translated yet
+	////////////////////////////////////////////////////////////////////////////////
+
+	boost::shared_ptr<const paloLegacy::CompiledRule> getCompiled() const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief keeps the threaded code until the definition changes
+	////////////////////////////////////////////////////////////////////////////////
+
+	void setCompiled(boost::shared_ptr<const paloLegacy::CompiledRule> compiled) const;
+
 	void getEvalCounters(uint64_t *pevalCounter, uint64_t *pevalNullCounter) const {
 		if (pevalCounter) {
 			*pevalCounter = evalCounter;
@@ -368,6 +386,9 @@ private:
 	uint64_t evalCounter;
 	uint64_t evalNullCounter;
 
+	mutable boost::shared_ptr<const paloLegacy::CompiledRule> compiled;
+	mutable Mutex compiledLock;
+
 	double position;
 	bool custom;
 
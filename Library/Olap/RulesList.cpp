@@ -29,14 +29,184 @@
 
 #include "Olap/RulesList.h"
 #include "Olap/Rule.h"
+#include "Engine/Area.h"
+#include "Thread/WriteLocker.h"
 
 namespace palo {
 
+RuleAreaIndex::RuleAreaIndex(const RuleList &rules) : words(0)
+{
+	vector<const Area *> areas;
+	for (CommitableList::ConstIterator iter = rules.const_begin(); iter != rules.const_end(); ++iter) {
+		CPRule rule = CONST_COMMITABLE_CAST(Rule, *iter);
+		areas.push_back(rule->isActive() ? rule->getDestinationArea() : 0);
+		ruleIds.push_back(rule->getId());
+	}
+	words = (areas.size() + 63) / 64;
+	active.resize(words, 0);
+
+	size_t dimCount = 0;
+	for (size_t i = 0; i < areas.size(); i++) {
+		if (areas[i]) {
+			setBit(&active[0], i);
+			dimCount = areas[i]->dimCount();
+		}
+	}
+	dims.resize(dimCount);
+
+	vector<pair<IdentifierType, IdentifierType> > ranges;
+	for (size_t d = 0; d < dimCount; d++) {
+		DimIndex &dim = dims[d];
+		dim.unrestricted.resize(words, 0);
+		for (size_t i = 0; i < areas.size(); i++) {
+			if (!areas[i]) {
+				continue;
+			}
+			if (getRanges(*areas[i], d, ranges)) {
+				for (vector<pair<IdentifierType, IdentifierType> >::const_iterator r = ranges.begin(); r != ranges.end(); ++r) {
+					dim.bounds.push_back(r->first);
+					if (r->second != numeric_limits<IdentifierType>::max()) {
+						dim.bounds.push_back(r->second + 1);
+					}
+				}
+			} else {
+				setBit(&dim.unrestricted[0], i);
+			}
+		}
+		sort(dim.bounds.begin(), dim.bounds.end());
+		dim.bounds.erase(unique(dim.bounds.begin(), dim.bounds.end()), dim.bounds.end());
+
+		dim.masks.resize(dim.bounds.size() * words, 0);
+		for (size_t i = 0; i < areas.size(); i++) {
+			if (!areas[i] || !getRanges(*areas[i], d, ranges)) {
+				continue;
+			}
+			for (vector<pair<IdentifierType, IdentifierType> >::const_iterator r = ranges.begin(); r != ranges.end(); ++r) {
+				size_t first = lower_bound(dim.bounds.begin(), dim.bounds.end(), r->first) - dim.bounds.begin();
+				size_t last = upper_bound(dim.bounds.begin(), dim.bounds.end(), r->second) - dim.bounds.begin();
+				for (size_t s = first; s < last; s++) {
+					setBit(&dim.masks[s * words], i);
+				}
+			}
+		}
+	}
+}
+
+void RuleAreaIndex::addCandidates(const Area &area, Mask &mask) const
+{
+	Mask result(active);
+	if (area.dimCount() == dims.size()) {
+		Mask dimMask(words);
+		vector<pair<IdentifierType, IdentifierType> > ranges;
+		for (size_t d = 0; d < dims.size(); d++) {
+			if (!getRanges(area, d, ranges)) {
+				continue;
+			}
+			const DimIndex &dim = dims[d];
+			dimMask = dim.unrestricted;
+			for (vector<pair<IdentifierType, IdentifierType> >::const_iterator r = ranges.begin(); r != ranges.end(); ++r) {
+				// segments starting after the range do not overlap it, the one before may
+				vector<IdentifierType>::const_iterator firstBound = upper_bound(dim.bounds.begin(), dim.bounds.end(), r->first);
+				if (firstBound != dim.bounds.begin()) {
+					--firstBound;
+				}
+				vector<IdentifierType>::const_iterator lastBound = upper_bound(firstBound, dim.bounds.end(), r->second);
+				for (size_t s = firstBound - dim.bounds.begin(); s < size_t(lastBound - dim.bounds.begin()); s++) {
+					const uint64_t *segment = &dim.masks[s * words];
+					for (size_t w = 0; w < words; w++) {
+						dimMask[w] |= segment[w];
+					}
+				}
+			}
+			bool any = false;
+			for (size_t w = 0; w < words; w++) {
+				result[w] &= dimMask[w];
+				any |= result[w] != 0;
+			}
+			if (!any) {
+				break;
+			}
+		}
+	}
+	mask.resize(words, 0);
+	for (size_t w = 0; w < words; w++) {
+		mask[w] |= result[w];
+	}
+}
+
+void RuleAreaIndex::addCandidates(const IdentifierType *path, Mask &mask) const
+{
+	Mask result(active);
+	for (size_t d = 0; d < dims.size(); d++) {
+		if (path[d] == NO_IDENTIFIER) {
+			continue;
+		}
+		const DimIndex &dim = dims[d];
+		const uint64_t *segment = 0;
+		vector<IdentifierType>::const_iterator bound = upper_bound(dim.bounds.begin(), dim.bounds.end(), path[d]);
+		if (bound != dim.bounds.begin()) {
+			segment = &dim.masks[(bound - dim.bounds.begin() - 1) * words];
+		}
+		bool any = false;
+		for (size_t w = 0; w < words; w++) {
+			result[w] &= dim.unrestricted[w] | (segment ? segment[w] : 0);
+			any |= result[w] != 0;
+		}
+		if (!any) {
+			break;
+		}
+	}
+	mask.resize(words, 0);
+	for (size_t w = 0; w < words; w++) {
+		mask[w] |= result[w];
+	}
+}
+
+size_t RuleAreaIndex::getPosition(IdentifierType ruleId) const
+{
+	IdentifiersType::const_iterator it = lower_bound(ruleIds.begin(), ruleIds.end(), ruleId);
+	if (it == ruleIds.end() || *it != ruleId) {
+		return NO_POSITION;
+	}
+	return it - ruleIds.begin();
+}
+
+bool RuleAreaIndex::getRanges(const Area &area, size_t dim, vector<pair<IdentifierType, IdentifierType> > &ranges)
+{
+	ranges.clear();
+	if (area.isSingleCell()) {
+		IdentifierType id = *area.elemBegin(dim);
+		ranges.push_back(make_pair(id, id));
+		return true;
+	}
+	CPSet set = area.getDim(dim);
+	if (!set || !set->size()) {
+		return false;
+	}
+	for (Set::range_iterator r = set->rangeBegin(); r != set->rangeEnd(); ++r) {
+		ranges.push_back(make_pair(r.low(), r.high()));
+	}
+	return true;
+}
+
 RuleList::RuleList(const RuleList& l) :
 	CommitableList(l)
 {
 }
 
+CPRuleAreaIndex RuleList::getAreaIndex() const
+{
+	if (isCheckedOut()) {
+		// rules of a list being changed may still change
+		return CPRuleAreaIndex(new RuleAreaIndex(*this));
+	}
+	WriteLocker wl(&areaIndexLock);
+	if (!areaIndex) {
+		areaIndex.reset(new RuleAreaIndex(*this));
+	}
+	return areaIndex;
+}
+
 PCommitableList RuleList::createnew(const CommitableList& l) const
 {
 	return PCommitableList(new RuleList(dynamic_cast<const RuleList&>(l)));
@@ -31,9 +31,91 @@
 #define OLAP_RULESLIST_H 1
 
 #include "Olap/CommitableList.h"
+#include "Thread/Mutex.h"
 
 namespace palo {
 
+class RuleList;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief index of the destination areas of active rules
+///
+/// Splits the element ids of every dimension into segments bounded by the
+/// destination ranges of the rules and stores a bit mask of covering rules
+/// per segment. Rules are identified by their position in the rule list.
+////////////////////////////////////////////////////////////////////////////////
+
+class SERVER_CLASS RuleAreaIndex {
+public:
+	typedef vector<uint64_t> Mask;
+
+	static const size_t NO_POSITION = (size_t)-1;
+
+	RuleAreaIndex(const RuleList &rules);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief adds the rules whose destination area may overlap the area to mask
+	////////////////////////////////////////////////////////////////////////////////
+
+	void addCandidates(const Area &area, Mask &mask) const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief adds the rules whose destination area may contain the cell to mask
+	///
+	/// A dimension with NO_IDENTIFIER in the path matches every rule.
+	////////////////////////////////////////////////////////////////////////////////
+
+	void addCandidates(const IdentifierType *path, Mask &mask) const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief returns the position of the rule in the masks or NO_POSITION
+	////////////////////////////////////////////////////////////////////////////////
+
+	size_t getPosition(IdentifierType ruleId) const;
+
+	static bool isCandidate(const Mask &mask, size_t position) {
+		return (mask[position / 64] >> (position % 64)) & 1;
+	}
+
+	// rules unknown to the index are kept
+	bool isCandidateRule(const Mask &mask, IdentifierType ruleId) const {
+		size_t position = getPosition(ruleId);
+		return position == NO_POSITION || isCandidate(mask, position);
+	}
+
+	static bool isEmpty(const Mask &mask) {
+		for (Mask::const_iterator it = mask.begin(); it != mask.end(); ++it) {
+			if (*it) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t getWords() const {
+		return words;
+	}
+
+private:
+	struct DimIndex {
+		vector<IdentifierType> bounds; // segment i starts at bounds[i] and ends before bounds[i + 1]
+		vector<uint64_t> masks; // words per segment
+		Mask unrestricted; // rules without destination elements in the dimension
+	};
+
+	static bool getRanges(const Area &area, size_t dim, vector<pair<IdentifierType, IdentifierType> > &ranges);
+	static void setBit(uint64_t *mask, size_t position) {
+		mask[position / 64] |= uint64_t(1) << (position % 64);
+	}
+
+	size_t words;
+	Mask active;
+	vector<DimIndex> dims;
+	IdentifiersType ruleIds; // sorted, rule list is ordered by id
+};
+
+typedef boost::shared_ptr<const RuleAreaIndex> CPRuleAreaIndex;
+
 class SERVER_CLASS RuleList : public CommitableList {
 public:
 	RuleList(const PIdHolder &newidh) : CommitableList(newidh, true) {}
@@ -42,6 +124,19 @@ public:
 	virtual PCommitableList createnew(const CommitableList& l) const;
 	bool hasActiveRule() const;
 	double highestPosition() const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief returns the destination area index of the rules
+	///
+	/// The index is kept with a committed list, every change of a rule or of its
+	/// activation works on a copy of the list that builds its own index.
+	////////////////////////////////////////////////////////////////////////////////
+
+	CPRuleAreaIndex getAreaIndex() const;
+
+private:
+	mutable CPRuleAreaIndex areaIndex;
+	mutable Mutex areaIndexLock;
 };
 
 }
@@ -85,6 +85,8 @@ PServer Server::readersserver;
 Mutex Server::readerslock;
 PServer Server::writersserver;
 Mutex Server::writerslock;
+uint64_t Server::commitSequence = 0;
+uint64_t Server::publishedSequence = 0;
 
 RightsType Server::defaultDbRight = RIGHT_DELETE;
 string Server::crossOrigin;
@@ -154,10 +156,14 @@ string LicIter::validateLics(string value)
 	return "";
 }
 
-void Server::invalidateCache(IdentifierType dbId, IdentifierType cubeId)
+void Server::invalidateCache(IdentifierType dbId, IdentifierType cubeId, CPArea changedArea)
 {
 	dbID_cubeID dbCubeId(dbId, cubeId);
 	Context::getContext()->clearQueryCache();
+	if (changedArea && dbId != NO_IDENTIFIER && cubeId != NO_IDENTIFIER) {
+		invalidateCacheArea(dbCubeId, changedArea);
+		return;
+	}
 	for (DatabaseList::Iterator dbit = dbs->begin(); dbit != dbs->end(); ++dbit) {
 		if (NULL == (*dbit)) {
 			continue;
@@ -185,6 +191,78 @@ void Server::invalidateCache(IdentifierType dbId, IdentifierType cubeId)
 	}
 }
 
+// changed cells with all cells whose value depends on them (base descendants and ancestors)
+static CPArea expandChangedArea(CPDatabase db, CPCube cube, const Area &area, bool descendants)
+{
+	const IdentifiersType *dimensions = cube->getDimensions();
+	PArea result(new Area(area.dimCount()));
+	for (size_t dim = 0; dim < area.dimCount(); dim++) {
+		CPDimension dimension = db->lookupDimension(dimensions->at(dim), false);
+		PSet elems(new Set());
+		for (Area::ConstElemIter it = area.elemBegin(dim); it != area.elemEnd(dim); ++it) {
+			elems->insert(*it);
+			if (descendants) {
+				Element *elem = dimension->lookupElement(*it, false);
+				if (elem && elem->getElementType() == Element::CONSOLIDATED) {
+					set<Element *> baseElements = dimension->getBaseElements(elem, 0);
+					for (set<Element *>::const_iterator bit = baseElements.begin(); bit != baseElements.end(); ++bit) {
+						elems->insert((*bit)->getIdentifier());
+					}
+				}
+			}
+		}
+		result->insert(dim, Set::addAncestors(elems, dimension));
+	}
+	return result;
+}
+
+void Server::invalidateCacheArea(const dbID_cubeID &dbCubeId, CPArea changedArea)
+{
+	PDatabase changedDb = lookupDatabase(dbCubeId.first, false);
+	PCube changedCube = changedDb ? changedDb->lookupCube(dbCubeId.second, false) : PCube();
+	if (!changedCube) {
+		return;
+	}
+	// values of the changed cube itself are always recalculated
+	changedCube->invalidateCache();
+
+	// cached areas removed from a cube are changes for cubes reading it
+	list<pair<dbID_cubeID, vector<CPArea> > > changes;
+	changes.push_back(make_pair(dbCubeId, vector<CPArea>(1, expandChangedArea(changedDb, changedCube, *changedArea, true))));
+	while (!changes.empty()) {
+		dbID_cubeID source = changes.front().first;
+		vector<CPArea> changed;
+		changed.swap(changes.front().second);
+		changes.pop_front();
+
+		for (DatabaseList::Iterator dbit = dbs->begin(); dbit != dbs->end(); ++dbit) {
+			if (NULL == (*dbit)) {
+				continue;
+			}
+			PDatabase db = COMMITABLE_CAST(Database, *dbit);
+			for (CubeList::Iterator cbit = db->cubes->begin(); cbit != db->cubes->end(); ++cbit) {
+				if (NULL == (*cbit)) {
+					continue;
+				}
+				PCube cube = COMMITABLE_CAST(Cube, *cbit);
+				ValueCache *cache = cube->getCache();
+				if (cube == changedCube || !cache || !cache->isDepending(source)) {
+					continue;
+				}
+				list<CPCubeArea> removed;
+				if (cache->invalidate(source, changed, removed)) {
+					Logger::debug << "Cache of cube: " << cube->getName() << " invalidated, areas removed: " << removed.size() << endl;
+					vector<CPArea> removedAreas;
+					for (list<CPCubeArea>::const_iterator it = removed.begin(); it != removed.end(); ++it) {
+						removedAreas.push_back(expandChangedArea(db, cube, **it, false));
+					}
+					changes.push_back(make_pair(dbID_cubeID(db->getId(), cube->getId()), removedAreas));
+				}
+			}
+		}
+	}
+}
+
 void Server::updateDatabaseDim(bool useDimWorker)
 {
 	systemDatabase->updateDatabaseDim(COMMITABLE_CAST(Server, shared_from_this()), useDimWorker);
@@ -1483,13 +1561,37 @@ bool Server::commit()
 	checkCheckedOut();
 	ret = Context::getContext()->makeCubeChanges(false, PServer());
 	if (!Context::getContext()->isWorker()) {
+		bool syncJournal = JournalSync::isSyncJournals();
+		uint64_t sequence = 0;
 		if (ret) {
 			WriteLocker wl(&writerslock);
 			ret = merge(writersserver, PCommitable());
 			if (ret) {
 				writersserver = COMMITABLE_CAST(Server, shared_from_this());
-				WriteLocker wl(&readerslock);
-				readersserver = writersserver;
+				sequence = ++commitSequence;
+				if (!syncJournal) {
+					WriteLocker wl(&readerslock);
+					readersserver = writersserver;
+					publishedSequence = sequence;
+				}
+			}
+		}
+		Context::getContext()->retireSupersededCubes(ret);
+		if (ret && syncJournal) {
+			// outside of the writers lock, so that concurrent commits are synced together,
+			// readers see the changes only when their journal is on disk
+			if (!Context::getContext()->syncJournals()) {
+				// the changes are the writers' version already, the next commit would publish
+				// them without a journal, so they would be lost by a restart
+				Logger::error << "cannot write journal to disk, stopping the server" << endl;
+				Logger::error << "please check the underlying file system for errors" << endl;
+				exit(1);
+			}
+			WriteLocker wl(&readerslock);
+			if (sequence > publishedSequence) {
+				// a later commit may have been synced and published already
+				readersserver = COMMITABLE_CAST(Server, shared_from_this());
+				publishedSequence = sequence;
 			}
 		}
 	}
@@ -387,7 +387,13 @@ public:
 	void ShutdownLoginWorker();
 	void ShutdownDimensionWorker();
 	void ShutdownGpuEngine(PUser user);
-	void invalidateCache(IdentifierType dbId = NO_IDENTIFIER, IdentifierType cubeId = NO_IDENTIFIER);
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief invalidates caches of the cube and of cubes depending on it
+	///
+	/// With changedArea only cached values calculated from the changed cells
+	/// are removed from the depending cubes.
+	////////////////////////////////////////////////////////////////////////////////
+	void invalidateCache(IdentifierType dbId = NO_IDENTIFIER, IdentifierType cubeId = NO_IDENTIFIER, CPArea changedArea = CPArea());
 	void updateDatabaseDim(bool useDimWorker);
 	void updateDatabaseDim(SystemDatabase::UpdateType type, const string &dbName, const string &dbOldName, PUser user, bool useDimWorker);
 	void checkOldCubes();
@@ -441,6 +447,7 @@ private:
 	IdentifierType loadServerOverview(FileReader *file);
 	IdentifierType loadServerDatabase(FileReader *file);
 	void loadServerDatabases(FileReader *file);
+	void invalidateCacheArea(const dbID_cubeID &dbCubeId, CPArea changedArea);
 	void saveServerOverview(FileWriter *file);
 	void saveServerDatabases(FileWriter *file);
 	void addCubeToList(PDatabase database, PCube cube);
@@ -485,6 +492,8 @@ private:
 	static PServer writersserver;
 	static Mutex readerslock;
 	static Mutex writerslock;
+	static uint64_t commitSequence;
+	static uint64_t publishedSequence;
 
 	PSharedMutex filelock;
 
@@ -40,9 +40,29 @@
 #include "Olap/Cube.h"
 #include "Olap/Server.h"
 #include "Engine/EngineBase.h"
+#include "Thread/WriteLocker.h"
 
 namespace palo {
 
+User::SharedDimRightsMap User::sharedDimRights;
+Mutex User::sharedDimRightsLock;
+
+User::ElemRightsTable::ElemRightsTable(const ElemRightsMap &erm)
+{
+	// the map is ordered by group and element, so the groups come sorted
+	for (ElemRightsMap::const_iterator it = erm.begin(); it != erm.end(); ++it) {
+		if (groupIds.empty() || groupIds.back() != it->first.first) {
+			groupIds.push_back(it->first.first);
+			rights.push_back(vector<uint8_t>());
+		}
+		vector<uint8_t> &row = rights.back();
+		if (row.size() <= it->first.second) {
+			row.resize(it->first.second + 1, (uint8_t)RIGHT_EMPTY);
+		}
+		row[it->first.second] = (uint8_t)it->second;
+	}
+}
+
 User::User(const string& name, vector<string>* groups, bool isExternal) :
 	Commitable(name), isExternal(isExternal), isAdmin(false)
 {
@@ -685,6 +705,12 @@ void User::computeDimensionDataRights(CPDatabase db, CPSystemDatabase sysDb, boo
 			DimRightsMap::iterator dimIter = dimRights.find(make_pair(dbId, dimId));
 			bool sameDim = isSameDimToken(dimIter, dim->getToken(), groupDimensionDataCube->getMyToken());
 
+			if ((!sameGroups || !sameDim) && findSharedDimRights(dbId, dimId, dim->getToken(), groupDimensionDataCube->getMyToken(), dRights)) {
+				// already computed for another user with the same groups
+				updateDimRights(dbId, dimId, dRights);
+				continue;
+			}
+
 			if (!sameGroups || !sameDim) {
 				if (!groupDimensionDataCube->sizeFilledCells() && !groupDimensionDataCube->hasRule()) {
 					dRights.minRight = RIGHT_EMPTY;
@@ -785,6 +811,7 @@ void User::computeDimensionDataRights(CPDatabase db, CPSystemDatabase sysDb, boo
 								}
 							}
 						}
+						dRights.elemTable.reset(new ElemRightsTable(*dRights.elemRights));
 					} else {
 						dRights.minRight = RIGHT_NONE;
 						dRights.maxRight = RIGHT_NONE;
@@ -795,6 +822,7 @@ void User::computeDimensionDataRights(CPDatabase db, CPSystemDatabase sysDb, boo
 					dRights.dimToken = dim->getToken();
 					dRights.cubeToken = groupDimensionDataCube->getMyToken();
 				}
+				storeSharedDimRights(dbId, dimId, dim->getToken(), groupDimensionDataCube->getMyToken(), dRights);
 			} else {
 				continue;
 			}
@@ -810,6 +838,30 @@ void User::computeDimensionDataRights(CPDatabase db, CPSystemDatabase sysDb, boo
 	}
 }
 
+bool User::findSharedDimRights(IdentifierType dbId, IdentifierType dimId, uint32_t dimToken, uint32_t cubeToken, DimRights &dRights) const
+{
+	WriteLocker wl(&sharedDimRightsLock);
+	SharedDimRightsMap::const_iterator it = sharedDimRights.find(make_pair(groups, make_pair(dbId, dimId)));
+	if (it == sharedDimRights.end() || it->second.dimToken != dimToken || it->second.cubeToken != cubeToken) {
+		return false;
+	}
+	dRights = it->second;
+	return true;
+}
+
+void User::storeSharedDimRights(IdentifierType dbId, IdentifierType dimId, uint32_t dimToken, uint32_t cubeToken, const DimRights &dRights) const
+{
+	WriteLocker wl(&sharedDimRightsLock);
+	if (sharedDimRights.size() >= MAX_SHARED_DIM_RIGHTS) {
+		// entries of deleted databases and changed groups are never looked up again
+		sharedDimRights.clear();
+	}
+	DimRights &shared = sharedDimRights[make_pair(groups, make_pair(dbId, dimId))];
+	shared = dRights;
+	shared.dimToken = dimToken;
+	shared.cubeToken = cubeToken;
+}
+
 void User::computeRDCDRights(CPDatabase db)
 {
 	IdentifierType dbId = db->getId();
@@ -1104,7 +1156,7 @@ bool User::checkDimsAndCells(CPDatabase db, CPCube cube, set<IdentifierType> &us
 	const IdentifiersType* dims = cube->getDimensions();
 	size_t dimCount = dims->size();
 	vector<RightsType> rtSingle(dimCount);
-	vector<ElemRightsMap *> erm(dimCount);
+	vector<const ElemRightsTable *> ert(dimCount);
 
 	size_t groupCount = userGroups.size();
 	IdentifiersType vGroups(groupCount);
@@ -1127,7 +1179,7 @@ bool User::checkDimsAndCells(CPDatabase db, CPCube cube, set<IdentifierType> &us
 				if (dit == dimRights.end()) {
 					throw ErrorException(ErrorException::ERROR_INTERNAL, "invalid dimension in User::checkDimsAndCells method");
 				}
-				erm[i] = dit->second.elemRights.get();
+				ert[i] = dit->second.elemTable.get();
 			}
 		} else {
 			RightsType rt = dim->getDimensionDataRight(this);
@@ -1153,11 +1205,11 @@ bool User::checkDimsAndCells(CPDatabase db, CPCube cube, set<IdentifierType> &us
 				bool emptyElem = false;
 				CPSet s = area->getDim(i);
 				if (s) {
-					if (erm[i]) {
+					if (ert[i]) {
 						for (Set::Iterator sit = s->begin(); sit != s->end(); ++sit) {
-							ElemRightsMap::iterator it = erm[i]->find(make_pair(groupId, *sit));
-							if (it != erm[i]->end()) {
-								if (it->second < requiredRight) {
+							RightsType rt = ert[i]->get(groupId, *sit);
+							if (rt != RIGHT_EMPTY) {
+								if (rt < requiredRight) {
 									enough = false;
 									break;
 								}
@@ -1175,7 +1227,7 @@ bool User::checkDimsAndCells(CPDatabase db, CPCube cube, set<IdentifierType> &us
 						emptyCell = false;
 					}
 					if (checkCells && emptyCell) {
-						emptyArea->insert(i, erm[i] ? sEmpty : s);
+						emptyArea->insert(i, ert[i] ? sEmpty : s);
 					}
 				} else {
 					checkCells = false; // area is empty
@@ -1309,29 +1361,23 @@ void User::checkAreaRightsComplete(CPDatabase db, CPCube cube, CPCubeArea area,
 	}
 }
 
-RightsType User::getElementRight(ElemRightsMap *erm, IdentifierType groupId, IdentifierType elemId) const
+RightsType User::getElementRight(const ElemRightsTable *ert, IdentifierType groupId, IdentifierType elemId) const
 {
-	if (erm) {
-		ElemRightsMap::const_iterator eit = erm->find(make_pair(groupId, elemId));
-		if (eit != erm->end()) {
-			return eit->second;
-		}
-	}
-	return RIGHT_EMPTY;
+	return ert ? ert->get(groupId, elemId) : RIGHT_EMPTY;
 }
 
-bool User::checkElementRight(ElemRightsMap *erm, const IdentifiersType *userGroups, IdentifierType elemId, RightsType requiredRight) const
+bool User::checkElementRight(const ElemRightsTable *ert, const IdentifiersType *userGroups, IdentifierType elemId, RightsType requiredRight) const
 {
-	if (!erm) {
+	if (!ert) {
 		return true;
 	}
 	if (userGroups) {
 		bool empty = false;
 		for (IdentifiersType::const_iterator git = userGroups->begin(); git != userGroups->end(); ++git) {
-			User::ElemRightsMap::const_iterator it = erm->find(make_pair(*git, elemId));
-			if (it == erm->end()) {
+			RightsType rt = ert->get(*git, elemId);
+			if (rt == RIGHT_EMPTY) {
 				empty = true;
-			} else if (it->second >= requiredRight) {
+			} else if (rt >= requiredRight) {
 				return true;
 			}
 		}
@@ -1346,7 +1392,7 @@ bool User::checkElementRight(IdentifierType dbId, IdentifierType dimId, Identifi
 	if (dit == dimRights.end()) {
 		throw ErrorException(ErrorException::ERROR_INTERNAL, "invalid dimension in User::checkElementRight method");
 	}
-	return checkElementRight(dit->second.elemRights.get(), &groups, elemId, requiredRight);
+	return checkElementRight(dit->second.elemTable.get(), &groups, elemId, requiredRight);
 }
 
 RightsType User::getElementRight(IdentifierType dbId, IdentifierType dimId, IdentifierType elemId, vector<RoleDbCubeRight> &vRights, bool checkRole) const
@@ -1358,12 +1404,12 @@ RightsType User::getElementRight(IdentifierType dbId, IdentifierType dimId, Iden
 	if (dit == dimRights.end()) {
 		throw ErrorException(ErrorException::ERROR_INTERNAL, "invalid dimension in User::getElementRight method");
 	}
-	ElemRightsMap *erm = dit->second.elemRights.get();
+	const ElemRightsTable *ert = dit->second.elemTable.get();
 
 	RightsType result = RIGHT_NONE;
 	for (size_t i = 0; i < groups.size(); i++) {
 		RightsType rtMin = checkRole ? min(vRights[i].roleRight, vRights[i].dbRight) : vRights[i].dbRight;
-		rtMin = min(rtMin, getElementRight(erm, groups[i], elemId));
+		rtMin = min(rtMin, getElementRight(ert, groups[i], elemId));
 
 		if (rtMin > result) {
 			result = rtMin;
@@ -1388,11 +1434,11 @@ RightsType User::getCellRight(CPDatabase db, CPCube cube, const IdentifiersType
 	const IdentifiersType *dims = cube->getDimensions();
 	size_t dimCount = dims->size();
 
-	vector<ElemRightsMap *> vElemRights(dimCount);
+	vector<const ElemRightsTable *> vElemRights(dimCount);
 	for (size_t i = 0; i < dimCount; i++) {
 		PDimension dim = db->lookupDimension(dims->at(i), false);
 		DimRightsMap::const_iterator it = dimRights.find(make_pair(db->getId(), dim->getId()));
-		vElemRights[i] = it == dimRights.end() ? 0 : (*it).second.elemRights.get();
+		vElemRights[i] = it == dimRights.end() ? 0 : (*it).second.elemTable.get();
 	}
 
 	PCellStream cellStream;
@@ -93,16 +93,44 @@ public:
 	typedef map<pair<IdentifierType, IdentifierType>, RightsType> ElemRightsMap; // <groupId, elemId>, RightsType
 	typedef boost::shared_ptr<ElemRightsMap> PElemRightsMap;
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief ElemRightsMap compiled into one array of rights per group
+	///
+	/// The arrays are indexed by element id, elements without a right are
+	/// RIGHT_EMPTY. Replaces the map lookups when rights are checked.
+	////////////////////////////////////////////////////////////////////////////////
+
+	class ElemRightsTable {
+	public:
+		ElemRightsTable(const ElemRightsMap &erm);
+
+		RightsType get(IdentifierType groupId, IdentifierType elemId) const {
+			IdentifiersType::const_iterator it = std::lower_bound(groupIds.begin(), groupIds.end(), groupId);
+			if (it == groupIds.end() || *it != groupId) {
+				return RIGHT_EMPTY;
+			}
+			const vector<uint8_t> &row = rights[it - groupIds.begin()];
+			return elemId < row.size() ? (RightsType)row[elemId] : RIGHT_EMPTY;
+		}
+
+	private:
+		IdentifiersType groupIds; // sorted
+		vector<vector<uint8_t> > rights; // [group][elemId]
+	};
+	typedef boost::shared_ptr<const ElemRightsTable> PElemRightsTable;
+
 	struct DimRights {
 		DimRights(): minRight(RIGHT_NONE), maxRight(RIGHT_NONE), dimToken(0), cubeToken(0) {}
-		DimRights(const DimRights &dr) : elemRights(dr.elemRights), minRight(dr.minRight), maxRight(dr.maxRight), dimToken(dr.dimToken), cubeToken(dr.cubeToken) {}
+		DimRights(const DimRights &dr) : elemRights(dr.elemRights), elemTable(dr.elemTable), minRight(dr.minRight), maxRight(dr.maxRight), dimToken(dr.dimToken), cubeToken(dr.cubeToken) {}
 		PElemRightsMap elemRights; // non-empty calculated rights from #_GROUP_DIMENSION_DATA_ cube
+		PElemRightsTable elemTable; // elemRights compiled for lookups
 		RightsType minRight; // minimum from elemRights
 		RightsType maxRight; // maximum from elemRights
 		uint32_t dimToken;
 		uint32_t cubeToken; // token of the dimension's #_GROUP_DIMENSION_DATA_ cube
 	};
 	typedef map<pair<IdentifierType, IdentifierType>, DimRights> DimRightsMap;  // <dbID, dimID>, DimRights
+	typedef map<pair<IdentifiersType, pair<IdentifierType, IdentifierType> >, DimRights> SharedDimRightsMap;  // <groups, <dbID, dimID>>, DimRights
 
 	User(const string& name, vector<string>* groups, bool isExternal);
 
@@ -129,7 +157,7 @@ public:
 	bool checkDimsAndCells(CPDatabase db, CPCube cube, set<IdentifierType> &userGroups, CPCubeArea area, bool checkCells, RightsType requiredRight, bool *defaultUsed) const;
 	void checkAreaRightsComplete(CPDatabase db, CPCube cube, CPCubeArea area, RightSetting& rs, bool isZero, RightsType requiredRight, bool *defaultUsed) const;
 
-	bool checkElementRight(ElemRightsMap *erm, const IdentifiersType *userGroups, IdentifierType elemId, RightsType requiredRight) const;
+	bool checkElementRight(const ElemRightsTable *ert, const IdentifiersType *userGroups, IdentifierType elemId, RightsType requiredRight) const;
 	bool checkElementRight(IdentifierType dbId, IdentifierType dimId, IdentifierType elemId, RightsType requiredRight) const;
 
 	void fillRights(vector<RoleDbCubeRight> &vRights, RightObject object, CPDatabase db, CPCube cube) const;
@@ -178,7 +206,9 @@ private:
 	bool isSameDimToken(DimRightsMap::iterator &it, uint32_t dimToken, uint32_t cubeToken) const;
 	void updateDimRights(IdentifierType dbId, IdentifierType dimId, const DimRights &dRights);
 	void updateDbRights(IdentifierType dbId, RightsType minRight, RightsType maxRight);
-	RightsType getElementRight(ElemRightsMap *erm, IdentifierType groupId, IdentifierType elemId) const;
+	RightsType getElementRight(const ElemRightsTable *ert, IdentifierType groupId, IdentifierType elemId) const;
+	bool findSharedDimRights(IdentifierType dbId, IdentifierType dimId, uint32_t dimToken, uint32_t cubeToken, DimRights &dRights) const;
+	void storeSharedDimRights(IdentifierType dbId, IdentifierType dimId, uint32_t dimToken, uint32_t cubeToken, const DimRights &dRights) const;
 
 	static PCube getCellDataRightCube(CPDatabase db, CPCube cube);
 	static RightsType computeDimensionDataRight(CPCube groupDimensionDataCube, IdentifierType groupId, CPDimension dimension, Element* element, RightsType defaultRight);
@@ -195,6 +225,11 @@ private:
 	DimRightsMap dimRights; // <dbID, dimID>, DimRights
 	RightMap RDCDRights; // <dbID, cubeID>, <minRights, maxRights>, RDCD means RoleDatabaseCubeDimensions
 
+	// dimension rights of all users, shared by users with the same groups
+	static SharedDimRightsMap sharedDimRights;
+	static Mutex sharedDimRightsLock;
+	static const size_t MAX_SHARED_DIM_RIGHTS = 10000;
+
 	// for external users:
 	vector<string> groupNames;	// even non-existing groups names are saved, so rights are assigned in refreshAll - getGroups if group is created later
 	bool isExternal;
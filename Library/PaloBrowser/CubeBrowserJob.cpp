@@ -59,7 +59,7 @@ bool CubeBrowserJob::initialize()
 	}
 
 	if (!action.empty()) {
-		if (action == "load" || action == "save") {
+		if (action == "load" || action == "save" || action == "columnar_pages" || action == "instruction_pages") {
 			jobType = WRITE_JOB;
 		}
 	}
@@ -91,6 +91,15 @@ void CubeBrowserJob::compute()
 				findCube(true, false);
 				database->saveCube(server, cube, user);
 				message1 = "cube saved";
+			} else if (action == "columnar_pages" || action == "instruction_pages") {
+				server = Context::getContext()->getServerCopy();
+				findDatabase(true, true);
+				findCube(false, true);
+				cube->setColumnarPages(server, action == "columnar_pages");
+				if (!server->commit()) {
+					throw CommitException(ErrorException::ERROR_COMMIT_CANTCOMMIT, "Can't commit changes.");
+				}
+				message1 = "page format changed";
 			} else if (action == "reset_cache") {
 				server = Context::getContext()->getServer();
 				findCube(false, false);
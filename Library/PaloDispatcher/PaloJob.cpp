@@ -111,6 +111,7 @@ void PaloJob::clear(bool setSession)
 	if (setSession) {
 		Context::getContext()->setSession(session);
 		Context::getContext()->setTask(ioTask);
+		Context::getContext()->enableArena();
 	}
 }
 
@@ -127,6 +128,7 @@ bool PaloJob::initialize()
 			session = PaloSession::findSession(jobRequest->sid, true);
 			context = Context::getContext();
 			context->setSession(session);
+			context->enableArena();
 
 			if (session) {
 				user = session->getUser();
@@ -252,7 +254,9 @@ void PaloJob::generateCellValueResponse(const IdentifiersType &key, const CellVa
 	}
 
 	StringBuffer &body = response->getBody();
-	if (value.isError()) {
+	if (jobRequest->binary) {
+		appendBinaryCell(body, value, 0, lockInfo, prop_vals);
+	} else if (value.isError()) {
 		appendError(body, value.getError(), value.getRuleId(), jobRequest->showRule, jobRequest->showLockInfo, prop_vals);
 	} else {
 		appendCell(body, value, jobRequest->showRule, jobRequest->showLockInfo, lockInfo, prop_vals);
@@ -1274,6 +1278,49 @@ void PaloJob::appendCell(StringBuffer& body, const CellValue& value, bool showRu
 	body.appendEol();
 }
 
+void PaloJob::appendBinaryCell(StringBuffer& body, const CellValue& value, const IdentifiersType *key, Cube::CellLockInfo lockInfo, const vector<CellValue> &prop_vals)
+{
+	if (value.isError()) {
+		body.appendChar((char)99);
+		body.appendVarint((uint32_t)value.getError());
+	} else {
+		body.appendChar(value.isString() ? (char)Element::STRING : (char)Element::NUMERIC);
+		body.appendChar(value.isEmpty() ? (char)0 : (char)1);
+		if (!value.isEmpty()) {
+			if (value.isString()) {
+				body.appendLengthString(value);
+			} else {
+				body.appendRawDouble(value.getNumeric());
+			}
+		}
+	}
+
+	if (key) {
+		body.appendVarint(key->size());
+		for (IdentifiersType::const_iterator it = key->begin(); it != key->end(); ++it) {
+			body.appendVarint(*it);
+		}
+	}
+	if (jobRequest->showRule) {
+		body.appendVarint(value.getRuleId());
+	}
+	if (jobRequest->showLockInfo) {
+		body.appendVarint((uint32_t)lockInfo);
+	}
+	if (jobRequest->properties) {
+		body.appendVarint(prop_vals.size());
+		for (vector<CellValue>::const_iterator it = prop_vals.begin(); it != prop_vals.end(); ++it) {
+			if (it->isEmpty()) {
+				body.appendVarint(0);
+			} else if (it->isString()) {
+				body.appendLengthString(*it);
+			} else {
+				body.appendLengthString(it->toString());
+			}
+		}
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // helper methods
 ///////////////////////////////////////////////////////////////////////////////
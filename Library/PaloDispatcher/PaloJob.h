@@ -218,6 +218,16 @@ protected:
 		response->setToken(PaloRequestHandler::X_PALO_DATABASE, database->getToken());
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief sets the binary content type in response for binary requests
+	////////////////////////////////////////////////////////////////////////////////
+
+	void setContentType() {
+		if (jobRequest->binary) {
+			response->setContentType(PaloRequestHandler::CONTENT_TYPE_BINARY);
+		}
+	}
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// @brief finds database
 	////////////////////////////////////////////////////////////////////////////////
@@ -361,6 +371,18 @@ protected:
 
 protected:
 	void appendCell(StringBuffer& body, const CellValue& value, bool showRule, bool showLockInfo, Cube::CellLockInfo lockInfo, const vector<CellValue> &prop_vals);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief appends a cell in the binary encoding
+	///
+	/// A type byte (1 numeric, 2 string, 99 error), for errors the varint error
+	/// code, otherwise an exists byte followed by a raw double or a string with
+	/// varint length. Then the path as varint count and varint ids if a key is
+	/// given, the varint rule id and lock info if requested and the properties
+	/// as varint count and strings.
+	////////////////////////////////////////////////////////////////////////////////
+
+	void appendBinaryCell(StringBuffer& body, const CellValue& value, const IdentifiersType *key, Cube::CellLockInfo lockInfo, const vector<CellValue> &prop_vals);
 	void appendElement(StringBuffer* sb, CPDimension dimension, const Element* element, IdentifierType elemId, bool showPermission, vector<User::RoleDbCubeRight> &vRights, IdentifierType depth = NO_IDENTIFIER, IdentifierType indent = NO_IDENTIFIER);
 	void appendError(StringBuffer& sb, ErrorException::ErrorType type, IdentifierType idRule, bool showRule, bool showLockInfo, const vector<CellValue> &prop_vals);
 private:
@@ -158,6 +158,9 @@ PaloJobRequest::~PaloJobRequest()
 	if (dPositions) {
 		delete dPositions;
 	}
+	if (doubleValues) {
+		delete doubleValues;
+	}
 
 	// list of strings
 	if (dimensionsName) {
@@ -274,6 +277,7 @@ void PaloJobRequest::initialize()
 	useRules = false;
 	showUserInfo = false;
 	showPermission = false;
+	binary = false;
 
 	// strings
 	action = 0;
@@ -324,6 +328,7 @@ void PaloJobRequest::initialize()
 	// list of doubles
 	weights = 0;
 	dPositions = 0;
+	doubleValues = 0;
 
 	// list of strings
 	dimensionsName = 0;
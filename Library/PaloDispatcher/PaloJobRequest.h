@@ -413,6 +413,7 @@ public:
 	bool useRules; // default FALSE
 	bool showUserInfo; // default FALSE
 	bool showPermission; // default FALSE
+	bool binary; // default FALSE, body and cell rows use the binary encoding
 
 	// strings
 	string * actcode;
@@ -464,6 +465,7 @@ public:
 	// list of doubles
 	vector<vector<double> > *weights;
 	vector<double> *dPositions;
+	vector<double> *doubleValues; // values of a binary request
 
 	// list of strings
 	vector<string> * dimensionsName;
@@ -360,6 +360,9 @@ void BrowserDocumentation::defineCubes(const vector<CPCube> * cubes)
 	vector<string> cached_values_limit;
 	vector<string> cached_values_found;
 	vector<string> cache_time_info;
+	vector<string> cached_plans;
+	vector<string> plan_cache_hits;
+	vector<string> page_format;
 
 	for (vector<CPCube>::const_iterator i = cubes->begin(); i != cubes->end(); ++i) {
 		CPCube cube = *i;
@@ -385,12 +388,12 @@ void BrowserDocumentation::defineCubes(const vector<CPCube> * cubes)
 		double foundCellsCount = 0;
 		ValueCache *cache = cube->getCache();
 		if (cache) {
-			PStorageCpu cacheStorage;
-			ValueCache::PCachedAreas cacheAreas;
-			double cacheFound = cache->getAreasAndStorage(cacheStorage, cacheAreas);
-			if (cacheStorage && cacheAreas) {
-				cache->getStatistics(cacheStorage, cacheAreas, cacheFound, areasCount, valuesCount, cellCount, foundCellsCount);
-			}
+			ValueCache::Statistics cacheStats;
+			cache->getStatistics(cacheStats);
+			areasCount = cacheStats.areas;
+			valuesCount = cacheStats.values;
+			cellCount = cacheStats.cells;
+			foundCellsCount = cacheStats.found;
 			cellLimit = cache->getBarrier();
 
 			time_t invalidationTime = cache->getInvalidationTime();
@@ -404,6 +407,11 @@ void BrowserDocumentation::defineCubes(const vector<CPCube> * cubes)
 		cached_cells.push_back(UTF8Comparer::doubleToString(cellCount, 0, 0, true));
 		cached_values_limit.push_back(StringUtils::convertToString(valuesCount)+"/"+UTF8Comparer::doubleToString(cellLimit,0,0, true)+" ("+(cellLimit ? UTF8Comparer::doubleToString(100*valuesCount/cellLimit,0,2, true) : "0")+"%)");
 		cached_values_found.push_back(UTF8Comparer::doubleToString(foundCellsCount,0,0, true));
+
+		PlanCache::Statistics planStats = cube->getPlanCache()->getStatistics();
+		cached_plans.push_back(StringUtils::convertToString(planStats.plans));
+		plan_cache_hits.push_back(StringUtils::convertToString(planStats.hits)+"/"+StringUtils::convertToString(planStats.misses)+"/"+StringUtils::convertToString(planStats.uncacheable));
+		page_format.push_back(cube->hasColumnarPages() ? "columnar" : "instruction");
 	}
 
 	values["@cube_identifier"] = identifier;
@@ -419,6 +427,9 @@ void BrowserDocumentation::defineCubes(const vector<CPCube> * cubes)
 	values["@cached_values_limit"] = cached_values_limit;
 	values["@cached_values_found"] = cached_values_found;
 	values["@cache_time_info"] = cache_time_info;
+	values["@cached_plans"] = cached_plans;
+	values["@plan_cache_hits"] = plan_cache_hits;
+	values["@cube_page_format"] = page_format;
 }
 
 void BrowserDocumentation::defineElement(CPDimension dimension, Element* element, const string& prefix)
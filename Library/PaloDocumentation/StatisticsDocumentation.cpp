@@ -34,6 +34,8 @@
 #include <sstream>
 
 #include "Collections/StringUtils.h"
+#include "Olap/ContextArena.h"
+#include "Engine/Cache.h"
 
 namespace palo {
 StatisticsDocumentation::StatisticsDocumentation(const Statistics& statistics)
@@ -43,6 +45,27 @@ StatisticsDocumentation::StatisticsDocumentation(const Statistics& statistics)
 
 	generateTimings(fullPath, fullTimings, "full_path");
 	generateTimings(combinedPath, combinedTimings, "combined");
+	generateArenaCounters();
+	generateCacheCounters();
+}
+
+void StatisticsDocumentation::generateArenaCounters()
+{
+	ContextArena::Counters counters = ContextArena::getTotalCounters();
+
+	vector<string>& names = values["@arena_counter"];
+	vector<string>& counts = values["@arena_value"];
+
+	names.push_back("released request arenas");
+	counts.push_back(StringUtils::convertToString(counters.arenas));
+	names.push_back("arena allocations");
+	counts.push_back(StringUtils::convertToString(counters.allocations));
+	names.push_back("arena bytes");
+	counts.push_back(StringUtils::convertToString(counters.bytes));
+	names.push_back("arena blocks");
+	counts.push_back(StringUtils::convertToString(counters.blocks));
+	names.push_back("allocations outside of arena");
+	counts.push_back(StringUtils::convertToString(counters.heapAllocations));
 }
 
 void StatisticsDocumentation::generateTimings(vector<string>& path, map<string, Statistics::Timing> timings, const string& postfix)
@@ -74,6 +97,35 @@ void StatisticsDocumentation::generateTimings(vector<string>& path, map<string,
 	}
 }
 
+void StatisticsDocumentation::generateCacheCounters()
+{
+	ValueCache::GlobalStatistics stats = ValueCache::getGlobalStatistics();
+
+	vector<string>& names = values["@cache_counter"];
+	vector<string>& counts = values["@cache_value"];
+
+	names.push_back("budget of cached values");
+	counts.push_back(stats.budget ? StringUtils::convertToString((uint64_t)stats.budget) : "unlimited");
+	names.push_back("cached values");
+	counts.push_back(StringUtils::convertToString(stats.values));
+	names.push_back("cube caches");
+	counts.push_back(StringUtils::convertToString(stats.caches));
+	names.push_back("admitted commits");
+	counts.push_back(StringUtils::convertToString(stats.admissions));
+	names.push_back("rejected commits");
+	counts.push_back(StringUtils::convertToString(stats.rejectedCommits));
+	names.push_back("partial invalidations");
+	counts.push_back(StringUtils::convertToString(stats.invalidations));
+	names.push_back("invalidated areas");
+	counts.push_back(StringUtils::convertToString(stats.invalidatedAreas));
+	names.push_back("hits");
+	counts.push_back(StringUtils::convertToString(stats.hits));
+	names.push_back("evicted shards");
+	counts.push_back(StringUtils::convertToString(stats.evictions));
+	names.push_back("evicted values");
+	counts.push_back(StringUtils::convertToString(stats.evictedValues));
+}
+
 bool StatisticsDocumentation::hasDocumentationEntry(const string& name)
 {
 	if (name == "@full_path") {
@@ -59,6 +59,8 @@ public:
 
 private:
 	void generateTimings(vector<string>& path, map<string, Statistics::Timing> timings, const string& postfix);
+	void generateArenaCounters();
+	void generateCacheCounters();
 
 private:
 	vector<string> fullPath;
@@ -35,6 +35,7 @@
 
 #include "Collections/StringBuffer.h"
 #include "Collections/StringUtils.h"
+#include "Exceptions/ParameterException.h"
 #include "PaloDispatcher/PaloJobRequest.h"
 #include "PaloHttpServer/PaloCommands.h"
 #include "Olap/PaloSession.h"
@@ -64,6 +65,54 @@ PaloHttpRequest::~PaloHttpRequest()
 // extraction
 // /////////////////////////////////////////////////////////////////////////////
 
+// header names are case-insensitive
+static bool isHeader(const char* start, const char* colon, const char* name)
+{
+	size_t length = strlen(name);
+
+	if ((size_t)(colon - start) != length) {
+		return false;
+	}
+
+	for (size_t i = 0; i < length; i++) {
+		if (::tolower((unsigned char)start[i]) != ::tolower((unsigned char)name[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// compares the media type of a Content-Type value, parameters after ';' are ignored
+static bool isMediaType(const char* value, const char* end, const string& type)
+{
+	while (value < end && (*value == ' ' || *value == '\t')) {
+		value++;
+	}
+
+	const char* e = value;
+
+	while (e < end && *e != ';') {
+		e++;
+	}
+
+	while (e > value && (e[-1] == ' ' || e[-1] == '\t')) {
+		e--;
+	}
+
+	if ((size_t)(e - value) != type.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < type.size(); i++) {
+		if (::tolower((unsigned char)value[i]) != ::tolower((unsigned char)type[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 void PaloHttpRequest::extractHeader(char* begin, char* end)
 {
 #ifdef ENABLE_TRACE_OPTION
@@ -143,6 +192,10 @@ void PaloHttpRequest::extractHeader(char* begin, char* end)
 							for (; reqe < endnl && *reqe != SPC; reqe++) {
 							}
 
+							if (reqe < endnl) {
+								protocol = string(reqe + 1, endnl);
+							}
+
 							// split requestPath and parameters
 							char* parm = space + 1;
 
@@ -164,6 +217,12 @@ void PaloHttpRequest::extractHeader(char* begin, char* end)
 							headerFields[key] = value;
 						}
 
+						if (isHeader(start, colon, "Content-Type") && isMediaType(space, endnl, PaloRequestHandler::CONTENT_TYPE_BINARY)) {
+							paloJobRequest->binary = true;
+						} else if (isHeader(start, colon, "Accept-Encoding")) {
+							setAcceptEncoding(space, endnl);
+						}
+
 						const struct CommandOption * option = Perfect_Hash::PaloValue(start, (unsigned int)(colon - start));
 
 						if (option != 0) {
@@ -226,7 +285,11 @@ void PaloHttpRequest::extractBody(char* begin, char* end)
 	}
 #endif
 
-	setKeyValues(begin, end);
+	if (paloJobRequest->binary) {
+		setBinaryValues(begin, end);
+	} else {
+		setKeyValues(begin, end);
+	}
 }
 
 // /////////////////////////////////////////////////////////////////////////////
@@ -309,6 +372,154 @@ void PaloHttpRequest::setKeyValues(char* begin, char* end)
 	}
 }
 
+static bool readVarint(const char*& p, const char* end, uint64_t& value)
+{
+	value = 0;
+
+	for (int shift = 0; p < end && shift < 64; shift += 7) {
+		uint8_t next = (uint8_t)*p++;
+		value |= (uint64_t)(next & 0x7f) << shift;
+
+		if (!(next & 0x80)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool readLength(const char*& p, const char* end, size_t& length)
+{
+	uint64_t value;
+
+	if (!readVarint(p, end, value) || value > (uint64_t)(end - p)) {
+		return false;
+	}
+
+	length = (size_t)value;
+	return true;
+}
+
+void PaloHttpRequest::setBinaryValues(char* begin, char* end)
+{
+	const char* p = begin;
+
+	while (p < end) {
+		size_t length;
+
+		if (!readLength(p, end, length) || p + length >= end) {
+			throw ParameterException(ErrorException::ERROR_INVALID_TYPE, "malformed binary request body", "offset", (unsigned int)(p - begin));
+		}
+
+		string key(p, length);
+		p += length;
+
+		BinaryType type = (BinaryType)*p++;
+
+		if (type == BINARY_TEXT) {
+			if (!readLength(p, end, length)) {
+				throw ParameterException(ErrorException::ERROR_INVALID_TYPE, "malformed binary parameter", key, "");
+			}
+
+			// setKeyValue expects writable, terminated buffers
+			string value(p, length);
+			p += length;
+
+			setKeyValue(&key[0], &key[0] + key.size(), &value[0], &value[0] + value.size());
+			continue;
+		}
+
+		const struct CommandOption * option = Perfect_Hash::PaloValue(key.c_str(), (unsigned int)key.size());
+		int code = option != 0 ? option->code : -1;
+		uint64_t count;
+
+		if (!readVarint(p, end, count)) {
+			throw ParameterException(ErrorException::ERROR_INVALID_TYPE, "malformed binary parameter", key, "");
+		}
+
+		if (type == BINARY_IDENTIFIERS && (code == PaloRequestHandler::CMD_ID_AREA || code == PaloRequestHandler::CMD_ID_PATHS || code == PaloRequestHandler::CMD_ID_PATH)) {
+			vector<IdentifiersType> *identifiers = new vector<IdentifiersType>;
+			bool valid = true;
+			bool inRange = true;
+
+			for (uint64_t i = 0; valid && inRange && i < count; i++) {
+				uint64_t size;
+				valid = readVarint(p, end, size) && size <= (uint64_t)(end - p);
+
+				identifiers->push_back(IdentifiersType());
+				IdentifiersType& vec = identifiers->back();
+
+				for (uint64_t j = 0; valid && inRange && j < size; j++) {
+					uint64_t id;
+					valid = readVarint(p, end, id);
+					inRange = id <= (IdentifierType)-1;
+					vec.push_back((IdentifierType)id);
+				}
+			}
+
+			if (!valid) {
+				delete identifiers;
+				throw ParameterException(ErrorException::ERROR_INVALID_TYPE, "malformed binary parameter", key, "");
+			}
+			if (!inRange) {
+				delete identifiers;
+				throw ParameterException(ErrorException::ERROR_INVALID_COORDINATES, "identifier out of range", key, "");
+			}
+
+			// a repeated parameter replaces the earlier one
+			if (code == PaloRequestHandler::CMD_ID_AREA) {
+				delete paloJobRequest->area;
+				paloJobRequest->area = identifiers;
+			} else if (code == PaloRequestHandler::CMD_ID_PATHS) {
+				delete paloJobRequest->paths;
+				paloJobRequest->paths = identifiers;
+			} else {
+				delete paloJobRequest->path;
+				paloJobRequest->path = new IdentifiersType(identifiers->empty() ? IdentifiersType() : identifiers->front());
+				delete identifiers;
+			}
+		} else if (type == BINARY_DOUBLES && code == PaloRequestHandler::CMD_VALUES) {
+			if (count > (uint64_t)(end - p) / sizeof(double)) {
+				throw ParameterException(ErrorException::ERROR_INVALID_TYPE, "malformed binary parameter", key, "");
+			}
+
+			delete paloJobRequest->values;
+			paloJobRequest->values = 0;
+			delete paloJobRequest->doubleValues;
+			paloJobRequest->doubleValues = new vector<double>((size_t)count);
+
+			if (count) {
+				memcpy(&(*paloJobRequest->doubleValues)[0], p, (size_t)count * sizeof(double));
+				p += (size_t)count * sizeof(double);
+			}
+		} else if (type == BINARY_STRINGS && code == PaloRequestHandler::CMD_VALUES) {
+			vector<string> *values = new vector<string>;
+			bool valid = true;
+
+			for (uint64_t i = 0; valid && i < count; i++) {
+				valid = readLength(p, end, length);
+
+				if (valid) {
+					values->push_back(string(p, length));
+					p += length;
+				}
+			}
+
+			if (!valid) {
+				delete values;
+				throw ParameterException(ErrorException::ERROR_INVALID_TYPE, "malformed binary parameter", key, "");
+			}
+
+			delete paloJobRequest->doubleValues;
+			paloJobRequest->doubleValues = 0;
+			delete paloJobRequest->values;
+			paloJobRequest->values = values;
+		} else {
+			throw ParameterException(ErrorException::ERROR_INVALID_TYPE, "unsupported binary parameter", key, (int)type);
+		}
+	}
+}
+
 void PaloHttpRequest::setKeyValue(char * keyStart, char * keyPtr, char * valueStart, char * valuePtr)
 {
 	const struct CommandOption * option = Perfect_Hash::PaloValue(keyStart, (unsigned int)(keyPtr - keyStart));
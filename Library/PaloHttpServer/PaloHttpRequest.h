@@ -110,7 +110,33 @@ public:
 	}
 
 private:
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief value types of the binary encoding
+	////////////////////////////////////////////////////////////////////////////////
+
+	enum BinaryType {
+		BINARY_TEXT = 0, BINARY_IDENTIFIERS = 1, BINARY_DOUBLES = 2, BINARY_STRINGS = 3
+	};
+
 	void setKeyValues(char* begin, char* end);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief reads a body with content type application/x-palo-binary
+	///
+	/// The body is a sequence of parameters with the names of the text encoding.
+	/// Each is the name as varint length and bytes, a type byte and the value:
+	///   BINARY_TEXT         varint length and bytes, parsed like a url parameter
+	///   BINARY_IDENTIFIERS  varint count of lists, each a varint count and
+	///                       varint ids, an empty list stands for "*" (area, paths
+	///                       and path)
+	///   BINARY_DOUBLES      varint count and raw little-endian doubles (values)
+	///   BINARY_STRINGS      varint count and strings with varint length (values)
+	/// Malformed bodies, unsupported parameters and ids out of range throw a
+	/// ParameterException.
+	////////////////////////////////////////////////////////////////////////////////
+
+	void setBinaryValues(char* begin, char* end);
 	void setKeyValue(char * keyStart, char * keyPtr, char * valueStart, char * valuePtr);
 
 	void fillToken(uint32_t*& token, char* begin, char* end);
@@ -123,6 +123,8 @@ const string PaloRequestHandler::X_PALO_DIMENSION = "X-PALO-DIM";
 const string PaloRequestHandler::X_PALO_CUBE = "X-PALO-CB";
 const string PaloRequestHandler::X_PALO_CUBE_CLIENT_CACHE = "X-PALO-CC";
 
+const string PaloRequestHandler::CONTENT_TYPE_BINARY = "application/x-palo-binary";
+
 // /////////////////////////////////////////////////////////////////////////////
 // HttpRequestHandler methods
 // /////////////////////////////////////////////////////////////////////////////
@@ -126,6 +126,8 @@ public:
 	static const string X_PALO_CUBE;
 	static const string X_PALO_CUBE_CLIENT_CACHE;
 
+	static const string CONTENT_TYPE_BINARY;
+
 	enum CommandIdentifier {
 		CMD_ACTCODE,
 		CMD_ACTIVATE,
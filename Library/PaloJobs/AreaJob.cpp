@@ -33,6 +33,7 @@
 #include "PaloJobs/AreaJob.h"
 
 #include "Engine/EngineBase.h"
+#include "HttpServer/HttpServerTask.h"
 #include "InputOutput/Statistics.h"
 #include "Olap/AttributesCube.h"
 
@@ -52,6 +53,19 @@ bool AreaJob::checkElement(CPDimension &dim, Element *e, vector<User::RoleDbCube
 void AreaJob::appendValue(const IdentifiersType &key, const CellValue &value, const vector<CellValue> &prop_vals)
 {
 	StringBuffer *sb = &response->getBody();
+	if (jobRequest->binary) {
+		appendBinaryValue(sb, key, value, prop_vals);
+	} else {
+		appendTextValue(sb, key, value, prop_vals);
+	}
+
+	if (streamBody && sb->length() >= STREAM_CHUNK_SIZE) {
+		flushBody();
+	}
+}
+
+void AreaJob::appendTextValue(StringBuffer *sb, const IdentifiersType &key, const CellValue &value, const vector<CellValue> &prop_vals)
+{
 	if (value.isError()) {
 		sb->appendCsvInteger((int32_t)99);
 		sb->appendCsvInteger((int32_t)value.getError());
@@ -102,6 +116,29 @@ void AreaJob::appendValue(const IdentifiersType &key, const CellValue &value, co
 	sb->appendEol();
 }
 
+void AreaJob::appendBinaryValue(StringBuffer *sb, const IdentifiersType &key, const CellValue &value, const vector<CellValue> &prop_vals)
+{
+	Cube::CellLockInfo lockInfo = 0;
+	if (jobRequest->showLockInfo && !value.isError()) {
+		lockInfo = cube->getCellLockInfo(key, user ? user->getId() : 0);
+	}
+	appendBinaryCell(*sb, value, &key, lockInfo, prop_vals);
+}
+
+bool AreaJob::canStreamBody() const
+{
+	HttpServerTask *task = dynamic_cast<HttpServerTask *>(ioTask);
+	return task && task->canSendChunks();
+}
+
+void AreaJob::flushBody()
+{
+	HttpServerTask *task = dynamic_cast<HttpServerTask *>(ioTask);
+	if (!task || !task->sendChunk(response)) {
+		throw ErrorException(ErrorException::ERROR_NET_SEND, "cannot send response chunk to client");
+	}
+}
+
 double AreaJob::fillEmptyDim(vector<User::RoleDbCubeRight> &vRights, bool checkPermissions, vector<IdentifiersType> &area, PCube &cube, PDatabase &database, PUser &user)
 {
 	const IdentifiersType *dimensions = cube->getDimensions();
@@ -155,16 +192,16 @@ PCubeArea AreaJob::checkRights(vector<User::RoleDbCubeRight> &vRights, bool chec
 
 		if (calcArea->elemCount(i) && dim->getDimensionType() != Dimension::VIRTUAL) {
 			bool changed = false;
-			for (Set::Iterator it = s->begin(); it != s->end();) {
+			PSet allowed(new Set); // built in order instead of erasing from s one by one
+			for (Set::Iterator it = s->begin(); it != s->end(); ++it) {
 				Element *elem = dim->lookupElement(*it, false);
 				if (elem) {
 					if (reduceCalcArea && !checkElement(dim, elem, vRights, checkPermissions, database, user)) {
 						np->insert(*it);
 						isNoPermission = true;
-						it = s->erase(it); // elements without permission are removed from calcArea to make the calculation faster
-						changed = true;
+						changed = true; // elements without permission are removed from calcArea to make the calculation faster
 					} else {
-						++it;
+						allowed->insert(*it);
 						if (hasStringElem) {
 							if (elem->getElementType() == Element::STRING || elem->isStringConsolidation()) {
 								*hasStringElem = true;
@@ -177,9 +214,8 @@ PCubeArea AreaJob::checkRights(vector<User::RoleDbCubeRight> &vRights, bool chec
 			}
 			if (changed) {
 				//update of calcArea->areaSize
-				CPSet s = calcArea->getDim(i);
-				if (s->size()) {
-					calcArea->insert(i, s);
+				if (allowed->size()) {
+					calcArea->insert(i, allowed);
 				} else {
 					calcArea->insert(i, PSet());
 				}
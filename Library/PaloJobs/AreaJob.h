@@ -62,12 +62,18 @@ public:
 
 	static const int MAX_AREA_SIZE = 350000;
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief body size in bytes after which a streamed body is sent as chunk
+	////////////////////////////////////////////////////////////////////////////////
+
+	static const size_t STREAM_CHUNK_SIZE = 256 * 1024;
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// @brief constructor
 	////////////////////////////////////////////////////////////////////////////////
 
 	AreaJob(PaloJobRequest* jobRequest) :
-		DirectPaloJob(jobRequest), max_cell_count(s_max_cell_count), isNoPermission(false) {
+		DirectPaloJob(jobRequest), max_cell_count(s_max_cell_count), isNoPermission(false), streamBody(false) {
 	}
 
 	PCellStream getCellPropsStream(CPDatabase db, CPCube cube, CPCubeArea area, const IdentifiersType &properties);
@@ -80,6 +86,19 @@ protected:
 	PArea noPermission;
 	bool isNoPermission;
 	vector<CPDimension> dims;
+	bool streamBody;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief true if the client connection accepts a chunked response
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool canStreamBody() const;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief sends the body generated so far to the client
+	////////////////////////////////////////////////////////////////////////////////
+
+	void flushBody();
 
 	virtual void appendValue(const IdentifiersType &key, const CellValue &value, const vector<CellValue> &prop_vals);
 
@@ -89,6 +108,8 @@ protected:
 
 private:
 	static bool checkElement(CPDimension &dim, Element *e, vector<User::RoleDbCubeRight> &vRights, bool checkPermissions, PDatabase &database, PUser &user);
+	void appendTextValue(StringBuffer *sb, const IdentifiersType &key, const CellValue &value, const vector<CellValue> &prop_vals);
+	void appendBinaryValue(StringBuffer *sb, const IdentifiersType &key, const CellValue &value, const vector<CellValue> &prop_vals);
 	void generateMissingValues(Area::PathIterator &curr, const Area::PathIterator &end, const IdentifiersType *newKey, PCellStream props, bool emptyValues, bool getCellRight, vector<User::RoleDbCubeRight> &vRights, bool isReadableArea, User::RightSetting rs, uint64_t &freeCount);
 	void generateMissingValues_intern(Area::PathIterator &curr, PCellStream props, bool emptyValues, bool getCellRight, vector<User::RoleDbCubeRight> &vRights, bool isReadableArea, User::RightSetting rs, uint64_t &freeCount);
 	void generateValue(const IdentifiersType &key, const CellValue value, PCellStream props, bool getCellRight, vector<User::RoleDbCubeRight> &vRights, bool isReadableArea, User::RightSetting rs, uint64_t &freeCount);
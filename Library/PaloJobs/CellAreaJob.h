@@ -144,6 +144,7 @@ public:
 
 		response = new HttpResponse(HttpResponse::OK);
 		setToken(cube);
+		setContentType();
 
 		bool strElem;
 		initResponse(*jobRequest->area);
@@ -156,6 +156,10 @@ public:
 
 		response = new HttpResponse(HttpResponse::OK);
 		setToken(cube);
+		setContentType();
+
+		// large exports are sent while the area is computed
+		streamBody = canStreamBody();
 
 		IdentifiersType lastKey(cube->getDimensions()->size());
 		PCubeArea area(new CubeArea(database, cube, *jobRequest->area));
@@ -222,9 +226,23 @@ public:
 		}
 
 		StringBuffer *body = &response->getBody();
-		body->appendCsvInteger(progressOfExport);
-		body->appendCsvInteger(progressMax);
-		body->appendEol();
+		if (jobRequest->binary) {
+			// end marker (no cell type is 0), number of cells and progress
+			body->appendChar((char)0);
+			body->appendVarint(linesPrinted);
+			body->appendVarint(progressOfExport);
+			body->appendVarint(progressMax);
+		} else {
+			body->appendCsvInteger(progressOfExport);
+			body->appendCsvInteger(progressMax);
+			body->appendEol();
+		}
+	}
+
+	virtual void appendValue(const IdentifiersType &key, const CellValue &value, const vector<CellValue> &prop_vals)
+	{
+		linesPrinted++;
+		AreaJob::appendValue(key, value, prop_vals);
 	}
 
 	virtual bool checkCondition(const CellValue &value) const
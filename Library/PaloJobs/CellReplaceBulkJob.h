@@ -95,7 +95,13 @@ public:
 			findCube(true, true);
 			findCellPaths(0, user.get());
 			findLockedPaths(0);
-			assertParameter(PaloRequestHandler::VALUES, jobRequest->values);
+			// binary requests pass numeric values as doubles
+			const vector<string> *values = jobRequest->values;
+			const vector<double> *doubleValues = values ? 0 : jobRequest->doubleValues;
+			if (!doubleValues) {
+				assertParameter(PaloRequestHandler::VALUES, values);
+			}
+			size_t valueCount = doubleValues ? doubleValues->size() : values->size();
 
 			cube->disableTokenUpdate(database->getType());
 
@@ -124,8 +130,8 @@ public:
 			bool checkArea = eventProcessor && !withinEvent;
 
 			// check size of values
-			if (cellPaths->size() > jobRequest->values->size()) {
-				throw ParameterException(ErrorException::ERROR_PARAMETER_MISSING, "missing values", PaloRequestHandler::VALUES, (int)jobRequest->values->size());
+			if (cellPaths->size() > valueCount) {
+				throw ParameterException(ErrorException::ERROR_PARAMETER_MISSING, "missing values", PaloRequestHandler::VALUES, (int)valueCount);
 			}
 			const IdentifiersType *dims = cube->getDimensions();
 			size_t dimCount = dims->size();
@@ -176,13 +182,13 @@ public:
 				}
 
 				if (cellType == CubeArea::BASE_STRING) {
-					string value = jobRequest->values->at(i);
+					string value = doubleValues ? UTF8Comparer::doubleToString(doubleValues->at(i), 0, -1, false) : values->at(i);
 					cvc->addPathAndValue(cellPaths->at(i), value.empty() ? CellValue::NullString : CellValue(value), !eventProcessor, cellType);
 				} else {
 					if (cellType == CubeArea::CONSOLIDATED) {
 						hasCons = true;
 					}
-					double value = UTF8Comparer::stringToDouble(jobRequest->values->at(i), false);
+					double value = doubleValues ? doubleValues->at(i) : UTF8Comparer::stringToDouble(values->at(i), false);
 					cvc->addPathAndValue(cellPaths->at(i), value == 0 ? CellValue::NullNumeric : CellValue(value), !eventProcessor, cellType);
 				}
 			}
@@ -214,7 +220,25 @@ public:
 			throw CommitException(ErrorException::ERROR_COMMIT_CANTCOMMIT, "CellReplaceBulkJob failed. Internal error occurred.");
 		}
 
-		server->invalidateCache(database ? database->getId() : NO_IDENTIFIER, cube ? cube->getId() : NO_IDENTIFIER);
+		// bounding area of all changed cells
+		PArea changedArea;
+		if (cellPaths && !cellPaths->empty()) {
+			size_t dims = cellPaths->at(0).size();
+			vector<PSet> sets(dims);
+			for (size_t dim = 0; dim < dims; dim++) {
+				sets[dim].reset(new Set());
+			}
+			for (vector<IdentifiersType>::const_iterator it = cellPaths->begin(); it != cellPaths->end(); ++it) {
+				for (size_t dim = 0; dim < dims; dim++) {
+					sets[dim]->insert(it->at(dim));
+				}
+			}
+			changedArea.reset(new Area(dims));
+			for (size_t dim = 0; dim < dims; dim++) {
+				changedArea->insert(dim, sets[dim]);
+			}
+		}
+		server->invalidateCache(database ? database->getId() : NO_IDENTIFIER, cube ? cube->getId() : NO_IDENTIFIER, changedArea);
 
 		generateOkResponse(cube);
 	}
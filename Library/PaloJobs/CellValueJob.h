@@ -81,6 +81,7 @@ public:
 
 		response = new HttpResponse(HttpResponse::OK);
 		setToken(cube);
+		setContentType();
 
 		CellValue value;
 		vector<CellValue> prop_vals;
@@ -127,6 +127,7 @@ public:
 
 		response = new HttpResponse(HttpResponse::OK);
 		setToken(cube);
+		setContentType();
 
 		size_t i = 0;
 		set<size_t>::iterator endip = invalidPaths.end();
@@ -29,6 +29,10 @@
 
 #include "Scheduler/WriteTask.h"
 
+#ifdef USE_POLL
+#include <poll.h>
+#endif
+
 #include <iostream>
 
 #include "Collections/StringBuffer.h"
@@ -104,6 +108,10 @@ bool WriteTask::handleWrite()
 			} else if (errno_socket != EWOULDBLOCK_SOCKET) {
 				Logger::debug << "write failed in " << __FUNCTION__ << "(" << __FILE__ << "@" << __LINE__ << ")" << " with " << errno_socket << " (" << strerror_socket(errno_socket) << ")" << endl;
 
+				return false;
+			} else if (!waitWritable()) {
+				Logger::warning << "client did not accept data for " << WRITE_TIMEOUT / 1000 << " seconds, closing connection" << endl;
+
 				return false;
 			} else {
 				nr = 0;
@@ -131,6 +139,39 @@ bool WriteTask::handleWrite()
 // protected methods
 // /////////////////////////////////////////////////////////////////////////////
 
+bool WriteTask::waitWritable()
+{
+#ifdef USE_POLL
+	pollfd fds[1];
+
+	fds[0].fd = writeSocket;
+	fds[0].events = POLLOUT;
+	fds[0].revents = 0;
+
+	int np = ::poll(fds, 1, WRITE_TIMEOUT);
+
+	if (np < 0) {
+		return errno_socket == EINTR_SOCKET;
+	}
+	return np > 0;
+#else
+	fd_set writeFds;
+	FD_ZERO(&writeFds);
+	FD_SET(writeSocket, &writeFds);
+
+	timeval tv;
+	tv.tv_sec = WRITE_TIMEOUT / 1000;
+	tv.tv_usec = (WRITE_TIMEOUT % 1000) * 1000;
+
+	int np = (int)select((int)writeSocket + 1, 0, &writeFds, 0, &tv);
+
+	if (np < 0) {
+		return errno_socket == EINTR_SOCKET;
+	}
+	return np > 0;
+#endif
+}
+
 bool WriteTask::hasWriteBuffer() const
 {
 	return writeBuffer != 0;
@@ -78,6 +78,18 @@ public:
 
 protected:
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief milliseconds a blocked socket may stay unwritable
+	////////////////////////////////////////////////////////////////////////////////
+
+	static const int WRITE_TIMEOUT = 60000;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief waits until the socket accepts data, false on timeout or error
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool waitWritable();
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// @brief checks for presence of an active write buffer
 	////////////////////////////////////////////////////////////////////////////////
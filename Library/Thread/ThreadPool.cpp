@@ -37,15 +37,103 @@
 
 namespace palo {
 
+boost::thread_specific_ptr<ThreadPool::WorkerSlot> ThreadPool::worker;
+
 ThreadPoolJob::~ThreadPoolJob()
 {
 }
 
-ThreadPool::ThreadPool() : processorCount(boost::thread::hardware_concurrency()), initSize(processorCount * 2 < 16 ? 16 : processorCount * 2), freeThreads(0), threads(0), hpFreeThreads(0), hpThreads(0), stop(false), destroyed(false)
+WorkStealingDeque::WorkStealingDeque() : top(0), bottom(0), buffer(new Buffer(64))
+{
+}
+
+WorkStealingDeque::~WorkStealingDeque()
+{
+	Buffer *b = buffer.load();
+	for (int64_t i = top.load(); i < bottom.load(); ++i) {
+		delete b->get(i);
+	}
+	delete b;
+	for (vector<Buffer *>::iterator it = retired.begin(); it != retired.end(); ++it) {
+		delete *it;
+	}
+}
+
+WorkStealingDeque::Buffer *WorkStealingDeque::grow(Buffer *b, int64_t bot, int64_t t)
+{
+	Buffer *g = new Buffer(b->size * 2);
+	for (int64_t i = t; i < bot; ++i) {
+		g->put(i, b->get(i));
+	}
+	retired.push_back(b);
+	buffer.store(g, std::memory_order_release);
+	return g;
+}
+
+void WorkStealingDeque::push(QueuedJob *job)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	Buffer *a = buffer.load(std::memory_order_relaxed);
+	if (b - t > a->size - 1) {
+		a = grow(a, b, t);
+	}
+	a->put(b, job);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+QueuedJob *WorkStealingDeque::pop()
+{
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	Buffer *a = buffer.load(std::memory_order_relaxed);
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+	QueuedJob *job = 0;
+	if (t <= b) {
+		job = a->get(b);
+		if (t == b) {
+			// last job, race against thieves
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				job = 0;
+			}
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+	} else {
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+QueuedJob *WorkStealingDeque::steal()
+{
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if (t < b) {
+		Buffer *a = buffer.load(std::memory_order_acquire);
+		QueuedJob *job = a->get(t);
+		if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return job;
+		}
+	}
+	return 0;
+}
+
+bool WorkStealingDeque::empty() const
+{
+	return bottom.load(std::memory_order_acquire) <= top.load(std::memory_order_acquire);
+}
+
+ThreadPool::ThreadPool() : queuedTasks(0), queuedHpTasks(0), processorCount(boost::thread::hardware_concurrency()), initSize(processorCount * 2 < 16 ? 16 : processorCount * 2), freeThreads(0), threads(0), hpFreeThreads(0), hpThreads(0), stop(false), sleepers(0), demand(0), load(0), destroyed(false)
 {
+	for (size_t i = 0; i < initSize; ++i) {
+		deques.push_back(new WorkStealingDeque());
+	}
 	for (size_t i = 0; i < initSize; ++i) {
 		++threads;
-		boost::thread th(ThreadStarter(*this, false));
+		boost::thread th(ThreadStarter(*this, false, i));
 #ifdef ENABLE_GOOGLE_CPU_PROFILER
             ProfilerRegisterThread();
 #endif
@@ -57,90 +145,218 @@ ThreadPool::~ThreadPool()
 	if (!destroyed) {
 		destroy();
 	}
+	for (vector<WorkStealingDeque *>::iterator it = deques.begin(); it != deques.end(); ++it) {
+		delete *it;
+	}
+	for (std::deque<QueuedJob *>::iterator it = tasks.begin(); it != tasks.end(); ++it) {
+		delete *it;
+	}
+	for (std::deque<QueuedJob *>::iterator it = hptasks.begin(); it != hptasks.end(); ++it) {
+		delete *it;
+	}
 }
 
 void ThreadPool::destroy()
 {
+	size_t hpCount;
 	{
 		boost::unique_lock<boost::mutex> lock(m);
 		stop = true;
+		hpCount = hpThreads;
 	}
-	hpWakeup.release(hpThreads);
+	hpWakeup.release(hpCount);
 	wakeup.release(threads);
-	stopped.wait(threads + hpThreads);
+	stopped.wait(threads + hpCount);
 	destroyed = true;
 }
 
-void ThreadPool::addJob(PThreadPoolJob job, unsigned int priority)
+size_t ThreadPool::currentDeque() const
 {
-	bool useHP = false;
-	{
-		boost::unique_lock<boost::mutex> lock(m);
-		switch (priority) {
-		case 2:
-			hptasks.push_front(job);
-			break;
-		case 1:
-			hptasks.push_back(job);
-			break;
-		default:
-			tasks.push(job);
+	WorkerSlot *slot = worker.get();
+	return slot && slot->pool == this ? slot->index : NO_DEQUE;
+}
+
+bool ThreadPool::tryAdmit(bool countThis)
+{
+	size_t limit = processorCount + (countThis ? 0 : 1);
+	size_t current = load.load(std::memory_order_relaxed);
+	while (current < limit) {
+		if (load.compare_exchange_weak(current, current + 1)) {
+			return true;
 		}
-		if (priority && !freeThreads) {
-			useHP = true;
-			if (!hpFreeThreads) {
-				++hpThreads;
-				boost::thread th(ThreadStarter(*this, true));
+	}
+	return false;
+}
+
+bool ThreadPool::admitSplit()
+{
+	if (!demand.load(std::memory_order_relaxed)) {
+		return false;
+	}
+	// reserve the load first, concurrent splitters must not overshoot it
+	if (!tryAdmit(true)) {
+		return false;
+	}
+	size_t current = demand.load(std::memory_order_relaxed);
+	while (current) {
+		if (demand.compare_exchange_weak(current, current - 1)) {
+			return true;
+		}
+	}
+	cancelAdmission();
+	return false;
+}
+
+void ThreadPool::addJob(PThreadPoolJob job, unsigned int priority, bool admitted)
+{
+	++job->tg->count;
+	if (priority) {
+		bool useHP = false;
+		{
+			boost::unique_lock<boost::mutex> lock(m);
+			if (priority == 2) {
+				hptasks.push_front(new QueuedJob(job, false));
+			} else {
+				hptasks.push_back(new QueuedJob(job, false));
+			}
+			++queuedHpTasks;
+			if (!freeThreads) {
+				useHP = true;
+				if (!hpFreeThreads) {
+					++hpThreads;
+					boost::thread th(ThreadStarter(*this, true, NO_DEQUE));
 #ifdef ENABLE_GOOGLE_CPU_PROFILER
             ProfilerRegisterThread();
 #endif
+				}
 			}
 		}
-		++(job->tg->count);
-	}
-	if (useHP) {
-		hpWakeup.release();
+		if (useHP) {
+			hpWakeup.release();
+			return;
+		}
 	} else {
+		if (!admitted) {
+			++load;
+		}
+		size_t index = currentDeque();
+		if (index == NO_DEQUE) {
+			boost::unique_lock<boost::mutex> lock(m);
+			tasks.push_back(new QueuedJob(job, true));
+			++queuedTasks;
+		} else {
+			// owner side of the deque, no lock needed
+			deques[index]->push(new QueuedJob(job, true));
+		}
+	}
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleepers.load(std::memory_order_relaxed)) {
 		wakeup.release();
 	}
-	boost::thread::yield();
 }
 
 void ThreadPool::join(ThreadGroup &tg, bool throwex)
 {
-	tg->sem->set(0);
-	for (;;) {
-		{
-			boost::unique_lock<boost::mutex> lock(m);
-			if (!tg->count) {
-				break;
-			}
+	tg->sem.set(0);
+	size_t index = currentDeque();
+	while (tg->count) {
+		// a joining worker keeps running jobs of any group, jobs split off by it are most
+		// likely waiting in its own deque, the others could belong to joins of other workers
+		QueuedJob *job = index == NO_DEQUE ? 0 : findJob(index, false);
+		if (job) {
+			runJob(job);
+		} else {
+			tg->sem.wait();
 		}
-		tg->sem->wait();
 	}
-	vector<TGError> errors;
-	{
-		boost::unique_lock<boost::mutex> lock(m);
-		errors = tg->errors;
-		delete tg->sem;
-		threadGroups.erase(tg);
-	}
-	if (throwex) {
-		if (!errors.empty()) {
-			TGError &e = errors[0];
-			throw ErrorException(e.type, e.message, e.details, e.ruleId);
+	if (throwex && tg->failed) {
+		vector<TGError> errors;
+		{
+			boost::unique_lock<boost::mutex> lock(tg->errorsLock);
+			errors = tg->errors;
 		}
+		TGError &e = errors[0];
+		throw ErrorException(e.type, e.message, e.details, e.ruleId);
 	}
 }
 
 ThreadPool::ThreadGroup ThreadPool::createThreadGroup(bool notthrow)
 {
+	return ThreadGroup(new TGInner(notthrow));
+}
+
+QueuedJob *ThreadPool::takeShared(std::deque<QueuedJob *> &queue, std::atomic<size_t> &queued)
+{
+	if (!queued.load(std::memory_order_acquire)) {
+		return 0;
+	}
 	boost::unique_lock<boost::mutex> lock(m);
-	threadGroups.push_back(TGInner(notthrow));
-	return --threadGroups.end();
+	if (queue.empty()) {
+		return 0;
+	}
+	QueuedJob *job = queue.front();
+	queue.pop_front();
+	--queued;
+	return job;
+}
+
+QueuedJob *ThreadPool::findJob(size_t index, bool hpOnly)
+{
+	QueuedJob *job = takeShared(hptasks, queuedHpTasks);
+	if (job || hpOnly) {
+		return job;
+	}
+	job = deques[index]->pop();
+	if (job) {
+		return job;
+	}
+	job = takeShared(tasks, queuedTasks);
+	if (job) {
+		return job;
+	}
+	for (size_t i = 1; i < deques.size(); ++i) {
+		WorkStealingDeque *victim = deques[(index + i) % deques.size()];
+		while (!victim->empty()) {
+			job = victim->steal();
+			if (job) {
+				return job;
+			}
+		}
+	}
+	return 0;
 }
 
-void ThreadPool::operator()(bool hpOnly)
+void ThreadPool::runJob(QueuedJob *job)
+{
+	{
+		TGReleaser fin(job->job->tg, this, job->counted);
+		ThreadGroup &tg = job->job->tg;
+		if (!tg->failed) {
+			try {
+				(*job->job)();
+			} catch (ErrorException &e) {
+				if (tg->notthrow) {
+					Logger::error << "error code: " << (int32_t)e.getErrorType() << " description: " << ErrorException::getDescriptionErrorType(e.getErrorType()) << " message: " << e.getMessage() << endl;
+				} else {
+					boost::unique_lock<boost::mutex> lock(tg->errorsLock);
+					tg->errors.push_back(TGError(e.getErrorType(), e.getMessage(), e.getDetails(), e.getRuleId()));
+					tg->failed = true;
+				}
+			} catch (...) {
+				if (tg->notthrow) {
+					Logger::error << "Unhandled exception occurred." << endl;
+				} else {
+					boost::unique_lock<boost::mutex> lock(tg->errorsLock);
+					tg->errors.push_back(TGError(ErrorException::ERROR_INTERNAL, "Internal error occurred", "Internal error occurred", 0));
+					tg->failed = true;
+				}
+			}
+		}
+	}
+	delete job;
+}
+
+void ThreadPool::operator()(bool hpOnly, size_t index)
 {
 #if defined(_MSC_VER)
 	DumpHandler::register_handler("");
@@ -150,65 +366,44 @@ void ThreadPool::operator()(bool hpOnly)
 #endif
 
 	SemaphoreReleaser st(stopped);
-	PThreadPoolJob job;
-	{
-		boost::unique_lock<boost::mutex> lock(m);
-		if (hpOnly) {
-			++hpFreeThreads;
-		} else {
-			++freeThreads;
-		}
+	if (!hpOnly) {
+		worker.reset(new WorkerSlot(this, index));
 	}
-	for (;;) {
+	std::atomic<size_t> &free = hpOnly ? hpFreeThreads : freeThreads;
+	++free;
+	while (!stop) {
+		QueuedJob *job;
 		if (hpOnly) {
 			hpWakeup.wait();
-		} else {
-			wakeup.wait();
-		}
-		bool err = false;
-		bool notthrow = false;
-		{
-			boost::unique_lock<boost::mutex> lock(m);
 			if (stop) {
 				break;
 			}
-			if (hpOnly) {
-				--hpFreeThreads;
-			} else {
-				--freeThreads;
-			}
-			if (hptasks.empty()) {
-				job = tasks.front();
-				tasks.pop();
-			} else {
-				job = hptasks.front();
-				hptasks.pop_front();
-			}
-			err = !job->tg->errors.empty();
-			notthrow = job->tg->notthrow;
-		}
-		TGReleaser fin(job->tg, this, hpOnly);
-		if (!err) {
-			try {
-				(*job)();
-			} catch (ErrorException &e) {
-				if (notthrow) {
-					Logger::error << "error code: " << (int32_t)e.getErrorType() << " description: " << ErrorException::getDescriptionErrorType(e.getErrorType()) << " message: " << e.getMessage() << endl;
-				} else {
-					boost::unique_lock<boost::mutex> lock(m);
-					job->tg->errors.push_back(TGError(e.getErrorType(), e.getMessage(), e.getDetails(), e.getRuleId()));
+			job = findJob(index, true);
+		} else {
+			job = findJob(index, false);
+			if (!job) {
+				// announce sleeping before the last check, addJob wakes us up if anything arrived meanwhile
+				++sleepers;
+				++demand;
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				job = findJob(index, false);
+				if (!job && !stop) {
+					wakeup.wait();
 				}
-			} catch (...) {
-				if (notthrow) {
-					Logger::error << "Unhandled exception occurred." << endl;
-				} else {
-					boost::unique_lock<boost::mutex> lock(m);
-					job->tg->errors.push_back(TGError(ErrorException::ERROR_INTERNAL, "Internal error occurred", "Internal error occurred", 0));
+				--sleepers;
+				// withdraw the demand unless a splitter took it already
+				size_t current = demand.load(std::memory_order_relaxed);
+				while (current && !demand.compare_exchange_weak(current, current - 1)) {
 				}
 			}
 		}
-		job.reset();
+		if (job) {
+			--free;
+			runJob(job);
+			++free;
+		}
 	}
+	worker.reset();
 }
 
 }
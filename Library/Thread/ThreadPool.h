@@ -33,8 +33,10 @@
 #include <boost/thread/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
 
-#include <queue>
+#include <deque>
+#include <atomic>
 
 #include "Exceptions/ErrorException.h"
 
@@ -87,12 +89,63 @@ struct TGError {
 	uint32_t ruleId;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief state of one thread group
+///
+/// Jobs of a group only touch its own counter, semaphore and error list,
+/// joining a group never takes the lock of the thread pool.
+////////////////////////////////////////////////////////////////////////////////
+
 struct TGInner {
-	TGInner(bool notthrow) : count(0), sem(new Semaphore), notthrow(notthrow) {}
-	size_t count;
-	Semaphore *sem;
+	TGInner(bool notthrow) : count(0), failed(false), notthrow(notthrow) {}
+	std::atomic<size_t> count;
+	std::atomic<bool> failed;
+	Semaphore sem;
+	boost::mutex errorsLock;
 	vector<TGError> errors;
 	bool notthrow;
+private:
+	TGInner(const TGInner &);
+};
+
+struct QueuedJob {
+	QueuedJob(PThreadPoolJob job, bool counted) : job(job), counted(counted) {}
+	PThreadPoolJob job;
+	bool counted;	// included in the load of the pool
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Chase-Lev work stealing deque
+///
+/// The owning worker pushes and pops jobs at the bottom, other workers steal
+/// from the top. Buffers replaced while growing are kept until destruction
+/// because thieves can still read from them.
+////////////////////////////////////////////////////////////////////////////////
+
+class WorkStealingDeque {
+public:
+	WorkStealingDeque();
+	~WorkStealingDeque();
+	void push(QueuedJob *job);
+	QueuedJob *pop();
+	QueuedJob *steal();
+	bool empty() const;
+private:
+	struct Buffer {
+		Buffer(int64_t size) : size(size), jobs(new std::atomic<QueuedJob *>[size]) {}
+		~Buffer() {delete[] jobs;}
+		QueuedJob *get(int64_t i) const {return jobs[i & (size - 1)].load(std::memory_order_relaxed);}
+		void put(int64_t i, QueuedJob *job) {jobs[i & (size - 1)].store(job, std::memory_order_relaxed);}
+		int64_t size;
+		std::atomic<QueuedJob *> *jobs;
+	};
+	Buffer *grow(Buffer *buffer, int64_t bottom, int64_t top);
+	WorkStealingDeque(const WorkStealingDeque &);
+
+	std::atomic<int64_t> top;
+	std::atomic<int64_t> bottom;
+	std::atomic<Buffer *> buffer;
+	vector<Buffer *> retired;
 };
 
 class ThreadPool {
@@ -100,36 +153,88 @@ class ThreadPool {
 	friend class ThreadStarter;
 	friend class TGReleaser;
 public:
-	typedef std::list<TGInner>::iterator ThreadGroup;
+	typedef boost::shared_ptr<TGInner> ThreadGroup;
 
 	ThreadPool();
 	~ThreadPool();
-	void addJob(PThreadPoolJob job, unsigned int priority = 0);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief adds job, admitted jobs were already counted by tryAdmit()
+	///
+	/// Jobs added from a worker thread go to its own deque, other jobs to the
+	/// shared queue. Priority jobs are served before all others.
+	////////////////////////////////////////////////////////////////////////////////
+	void addJob(PThreadPoolJob job, unsigned int priority = 0, bool admitted = false);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief waits for all jobs of the group
+	///
+	/// A worker thread runs queued jobs of any group meanwhile, it sleeps only
+	/// if there is nothing left to run.
+	////////////////////////////////////////////////////////////////////////////////
 	void join(ThreadGroup &tg, bool throwex = true);
 	ThreadGroup createThreadGroup(bool notthrow = false);
-	bool hasFreeCore(bool countThis) {return freeThreads - (countThis ? 1 : 0) >= threads - processorCount;}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief reserves a core for a job split off the running one
+	///
+	/// Returns false if all cores are taken by queued or running jobs. A true
+	/// result has to be followed by addJob(job, 0, true) or cancelAdmission().
+	////////////////////////////////////////////////////////////////////////////////
+	bool tryAdmit(bool countThis = true);
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief admits a job split off the running one for a waiting worker
+	///
+	/// Idle workers post their demand before they block, the call only takes
+	/// one of these admissions and never competes for the load counter while
+	/// all workers are busy. The core is reserved like in tryAdmit() before the
+	/// demand is taken and given back if another splitter was faster. Same
+	/// follow-up as tryAdmit().
+	////////////////////////////////////////////////////////////////////////////////
+	bool admitSplit();
+	void cancelAdmission() {--load;}
+	bool hasFreeCore(bool countThis) {return load.load(std::memory_order_relaxed) + (countThis ? 1 : 0) <= processorCount;}
 	size_t getCoreCount() {return processorCount;}
 	void destroy();
-	int getUsage() {return (int)((threads - freeThreads) * 100 / threads);}
+	int getUsage() {return (int)((threads - freeThreads.load(std::memory_order_relaxed)) * 100 / threads);}
 
 private:
-	void operator()(bool hpOnly);
+	struct WorkerSlot {
+		WorkerSlot(ThreadPool *pool, size_t index) : pool(pool), index(index) {}
+		ThreadPool *pool;
+		size_t index;
+	};
+	static const size_t NO_DEQUE = size_t(-1);
+
+	void operator()(bool hpOnly, size_t index);
 	ThreadPool(const ThreadPool &);
-	std::queue<PThreadPoolJob> tasks;
-	std::deque<PThreadPoolJob> hptasks;
+	QueuedJob *findJob(size_t index, bool hpOnly);
+	QueuedJob *takeShared(std::deque<QueuedJob *> &queue, std::atomic<size_t> &queued);
+	void runJob(QueuedJob *job);
+	size_t currentDeque() const;
+
+	std::deque<QueuedJob *> tasks;
+	std::deque<QueuedJob *> hptasks;
+	std::atomic<size_t> queuedTasks;
+	std::atomic<size_t> queuedHpTasks;
 	boost::mutex m;
+	vector<WorkStealingDeque *> deques;
 	size_t processorCount;
 	size_t initSize;
 	Semaphore stopped;
 	Semaphore wakeup;
-	size_t freeThreads;
+	std::atomic<size_t> freeThreads;
 	size_t threads;
-	size_t hpFreeThreads;
+	std::atomic<size_t> hpFreeThreads;
 	size_t hpThreads;
 	Semaphore hpWakeup;
-	bool stop;
-	std::list<TGInner> threadGroups;
+	std::atomic<bool> stop;
+	std::atomic<size_t> sleepers;
+	std::atomic<size_t> demand;	// admissions posted by idle workers
+	std::atomic<size_t> load;	// queued and running jobs
 	bool destroyed;
+	static boost::thread_specific_ptr<WorkerSlot> worker;
 };
 typedef boost::shared_ptr<ThreadPool> PThreadPool;
 
@@ -146,31 +251,31 @@ private:
 
 class TGReleaser {
 public:
-	TGReleaser(ThreadPool::ThreadGroup &s, ThreadPool *tp, bool hpOnly) :s(s), tp(tp), hpOnly(hpOnly) {}
+	TGReleaser(ThreadPool::ThreadGroup &s, ThreadPool *tp, bool counted) :s(s), tp(tp), counted(counted) {}
 	~TGReleaser() {
-		boost::unique_lock<boost::mutex> lock(tp->m);
-		if (hpOnly) {
-			++tp->hpFreeThreads;
-		} else {
-			++tp->freeThreads;
+		if (counted) {
+			--tp->load;
 		}
-		--s->count;
-		s->sem->release();
+		// the group can be destroyed by join as soon as the counter drops to zero
+		ThreadPool::ThreadGroup group = s;
+		--group->count;
+		group->sem.release();
 	}
 private:
 	ThreadPool::ThreadGroup &s;
 	ThreadPool *tp;
-	bool hpOnly;
+	bool counted;
 };
 
 class ThreadStarter
 {
 public:
-	ThreadStarter(ThreadPool &tp, bool hpOnly) : tp(tp), hpOnly(hpOnly) {}
-	void operator()() {tp(hpOnly);}
+	ThreadStarter(ThreadPool &tp, bool hpOnly, size_t index) : tp(tp), hpOnly(hpOnly), index(index) {}
+	void operator()() {tp(hpOnly, index);}
 private:
 	ThreadPool &tp;
 	bool hpOnly;
+	size_t index;
 };
 
 }
@@ -43,10 +43,38 @@
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
+
 namespace palo {
 
+MTPaloHttpInterface::MTPaloHttpInterface(PaloOptions* options, JobAnalyser* analyser) :
+	PaloHttpInterface(options, analyser), connectionLimit(options->connectionLimit > 0 ? options->connectionLimit : 0),
+	connectionTimeout(options->connectionTimeout > 0 ? options->connectionTimeout : 0), idleWheelTime(0)
+#if defined(__linux__)
+	, epollFd(-1)
+#endif
+{
+	if (connectionTimeout) {
+		idleWheel.resize((size_t)connectionTimeout);
+	}
+}
+
 void MTPaloHttpInterface::ConnectionHandler::operator()()
 {
+#if defined(__linux__)
+	if (intf->epollFd != -1) {
+		// the one-shot event is armed again after the request, no other worker gets the connection meanwhile
+		socket_t fd = task->getReadSocket();
+		task->Tranzact();
+		WriteLocker connection_locker(&intf->connections_lock);
+		task->notWorking();
+		intf->rearmConnection(fd, task);
+		return;
+	}
+#endif
+
 	boost::posix_time::time_duration t;
 	boost::posix_time::time_duration timeoutHigh(boost::posix_time::milliseconds(500));
 	boost::posix_time::time_duration timeoutLow(boost::posix_time::milliseconds(5000));
@@ -78,6 +106,13 @@ void MTPaloHttpInterface::ConnectionHandler::operator()()
 	} while (ret > 0);
 	WriteLocker connection_locker(&intf->connections_lock);
 	task->notWorking();
+	socket_t crt = task->getReadSocket();
+	if (crt != INVALID_SOCKET) {
+		connection_map_type::iterator it = intf->active_connections.find(crt);
+		if (it != intf->active_connections.end()) {
+			intf->touchConnection(crt, it->second, time(0));
+		}
+	}
 }
 
 void MTPaloHttpInterface::handleShutdown()
@@ -90,13 +125,124 @@ void MTPaloHttpInterface::handleShutdown()
 	PaloHttpInterface::handleShutdown();
 }
 
+bool MTPaloHttpInterface::addConnection(HttpServer *server)
+{
+	PHttpServerTask task((server)->CreateConnectionTask());
+	if (!task || task->getReadSocket() == INVALID_SOCKET) {
+		return false;
+	}
+	socket_t fd = task->getReadSocket();
+
+	WriteLocker connection_locker(&connections_lock);
+	if (connectionLimit && active_connections.size() >= connectionLimit) {
+		Logger::warning << "limit of " << connectionLimit << " client connections reached, closing new connection" << endl;
+		task->handleShutdown();
+		return false;
+	}
+	// the descriptor of a closed connection can be reused by the new one
+	Connection &conn = active_connections[fd];
+	conn = Connection(task, 0);
+	touchConnection(fd, conn, time(0));
+
+#if defined(__linux__)
+	if (epollFd != -1) {
+		struct epoll_event ev;
+		ev.events = EPOLLIN | EPOLLET | EPOLLONESHOT;
+		ev.data.fd = fd;
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+			Logger::warning << "cannot watch connection on " << fd << " (" << strerror(errno) << ")" << endl;
+			task->handleShutdown();
+			active_connections.erase(fd);
+			return false;
+		}
+	}
+#endif
+	return true;
+}
+
+void MTPaloHttpInterface::touchConnection(socket_t fd, Connection &conn, time_t now)
+{
+	conn.lastActive = now;
+	if (connectionTimeout && conn.wheelSlot == NO_WHEEL_SLOT) {
+		conn.wheelSlot = (size_t)(now % connectionTimeout);
+		idleWheel[conn.wheelSlot].push_back(fd);
+	}
+}
+
+void MTPaloHttpInterface::closeIdleConnections(time_t now)
+{
+	if (!connectionTimeout) {
+		return;
+	}
+	if (!idleWheelTime || now - idleWheelTime > 2 * connectionTimeout) {
+		idleWheelTime = now - connectionTimeout;
+	}
+
+	WriteLocker connection_locker(&connections_lock);
+	for (; idleWheelTime + connectionTimeout < now; idleWheelTime++) {
+		// the slot of second s is shared with second s + timeout
+		time_t second = idleWheelTime + 1;
+		size_t index = (size_t)(second % connectionTimeout);
+		vector<socket_t> slot;
+		slot.swap(idleWheel[index]);
+
+		// entries of closed connections can remain, their descriptor may be reused by a newer one
+		vector<connection_map_type::iterator> due;
+		for (vector<socket_t>::iterator i = slot.begin(); i != slot.end(); ++i) {
+			connection_map_type::iterator it = active_connections.find(*i);
+			if (it != active_connections.end() && it->second.wheelSlot == index) {
+				it->second.wheelSlot = NO_WHEEL_SLOT;
+				due.push_back(it);
+			}
+		}
+
+		for (vector<connection_map_type::iterator>::iterator i = due.begin(); i != due.end(); ++i) {
+			Connection &conn = (*i)->second;
+			if (conn.lastActive + connectionTimeout > now) {
+				touchConnection((*i)->first, conn, conn.lastActive);
+			} else if (!conn.task->isWorking()) {
+				Logger::debug << "closing client connection idle for " << (now - conn.lastActive) << " seconds" << endl;
+				conn.task->handleShutdown();
+				active_connections.erase(*i);
+			}
+			// a working connection is added again when its request is done
+		}
+	}
+}
+
 void MTPaloHttpInterface::run()
 {
 	PThreadPool tp = Context::getContext()->getServer()->getThreadPool();
 	ThreadPool::ThreadGroup tg = Context::getContext()->getServer()->getThreadPool()->createThreadGroup(true);
 	Context::reset();
-	fd_set sockets;
 	runnable = true;
+
+#if defined(__linux__)
+	runEpoll(tp, tg);
+#else
+	runSelect(tp, tg);
+#endif
+
+	PaloSession::printActiveJobs("found running \"", "\" job");
+	{
+		WriteLocker lock(&connections_lock);
+		for (connection_map_type::iterator i = active_connections.begin(); i != active_connections.end(); ++i) {
+			i->second.task->handleShutdown();
+		}
+	}
+	tp->join(tg);
+	tp->destroy();
+#if defined(__linux__)
+	if (epollFd != -1) {
+		close(epollFd);
+	}
+#endif
+	Logger::info << "all jobs finished, proceeding with shutdown" << endl;
+}
+
+void MTPaloHttpInterface::runSelect(PThreadPool tp, ThreadPool::ThreadGroup &tg)
+{
+	fd_set sockets;
 	struct timeval tv;
 
 	for (;;) {
@@ -113,10 +259,10 @@ void MTPaloHttpInterface::run()
 		}
 		{
 			WriteLocker lock(&connections_lock);
-			for (std::vector<PHttpServerTask>::iterator i = active_connections.begin(); i != active_connections.end();) {
-				socket_t crt = (*i)->getReadSocket();
+			for (connection_map_type::iterator i = active_connections.begin(); i != active_connections.end();) {
+				socket_t crt = i->second.task->getReadSocket();
 				if (crt == INVALID_SOCKET) {
-					i = active_connections.erase(i);
+					active_connections.erase(i++);
 				} else {
 					FD_SET(crt, &sockets);
 					if (max < crt) {
@@ -126,7 +272,7 @@ void MTPaloHttpInterface::run()
 				}
 			}
 		}
-		tv.tv_sec = 10;
+		tv.tv_sec = connectionTimeout ? 1 : 10;
 		tv.tv_usec = 0;
 		int ret = select((int)max + 1, &sockets, NULL, NULL, &tv);
 		if (!runnable) {
@@ -137,41 +283,111 @@ void MTPaloHttpInterface::run()
 				socket_t crt = (*pServer)->getReadSocket();
 				if (crt != INVALID_SOCKET) {
 					if (FD_ISSET(crt, &sockets)) {
-						PHttpServerTask crt((*pServer)->CreateConnectionTask());
-						{
-							WriteLocker connection_locker(&connections_lock);
-							active_connections.push_back(crt);
-						}
+						addConnection(*pServer);
 					}
 				}
 			}
 			{
 				WriteLocker lock(&connections_lock);
-				for (std::vector<PHttpServerTask>::iterator i = active_connections.begin(); i != active_connections.end(); ++i) {
-					socket_t crt = (*i)->getReadSocket();
+				for (connection_map_type::iterator i = active_connections.begin(); i != active_connections.end(); ++i) {
+					socket_t crt = i->second.task->getReadSocket();
 					if (crt != INVALID_SOCKET) {
-						if (FD_ISSET(crt, &sockets) && !(*i)->isWorking()) {
-							(*i)->working();
-							tp->addJob(PThreadPoolJob(new ConnectionHandler(*i, this, tg, tp)));
+						if (FD_ISSET(crt, &sockets) && !i->second.task->isWorking()) {
+							i->second.task->working();
+							tp->addJob(PThreadPoolJob(new ConnectionHandler(i->second.task, this, tg, tp)));
 						}
 					}
 				}
 			}
 		}
+		closeIdleConnections(time(0));
 	}
+}
 
-	PaloSession::printActiveJobs("found running \"", "\" job");
-	{
-		WriteLocker lock(&connections_lock);
-		for (std::vector<PHttpServerTask>::iterator i = active_connections.begin(); i != active_connections.end(); ++i) {
-			(*i)->handleShutdown();
+#if defined(__linux__)
+void MTPaloHttpInterface::runEpoll(PThreadPool tp, ThreadPool::ThreadGroup &tg)
+{
+	epollFd = epoll_create(1024);
+	if (epollFd == -1) {
+		Logger::warning << "epoll_create failed (" << strerror(errno) << "), using select" << endl;
+		runSelect(tp, tg);
+		return;
+	}
+
+	for (vector<HttpServer*>::iterator i = servers.begin(); i != servers.end(); ++i) {
+		socket_t crt = (*i)->getReadSocket();
+		if (crt != INVALID_SOCKET) {
+			struct epoll_event ev;
+			ev.events = EPOLLIN;
+			ev.data.fd = crt;
+			if (epoll_ctl(epollFd, EPOLL_CTL_ADD, crt, &ev) == -1) {
+				Logger::error << "cannot watch listener on " << crt << " (" << strerror(errno) << ")" << endl;
+			}
 		}
 	}
-	tp->join(tg);
-	tp->destroy();
-	Logger::info << "all jobs finished, proceeding with shutdown" << endl;
+
+	vector<struct epoll_event> events(256);
+	while (runnable) {
+		// listeners closed on shutdown do not wake epoll up, check the flag every second
+		int ret = epoll_wait(epollFd, &events[0], (int)events.size(), 1000);
+		if (!runnable) {
+			break;
+		}
+		if (ret == -1 && errno != EINTR) {
+			Logger::warning << "epoll_wait failed (" << strerror(errno) << ")" << endl;
+		}
+		for (int n = 0; n < ret; n++) {
+			socket_t crt = events[n].data.fd;
+			HttpServer *listener = 0;
+			for (vector<HttpServer*>::iterator i = servers.begin(); i != servers.end(); ++i) {
+				if ((*i)->getReadSocket() == crt) {
+					listener = *i;
+					break;
+				}
+			}
+
+			if (listener) {
+				addConnection(listener);
+				continue;
+			}
+
+			WriteLocker lock(&connections_lock);
+			connection_map_type::iterator it = active_connections.find(crt);
+			if (it != active_connections.end() && !it->second.task->isWorking()) {
+				it->second.task->working();
+				tp->addJob(PThreadPoolJob(new ConnectionHandler(it->second.task, this, tg, tp)));
+			}
+		}
+		closeIdleConnections(time(0));
+	}
 }
 
+void MTPaloHttpInterface::rearmConnection(socket_t fd, PHttpServerTask task)
+{
+	connection_map_type::iterator it = active_connections.find(fd);
+	if (task->getReadSocket() == INVALID_SOCKET) {
+		// closed by the worker, the descriptor may belong to a new connection already
+		if (it != active_connections.end() && it->second.task == task) {
+			active_connections.erase(it);
+		}
+		return;
+	}
+	if (it == active_connections.end()) {
+		return;
+	}
+	touchConnection(fd, it->second, time(0));
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN | EPOLLET | EPOLLONESHOT;
+	ev.data.fd = fd;
+	if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+		Logger::warning << "cannot watch connection on " << fd << " (" << strerror(errno) << ")" << endl;
+		task->handleShutdown();
+		active_connections.erase(it);
+	}
+}
+#endif
+
 void MTPaloHttpInterface::EnablePaloInterface(PaloHttpServer *paloHttpServer)
 {
 	PaloHttpInterface::EnablePaloInterface(paloHttpServer);
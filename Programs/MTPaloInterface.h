@@ -53,16 +53,47 @@ private:
 		virtual void operator()();
 	};
 
-	std::vector<PHttpServerTask> active_connections;
+	static const size_t NO_WHEEL_SLOT = size_t(-1);
+
+	struct Connection {
+		Connection() : lastActive(0), wheelSlot(NO_WHEEL_SLOT) {}
+		Connection(PHttpServerTask task, time_t lastActive) : task(task), lastActive(lastActive), wheelSlot(NO_WHEEL_SLOT) {}
+
+		PHttpServerTask task;
+		time_t lastActive;
+		size_t wheelSlot;	// slot of idleWheel holding the connection
+	};
+	typedef std::map<socket_t, Connection> connection_map_type;
+
+	connection_map_type active_connections;
 	Mutex connections_lock;
+	size_t connectionLimit;
+	time_t connectionTimeout;
+
+	// every connection is in one slot, checked when the timeout of the slot's second is
+	// over and moved to the slot of its last activity if it was active since
+	std::vector<std::vector<socket_t> > idleWheel;
+	time_t idleWheelTime;
+#if defined(__linux__)
+	int epollFd;
+#endif
 public:
-	MTPaloHttpInterface(PaloOptions* options, JobAnalyser* analyser) : PaloHttpInterface(options, analyser) {}
+	MTPaloHttpInterface(PaloOptions* options, JobAnalyser* analyser);
 	virtual ~MTPaloHttpInterface() {}
 
 	void handleShutdown();
 	void run();
 private:
 	virtual void EnablePaloInterface(PaloHttpServer *paloHttpServer);
+
+	void runSelect(PThreadPool tp, ThreadPool::ThreadGroup &tg);
+	bool addConnection(HttpServer *server);
+	void touchConnection(socket_t fd, Connection &conn, time_t now);
+	void closeIdleConnections(time_t now);
+#if defined(__linux__)
+	void runEpoll(PThreadPool tp, ThreadPool::ThreadGroup &tg);
+	void rearmConnection(socket_t fd, PHttpServerTask task);
+#endif
 };
 
 }
@@ -43,6 +43,11 @@
 #include "Worker/DimensionWorker.h"
 #include "PaloJobs/AreaJob.h"
 #include "InputOutput/FileReaderBF.h"
+#include "Engine/StorageCpu.h"
+#include "InputOutput/JournalFileWriter.h"
+#include "HttpServer/HttpCompressor.h"
+#include "Engine/Legacy/CompiledRule.h"
+#include "HttpServer/HttpServerTask.h"
 
 namespace palo {
 using namespace std;
@@ -53,6 +58,18 @@ using namespace std;
 
 // build options parser
 static const char * AllowedOptions[] = {"?|help",
+        "0|binary-journal",
+        "1:load-threads          <number of cube files read in parallel on load>",
+        "2|incremental-save",
+        "3|sync-journal",
+        "4:connection-limit      <maximum number of client connections>",
+        "5:connection-timeout    <seconds an idle client connection is kept open>",
+        "6|chunked-responses",
+        "7:compression-threshold <minimum response size in bytes sent compressed>",
+        "8|compile-rules",
+#if defined(ENABLE_TEST_MODE)
+        "9|benchmark",
+#endif
         "a+admin                 <address> <port>",
         "A|auto-load",
         "b:cache-barrier         <maximum of number_of_cells to store in each Cube cache>",
@@ -68,6 +85,7 @@ static const char * AllowedOptions[] = {"?|help",
         "F:friendly-service-name <service-name>",
 #endif
         "g:cross-origin          <domain_name>",
+        "G:cache-budget          <maximum of number_of_values to store in all Cube caches>",
         "h+http                  <address> <port>",
 #if defined(ENABLE_HTTPS)
         "H+https                 <port>",
@@ -83,6 +101,7 @@ static const char * AllowedOptions[] = {"?|help",
         "M:session-timeout       <seconds>",
         "m:undo-memory-size      <undo_memory_size_in_bytes_per_lock>",
         "n|load-init-file",
+        "N|map-cube-pages",
         "o:log                   <logfile>",
         "O|amazon-id",
         "p:password              <private-password>",
@@ -137,6 +156,7 @@ PaloOptions::PaloOptions(int argc, char** argv) :
 	ignoreJournal = false;
 	autoLoadDb = true;
 	cacheBarrier = 1000000.0;
+	cacheBudget = 10000000.0;
 	changeDirectory = true;
 	dataDirectory = "./Data";
 	defaultTtl = -1;
@@ -183,6 +203,19 @@ PaloOptions::PaloOptions(int argc, char** argv) :
 
 	crypt = false;
 	saveCSV = true;
+	mapCubePages = false;
+	loadThreads = 0;
+	incrementalSave = false;
+	syncJournal = false;
+	binaryJournal = false;
+	connectionLimit = 0;
+	connectionTimeout = 0;
+	chunkedResponses = false;
+	compressionThreshold = 0;
+	compileRules = false;
+#ifdef ENABLE_TEST_MODE
+	benchmark = false;
+#endif
 }
 
 // /////////////////////////////////////////////////////////////////////////////
@@ -296,10 +329,19 @@ void PaloOptions::updateGlobals()
 
 	Server::setCrossOrigin(crossOrigin);
 	Cube::setCacheBarrier(cacheBarrier);
+	ValueCache::setBudget(cacheBudget);
 	Cube::setGoalseekCellLimit(goalseekCellLimit);
 	Cube::setGoalseekTimeout(goalseekTimeout);
 	Cube::setIgnoreCellData(ignoreCellData);
 	Cube::setSaveCSV(saveCSV);
+	StorageCpu::setMapPages(mapCubePages);
+	Cube::setLoadThreads(loadThreads);
+	Cube::setIncrementalSave(incrementalSave);
+	JournalSync::setSyncJournals(syncJournal);
+	JournalFile::setBinaryRecords(binaryJournal);
+	HttpServerTask::setChunkedResponses(chunkedResponses);
+	HttpCompressor::setThreshold(compressionThreshold);
+	paloLegacy::CompiledRule::setEnabled(compileRules);
 	if (defaultDbRight.length()) {
 		Server::setDefaultDbRight(defaultDbRight);
 	}
@@ -378,13 +420,78 @@ void PaloOptions::usage()
 		     << "use dimension worker:  " << (useDimensionWorker ? "true" : "false") << "\n"
 		     << "drillthrough enabled:  " << (drillThroughEnabled ? "true" : "false") << "\n"
 		     << "cache-barrier:         " << cacheBarrier << "\n"
+		     << "cache-budget:          " << cacheBudget << "\n"
+		     << "map cube pages:        " << (mapCubePages ? "true" : "false") << "\n"
+		     << "load-threads:          " << loadThreads << "\n"
+		     << "incremental save:      " << (incrementalSave ? "true" : "false") << "\n"
+		     << "sync journal:          " << (syncJournal ? "true" : "false") << "\n"
+		     << "binary journal:        " << (binaryJournal ? "true" : "false") << "\n"
+		     << "connection-limit:      " << connectionLimit << "\n"
+		     << "connection-timeout:    " << connectionTimeout << "\n"
+		     << "chunked responses:     " << (chunkedResponses ? "true" : "false") << "\n"
+		     << "compression-threshold: " << compressionThreshold << "\n"
+		     << "compile rules:         " << (compileRules ? "true" : "false") << "\n"
+#ifdef ENABLE_TEST_MODE
+		     << "benchmark:             " << (benchmark ? "true" : "false") << "\n"
+#endif
 		     << "gpu server enabled:    " << (enableGpu ? "true" : "false") << "\n"
 		     << "gpu device ids:              list of gpu device ids\n"
 		     ;
 		cout << "\n"
 		     << "The server side cache is configured to 1000000 cells per cube\n"
 		     << "by default. In order to deactivate the cache completely set\n"
-		     << "<cache-barrier> to 0.\n";
+		     << "<cache-barrier> to 0. All cube caches together keep at most\n"
+		     << "10000000 values by default, least valuable parts of the caches\n"
+		     << "are evicted above <cache-budget>. Set it to 0 for no limit.\n";
+
+		cout << "\n"
+		     << "With map-cube-pages cube files are saved with page-aligned cell\n"
+		     << "storage which is mapped into memory on load and read on first\n"
+		     << "access. Encrypted files are always read completely.\n";
+
+		cout << "\n"
+		     << "On load the cell data of the cubes of a database is read by up to\n"
+		     << "<load-threads> threads, 0 (default) uses all cores and 1 reads the\n"
+		     << "cubes one after the other.\n";
+
+		cout << "\n"
+		     << "With incremental-save only the changed cell pages of a cube are\n"
+		     << "appended to its delta file, which is merged into the BIN file in the\n"
+		     << "background. Requires no-csv-save, cubes with alias dimensions are\n"
+		     << "always saved completely.\n";
+
+		cout << "\n"
+		     << "With sync-journal a commit returns when its journal entries are\n"
+		     << "written to disk. Journals of concurrent commits are synced together.\n"
+		     << "A journal that cannot be written to disk stops the server, the\n"
+		     << "changes of commits not synced yet are lost.\n"
+		     << "With binary-journal cell changes are journaled as checksummed binary\n"
+		     << "records, which are smaller and replayed faster.\n";
+
+		cout << "\n"
+		     << "New client connections above <connection-limit> are closed and\n"
+		     << "connections idle for <connection-timeout> seconds are closed by the\n"
+		     << "server. 0 (default) means no limit.\n";
+
+		cout << "\n"
+		     << "With chunked-responses large cell exports are sent to HTTP/1.1\n"
+		     << "clients in chunks while they are computed.\n";
+
+		cout << "\n"
+		     << "Responses of at least <compression-threshold> bytes are compressed\n"
+		     << "with gzip or deflate if the client accepts it. 0 (default) disables\n"
+		     << "compression.\n";
+
+		cout << "\n"
+		     << "With compile-rules numeric rules evaluated often are translated\n"
+		     << "from bytecode to threaded code, which skips the opcode dispatch of\n"
+		     << "the rule interpreter.\n";
+
+#ifdef ENABLE_TEST_MODE
+		cout << "\n"
+		     << "With benchmark the server loads the databases, prints the results\n"
+		     << "of the engine benchmarks and exits without serving clients.\n";
+#endif
 
 		cout << "\n"
 		     << "In a locked cube area it is possible to undo changes. Each lock can use\n"
@@ -504,6 +611,11 @@ void PaloOptions::parseOptions(OptionsIterator& iter, bool commandLine)
 				crossOrigin = optarg;
 				break;
 
+			case 'G':
+				d = UTF8Comparer::stringToDouble(optarg, false);
+				cacheBudget = d;
+				break;
+
 			case 'h':
 				if (httpPorts.size() % 2 == 1) {
 					i = StringUtils::stringToInteger(optarg);
@@ -538,6 +650,36 @@ void PaloOptions::parseOptions(OptionsIterator& iter, bool commandLine)
 				saveCSV = false;
 				break;
 
+			case 'N':
+				mapCubePages = !mapCubePages;
+				break;
+
+			case '2':
+				incrementalSave = !incrementalSave;
+				break;
+
+			case '3':
+				syncJournal = !syncJournal;
+				break;
+
+			case '0':
+				binaryJournal = !binaryJournal;
+				break;
+
+			case '6':
+				chunkedResponses = !chunkedResponses;
+				break;
+
+			case '8':
+				compileRules = !compileRules;
+				break;
+
+#ifdef ENABLE_TEST_MODE
+			case '9':
+				benchmark = !benchmark;
+				break;
+#endif
+
 			case 'k':
 				cryptPassphrase = optarg;
 				break;
@@ -688,6 +830,26 @@ void PaloOptions::parseOptions(OptionsIterator& iter, bool commandLine)
 				goalseekCellLimit = i;
 				break;
 
+			case '1':
+				i = StringUtils::stringToInteger(optarg);
+				loadThreads = i < 0 ? 0 : i;
+				break;
+
+			case '4':
+				i = StringUtils::stringToInteger(optarg);
+				connectionLimit = i < 0 ? 0 : i;
+				break;
+
+			case '5':
+				i = StringUtils::stringToInteger(optarg);
+				connectionTimeout = i < 0 ? 0 : i;
+				break;
+
+			case '7':
+				i = StringUtils::stringToInteger(optarg);
+				compressionThreshold = i < 0 ? 0 : i;
+				break;
+
 			case '?':
 				if (commandLine) {
 					showUsage = !showUsage;
@@ -728,6 +890,10 @@ void PaloOptions::parseOptions(OptionsIterator& iter, bool commandLine)
 			case 'u':
 			case 'z':
 			case 'Z':
+			case '1':
+			case '4':
+			case '5':
+			case '7':
 				PaloOptions::printError(ErrNumericConversion, optarg);
 				break;
 			case 'x':
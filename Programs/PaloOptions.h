@@ -133,6 +133,12 @@ public:
 
 	double cacheBarrier;
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief maximal number of values cached in all cubes (-G)
+	////////////////////////////////////////////////////////////////////////////////
+
+	double cacheBudget;
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// @brief change into data directory (-C)
 	////////////////////////////////////////////////////////////////////////////////
@@ -397,6 +403,74 @@ public:
 
 	bool saveCSV;
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief save cube storage page-aligned and map it on load
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool mapCubePages;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief number of cube files read in parallel on load (-1)
+	////////////////////////////////////////////////////////////////////////////////
+
+	int loadThreads;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief append changed cube pages to a delta file instead of a full save
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool incrementalSave;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief commits wait until their journal entries are on disk
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool syncJournal;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief cell changes are journaled as binary records
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool binaryJournal;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief maximum number of client connections, 0 for no limit
+	////////////////////////////////////////////////////////////////////////////////
+
+	int connectionLimit;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief seconds after which idle client connections are closed, 0 for never
+	////////////////////////////////////////////////////////////////////////////////
+
+	int connectionTimeout;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief stream large responses with chunked transfer encoding
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool chunkedResponses;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief minimum response size in bytes to compress, 0 for no compression
+	////////////////////////////////////////////////////////////////////////////////
+
+	int compressionThreshold;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief translate hot rules to threaded code
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool compileRules;
+
+#ifdef ENABLE_TEST_MODE
+	////////////////////////////////////////////////////////////////////////////////
+	/// @brief run the engine benchmarks on the loaded databases and exit
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool benchmark;
+#endif
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// @brief default right for database access
 	////////////////////////////////////////////////////////////////////////////////
@@ -51,8 +51,15 @@
 #include "Programs/GpuIdleWorker.h"
 #endif
 
+#ifdef ENABLE_TEST_MODE
+#include "Engine/EngineCpuMT.h"
+#endif
+
 typedef void (*callback)();
 static int startPalo(palo::PaloOptions& options, callback sink);
+#ifdef ENABLE_TEST_MODE
+static int benchmarkPalo(palo::PaloOptions& options);
+#endif
 static void initiatePaloStop();
 #if defined(_MSC_VER)
 static void paloServerSave();
@@ -329,6 +336,35 @@ static int startPalo(PaloOptions& options, callback sink)
 	return result;
 }
 
+#ifdef ENABLE_TEST_MODE
+////////////////////////////////////////////////////////////////////////////////
+/// @brief loads the server and runs the engine benchmarks
+////////////////////////////////////////////////////////////////////////////////
+static int benchmarkPalo(PaloOptions& options)
+{
+	int result = 0;
+	FileName serverFileName(options.dataDirectory, "palo", "csv");
+	try {
+		Server::create(serverFileName);
+		options.updateGlobals();
+		{
+			PaloLoader loader(false, options.dataDirectory);
+
+			loader.load(options.autoLoadDb, options.autoAddDb);
+			loader.finalize(options.useFakeSession);
+		}
+		EngineCpuMT::runBenchmarks();
+	} catch (const ErrorException& e) {
+		Logger::error << "exception '" << e.getMessage() << "' (" << e.getDetails() << ")" << endl;
+		result = 1;
+	}
+
+	Context::reset();
+	Server::destroy();
+	return result;
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief runs palo
 ////////////////////////////////////////////////////////////////////////////////
@@ -407,6 +443,12 @@ static int runPalo(int argc, char* argv[])
 			options.httpsPorts.clear();
 		}
 
+#ifdef ENABLE_TEST_MODE
+		if (options.benchmark) {
+			return benchmarkPalo(options);
+		}
+#endif
+
 #if defined(_MSC_VER)
 		signal(SIGTERM, &signalHandlerSVS);
 